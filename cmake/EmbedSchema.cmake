@@ -0,0 +1,101 @@
+# ============================================================================
+# Встраивание SQL скриптов схемы в исполняемый файл
+# ============================================================================
+#
+# При подключении через include() определяет функцию embed_schema_scripts.
+# В режиме скрипта (cmake -P) генерирует исходный файл с содержимым скриптов
+# и их SHA-256; вызывается из правила сборки, созданного функцией.
+
+# Путь к модулю для вызова в режиме скрипта (CMAKE_CURRENT_FUNCTION_LIST_FILE требует CMake 3.17)
+set(EMBED_SCHEMA_SCRIPT "${CMAKE_CURRENT_LIST_FILE}")
+
+# embed_schema_scripts(<target> BASE_DIR <dir> SCRIPTS <file>...)
+#
+# Добавляет к target сгенерированный SchemaScripts.cpp. Имена скриптов
+# задаются относительно BASE_DIR и сохраняются в журнале миграций;
+# порядок SCRIPTS - порядок применения.
+function(embed_schema_scripts target)
+    cmake_parse_arguments(ARG "" "BASE_DIR" "SCRIPTS" ${ARGN})
+
+    set(output "${CMAKE_CURRENT_BINARY_DIR}/SchemaScripts.cpp")
+    set(dependencies)
+    foreach(script IN LISTS ARG_SCRIPTS)
+        list(APPEND dependencies "${ARG_BASE_DIR}/${script}")
+    endforeach()
+
+    # Точка с запятой в аргументах COMMAND разбивает список, поэтому имена передаются через '|'
+    string(REPLACE ";" "|" scripts "${ARG_SCRIPTS}")
+
+    add_custom_command(
+        OUTPUT "${output}"
+        COMMAND "${CMAKE_COMMAND}"
+            "-DBASE_DIR=${ARG_BASE_DIR}"
+            "-DSCRIPTS=${scripts}"
+            "-DOUTPUT=${output}"
+            -P "${EMBED_SCHEMA_SCRIPT}"
+        DEPENDS ${dependencies} "${EMBED_SCHEMA_SCRIPT}"
+        COMMENT "Embedding schema scripts"
+        VERBATIM
+    )
+
+    target_sources(${target} PRIVATE "${output}")
+endfunction()
+
+if(NOT CMAKE_SCRIPT_MODE_FILE)
+    return()
+endif()
+
+# ============================================================================
+# Генерация SchemaScripts.cpp
+# ============================================================================
+
+string(REPLACE "|" ";" SCRIPTS "${SCRIPTS}")
+
+# 16 байт в строке массива (регулярные выражения CMake не поддерживают {n})
+string(REPEAT "0x[0-9a-f][0-9a-f]," 16 row)
+
+set(arrays "")
+set(entries "")
+set(index 0)
+foreach(script IN LISTS SCRIPTS)
+    set(path "${BASE_DIR}/${script}")
+    file(SHA256 "${path}" checksum)
+
+    # Байтовый массив вместо строкового литерала: не зависит от кодировки
+    # исходника и ограничений компиляторов на длину литерала
+    file(READ "${path}" content HEX)
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," content "${content}")
+    string(REGEX REPLACE "(${row})" "\\1\n    " content "${content}")
+
+    string(APPEND arrays "// ${script}\nconst unsigned char kScript${index}[] = {\n    ${content}0x00};\n\n")
+    string(APPEND entries
+        "    {\"${script}\", {reinterpret_cast<const char*>(kScript${index}), sizeof(kScript${index}) - 1}, "
+        "\"${checksum}\"},\n")
+    math(EXPR index "${index} + 1")
+endforeach()
+
+set(source "// Сгенерировано cmake/EmbedSchema.cmake - не редактировать вручную
+
+#include \"SchemaScripts.h\"
+
+namespace
+{
+${arrays}const db::SchemaScript kScripts[] = {
+${entries}};
+} // namespace
+
+// Встроенные скрипты схемы в порядке применения
+std::span<const db::SchemaScript> db::GetSchemaScripts()
+{
+    return kScripts;
+}
+")
+
+# Файл перезаписывается только при изменении, чтобы не пересобирать библиотеку
+set(current "")
+if(EXISTS "${OUTPUT}")
+    file(READ "${OUTPUT}" current)
+endif()
+if(NOT current STREQUAL source)
+    file(WRITE "${OUTPUT}" "${source}")
+endif()
@@ -397,7 +397,7 @@ BEGIN
             
             -- Если это первое решение с приоритетом 0, проверяем условие
             -- Если условие истинно или это безусловное решение, возвращаем результат
-            IF rec_decision.PRIORITЕТ = 0 OR v_result <> 0 THEN
+            IF rec_decision.PRIORITET = 0 OR v_result <> 0 THEN
                 RETURN v_result;
             END IF;
         EXCEPTION
@@ -413,108 +413,6 @@ $$;
 
 COMMENT ON FUNCTION CASE_ARG IS 'Функция выбора решения по условию (IF-THEN-ELSE)';
 
--- ============================================================================
--- CALC_ORDER_COST - Расчет стоимости заказа по тарифу
--- ============================================================================
-
-CREATE OR REPLACE FUNCTION CALC_ORDER_COST(
-    p_id_order INTEGER,      -- ID заказа
-    p_id_tariff INTEGER DEFAULT NULL  -- ID тарифа (если NULL, используем тариф заказа)
-)
-RETURNS DOUBLE PRECISION
-LANGUAGE plpgsql
-AS $$
-DECLARE
-    v_id_tariff INTEGER;
-    v_id_service_type INTEGER;
-    v_base_cost DOUBLE PRECISION := 0;
-    v_total_cost DOUBLE PRECISION := 0;
-    v_coeff DOUBLE PRECISION := 1.0;
-    v_is_with_vat INTEGER;
-    v_vat_rate DOUBLE PRECISION;
-    rec_rate RECORD;
-    rec_param RECORD;
-    rec_item RECORD;
-    rec_rule RECORD;
-    rec_coeff RECORD;
-BEGIN
-    -- Получаем информацию о заказе
-    SELECT ID_TARIFF, ID_SERVICE_TYPE INTO v_id_tariff, v_id_service_type
-    FROM SERVICE_ORDER
-    WHERE ID_ORDER = p_id_order;
-    
-    IF NOT FOUND THEN
-        RAISE EXCEPTION 'Заказ с ID % не найден', p_id_order;
-    END IF;
-    
-    -- Используем переданный тариф или тариф заказа
-    v_id_tariff := COALESCE(p_id_tariff, v_id_tariff);
-    
-    IF v_id_tariff IS NULL THEN
-        RAISE EXCEPTION 'Для заказа % не указан тариф', p_id_order;
-    END IF;
-    
-    -- Получаем информацию о тарифе
-    SELECT IS_WITH_VAT, VAT_RATE INTO v_is_with_vat, v_vat_rate
-    FROM TARIFF
-    WHERE ID_TARIFF = v_id_tariff;
-    
-    -- Расчет по правилам тарифа
-    FOR rec_rule IN
-        SELECT tr.ID_FUNCT, tr.PRIORITY
-        FROM TARIFF_RULE tr
-        WHERE tr.ID_TARIFF = v_id_tariff AND tr.IS_ACTIVE = 1
-        ORDER BY tr.PRIORITY
-    LOOP
-        BEGIN
-            -- Здесь можно добавить логику вызова правил расчета
-            -- v_base_cost := v_base_cost + CALC_VAL_F(rec_rule.ID_FUNCT, ...);
-            NULL;
-        EXCEPTION
-            WHEN OTHERS THEN
-                CONTINUE;
-        END;
-    END LOOP;
-    
-    -- Расчет по ставкам тарифа
-    FOR rec_rate IN
-        SELECT tr.RATE_VALUE, tr.COD_RATE
-        FROM TARIFF_RATE tr
-        WHERE tr.ID_TARIFF = v_id_tariff
-    LOOP
-        -- Простой расчет: суммируем ставки
-        -- В реальности нужна более сложная логика сопоставления параметров
-        v_base_cost := v_base_cost + rec_rate.RATE_VALUE;
-    END LOOP;
-    
-    -- Применяем повышающие коэффициенты
-    FOR rec_coeff IN
-        SELECT tc.COEFF_VALUE
-        FROM TARIFF_COEFFICIENT tc
-        WHERE tc.ID_TARIFF = v_id_tariff
-    LOOP
-        v_coeff := v_coeff * rec_coeff.COEFF_VALUE;
-    END LOOP;
-    
-    v_total_cost := v_base_cost * v_coeff;
-    
-    -- Учитываем НДС
-    IF v_is_with_vat = 0 THEN
-        -- Тариф без НДС, добавляем НДС
-        v_total_cost := v_total_cost * (1 + v_vat_rate / 100);
-    END IF;
-    
-    -- Обновляем стоимость заказа
-    UPDATE SERVICE_ORDER
-    SET TOTAL_COST = v_total_cost, ID_TARIFF = v_id_tariff
-    WHERE ID_ORDER = p_id_order;
-    
-    RETURN v_total_cost;
-END;
-$$;
-
-COMMENT ON FUNCTION CALC_ORDER_COST IS 'Расчет стоимости заказа по тарифу';
-
 -- ============================================================================
 -- CALC_ORDER_ITEM_COST - Расчет стоимости позиции заказа
 -- ============================================================================
@@ -601,54 +499,6 @@ $$;
 
 COMMENT ON FUNCTION FIND_OPTIMAL_EXECUTOR IS 'Поиск оптимального исполнителя по стоимости для типа услуги';
 
--- ============================================================================
--- FIND_OPTIMAL_TARIFF - Поиск оптимального тарифа для заказа
--- ============================================================================
-
-CREATE OR REPLACE FUNCTION FIND_OPTIMAL_TARIFF(
-    p_id_order INTEGER
-)
-RETURNS TABLE (
-    tariff_id INTEGER,
-    tariff_name VARCHAR,
-    executor_name VARCHAR,
-    estimated_cost DOUBLE PRECISION
-)
-LANGUAGE plpgsql
-AS $$
-DECLARE
-    v_id_service_type INTEGER;
-    v_order_date DATE;
-BEGIN
-    -- Получаем тип услуги и дату заказа
-    SELECT ID_SERVICE_TYPE, EXECUTION_DATE INTO v_id_service_type, v_order_date
-    FROM SERVICE_ORDER
-    WHERE ID_ORDER = p_id_order;
-    
-    IF NOT FOUND THEN
-        RAISE EXCEPTION 'Заказ с ID % не найден', p_id_order;
-    END IF;
-    
-    v_order_date := COALESCE(v_order_date, CURRENT_DATE);
-    
-    RETURN QUERY
-    SELECT 
-        t.ID_TARIFF,
-        t.NAME_TARIFF,
-        COALESCE(e.NAME_EXECUTOR, 'Без исполнителя'::VARCHAR) as executor_name,
-        CALC_ORDER_COST(p_id_order, t.ID_TARIFF) as estimated_cost
-    FROM TARIFF t
-    LEFT JOIN EXECUTOR e ON t.ID_EXECUTOR = e.ID_EXECUTOR
-    WHERE t.IS_ACTIVE = 1
-      AND t.ID_SERVICE_TYPE = v_id_service_type
-      AND t.DATE_BEGIN <= v_order_date
-      AND (t.DATE_END IS NULL OR t.DATE_END >= v_order_date)
-    ORDER BY estimated_cost ASC;
-END;
-$$;
-
-COMMENT ON FUNCTION FIND_OPTIMAL_TARIFF IS 'Поиск оптимального тарифа для заказа';
-
 -- ============================================================================
 -- VALIDATE_ORDER - Валидация заказа
 -- ============================================================================
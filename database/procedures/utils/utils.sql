@@ -191,6 +191,40 @@ $$;
 
 COMMENT ON FUNCTION GET_ALL_SERVICE_TYPES IS 'Получение всех типов услуг';
 
+-- ============================================================================
+-- GET_SERVICE_TYPE - Получение типа услуги по идентификатору
+-- ============================================================================
+-- Колонки как в GET_ALL_SERVICE_TYPES; поиск по первичному ключу
+
+CREATE OR REPLACE FUNCTION GET_SERVICE_TYPE(p_id_service_type INTEGER)
+RETURNS TABLE (
+    id INTEGER,
+    code VARCHAR,
+    name VARCHAR,
+    class_id INTEGER,
+    class_name VARCHAR,
+    note TEXT
+)
+LANGUAGE plpgsql
+STABLE
+AS $$
+BEGIN
+    RETURN QUERY
+    SELECT 
+        st.ID_SERVICE_TYPE,
+        st.COD_SERVICE,
+        st.NAME_SERVICE,
+        st.ID_CLASS,
+        c.NAME_CHEM,
+        st.NOTE
+    FROM SERVICE_TYPE st
+    LEFT JOIN CHEM_CLASS c ON st.ID_CLASS = c.ID_CHEM
+    WHERE st.ID_SERVICE_TYPE = p_id_service_type;
+END;
+$$;
+
+COMMENT ON FUNCTION GET_SERVICE_TYPE IS 'Получение типа услуги по идентификатору';
+
 -- ============================================================================
 -- INS_SERVICE_TYPE - Создание типа услуги
 -- ============================================================================
@@ -357,6 +391,55 @@ $$;
 
 COMMENT ON FUNCTION GET_ALL_EXECUTORS IS 'Получение всех исполнителей';
 
+-- ============================================================================
+-- GET_EXECUTORS_PAGE - Страница исполнителей (keyset-пагинация)
+-- ============================================================================
+-- Порядок как в GET_ALL_EXECUTORS: (NAME_EXECUTOR, ID_EXECUTOR). Следующая
+-- страница начинается после строки (p_after_name, p_after_id) предыдущей;
+-- при p_after_id = NULL возвращается первая страница. Запрос строится
+-- динамически, чтобы для каждого набора фильтров использовался свой индекс
+
+CREATE OR REPLACE FUNCTION GET_EXECUTORS_PAGE(
+    p_limit INTEGER,
+    p_after_name VARCHAR DEFAULT NULL,
+    p_after_id INTEGER DEFAULT NULL,
+    p_is_active INTEGER DEFAULT NULL
+)
+RETURNS TABLE (
+    id INTEGER,
+    code VARCHAR,
+    name VARCHAR,
+    address TEXT,
+    phone VARCHAR,
+    email VARCHAR,
+    is_active INTEGER,
+    note TEXT
+)
+LANGUAGE plpgsql
+STABLE
+AS $$
+DECLARE
+    v_where TEXT := 'TRUE';
+BEGIN
+    IF p_after_id IS NOT NULL THEN
+        v_where := v_where || ' AND (e.NAME_EXECUTOR, e.ID_EXECUTOR) > ($2, $3)';
+    END IF;
+    IF p_is_active IS NOT NULL THEN
+        v_where := v_where || ' AND e.IS_ACTIVE = $4';
+    END IF;
+
+    RETURN QUERY EXECUTE
+        'SELECT e.ID_EXECUTOR, e.COD_EXECUTOR, e.NAME_EXECUTOR, e.ADDRESS, e.PHONE, e.EMAIL, e.IS_ACTIVE, e.NOTE
+         FROM EXECUTOR e
+         WHERE ' || v_where || '
+         ORDER BY e.NAME_EXECUTOR, e.ID_EXECUTOR
+         LIMIT $1'
+    USING p_limit, p_after_name, p_after_id, p_is_active;
+END;
+$$;
+
+COMMENT ON FUNCTION GET_EXECUTORS_PAGE IS 'Страница исполнителей после заданной позиции';
+
 -- ============================================================================
 -- INS_EXECUTOR - Создание исполнителя
 -- ============================================================================
@@ -480,6 +563,123 @@ $$;
 
 COMMENT ON FUNCTION GET_ALL_TARIFFS IS 'Получение всех тарифов';
 
+-- ============================================================================
+-- GET_TARIFF - Получение тарифа по идентификатору
+-- ============================================================================
+-- Колонки как в GET_ALL_TARIFFS; поиск по первичному ключу
+
+CREATE OR REPLACE FUNCTION GET_TARIFF(p_id_tariff INTEGER)
+RETURNS TABLE (
+    id INTEGER,
+    code VARCHAR,
+    name VARCHAR,
+    service_type_id INTEGER,
+    service_name VARCHAR,
+    executor_id INTEGER,
+    executor_name VARCHAR,
+    date_begin TEXT,
+    date_end TEXT,
+    is_with_vat INTEGER,
+    vat_rate DOUBLE PRECISION,
+    is_active INTEGER,
+    note TEXT
+)
+LANGUAGE plpgsql
+STABLE
+AS $$
+BEGIN
+    RETURN QUERY
+    SELECT 
+        t.ID_TARIFF,
+        t.COD_TARIFF,
+        t.NAME_TARIFF,
+        t.ID_SERVICE_TYPE,
+        st.NAME_SERVICE,
+        t.ID_EXECUTOR,
+        e.NAME_EXECUTOR,
+        t.DATE_BEGIN::TEXT,
+        t.DATE_END::TEXT,
+        t.IS_WITH_VAT,
+        t.VAT_RATE,
+        t.IS_ACTIVE,
+        t.NOTE
+    FROM TARIFF t
+    LEFT JOIN SERVICE_TYPE st ON t.ID_SERVICE_TYPE = st.ID_SERVICE_TYPE
+    LEFT JOIN EXECUTOR e ON t.ID_EXECUTOR = e.ID_EXECUTOR
+    WHERE t.ID_TARIFF = p_id_tariff;
+END;
+$$;
+
+COMMENT ON FUNCTION GET_TARIFF IS 'Получение тарифа по идентификатору';
+
+-- ============================================================================
+-- GET_TARIFFS_PAGE - Страница тарифов (keyset-пагинация)
+-- ============================================================================
+-- Порядок как в GET_ALL_TARIFFS: (NAME_TARIFF, ID_TARIFF). p_on_date оставляет
+-- тарифы, действующие на дату. Соединения выполняются только для строк страницы
+
+CREATE OR REPLACE FUNCTION GET_TARIFFS_PAGE(
+    p_limit INTEGER,
+    p_after_name VARCHAR DEFAULT NULL,
+    p_after_id INTEGER DEFAULT NULL,
+    p_id_service_type INTEGER DEFAULT NULL,
+    p_is_active INTEGER DEFAULT NULL,
+    p_on_date DATE DEFAULT NULL
+)
+RETURNS TABLE (
+    id INTEGER,
+    code VARCHAR,
+    name VARCHAR,
+    service_type_id INTEGER,
+    service_name VARCHAR,
+    executor_id INTEGER,
+    executor_name VARCHAR,
+    date_begin TEXT,
+    date_end TEXT,
+    is_with_vat INTEGER,
+    vat_rate DOUBLE PRECISION,
+    is_active INTEGER,
+    note TEXT
+)
+LANGUAGE plpgsql
+STABLE
+AS $$
+DECLARE
+    v_where TEXT := 'TRUE';
+BEGIN
+    IF p_after_id IS NOT NULL THEN
+        v_where := v_where || ' AND (t.NAME_TARIFF, t.ID_TARIFF) > ($2, $3)';
+    END IF;
+    IF p_id_service_type IS NOT NULL THEN
+        v_where := v_where || ' AND t.ID_SERVICE_TYPE = $4';
+    END IF;
+    IF p_is_active IS NOT NULL THEN
+        v_where := v_where || ' AND t.IS_ACTIVE = $5';
+    END IF;
+    IF p_on_date IS NOT NULL THEN
+        v_where := v_where || ' AND (t.DATE_BEGIN IS NULL OR t.DATE_BEGIN <= $6)'
+                           || ' AND (t.DATE_END IS NULL OR t.DATE_END >= $6)';
+    END IF;
+
+    RETURN QUERY EXECUTE
+        'SELECT t.ID_TARIFF, t.COD_TARIFF, t.NAME_TARIFF, t.ID_SERVICE_TYPE, st.NAME_SERVICE,
+                t.ID_EXECUTOR, e.NAME_EXECUTOR, t.DATE_BEGIN::TEXT, t.DATE_END::TEXT,
+                t.IS_WITH_VAT, t.VAT_RATE, t.IS_ACTIVE, t.NOTE
+         FROM (
+             SELECT * FROM TARIFF t
+             WHERE ' || v_where || '
+             ORDER BY t.NAME_TARIFF, t.ID_TARIFF
+             LIMIT $1
+         ) t
+         LEFT JOIN SERVICE_TYPE st ON t.ID_SERVICE_TYPE = st.ID_SERVICE_TYPE
+         LEFT JOIN EXECUTOR e ON t.ID_EXECUTOR = e.ID_EXECUTOR
+         ORDER BY t.NAME_TARIFF, t.ID_TARIFF'
+    USING p_limit, p_after_name, p_after_id, p_id_service_type, p_is_active, p_on_date;
+END;
+$$;
+
+COMMENT ON FUNCTION GET_TARIFFS_PAGE IS 'Страница тарифов после заданной позиции';
+
 -- ============================================================================
 -- INS_TARIFF - Создание тарифа
 -- ============================================================================
@@ -759,6 +959,151 @@ $$;
 
 COMMENT ON FUNCTION GET_ALL_ORDERS IS 'Получение всех заказов';
 
+-- ============================================================================
+-- GET_ORDER - Получение заказа по идентификатору
+-- ============================================================================
+-- Колонки как в GET_ALL_ORDERS; поиск по первичному ключу
+
+CREATE OR REPLACE FUNCTION GET_ORDER(p_id_order INTEGER)
+RETURNS TABLE (
+    id INTEGER,
+    code VARCHAR,
+    service_type_id INTEGER,
+    service_name VARCHAR,
+    order_date TEXT,
+    execution_date TEXT,
+    status INTEGER,
+    status_name VARCHAR,
+    executor_id INTEGER,
+    executor_name VARCHAR,
+    tariff_id INTEGER,
+    tariff_name VARCHAR,
+    total_cost DOUBLE PRECISION,
+    note TEXT
+)
+LANGUAGE plpgsql
+STABLE
+AS $$
+BEGIN
+    RETURN QUERY
+    SELECT 
+        so.ID_ORDER,
+        so.COD_ORDER,
+        so.ID_SERVICE_TYPE,
+        st.NAME_SERVICE,
+        so.ORDER_DATE::TEXT,
+        so.EXECUTION_DATE::TEXT,
+        so.STATUS,
+        CASE so.STATUS
+            WHEN 0 THEN 'Новый'::VARCHAR
+            WHEN 1 THEN 'В работе'::VARCHAR
+            WHEN 2 THEN 'Выполнен'::VARCHAR
+            WHEN 3 THEN 'Отменен'::VARCHAR
+            ELSE 'Неизвестно'::VARCHAR
+        END,
+        so.ID_EXECUTOR,
+        e.NAME_EXECUTOR,
+        so.ID_TARIFF,
+        t.NAME_TARIFF,
+        so.TOTAL_COST,
+        so.NOTE
+    FROM SERVICE_ORDER so
+    LEFT JOIN SERVICE_TYPE st ON so.ID_SERVICE_TYPE = st.ID_SERVICE_TYPE
+    LEFT JOIN EXECUTOR e ON so.ID_EXECUTOR = e.ID_EXECUTOR
+    LEFT JOIN TARIFF t ON so.ID_TARIFF = t.ID_TARIFF
+    WHERE so.ID_ORDER = p_id_order;
+END;
+$$;
+
+COMMENT ON FUNCTION GET_ORDER IS 'Получение заказа по идентификатору';
+
+-- ============================================================================
+-- GET_ORDERS_PAGE - Страница заказов (keyset-пагинация)
+-- ============================================================================
+-- Порядок как в GET_ALL_ORDERS: (ORDER_DATE DESC, ID_ORDER DESC), заказы без
+-- даты - первыми (NULLS FIRST). Следующая страница начинается после строки
+-- (p_after_date, p_after_id) предыдущей; p_after_date = NULL при заданном
+-- p_after_id - позиция среди заказов без даты.
+-- Фильтры: статус, период дат заказа, тип услуги
+
+CREATE OR REPLACE FUNCTION GET_ORDERS_PAGE(
+    p_limit INTEGER,
+    p_after_date DATE DEFAULT NULL,
+    p_after_id INTEGER DEFAULT NULL,
+    p_status INTEGER DEFAULT NULL,
+    p_date_from DATE DEFAULT NULL,
+    p_date_to DATE DEFAULT NULL,
+    p_id_service_type INTEGER DEFAULT NULL
+)
+RETURNS TABLE (
+    id INTEGER,
+    code VARCHAR,
+    service_type_id INTEGER,
+    service_name VARCHAR,
+    order_date TEXT,
+    execution_date TEXT,
+    status INTEGER,
+    status_name VARCHAR,
+    executor_id INTEGER,
+    executor_name VARCHAR,
+    tariff_id INTEGER,
+    tariff_name VARCHAR,
+    total_cost DOUBLE PRECISION,
+    note TEXT
+)
+LANGUAGE plpgsql
+STABLE
+AS $$
+DECLARE
+    v_where TEXT := 'TRUE';
+BEGIN
+    IF p_after_id IS NOT NULL AND p_after_date IS NULL THEN
+        v_where := v_where || ' AND (so.ORDER_DATE IS NOT NULL OR so.ID_ORDER < $3)';
+    ELSIF p_after_id IS NOT NULL THEN
+        -- Заказы без даты предшествуют позиции: для них сравнение не истинно
+        v_where := v_where || ' AND (so.ORDER_DATE, so.ID_ORDER) < ($2, $3)';
+    END IF;
+    IF p_status IS NOT NULL THEN
+        v_where := v_where || ' AND so.STATUS = $4';
+    END IF;
+    IF p_date_from IS NOT NULL THEN
+        v_where := v_where || ' AND so.ORDER_DATE >= $5';
+    END IF;
+    IF p_date_to IS NOT NULL THEN
+        v_where := v_where || ' AND so.ORDER_DATE <= $6';
+    END IF;
+    IF p_id_service_type IS NOT NULL THEN
+        v_where := v_where || ' AND so.ID_SERVICE_TYPE = $7';
+    END IF;
+
+    RETURN QUERY EXECUTE
+        'SELECT so.ID_ORDER, so.COD_ORDER, so.ID_SERVICE_TYPE, st.NAME_SERVICE,
+                so.ORDER_DATE::TEXT, so.EXECUTION_DATE::TEXT, so.STATUS,
+                CASE so.STATUS
+                    WHEN 0 THEN ''Новый''::VARCHAR
+                    WHEN 1 THEN ''В работе''::VARCHAR
+                    WHEN 2 THEN ''Выполнен''::VARCHAR
+                    WHEN 3 THEN ''Отменен''::VARCHAR
+                    ELSE ''Неизвестно''::VARCHAR
+                END,
+                so.ID_EXECUTOR, e.NAME_EXECUTOR, so.ID_TARIFF, t.NAME_TARIFF,
+                so.TOTAL_COST, so.NOTE
+         FROM (
+             SELECT * FROM SERVICE_ORDER so
+             WHERE ' || v_where || '
+             ORDER BY so.ORDER_DATE DESC NULLS FIRST, so.ID_ORDER DESC
+             LIMIT $1
+         ) so
+         LEFT JOIN SERVICE_TYPE st ON so.ID_SERVICE_TYPE = st.ID_SERVICE_TYPE
+         LEFT JOIN EXECUTOR e ON so.ID_EXECUTOR = e.ID_EXECUTOR
+         LEFT JOIN TARIFF t ON so.ID_TARIFF = t.ID_TARIFF
+         ORDER BY so.ORDER_DATE DESC NULLS FIRST, so.ID_ORDER DESC'
+    USING p_limit, p_after_date, p_after_id, p_status, p_date_from, p_date_to, p_id_service_type;
+END;
+$$;
+
+COMMENT ON FUNCTION GET_ORDERS_PAGE IS 'Страница заказов после заданной позиции';
+
 -- ============================================================================
 -- INS_ORDER - Создание заказа
 -- ============================================================================
@@ -923,6 +1268,56 @@ $$;
 
 COMMENT ON FUNCTION GET_ORDER_PARAMS IS 'Получение параметров заказа';
 
+-- ============================================================================
+-- GET_ORDER_PARAMS_BULK - Получение параметров нескольких заказов
+-- ============================================================================
+-- Первые колонки как в GET_ORDER_PARAMS. order_pos - позиция заказа в p_ids
+-- (с 1); строки упорядочены по ней, параметры одного заказа идут подряд
+
+CREATE OR REPLACE FUNCTION GET_ORDER_PARAMS_BULK(p_ids INTEGER[])
+RETURNS TABLE (
+    par_id INTEGER,
+    code VARCHAR,
+    name VARCHAR,
+    type INTEGER,
+    val_num DOUBLE PRECISION,
+    val_str TEXT,
+    val_date TEXT,
+    enum_id INTEGER,
+    enum_name VARCHAR,
+    unit_name VARCHAR,
+    order_id INTEGER,
+    order_pos INTEGER
+)
+LANGUAGE plpgsql
+STABLE
+AS $$
+BEGIN
+    RETURN QUERY
+    SELECT 
+        p.ID_PAR,
+        p.COD_PAR,
+        p.NAME_PAR,
+        p.TYPE_PAR,
+        op.VAL_NUM,
+        op.VAL_STR,
+        op.VAL_DATE::TEXT,
+        op.ID_VAL_ENUM,
+        pe.NAME_POS,
+        e.NAME_EI,
+        op.ID_ORDER,
+        ids.POS::INTEGER
+    FROM UNNEST(p_ids) WITH ORDINALITY AS ids(ID_ORDER, POS)
+    JOIN ORDER_PARAM op ON op.ID_ORDER = ids.ID_ORDER
+    JOIN PARAMETR1 p ON op.ID_PAR = p.ID_PAR
+    LEFT JOIN EI e ON p.EI = e.ID_EI
+    LEFT JOIN POS_ENUM pe ON op.ID_VAL_ENUM = pe.ID_POS_ENUM
+    ORDER BY ids.POS, p.NAME_PAR;
+END;
+$$;
+
+COMMENT ON FUNCTION GET_ORDER_PARAMS_BULK IS 'Получение параметров нескольких заказов';
+
 -- ============================================================================
 -- GET_ALL_COEFFICIENTS - Получение всех коэффициентов
 -- ============================================================================
@@ -1023,79 +1418,120 @@ $$;
 COMMENT ON FUNCTION DEL_COEFFICIENT IS 'Удаление коэффициента';
 
 -- ============================================================================
--- CALC_ORDER_COST - Расчет стоимости заказа
+-- MUL_AGG - Произведение значений (агрегат)
 -- ============================================================================
+-- Пустой набор дает 1; NULL среди значений дает NULL, как при умножении
+-- в цикле. Шаг не строгий: строгая float8mul пропускала бы NULL.
+-- OR REPLACE обновляет и агрегат, созданный ранее с float8mul
 
-CREATE OR REPLACE FUNCTION CALC_ORDER_COST(
+CREATE OR REPLACE FUNCTION MUL_AGG_STEP(
+    p_state DOUBLE PRECISION,
+    p_value DOUBLE PRECISION
+)
+RETURNS DOUBLE PRECISION
+LANGUAGE sql
+IMMUTABLE
+PARALLEL SAFE
+AS $$
+    SELECT p_state * p_value;
+$$;
+
+COMMENT ON FUNCTION MUL_AGG_STEP IS 'Шаг и объединение агрегата MUL_AGG с передачей NULL';
+
+CREATE OR REPLACE AGGREGATE MUL_AGG(DOUBLE PRECISION) (
+    SFUNC = MUL_AGG_STEP,
+    STYPE = DOUBLE PRECISION,
+    COMBINEFUNC = MUL_AGG_STEP,
+    INITCOND = '1',
+    PARALLEL = SAFE
+);
+
+COMMENT ON AGGREGATE MUL_AGG(DOUBLE PRECISION) IS 'Произведение значений; NULL, если среди них есть NULL';
+
+-- ============================================================================
+-- QUOTE_ORDER_COST - Оценка стоимости заказа по тарифу
+-- ============================================================================
+-- Только чтение: заказ не изменяется, поэтому функция подходит для перебора
+-- тарифов, выполнения на реплике и в параллельных процессах. Стоимость -
+-- сумма ставок тарифа (ставка умножается на одноименный числовой параметр
+-- заказа, если он задан), умноженная на коэффициенты тарифа и НДС
+
+CREATE OR REPLACE FUNCTION QUOTE_ORDER_COST(
     p_id_order INTEGER,
     p_id_tariff INTEGER DEFAULT NULL
 )
 RETURNS DOUBLE PRECISION
 LANGUAGE plpgsql
+STABLE
+PARALLEL SAFE
 AS $$
 DECLARE
-    v_tariff_id INTEGER;
-    v_total_cost DOUBLE PRECISION := 0;
-    v_service_type_id INTEGER;
+    v_tariff_id INTEGER := p_id_tariff;
+    v_base_cost DOUBLE PRECISION;
+    v_factor DOUBLE PRECISION;
     v_is_with_vat INTEGER;
     v_vat_rate DOUBLE PRECISION;
-    rec_param RECORD;
-    rec_rate RECORD;
-    v_param_value DOUBLE PRECISION;
 BEGIN
-    -- Получаем ID тарифа (из параметра или из заказа)
-    IF p_id_tariff IS NOT NULL THEN
-        v_tariff_id := p_id_tariff;
-    ELSE
-        SELECT ID_TARIFF, ID_SERVICE_TYPE INTO v_tariff_id, v_service_type_id
+    -- Тариф из параметра или из заказа
+    IF v_tariff_id IS NULL THEN
+        SELECT ID_TARIFF INTO v_tariff_id
         FROM SERVICE_ORDER
         WHERE ID_ORDER = p_id_order;
     END IF;
-    
+
     IF v_tariff_id IS NULL THEN
         RAISE EXCEPTION 'Тариф не указан для заказа %', p_id_order;
     END IF;
-    
-    -- Получаем информацию о тарифе
+
     SELECT IS_WITH_VAT, VAT_RATE INTO v_is_with_vat, v_vat_rate
     FROM TARIFF
     WHERE ID_TARIFF = v_tariff_id;
-    
-    -- Базовый расчет на основе ставок тарифа и параметров заказа
-    FOR rec_rate IN
-        SELECT tr.COD_RATE, tr.RATE_VALUE, tr.ID_CONDITION_ENUM
-        FROM TARIFF_RATE tr
-        WHERE tr.ID_TARIFF = v_tariff_id
-    LOOP
-        -- Ищем соответствующий параметр в заказе
-        SELECT VAL_NUM INTO v_param_value
-        FROM ORDER_PARAM op
-        JOIN PARAMETR1 p ON op.ID_PAR = p.ID_PAR
-        WHERE op.ID_ORDER = p_id_order
-          AND LOWER(p.COD_PAR) = LOWER(rec_rate.COD_RATE);
-        
-        IF v_param_value IS NOT NULL THEN
-            v_total_cost := v_total_cost + (rec_rate.RATE_VALUE * v_param_value);
-        ELSE
-            -- Если параметр не найден, добавляем базовую ставку
-            v_total_cost := v_total_cost + rec_rate.RATE_VALUE;
-        END IF;
-    END LOOP;
-    
-    -- Применяем коэффициенты тарифа
-    FOR rec_param IN
-        SELECT tc.COEFF_VALUE
-        FROM TARIFF_COEFFICIENT tc
-        WHERE tc.ID_TARIFF = v_tariff_id
-    LOOP
-        v_total_cost := v_total_cost * rec_param.COEFF_VALUE;
-    END LOOP;
-    
-    -- Применяем НДС если требуется
+
+    -- Ставки с параметрами заказа (коды сравниваются без учета регистра)
+    SELECT COALESCE(SUM(tr.RATE_VALUE * COALESCE(
+               (SELECT op.VAL_NUM
+                FROM ORDER_PARAM op
+                JOIN PARAMETR1 p ON op.ID_PAR = p.ID_PAR
+                WHERE op.ID_ORDER = p_id_order
+                  AND LOWER(p.COD_PAR) = LOWER(tr.COD_RATE)
+                ORDER BY op.ID_PAR
+                LIMIT 1),
+               1)), 0)
+    INTO v_base_cost
+    FROM TARIFF_RATE tr
+    WHERE tr.ID_TARIFF = v_tariff_id;
+
+    SELECT MUL_AGG(tc.COEFF_VALUE) INTO v_factor
+    FROM TARIFF_COEFFICIENT tc
+    WHERE tc.ID_TARIFF = v_tariff_id;
+
     IF v_is_with_vat = 1 AND v_vat_rate > 0 THEN
-        v_total_cost := v_total_cost * (1 + v_vat_rate / 100);
+        v_factor := v_factor * (1 + v_vat_rate / 100);
     END IF;
-    
+
+    RETURN v_base_cost * v_factor;
+END;
+$$;
+
+COMMENT ON FUNCTION QUOTE_ORDER_COST IS 'Оценка стоимости заказа по тарифу без сохранения';
+
+-- ============================================================================
+-- CALC_ORDER_COST - Расчет стоимости заказа
+-- ============================================================================
+-- Оценка QUOTE_ORDER_COST с сохранением в TOTAL_COST заказа
+
+CREATE OR REPLACE FUNCTION CALC_ORDER_COST(
+    p_id_order INTEGER,
+    p_id_tariff INTEGER DEFAULT NULL
+)
+RETURNS DOUBLE PRECISION
+LANGUAGE plpgsql
+AS $$
+DECLARE
+    v_total_cost DOUBLE PRECISION;
+BEGIN
+    v_total_cost := QUOTE_ORDER_COST(p_id_order, p_id_tariff);
+
     -- Обновляем стоимость в заказе
     UPDATE SERVICE_ORDER
     SET TOTAL_COST = v_total_cost
@@ -1107,6 +1543,122 @@ $$;
 
 COMMENT ON FUNCTION CALC_ORDER_COST IS 'Расчет стоимости заказа по тарифу';
 
+-- ============================================================================
+-- ACCEPT_ORDER_TARIFF - Выбор тарифа для заказа
+-- ============================================================================
+-- Сохраняет выбранный пользователем тариф и его стоимость в заказе
+
+CREATE OR REPLACE FUNCTION ACCEPT_ORDER_TARIFF(
+    p_id_order INTEGER,
+    p_id_tariff INTEGER
+)
+RETURNS DOUBLE PRECISION
+LANGUAGE plpgsql
+AS $$
+DECLARE
+    v_total_cost DOUBLE PRECISION;
+BEGIN
+    IF NOT EXISTS (SELECT 1 FROM SERVICE_ORDER WHERE ID_ORDER = p_id_order) THEN
+        RAISE EXCEPTION 'Заказ с ID % не найден', p_id_order;
+    END IF;
+
+    v_total_cost := QUOTE_ORDER_COST(p_id_order, p_id_tariff);
+
+    UPDATE SERVICE_ORDER
+    SET ID_TARIFF = p_id_tariff,
+        TOTAL_COST = v_total_cost
+    WHERE ID_ORDER = p_id_order;
+
+    RETURN v_total_cost;
+END;
+$$;
+
+COMMENT ON FUNCTION ACCEPT_ORDER_TARIFF IS 'Сохранение выбранного тарифа и стоимости заказа';
+
+-- ============================================================================
+-- CALC_ORDER_COST_BATCH - Расчет стоимости набора заказов
+-- ============================================================================
+-- Та же формула, что в CALC_ORDER_COST, вычисленная одним запросом для всех
+-- заказов: сумма ставок (ставка умножается на одноименный числовой параметр
+-- заказа, если он задан), произведение коэффициентов тарифа и НДС.
+-- p_id_tariff задает тариф для всех заказов, NULL - у каждого заказа свой.
+-- Несуществующие заказы пропускаются
+
+CREATE OR REPLACE FUNCTION CALC_ORDER_COST_BATCH(
+    p_ids INTEGER[],
+    p_id_tariff INTEGER DEFAULT NULL
+)
+RETURNS TABLE (
+    order_id INTEGER,
+    total_cost DOUBLE PRECISION
+)
+LANGUAGE plpgsql
+AS $$
+DECLARE
+    v_id_order INTEGER;
+BEGIN
+    SELECT so.ID_ORDER INTO v_id_order
+    FROM SERVICE_ORDER so
+    WHERE so.ID_ORDER = ANY(p_ids)
+      AND COALESCE(p_id_tariff, so.ID_TARIFF) IS NULL
+    LIMIT 1;
+
+    IF FOUND THEN
+        RAISE EXCEPTION 'Тариф не указан для заказа %', v_id_order;
+    END IF;
+
+    RETURN QUERY
+    WITH orders AS (
+        SELECT so.ID_ORDER, COALESCE(p_id_tariff, so.ID_TARIFF) AS ID_TARIFF
+        FROM SERVICE_ORDER so
+        WHERE so.ID_ORDER = ANY(p_ids)
+    ),
+    order_values AS (
+        -- Числовое значение параметра заказа по коду (коды сравниваются без учета регистра)
+        SELECT DISTINCT ON (op.ID_ORDER, LOWER(p.COD_PAR))
+            op.ID_ORDER, LOWER(p.COD_PAR) AS CODE, op.VAL_NUM
+        FROM ORDER_PARAM op
+        JOIN PARAMETR1 p ON op.ID_PAR = p.ID_PAR
+        WHERE op.ID_ORDER = ANY(p_ids)
+        ORDER BY op.ID_ORDER, LOWER(p.COD_PAR), op.ID_PAR
+    ),
+    base_costs AS (
+        SELECT o.ID_ORDER, SUM(tr.RATE_VALUE * COALESCE(ov.VAL_NUM, 1)) AS COST
+        FROM orders o
+        JOIN TARIFF_RATE tr ON tr.ID_TARIFF = o.ID_TARIFF
+        LEFT JOIN order_values ov ON ov.ID_ORDER = o.ID_ORDER AND ov.CODE = LOWER(tr.COD_RATE)
+        GROUP BY o.ID_ORDER
+    ),
+    factors AS (
+        SELECT tc.ID_TARIFF, MUL_AGG(tc.COEFF_VALUE) AS FACTOR
+        FROM TARIFF_COEFFICIENT tc
+        WHERE tc.ID_TARIFF IN (SELECT o.ID_TARIFF FROM orders o)
+        GROUP BY tc.ID_TARIFF
+    ),
+    costs AS (
+        SELECT o.ID_ORDER,
+               COALESCE(bc.COST, 0) * CASE WHEN f.ID_TARIFF IS NULL THEN 1 ELSE f.FACTOR END
+                   * CASE WHEN t.IS_WITH_VAT = 1 AND t.VAT_RATE > 0 THEN 1 + t.VAT_RATE / 100 ELSE 1 END AS COST
+        FROM orders o
+        LEFT JOIN base_costs bc ON bc.ID_ORDER = o.ID_ORDER
+        LEFT JOIN factors f ON f.ID_TARIFF = o.ID_TARIFF
+        LEFT JOIN TARIFF t ON t.ID_TARIFF = o.ID_TARIFF
+    ),
+    updated AS (
+        UPDATE SERVICE_ORDER so
+        SET TOTAL_COST = c.COST
+        FROM costs c
+        WHERE so.ID_ORDER = c.ID_ORDER
+        RETURNING so.ID_ORDER, so.TOTAL_COST
+    )
+    SELECT u.ID_ORDER, u.TOTAL_COST
+    FROM updated u
+    ORDER BY u.ID_ORDER;
+END;
+$$;
+
+COMMENT ON FUNCTION CALC_ORDER_COST_BATCH IS 'Расчет стоимости набора заказов одним запросом';
+
 -- ============================================================================
 -- CALC_ORDER_ITEM_COST - Расчет стоимости позиции заказа
 -- ============================================================================
@@ -1237,6 +1789,8 @@ RETURNS TABLE (
     estimated_cost DOUBLE PRECISION
 )
 LANGUAGE plpgsql
+STABLE
+PARALLEL SAFE
 AS $$
 DECLARE
     v_service_type_id INTEGER;
@@ -1247,15 +1801,17 @@ BEGIN
     FROM SERVICE_ORDER
     WHERE ID_ORDER = p_id_order;
     
+    IF NOT FOUND THEN
+        RAISE EXCEPTION 'Заказ с ID % не найден', p_id_order;
+    END IF;
+    
+    -- Оценка без сохранения: заказ изменяется только в ACCEPT_ORDER_TARIFF
     RETURN QUERY
     SELECT 
         t.ID_TARIFF,
         t.NAME_TARIFF,
         e.NAME_EXECUTOR,
-        COALESCE(
-            (SELECT SUM(tr.RATE_VALUE) FROM TARIFF_RATE tr WHERE tr.ID_TARIFF = t.ID_TАРИФ),
-            0.0
-        ) AS estimated_cost
+        QUOTE_ORDER_COST(p_id_order, t.ID_TARIFF) AS estimated_cost
     FROM TARIFF t
     LEFT JOIN EXECUTOR e ON t.ID_EXECUTOR = e.ID_EXECUTOR
     WHERE t.ID_SERVICE_TYPE = v_service_type_id
@@ -138,8 +138,15 @@ CREATE INDEX IF NOT EXISTS IDX_SERVICE_TYPE_COD
 -- Индексы для EXECUTOR
 -- ============================================================================
 
-CREATE INDEX IF NOT EXISTS IDX_EXECUTOR_ACTIVE 
-    ON EXECUTOR(IS_ACTIVE);
+-- Постраничная выборка GET_EXECUTORS_PAGE: порядок (NAME_EXECUTOR, ID_EXECUTOR).
+-- Составной индекс по IS_ACTIVE заменяет прежний одноколоночный IDX_EXECUTOR_ACTIVE
+DROP INDEX IF EXISTS IDX_EXECUTOR_ACTIVE;
+
+CREATE INDEX IF NOT EXISTS IDX_EXECUTOR_NAME_ID 
+    ON EXECUTOR(NAME_EXECUTOR, ID_EXECUTOR);
+
+CREATE INDEX IF NOT EXISTS IDX_EXECUTOR_ACTIVE_NAME 
+    ON EXECUTOR(IS_ACTIVE, NAME_EXECUTOR, ID_EXECUTOR);
 
 CREATE INDEX IF NOT EXISTS IDX_EXECUTOR_COD 
     ON EXECUTOR(COD_EXECUTOR);
@@ -148,8 +155,15 @@ CREATE INDEX IF NOT EXISTS IDX_EXECUTOR_COD
 -- Индексы для TARIFF
 -- ============================================================================
 
-CREATE INDEX IF NOT EXISTS IDX_TARIFF_SERVICE_TYPE 
-    ON TARIFF(ID_SERVICE_TYPE);
+-- Постраничная выборка GET_TARIFFS_PAGE: порядок (NAME_TARIFF, ID_TARIFF).
+-- Составной индекс по ID_SERVICE_TYPE заменяет прежний IDX_TARIFF_SERVICE_TYPE
+DROP INDEX IF EXISTS IDX_TARIFF_SERVICE_TYPE;
+
+CREATE INDEX IF NOT EXISTS IDX_TARIFF_NAME_ID 
+    ON TARIFF(NAME_TARIFF, ID_TARIFF);
+
+CREATE INDEX IF NOT EXISTS IDX_TARIFF_SERVICE_TYPE_NAME 
+    ON TARIFF(ID_SERVICE_TYPE, NAME_TARIFF, ID_TARIFF);
 
 CREATE INDEX IF NOT EXISTS IDX_TARIFF_EXECUTOR 
     ON TARIFF(ID_EXECUTOR);
@@ -187,17 +201,27 @@ CREATE INDEX IF NOT EXISTS IDX_TARIFF_RULE_FUNCT
 -- Индексы для SERVICE_ORDER
 -- ============================================================================
 
-CREATE INDEX IF NOT EXISTS IDX_ORDER_SERVICE_TYPE 
-    ON SERVICE_ORDER(ID_SERVICE_TYPE);
+-- Постраничная выборка GET_ORDERS_PAGE: порядок (ORDER_DATE DESC, ID_ORDER DESC),
+-- индексы просматриваются в обратном направлении. Составные индексы заменяют
+-- прежние одноколоночные IDX_ORDER_SERVICE_TYPE, IDX_ORDER_STATUS и IDX_ORDER_DATE:
+-- их столбцы - первые в составных, поэтому условия только по ним (в том числе
+-- проверка внешнего ключа при удалении типа услуги) используют составные индексы.
+-- Остальные запросы к SERVICE_ORDER выбирают заказ по ID_ORDER
+DROP INDEX IF EXISTS IDX_ORDER_SERVICE_TYPE;
+DROP INDEX IF EXISTS IDX_ORDER_STATUS;
+DROP INDEX IF EXISTS IDX_ORDER_DATE;
+
+CREATE INDEX IF NOT EXISTS IDX_ORDER_SERVICE_TYPE_DATE 
+    ON SERVICE_ORDER(ID_SERVICE_TYPE, ORDER_DATE, ID_ORDER);
 
 CREATE INDEX IF NOT EXISTS IDX_ORDER_EXECUTOR 
     ON SERVICE_ORDER(ID_EXECUTOR);
 
-CREATE INDEX IF NOT EXISTS IDX_ORDER_STATUS 
-    ON SERVICE_ORDER(STATUS);
+CREATE INDEX IF NOT EXISTS IDX_ORDER_STATUS_DATE 
+    ON SERVICE_ORDER(STATUS, ORDER_DATE, ID_ORDER);
 
-CREATE INDEX IF NOT EXISTS IDX_ORDER_DATE 
-    ON SERVICE_ORDER(ORDER_DATE);
+CREATE INDEX IF NOT EXISTS IDX_ORDER_DATE_ID 
+    ON SERVICE_ORDER(ORDER_DATE, ID_ORDER);
 
 CREATE INDEX IF NOT EXISTS IDX_ORDER_COD 
     ON SERVICE_ORDER(COD_ORDER);
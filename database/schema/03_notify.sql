@@ -0,0 +1,54 @@
+-- ============================================================================
+-- Уведомления об изменении справочников
+-- СУБД: PostgreSQL 12+
+-- Описание: Триггеры NOTIFY для сброса клиентского кэша справочников и правил
+-- ============================================================================
+
+-- ============================================================================
+-- NOTIFY_DICTIONARY_CHANGED - Уведомление об изменении справочника
+-- ============================================================================
+
+-- Канал tariff_sys_dictionary, в нагрузке - имя измененной таблицы.
+-- Уведомление доставляется слушателям при фиксации транзакции; одинаковые
+-- уведомления одной транзакции сервер объединяет
+CREATE OR REPLACE FUNCTION NOTIFY_DICTIONARY_CHANGED()
+RETURNS TRIGGER
+LANGUAGE plpgsql
+AS $$
+BEGIN
+    PERFORM pg_notify('tariff_sys_dictionary', LOWER(TG_TABLE_NAME));
+    RETURN NULL;
+END;
+$$;
+
+COMMENT ON FUNCTION NOTIFY_DICTIONARY_CHANGED IS 'Уведомление клиентов об изменении справочника';
+
+-- ============================================================================
+-- Триггеры справочников
+-- ============================================================================
+
+-- Триггер на уровне оператора: одно уведомление на команду, а не на строку.
+-- Таблицы правил (funct_r ... const) сбрасывают скомпилированный клиентом
+-- набор правил. Таблицы, отсутствующие в схеме, пропускаются
+DO $$
+DECLARE
+    v_table TEXT;
+BEGIN
+    FOREACH v_table IN ARRAY ARRAY['ei', 'parametr1', 'coefficient', 'enum_val_r', 'pos_enum', 'chem_class',
+                                   'funct_r', 'arg_funct', 'fact_fun', 'fact_par', 'decision_rule', 'const',
+                                   'fun_comp']
+    LOOP
+        IF to_regclass(v_table) IS NOT NULL THEN
+            EXECUTE format('DROP TRIGGER IF EXISTS TRG_%s_NOTIFY ON %I', v_table, v_table);
+            EXECUTE format('CREATE TRIGGER TRG_%s_NOTIFY '
+                           'AFTER INSERT OR UPDATE OR DELETE OR TRUNCATE ON %I '
+                           'FOR EACH STATEMENT EXECUTE FUNCTION NOTIFY_DICTIONARY_CHANGED()',
+                           v_table, v_table);
+        END IF;
+    END LOOP;
+END;
+$$;
+
+-- ============================================================================
+-- Конец скрипта уведомлений
+-- ============================================================================
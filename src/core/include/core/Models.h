@@ -199,6 +199,44 @@ struct Order
     std::vector<OrderParameterValue> parameters;
 };
 
+// Позиция постраничной выборки: ключ сортировки и идентификатор последней строки
+struct PageCursor
+{
+    std::string key;
+    int id = 0;
+};
+
+// Страница списка; next пуст на последней странице
+template <typename T>
+struct Page
+{
+    std::vector<T> items;
+    std::optional<PageCursor> next;
+};
+
+// Фильтр заказов; пустые значения не ограничивают выборку
+struct OrderFilter
+{
+    std::optional<OrderStatus> status;
+    std::string dateFrom;
+    std::string dateTo;
+    std::optional<int> serviceTypeId;
+};
+
+// Фильтр тарифов
+struct TariffFilter
+{
+    std::optional<int> serviceTypeId;
+    std::optional<bool> isActive;
+    std::string onDate; // Тарифы, действующие на дату
+};
+
+// Фильтр исполнителей
+struct ExecutorFilter
+{
+    std::optional<bool> isActive;
+};
+
 // Коэффициент
 struct Coefficient
 {
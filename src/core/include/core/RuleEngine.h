@@ -0,0 +1,364 @@
+#pragma once
+
+#include "Models.h"
+
+#include <db/DbApi.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace core
+{
+
+class RuleSession;
+
+// Параметры пакета заказов по столбцам: для каждого кода - значения всех
+// заказов подряд, чтобы одна команда обрабатывала пакет векторно
+class RuleBatch
+{
+public:
+    explicit RuleBatch(std::size_t size);
+
+    std::size_t GetSize() const;
+
+    // Значение параметра заказа index; коды сравниваются без учета регистра латиницы.
+    // Пустая строка - нет строкового значения
+    void SetParameter(std::size_t index, std::string_view code, std::optional<double> number,
+                      std::string_view text = {});
+    // Все параметры заказа index
+    void SetOrder(std::size_t index, std::span<const OrderParameterValue> parameters);
+    // Числовые значения параметра для всех заказов пакета
+    void SetNumbers(std::string_view code, std::span<const double> values);
+
+private:
+    friend class RuleEngine;
+
+    // Состояние значения: параметр не задан - используется значение константы
+    enum class State : std::uint8_t
+    {
+        Number,
+        Null,
+        Absent
+    };
+
+    struct Column
+    {
+        std::vector<double> numbers;
+        std::vector<State> states;
+        std::vector<std::string> texts; // Пустой, пока нет строковых значений
+    };
+
+    Column& GetColumn(std::string_view code);
+    const Column* FindColumn(const std::string& code) const;
+
+    std::size_t size_;
+    std::map<std::string, Column, std::less<>> columns_; // По коду в нижнем регистре
+};
+
+// Результат вычисления пакета
+struct RuleBatchResult
+{
+    std::vector<std::optional<double>> values;               // NULL и ошибки - std::nullopt
+    std::vector<std::pair<std::size_t, std::string>> errors; // Номер заказа и сообщение
+};
+
+// Исполнитель правил в памяти процесса. Определения FUNCT_R, FACT_FUN,
+// FACT_PAR, DECISION_RULE и CONST загружаются один раз и компилируются
+// в неизменяемый граф выражений, а узел, вычисляемый как корень, - при первом
+// вычислении в программу байт-кода с целочисленными кодами команд и номерами
+// регистров. Вычисление не
+// обращается к БД, не выделяет память (до kInlineRegisters регистров) и дает
+// тот же результат, что CALC_VAL_F (без записи в ROLE_VAL).
+//
+// Аргумент вызова берет значение из VAL_NUM/VAL_STR, как калькулятор в БД.
+// Если оба пусты, используется ссылка: константа (ее заменяет параметр заказа
+// с тем же кодом), результат функции для того же объекта или результат
+// вызова. Объект неизменяем, вычисления из разных потоков безопасны
+class RuleEngine
+{
+public:
+    explicit RuleEngine(const db::RuleSetInfo& rules);
+
+    // Значение функции для объекта, как CALC_VAL_F(functionId, objectId).
+    // parameters - параметры заказа, коды сравниваются без учета регистра латиницы.
+    // std::nullopt - результат NULL; ошибка вычисления - std::runtime_error.
+    // Независимые ветви больших правил вычисляются параллельно, малые - в вызывающем потоке
+    std::optional<double> Evaluate(int functionId, int objectId,
+                                   std::span<const OrderParameterValue> parameters = {}) const;
+
+    // Значение функции для каждого заказа пакета. Команды выполняются над
+    // блоками заказов векторными инструкциями (AVX или SSE2), CASE - выбором
+    // по маске; группы с NULL, ошибками или строками вычисляются поэлементно
+    RuleBatchResult EvaluateBatch(int functionId, int objectId, const RuleBatch& batch) const;
+
+private:
+    friend class RuleSession;
+
+    // Тип функции (FUNCT_R.TYPE_F); Invalid - ссылка, которую нельзя вычислить
+    enum class NodeKind : std::uint8_t
+    {
+        Predicate,
+        Arithmetic,
+        Logic,
+        Case,
+        Invalid
+    };
+
+    // Операция FUNCT_R.OPERATION, разобранная при загрузке
+    enum class Operation : std::uint8_t
+    {
+        Unknown,
+        Less,
+        LessEqual,
+        Equal,
+        GreaterEqual,
+        Greater,
+        NotEqual,
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        And,
+        Or,
+        Not
+    };
+
+    enum class OperandKind : std::uint8_t
+    {
+        Null,
+        Literal, // index в literals_
+        Input,   // index в inputs_
+        Node     // index в nodes_
+    };
+
+    struct Function
+    {
+        int type = 0;
+        Operation operation = Operation::Unknown;
+        std::string text; // Исходная операция для сообщений об ошибках
+    };
+
+    struct Literal
+    {
+        std::optional<double> number;
+        std::optional<std::string> text;
+    };
+
+    // Константа, значение которой может заменить параметр заказа
+    struct Input
+    {
+        std::string code; // В нижнем регистре
+        Literal value;
+    };
+
+    struct Operand
+    {
+        OperandKind kind = OperandKind::Null;
+        std::uint32_t index = 0;
+    };
+
+    struct Decision
+    {
+        std::uint32_t node = 0;
+        bool isUnconditional = false; // PRIORITET = 0
+    };
+
+    // Вызов функции (аргументы operands_[first, first + count)) или выбор
+    // CASE (решения decisions_[first, first + count)); для Invalid first -
+    // индекс сообщения в errors_
+    struct Node
+    {
+        NodeKind kind = NodeKind::Invalid;
+        Operation operation = Operation::Unknown;
+        int functionId = 0;
+        int objectId = 0;
+        std::uint32_t first = 0;
+        std::uint32_t count = 0;
+    };
+
+    // Узел, значение которого зависит от другого узла; isComposition - связь
+    // FUN_COMP, которая не участвует в вычислении
+    struct Dependent
+    {
+        std::uint32_t node = 0;
+        bool isComposition = false;
+    };
+
+    struct Source;
+    struct Machine;
+    struct BatchMachine;
+
+    using CallKey = std::tuple<int, int, int>; // Функция, объект, номер вызова
+
+    // ==================== Байт-код ====================
+
+    // Код команды; операция функции выбирается при компиляции, поэтому
+    // для каждой операции свой обработчик без разбора строк при вычислении
+    enum class Opcode : std::uint8_t
+    {
+        LoadInput, // Значение константы или параметра заказа
+        Fail,      // Ошибка, известная при компиляции
+        Less,
+        LessEqual,
+        Equal,
+        GreaterEqual,
+        Greater,
+        NotEqual,
+        UnknownPredicate,
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        UnknownArithmetic,
+        And,
+        Or,
+        UnknownLogic,
+        Not,
+        Case
+    };
+
+    enum class ErrorCode : std::uint8_t
+    {
+        None,
+        Invalid, // Сообщение в errors_
+        Cycle,
+        UnknownPredicate,
+        UnsupportedForStrings,
+        NotEnoughArguments,
+        UnknownArithmetic,
+        DivisionByZero,
+        Overflow,
+        Underflow,
+        UnknownLogic,
+        IntegerOutOfRange
+    };
+
+    enum class SlotKind : std::uint8_t
+    {
+        Null,
+        Constant, // index в literals_
+        Register, // index регистра программы (в командах узлов - index узла)
+        Input     // index в inputs_ (только в командах узлов)
+    };
+
+    // Операнд команды; для CASE flag - безусловное решение (PRIORITET = 0)
+    struct Slot
+    {
+        SlotKind kind = SlotKind::Null;
+        bool flag = false;
+        std::uint32_t index = 0;
+    };
+
+    // Команда пишет результат в регистр target; операнды - slots[first, first + count).
+    // Для LoadInput first - индекс в inputs_, для Fail node и error задают ошибку
+    struct Instruction
+    {
+        Opcode opcode = Opcode::Fail;
+        ErrorCode error = ErrorCode::None;
+        std::uint32_t target = 0;
+        std::uint32_t first = 0;
+        std::uint32_t count = 0;
+        std::uint32_t node = 0; // Узел графа для сообщений об ошибках
+    };
+
+    // Программа вычисления одного узла: команды в порядке вычисления
+    // и их операнды, результат - в регистре result
+    struct Program
+    {
+        std::vector<Instruction> code;
+        std::vector<Slot> slots;
+        std::uint32_t registers = 0;
+        std::uint32_t result = 0;
+    };
+
+    // Регистр: число, строка (только у констант и параметров) или ошибка
+    struct Register
+    {
+        double number = 0;
+        const std::string* text = nullptr;
+        std::uint32_t node = 0; // Узел, в котором возникла ошибка
+        bool hasNumber = false;
+        ErrorCode error = ErrorCode::None;
+    };
+
+    // Регистров в стеке вычисления; большие программы используют кучу
+    static constexpr std::uint32_t kInlineRegisters = 128;
+    // Программы от kParallelInstructions команд со средней шириной уровня
+    // от kParallelChunk узлов вычисляются параллельно, задача пула - kParallelChunk узлов
+    static constexpr std::uint32_t kParallelInstructions = 4096;
+    static constexpr std::uint32_t kParallelChunk = 128;
+
+    // Узел для CALC_VAL_F(functionId, objectId) с номером вызова numCall;
+    // создается при первом обращении, операнды заполняет Link
+    std::uint32_t ResolveNode(Source& source, int functionId, int objectId, int numCall);
+    std::uint32_t AddInvalidNode(std::string message);
+    void Link(Source& source, std::uint32_t index, int objectId, int callId);
+
+    // Команды узлов (nodeCode_) и граф зависимостей между узлами
+    void BuildNodeCode();
+    void BuildDependencies(const db::RuleSetInfo& rules);
+    static Opcode SelectOpcode(const Node& node);
+
+    // Компиляция узла и всех узлов, от которых он зависит, в программу
+    Program Compile(std::uint32_t root) const;
+    // Программа корня; компилируется при первом обращении и сохраняется
+    const Program& GetProgram(std::uint32_t root) const;
+    std::string FormatError(const Register& value) const;
+
+    // Узел-корень для CALC_VAL_F(functionId, objectId); std::nullopt - CASE
+    // без решений (значение 0). Ошибки поиска - std::runtime_error
+    std::optional<std::uint32_t> FindRoot(int functionId, int objectId) const;
+
+    // Значение константы с учетом параметров заказа
+    Register LoadInput(std::uint32_t input, std::span<const OrderParameterValue> parameters) const;
+    // Команда узла по значениям узлов-операндов values и констант inputs
+    void Execute(std::uint32_t node, const Register* values, const Register* inputs, Register& out) const;
+    // Вычисление корня без циклов по топологическим уровням: узлы уровня
+    // независимы и при достаточной ширине выполняются в общем пуле потоков
+    Register EvaluateParallel(std::uint32_t root, std::span<const OrderParameterValue> parameters) const;
+
+    std::map<int, Function> functions_;
+    std::map<CallKey, std::uint32_t> callNodes_;
+    std::map<std::pair<int, int>, std::uint32_t> caseNodes_;
+
+    std::vector<Node> nodes_;
+    std::vector<Operand> operands_;
+    std::vector<Decision> decisions_;
+    std::vector<Literal> literals_;
+    std::vector<Input> inputs_;
+    std::vector<std::string> errors_;
+
+    // Команда каждого узла с операндами-узлами, по индексу узла
+    std::vector<Instruction> nodeCode_;
+    std::vector<Slot> nodeSlots_;
+
+    // Обратные связи: узлы, зависящие от узла i, -
+    // dependents_[dependentOffsets_[i], dependentOffsets_[i + 1]);
+    // узлы, читающие константу i, - inputDependents_[inputOffsets_[i], inputOffsets_[i + 1])
+    std::vector<std::uint32_t> dependentOffsets_;
+    std::vector<Dependent> dependents_;
+    std::vector<std::uint32_t> inputOffsets_;
+    std::vector<std::uint32_t> inputDependents_;
+    std::vector<bool> isCyclic_; // Узел входит в цикл или зависит от цикла
+    std::vector<std::uint32_t> levels_; // Длина наибольшего пути от узла до листа (без циклов)
+
+    // Программы корней по индексу узла (nullptr - еще не скомпилирована).
+    // Программы только добавляются и не изменяются после публикации
+    mutable std::vector<std::atomic<const Program*>> programs_;
+    mutable std::vector<std::unique_ptr<const Program>> compiled_;
+    mutable std::mutex compileMutex_;
+};
+
+} // namespace core
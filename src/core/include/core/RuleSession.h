@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Models.h"
+#include "RuleEngine.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace core
+{
+
+// Сеанс вычисления правил для одного заказа (например, пока оператор
+// редактирует заказ). Результаты узлов графа правил сохраняются между
+// вычислениями; при изменении параметра сбрасываются только узлы, которые
+// читают совпадающую по коду константу, и узлы, зависящие от них через
+// аргументы, решения DECISION_RULE и связи FUN_COMP. Следующее вычисление
+// пересчитывает лишь сброшенные узлы.
+//
+// Правила берутся из engine на момент открытия сеанса. Методы потокобезопасны
+class RuleSession
+{
+public:
+    RuleSession(std::shared_ptr<const RuleEngine> engine, std::vector<OrderParameterValue> parameters);
+
+    // Значение функции для объекта, как RuleEngine::Evaluate с параметрами сеанса
+    std::optional<double> Evaluate(int functionId, int objectId);
+
+    // Новое значение параметра: замена параметра с тем же parameterId (или кодом,
+    // если parameterId = 0) либо добавление
+    void SetParameter(const OrderParameterValue& parameter);
+    void RemoveParameter(int parameterId);
+
+    std::shared_ptr<const RuleEngine> GetEngine() const;
+
+private:
+    using Register = RuleEngine::Register;
+
+    // Перечитывание констант и сброс узлов, зависящих от изменившихся
+    void Refresh();
+    void Invalidate(std::uint32_t input);
+
+    const Register& EvaluateNode(std::uint32_t node);
+
+    const std::shared_ptr<const RuleEngine> engine_;
+    std::vector<OrderParameterValue> parameters_;
+    std::vector<Register> inputs_; // По индексу константы
+    // Копии строк констант: строки inputs_ указывают в parameters_ и меняются вместе с ними
+    std::vector<std::optional<std::string>> texts_;
+    std::vector<Register> values_; // По индексу узла
+    std::vector<bool> isValid_;
+    std::vector<std::uint32_t> stack_; // Обход узлов при сбросе и вычислении
+    std::mutex mutex_;
+};
+
+} // namespace core
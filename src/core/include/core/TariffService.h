@@ -1,10 +1,16 @@
 #pragma once
 
 #include "Models.h"
+#include "RuleEngine.h"
+#include "RuleSession.h"
 
 #include <db/DbApi.h>
 
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <vector>
 
 namespace core
@@ -13,9 +19,49 @@ namespace core
 class TariffService
 {
 public:
+    // Группа изменений в одной транзакции (одна фиксация вместо фиксации на
+    // каждую операцию). Действует для вызовов сервиса из потока, создавшего
+    // группу; без Commit изменения откатываются при разрушении объекта
+    class Batch
+    {
+    public:
+        Batch(Batch&&) noexcept = default;
+        Batch& operator=(Batch&&) noexcept = default;
+        ~Batch();
+
+        // Выполнение операции в точке сохранения: при ошибке откатывается
+        // только эта операция, текст ошибки сохраняется. Возвращает успешность
+        bool Try(const std::function<void()>& operation);
+
+        // Фиксация всех успешных операций
+        void Commit();
+
+        // Откат всей группы
+        void Rollback();
+
+        // Ошибки операций, откатенных в Try
+        const std::vector<std::string>& GetErrors() const;
+
+    private:
+        friend class TariffService;
+
+        explicit Batch(std::shared_ptr<db::DatabaseManager> db);
+
+        std::shared_ptr<db::DatabaseManager> db_;
+        std::unique_ptr<db::Transaction> transaction_;
+        std::vector<std::string> errors_;
+    };
+
+    // Справочники (единицы измерения, перечисления, классы, параметры,
+    // коэффициенты) и скомпилированные правила кэшируются в памяти и сбрасываются по уведомлениям
+    // об изменении таблиц (LISTEN/NOTIFY). Пока слушатель не подключен,
+    // а также внутри транзакции чтение идет в БД
     explicit TariffService(std::shared_ptr<db::DbApi> api);
     ~TariffService();
 
+    // Начало группы изменений
+    Batch BeginBatch();
+
     // Инициализация схемы БД
     void InitializeDatabase();
 
@@ -58,12 +104,18 @@ public:
 
     // ==================== Исполнители ====================
     std::vector<Executor> GetAllExecutors();
+    Page<Executor> GetExecutorsPage(int pageSize,
+                                    const std::optional<PageCursor>& after = std::nullopt,
+                                    const ExecutorFilter& filter = {});
     Executor CreateExecutor(const Executor& executor);
     void UpdateExecutor(const Executor& executor);
     void DeleteExecutor(int id);
 
     // ==================== Тарифы ====================
     std::vector<Tariff> GetAllTariffs();
+    Page<Tariff> GetTariffsPage(int pageSize,
+                                const std::optional<PageCursor>& after = std::nullopt,
+                                const TariffFilter& filter = {});
     Tariff GetTariff(int id);
     Tariff CreateTariff(const Tariff& tariff);
     void UpdateTariff(const Tariff& tariff);
@@ -75,6 +127,12 @@ public:
 
     // ==================== Заказы ====================
     std::vector<Order> GetAllOrders();
+    // Постраничная выборка заказов (от новых к старым) по позиции последней строки
+    Page<Order> GetOrdersPage(int pageSize,
+                              const std::optional<PageCursor>& after = std::nullopt,
+                              const OrderFilter& filter = {});
+    // Обход всех заказов по мере получения строк, без загрузки списка в память
+    std::size_t ForEachOrder(const std::function<void(const Order&)>& callback);
     Order GetOrder(int id);
     Order CreateOrder(const Order& order);
     void UpdateOrder(const Order& order);
@@ -91,12 +149,46 @@ public:
 
     // ==================== Расчеты ====================
     double CalculateOrderCost(int orderId, std::optional<int> tariffId = std::nullopt);
+    // Оценка стоимости без изменения заказа
+    double QuoteOrderCost(int orderId, std::optional<int> tariffId = std::nullopt);
+    // Сохранение выбранного тарифа и стоимости в заказе
+    double AcceptOrderTariff(int orderId, int tariffId);
     ValidationResult ValidateOrder(int orderId);
+    // Правила калькулятора, скомпилированные для вычисления без обращения к БД
+    std::shared_ptr<const RuleEngine> GetRuleEngine();
+    // Значение функции для объекта с параметрами заказа; ROLE_VAL не изменяется
+    std::optional<double> EvaluateRule(int functionId, int objectId, int orderId);
+    // То же для многих заказов: параметры читаются одним запросом, правило
+    // вычисляется пакетом (результаты в порядке orderIds)
+    RuleBatchResult EvaluateRuleBatch(int functionId, int objectId, std::span<const int> orderIds);
+    // Сеанс пересчета правил для редактируемого заказа: SetOrderParameter и
+    // RemoveOrderParameter передают изменения в открытые сеансы заказа, и
+    // вычисление пересчитывает только зависящие от них узлы. Сеанс использует
+    // правила на момент открытия и видит изменения незафиксированной группы
+    std::shared_ptr<RuleSession> OpenRuleSession(int orderId);
     std::vector<OptimalExecutor> FindOptimalExecutor(int serviceTypeId, const std::string& targetDate = "");
     std::vector<OptimalExecutor> FindOptimalTariff(int orderId);
 
 private:
+    struct DictionaryCache;
+
+    // Можно ли читать справочники из кэша и сохранять в него
+    bool IsCacheUsable() const;
+
+    // Значение из кэша или загруженное load; сохраняется, если за время
+    // загрузки кэш не сбрасывался
+    template <typename T, typename Load>
+    T ReadCached(std::optional<T>& slot, Load load);
+
+    // Открытые сеансы заказа; закрытые удаляются при обращении
+    std::vector<std::shared_ptr<RuleSession>> GetRuleSessions(int orderId);
+
     std::shared_ptr<db::DbApi> api_;
+    std::unique_ptr<DictionaryCache> cache_;
+    std::unique_ptr<db::NotificationListener> listener_; // Разрушается раньше cache_
+
+    std::mutex sessionsMutex_;
+    std::multimap<int, std::weak_ptr<RuleSession>> sessions_; // По ID заказа
 };
 
 } // namespace core
@@ -0,0 +1,1753 @@
+#include "RuleEngine.h"
+
+#include "Simd.h"
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <numeric>
+#include <array>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace core
+{
+
+namespace
+{
+char ToLower(char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+std::string ToLower(std::string_view text)
+{
+    std::string result(text);
+    std::transform(result.begin(), result.end(), result.begin(), [](char c) { return ToLower(c); });
+    return result;
+}
+
+// Сравнение с кодом в нижнем регистре без копирования строки
+bool EqualsLower(std::string_view text, std::string_view lower)
+{
+    return text.size() == lower.size() &&
+           std::equal(text.begin(), text.end(), lower.begin(), [](char c, char l) { return ToLower(c) == l; });
+}
+
+// Сравнение чисел по правилам PostgreSQL: NaN равен NaN и больше любого числа
+int Compare(double left, double right)
+{
+    if (std::isnan(left))
+    {
+        return std::isnan(right) ? 0 : 1;
+    }
+    if (std::isnan(right))
+    {
+        return -1;
+    }
+    return left < right ? -1 : (left > right ? 1 : 0);
+}
+
+// Проверки переполнения операций над DOUBLE PRECISION, как в PostgreSQL
+bool IsOverflow(double result, double left, double right)
+{
+    return std::isinf(result) && !std::isinf(left) && !std::isinf(right);
+}
+
+} // namespace
+
+// Определения из БД, сгруппированные для построения графа
+struct RuleEngine::Source
+{
+    std::map<CallKey, int> calls;    // Ключ вызова -> ID_FACT_FUN
+    std::map<int, CallKey> callKeys; // ID_FACT_FUN -> ключ вызова
+    std::map<int, std::vector<const db::RuleArgumentInfo*>> arguments;
+    std::map<std::pair<int, int>, std::vector<const db::RuleDecisionInfo*>> decisions;
+    std::map<int, std::uint32_t> inputs; // ID_CONST -> индекс в inputs_
+
+    // Созданные узлы без операндов: узел, объект, ID_FACT_FUN (0 - CASE)
+    std::vector<std::tuple<std::uint32_t, int, int>> pending;
+};
+
+RuleEngine::RuleEngine(const db::RuleSetInfo& rules)
+{
+    for (const auto& f : rules.functions)
+    {
+        Function function;
+        function.type = f.type;
+        function.text = f.operation;
+        const auto& op = f.operation;
+        switch (f.type)
+        {
+        case 0:
+            function.operation = op == "<"    ? Operation::Less
+                                 : op == "<=" ? Operation::LessEqual
+                                 : op == "="  ? Operation::Equal
+                                 : op == ">=" ? Operation::GreaterEqual
+                                 : op == ">"  ? Operation::Greater
+                                 : op == "<>" ? Operation::NotEqual
+                                              : Operation::Unknown;
+            break;
+        case 1:
+            function.operation = op == "+"   ? Operation::Add
+                                 : op == "-" ? Operation::Subtract
+                                 : op == "*" ? Operation::Multiply
+                                 : op == "/" ? Operation::Divide
+                                             : Operation::Unknown;
+            break;
+        case 2:
+            function.operation = op == "AND"   ? Operation::And
+                                 : op == "OR"  ? Operation::Or
+                                 : op == "NOT" ? Operation::Not
+                                               : Operation::Unknown;
+            break;
+        default:
+            break;
+        }
+        functions_[f.id] = std::move(function);
+    }
+
+    Source source;
+    for (const auto& call : rules.calls)
+    {
+        CallKey key{call.functionId, call.objectId, call.numCall};
+        source.calls[key] = call.id;
+        source.callKeys[call.id] = key;
+    }
+    for (const auto& argument : rules.arguments)
+    {
+        source.arguments[argument.callId].push_back(&argument);
+    }
+    for (auto& [callId, arguments] : source.arguments)
+    {
+        std::stable_sort(arguments.begin(), arguments.end(), [](const auto* left, const auto* right) {
+            return left->numArg < right->numArg;
+        });
+    }
+
+    // Решения CASE_ARG: по PRIORITET, NULL в конце
+    for (const auto& decision : rules.decisions)
+    {
+        source.decisions[{decision.functionId, decision.objectId}].push_back(&decision);
+    }
+    for (auto& [key, decisions] : source.decisions)
+    {
+        std::stable_sort(decisions.begin(), decisions.end(), [](const auto* left, const auto* right) {
+            if (left->priority.has_value() != right->priority.has_value())
+            {
+                return left->priority.has_value();
+            }
+            return left->priority.value_or(0) < right->priority.value_or(0);
+        });
+    }
+
+    for (const auto& constant : rules.constants)
+    {
+        source.inputs[constant.id] = static_cast<std::uint32_t>(inputs_.size());
+        inputs_.push_back({ToLower(constant.code), {constant.valNum, constant.valStr}});
+    }
+
+    // Узлы для всех вызовов и всех функций выбора; ссылки между ними
+    // создают недостающие узлы по мере связывания
+    for (const auto& call : rules.calls)
+    {
+        ResolveNode(source, call.functionId, call.objectId, call.numCall);
+    }
+    for (const auto& [key, decisions] : source.decisions)
+    {
+        auto function = functions_.find(key.first);
+        if (function != functions_.end() && function->second.type == 3)
+        {
+            ResolveNode(source, key.first, key.second, 1);
+        }
+    }
+    while (!source.pending.empty())
+    {
+        auto [index, objectId, callId] = source.pending.back();
+        source.pending.pop_back();
+        Link(source, index, objectId, callId);
+    }
+
+    BuildNodeCode();
+    BuildDependencies(rules);
+
+    // Программа включает все узлы, от которых зависит корень, поэтому
+    // компилируются только вычисляемые корни: на цепочке из N функций
+    // компиляция всех узлов заняла бы O(N^2) команд
+    programs_ = std::vector<std::atomic<const Program*>>(nodes_.size());
+}
+
+std::uint32_t RuleEngine::ResolveNode(Source& source, int functionId, int objectId, int numCall)
+{
+    auto function = functions_.find(functionId);
+    if (function == functions_.end())
+    {
+        return AddInvalidNode("Функция с ID " + std::to_string(functionId) + " не найдена");
+    }
+
+    int type = function->second.type;
+    if (type == 3)
+    {
+        // CASE_ARG не различает номера вызовов
+        auto [it, inserted] = caseNodes_.try_emplace({functionId, objectId}, 0);
+        if (inserted)
+        {
+            it->second = static_cast<std::uint32_t>(nodes_.size());
+            nodes_.push_back({NodeKind::Case, Operation::Unknown, functionId, objectId, 0, 0});
+            source.pending.emplace_back(it->second, objectId, 0);
+        }
+        return it->second;
+    }
+    if (type < 0 || type > 3)
+    {
+        return AddInvalidNode("Неизвестный тип функции: " + std::to_string(type));
+    }
+
+    CallKey key{functionId, objectId, numCall};
+    auto call = source.calls.find(key);
+    if (call == source.calls.end())
+    {
+        return AddInvalidNode("Вызов функции " + std::to_string(functionId) + " для объекта " +
+                              std::to_string(objectId) + " не найден");
+    }
+
+    auto [it, inserted] = callNodes_.try_emplace(key, 0);
+    if (inserted)
+    {
+        static constexpr NodeKind kKinds[] = {NodeKind::Predicate, NodeKind::Arithmetic, NodeKind::Logic};
+        it->second = static_cast<std::uint32_t>(nodes_.size());
+        nodes_.push_back({kKinds[type], function->second.operation, functionId, objectId, 0, 0});
+        source.pending.emplace_back(it->second, objectId, call->second);
+    }
+    return it->second;
+}
+
+std::uint32_t RuleEngine::AddInvalidNode(std::string message)
+{
+    auto index = static_cast<std::uint32_t>(nodes_.size());
+    nodes_.push_back({NodeKind::Invalid, Operation::Unknown, 0, 0, static_cast<std::uint32_t>(errors_.size()), 0});
+    errors_.push_back(std::move(message));
+    return index;
+}
+
+void RuleEngine::Link(Source& source, std::uint32_t index, int objectId, int callId)
+{
+    // ResolveNode добавляет только узлы, поэтому операнды и решения узла
+    // занимают непрерывный диапазон
+    if (callId == 0)
+    {
+        auto first = static_cast<std::uint32_t>(decisions_.size());
+        auto decisions = source.decisions.find({nodes_[index].functionId, objectId});
+        if (decisions != source.decisions.end())
+        {
+            for (const auto* decision : decisions->second)
+            {
+                std::uint32_t node = ResolveNode(source, decision->decisionFunctionId, objectId, 1);
+                decisions_.push_back({node, decision->priority == 0});
+            }
+        }
+        nodes_[index].first = first;
+        nodes_[index].count = static_cast<std::uint32_t>(decisions_.size()) - first;
+        return;
+    }
+
+    auto first = static_cast<std::uint32_t>(operands_.size());
+    auto arguments = source.arguments.find(callId);
+    if (arguments != source.arguments.end())
+    {
+        for (const auto* argument : arguments->second)
+        {
+            Operand operand;
+            if (argument->valNum || argument->valStr)
+            {
+                operand = {OperandKind::Literal, static_cast<std::uint32_t>(literals_.size())};
+                literals_.push_back({argument->valNum, argument->valStr});
+            }
+            else if (argument->constId)
+            {
+                auto input = source.inputs.find(*argument->constId);
+                if (input != source.inputs.end())
+                {
+                    operand = {OperandKind::Input, input->second};
+                }
+            }
+            else if (argument->valCallId)
+            {
+                auto key = source.callKeys.find(*argument->valCallId);
+                if (key != source.callKeys.end())
+                {
+                    auto [functionId, callObjectId, numCall] = key->second;
+                    operand = {OperandKind::Node, ResolveNode(source, functionId, callObjectId, numCall)};
+                }
+            }
+            else if (argument->valFunctionId)
+            {
+                operand = {OperandKind::Node, ResolveNode(source, *argument->valFunctionId, objectId, 1)};
+            }
+            operands_.push_back(operand);
+        }
+    }
+    nodes_[index].first = first;
+    nodes_[index].count = static_cast<std::uint32_t>(operands_.size()) - first;
+}
+
+// ==================== Компиляция ====================
+
+void RuleEngine::BuildNodeCode()
+{
+    nodeCode_.reserve(nodes_.size());
+    for (std::uint32_t index = 0; index < nodes_.size(); ++index)
+    {
+        const Node& node = nodes_[index];
+        Instruction instruction;
+        instruction.target = index;
+        instruction.node = index;
+        instruction.first = static_cast<std::uint32_t>(nodeSlots_.size());
+        switch (node.kind)
+        {
+        case NodeKind::Invalid:
+            instruction.error = ErrorCode::Invalid;
+            break;
+        case NodeKind::Case:
+            instruction.opcode = Opcode::Case;
+            for (std::uint32_t i = 0; i < node.count; ++i)
+            {
+                const Decision& decision = decisions_[node.first + i];
+                nodeSlots_.push_back({SlotKind::Register, decision.isUnconditional, decision.node});
+            }
+            break;
+        default:
+        {
+            instruction.opcode = SelectOpcode(node);
+            // Предикат сравнивает первые два аргумента, NOT использует первый
+            std::uint32_t count = node.count;
+            if (node.kind == NodeKind::Predicate || node.operation == Operation::Not)
+            {
+                count = std::min(count, node.kind == NodeKind::Predicate ? 2u : 1u);
+            }
+            for (std::uint32_t i = 0; i < count; ++i)
+            {
+                const Operand& operand = operands_[node.first + i];
+                switch (operand.kind)
+                {
+                case OperandKind::Null:
+                    nodeSlots_.push_back({});
+                    break;
+                case OperandKind::Literal:
+                    nodeSlots_.push_back({SlotKind::Constant, false, operand.index});
+                    break;
+                case OperandKind::Input:
+                    nodeSlots_.push_back({SlotKind::Input, false, operand.index});
+                    break;
+                case OperandKind::Node:
+                    nodeSlots_.push_back({SlotKind::Register, false, operand.index});
+                    break;
+                }
+            }
+            break;
+        }
+        }
+        instruction.count = static_cast<std::uint32_t>(nodeSlots_.size()) - instruction.first;
+        nodeCode_.push_back(instruction);
+    }
+}
+
+// Обратные связи для сброса результатов: операнды и решения узлов, а также
+// FUN_COMP - композитная функция зависит от компонента для того же объекта.
+// Узлы, которые нельзя упорядочить (алгоритм Кана), входят в цикл или
+// зависят от него
+void RuleEngine::BuildDependencies(const db::RuleSetInfo& rules)
+{
+    std::vector<std::pair<std::uint32_t, Dependent>> edges;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> inputEdges;
+    std::vector<std::uint32_t> pending(nodes_.size(), 0); // Неупорядоченные операнды узла
+    for (std::uint32_t index = 0; index < nodes_.size(); ++index)
+    {
+        const Instruction& instruction = nodeCode_[index];
+        for (std::uint32_t i = 0; i < instruction.count; ++i)
+        {
+            const Slot& slot = nodeSlots_[instruction.first + i];
+            if (slot.kind == SlotKind::Register)
+            {
+                edges.push_back({slot.index, {index, false}});
+                ++pending[index];
+            }
+            else if (slot.kind == SlotKind::Input)
+            {
+                inputEdges.emplace_back(slot.index, index);
+            }
+        }
+    }
+
+    std::map<int, std::vector<std::uint32_t>> functionNodes;
+    for (std::uint32_t index = 0; index < nodes_.size(); ++index)
+    {
+        if (nodes_[index].kind != NodeKind::Invalid)
+        {
+            functionNodes[nodes_[index].functionId].push_back(index);
+        }
+    }
+    for (const auto& composition : rules.compositions)
+    {
+        auto composites = functionNodes.find(composition.functionId);
+        auto components = functionNodes.find(composition.componentId);
+        if (composites == functionNodes.end() || components == functionNodes.end())
+        {
+            continue;
+        }
+        for (std::uint32_t component : components->second)
+        {
+            for (std::uint32_t composite : composites->second)
+            {
+                if (nodes_[composite].objectId == nodes_[component].objectId && composite != component)
+                {
+                    edges.push_back({component, {composite, true}});
+                }
+            }
+        }
+    }
+
+    std::stable_sort(edges.begin(), edges.end(), [](const auto& left, const auto& right) {
+        return left.first < right.first;
+    });
+    dependentOffsets_.assign(nodes_.size() + 1, 0);
+    for (const auto& [node, dependent] : edges)
+    {
+        ++dependentOffsets_[node + 1];
+        dependents_.push_back(dependent);
+    }
+    std::partial_sum(dependentOffsets_.begin(), dependentOffsets_.end(), dependentOffsets_.begin());
+
+    std::stable_sort(inputEdges.begin(), inputEdges.end(), [](const auto& left, const auto& right) {
+        return left.first < right.first;
+    });
+    inputOffsets_.assign(inputs_.size() + 1, 0);
+    for (const auto& [input, node] : inputEdges)
+    {
+        ++inputOffsets_[input + 1];
+        inputDependents_.push_back(node);
+    }
+    std::partial_sum(inputOffsets_.begin(), inputOffsets_.end(), inputOffsets_.begin());
+
+    // Сортировка Кана: уровень узла на 1 больше наибольшего уровня его операндов,
+    // узлы, оставшиеся неупорядоченными, лежат в цикле или зависят от него
+    levels_.assign(nodes_.size(), 0);
+    std::vector<std::uint32_t> ready;
+    for (std::uint32_t index = 0; index < nodes_.size(); ++index)
+    {
+        if (pending[index] == 0)
+        {
+            ready.push_back(index);
+        }
+    }
+    while (!ready.empty())
+    {
+        std::uint32_t node = ready.back();
+        ready.pop_back();
+        for (std::uint32_t i = dependentOffsets_[node]; i < dependentOffsets_[node + 1]; ++i)
+        {
+            const Dependent& dependent = dependents_[i];
+            if (dependent.isComposition)
+            {
+                continue;
+            }
+            levels_[dependent.node] = std::max(levels_[dependent.node], levels_[node] + 1);
+            if (--pending[dependent.node] == 0)
+            {
+                ready.push_back(dependent.node);
+            }
+        }
+    }
+    isCyclic_.resize(nodes_.size());
+    for (std::uint32_t index = 0; index < nodes_.size(); ++index)
+    {
+        isCyclic_[index] = pending[index] > 0;
+    }
+}
+
+RuleEngine::Opcode RuleEngine::SelectOpcode(const Node& node)
+{
+    switch (node.operation)
+    {
+    case Operation::Less:
+        return Opcode::Less;
+    case Operation::LessEqual:
+        return Opcode::LessEqual;
+    case Operation::Equal:
+        return Opcode::Equal;
+    case Operation::GreaterEqual:
+        return Opcode::GreaterEqual;
+    case Operation::Greater:
+        return Opcode::Greater;
+    case Operation::NotEqual:
+        return Opcode::NotEqual;
+    case Operation::Add:
+        return Opcode::Add;
+    case Operation::Subtract:
+        return Opcode::Subtract;
+    case Operation::Multiply:
+        return Opcode::Multiply;
+    case Operation::Divide:
+        return Opcode::Divide;
+    case Operation::And:
+        return Opcode::And;
+    case Operation::Or:
+        return Opcode::Or;
+    case Operation::Not:
+        return Opcode::Not;
+    case Operation::Unknown:
+        break;
+    }
+    return node.kind == NodeKind::Predicate    ? Opcode::UnknownPredicate
+           : node.kind == NodeKind::Arithmetic ? Opcode::UnknownArithmetic
+                                               : Opcode::UnknownLogic;
+}
+
+// Узлы, достижимые из корня, выкладываются в порядке обхода в глубину, как их
+// вычислял бы CALC_VAL_F; каждый узел вычисляется один раз. Ошибка хранится
+// в регистре и передается зависимым узлам, поэтому CASE пропускает решения
+// с ошибкой так же, как CASE_ARG. Ссылка на узел, вычисление которого еще
+// не завершено, компилируется в ошибку циклической ссылки
+RuleEngine::Program RuleEngine::Compile(std::uint32_t root) const
+{
+    // Обход без рекурсии: глубина графа ограничена только данными
+    struct Frame
+    {
+        std::uint32_t node = 0;
+        Instruction instruction;
+        std::size_t slots = 0; // Начало операндов узла в pending
+        std::uint32_t next = 0;
+    };
+
+    Program program;
+    std::unordered_map<std::uint32_t, std::uint32_t> nodes;  // Узел -> регистр
+    std::unordered_map<std::uint32_t, std::uint32_t> inputs; // Константа -> регистр
+    std::unordered_set<std::uint32_t> active;
+    std::vector<Frame> frames;
+    std::vector<Slot> pending; // Операнды узлов в frames
+
+    // Регистр узла, если он уже вычислен или образует цикл; иначе узел
+    // открывается для обхода операндов
+    auto enter = [&](std::uint32_t index) -> std::optional<std::uint32_t> {
+        if (auto it = nodes.find(index); it != nodes.end())
+        {
+            return it->second;
+        }
+        if (active.count(index))
+        {
+            program.code.push_back({Opcode::Fail, ErrorCode::Cycle, program.registers, 0, 0, index});
+            return program.registers++;
+        }
+        active.insert(index);
+        const Instruction& instruction = nodeCode_[index];
+        frames.push_back({index, instruction, pending.size(), 0});
+        pending.insert(pending.end(), nodeSlots_.begin() + instruction.first,
+                       nodeSlots_.begin() + instruction.first + instruction.count);
+        return std::nullopt;
+    };
+
+    std::optional<std::uint32_t> result = enter(root);
+    while (!frames.empty())
+    {
+        // Операнды-узлы и константы заменяются регистрами программы
+        Frame& frame = frames.back();
+        if (frame.next < frame.instruction.count)
+        {
+            Slot& slot = pending[frame.slots + frame.next];
+            if (slot.kind == SlotKind::Register)
+            {
+                std::uint32_t node = slot.index;
+                result = enter(node);
+                if (!result)
+                {
+                    continue; // Регистр запишет завершение узла
+                }
+                pending[frame.slots + frame.next].index = *result;
+            }
+            else if (slot.kind == SlotKind::Input)
+            {
+                auto [it, inserted] = inputs.try_emplace(slot.index, program.registers);
+                if (inserted)
+                {
+                    program.code.push_back({Opcode::LoadInput, ErrorCode::None, program.registers++, slot.index, 0, 0});
+                }
+                slot = {SlotKind::Register, false, it->second};
+            }
+            ++frame.next;
+            continue;
+        }
+
+        Instruction instruction = frame.instruction;
+        instruction.first = static_cast<std::uint32_t>(program.slots.size());
+        instruction.target = program.registers++;
+        program.slots.insert(program.slots.end(), pending.begin() + frame.slots, pending.end());
+        program.code.push_back(instruction);
+        pending.resize(frame.slots);
+        active.erase(frame.node);
+        nodes.emplace(frame.node, instruction.target);
+        frames.pop_back();
+
+        result = instruction.target;
+        if (!frames.empty())
+        {
+            Frame& parent = frames.back();
+            pending[parent.slots + parent.next++].index = instruction.target;
+        }
+    }
+
+    program.result = *result;
+    return program;
+}
+
+const RuleEngine::Program& RuleEngine::GetProgram(std::uint32_t root) const
+{
+    if (const Program* program = programs_[root].load(std::memory_order_acquire))
+    {
+        return *program;
+    }
+
+    std::lock_guard lock(compileMutex_);
+    if (const Program* program = programs_[root].load(std::memory_order_relaxed))
+    {
+        return *program;
+    }
+    compiled_.push_back(std::make_unique<const Program>(Compile(root)));
+    programs_[root].store(compiled_.back().get(), std::memory_order_release);
+    return *compiled_.back();
+}
+
+// ==================== Исполнение ====================
+
+// Интерпретатор байт-кода: один проход по командам программы, регистры
+// выделяет вызывающий
+struct RuleEngine::Machine
+{
+    const RuleEngine& engine;
+    std::span<const OrderParameterValue> parameters;
+    Register* registers;
+
+    void Run(const Program& program)
+    {
+        const Instruction* instruction = program.code.data();
+        const Instruction* end = instruction + program.code.size();
+        for (; instruction != end; ++instruction)
+        {
+            if (instruction->opcode == Opcode::LoadInput)
+            {
+                LoadInput(*instruction);
+                continue;
+            }
+            const Slot* slots = program.slots.data() + instruction->first;
+            Apply(*instruction, slots, [&](std::uint32_t i) { return Read(slots[i]); }, registers[instruction->target]);
+        }
+    }
+
+    // Выполнение команды (кроме LoadInput) с операндами slots; read(i) - значение
+    // i-го операнда. Используется и для пакета, и для команд узлов
+    template <typename Read>
+    static void Apply(const Instruction& instruction, const Slot* slots, const Read& read, Register& out)
+    {
+        switch (instruction.opcode)
+        {
+        case Opcode::LoadInput:
+        case Opcode::Fail:
+            SetError(out, instruction.error, instruction.node);
+            break;
+        case Opcode::Less:
+            Predicate<Opcode::Less>(read, instruction, out);
+            break;
+        case Opcode::LessEqual:
+            Predicate<Opcode::LessEqual>(read, instruction, out);
+            break;
+        case Opcode::Equal:
+            Predicate<Opcode::Equal>(read, instruction, out);
+            break;
+        case Opcode::GreaterEqual:
+            Predicate<Opcode::GreaterEqual>(read, instruction, out);
+            break;
+        case Opcode::Greater:
+            Predicate<Opcode::Greater>(read, instruction, out);
+            break;
+        case Opcode::NotEqual:
+            Predicate<Opcode::NotEqual>(read, instruction, out);
+            break;
+        case Opcode::UnknownPredicate:
+            Predicate<Opcode::UnknownPredicate>(read, instruction, out);
+            break;
+        case Opcode::Add:
+            Arithmetic<Opcode::Add>(read, instruction, out);
+            break;
+        case Opcode::Subtract:
+            Arithmetic<Opcode::Subtract>(read, instruction, out);
+            break;
+        case Opcode::Multiply:
+            Arithmetic<Opcode::Multiply>(read, instruction, out);
+            break;
+        case Opcode::Divide:
+            Arithmetic<Opcode::Divide>(read, instruction, out);
+            break;
+        case Opcode::UnknownArithmetic:
+            Arithmetic<Opcode::UnknownArithmetic>(read, instruction, out);
+            break;
+        case Opcode::And:
+            Logic<Opcode::And>(read, instruction, out);
+            break;
+        case Opcode::Or:
+            Logic<Opcode::Or>(read, instruction, out);
+            break;
+        case Opcode::UnknownLogic:
+            Logic<Opcode::UnknownLogic>(read, instruction, out);
+            break;
+        case Opcode::Not:
+            Logic<Opcode::Not>(read, instruction, out);
+            break;
+        case Opcode::Case:
+            Case(slots, read, instruction, out);
+            break;
+        }
+    }
+
+    static void SetNumber(Register& out, double value)
+    {
+        out = {value, nullptr, 0, true, ErrorCode::None};
+    }
+
+    static void SetNull(Register& out)
+    {
+        out = {};
+    }
+
+    static void SetError(Register& out, ErrorCode error, std::uint32_t node)
+    {
+        out = {0, nullptr, node, false, error};
+    }
+
+    static Register ReadLiteral(const Literal& literal)
+    {
+        return {literal.number.value_or(0), literal.text ? &*literal.text : nullptr, 0, literal.number.has_value(),
+                ErrorCode::None};
+    }
+
+    Register Read(const Slot& slot) const
+    {
+        switch (slot.kind)
+        {
+        case SlotKind::Constant:
+            return ReadLiteral(engine.literals_[slot.index]);
+        case SlotKind::Register:
+            return registers[slot.index];
+        case SlotKind::Null:
+        case SlotKind::Input:
+            break;
+        }
+        return {};
+    }
+
+    void LoadInput(const Instruction& instruction)
+    {
+        registers[instruction.target] = engine.LoadInput(instruction.first, parameters);
+    }
+
+    // CALC_PRED: сравнение первых двух аргументов, чисел или строк
+    template <Opcode Op, typename Read>
+    static void Predicate(const Read& read, const Instruction& instruction, Register& out)
+    {
+        Register left = instruction.count > 0 ? read(0) : Register{};
+        if (left.error != ErrorCode::None)
+        {
+            return SetError(out, left.error, left.node);
+        }
+        Register right = instruction.count > 1 ? read(1) : Register{};
+        if (right.error != ErrorCode::None)
+        {
+            return SetError(out, right.error, right.node);
+        }
+
+        bool value = false;
+        if (left.hasNumber && right.hasNumber)
+        {
+            int order = Compare(left.number, right.number);
+            if constexpr (Op == Opcode::Less)
+            {
+                value = order < 0;
+            }
+            else if constexpr (Op == Opcode::LessEqual)
+            {
+                value = order <= 0;
+            }
+            else if constexpr (Op == Opcode::Equal)
+            {
+                value = order == 0;
+            }
+            else if constexpr (Op == Opcode::GreaterEqual)
+            {
+                value = order >= 0;
+            }
+            else if constexpr (Op == Opcode::Greater)
+            {
+                value = order > 0;
+            }
+            else
+            {
+                return SetError(out, ErrorCode::UnknownPredicate, instruction.node);
+            }
+        }
+        else if (left.text && right.text)
+        {
+            if constexpr (Op == Opcode::Equal)
+            {
+                value = *left.text == *right.text;
+            }
+            else if constexpr (Op == Opcode::NotEqual)
+            {
+                value = *left.text != *right.text;
+            }
+            else
+            {
+                return SetError(out, ErrorCode::UnsupportedForStrings, instruction.node);
+            }
+        }
+        else
+        {
+            return SetError(out, ErrorCode::NotEnoughArguments, instruction.node);
+        }
+        SetNumber(out, value ? 1.0 : 0.0);
+    }
+
+    // CALC_AR: левая свертка аргументов операцией; NULL делает результат NULL.
+    // Переполнение проверяется, как для DOUBLE PRECISION в PostgreSQL
+    template <Opcode Op, typename Read>
+    static void Arithmetic(const Read& read, const Instruction& instruction, Register& out)
+    {
+        bool hasValue = true;
+        double value = 0;
+        for (std::uint32_t i = 0; i < instruction.count; ++i)
+        {
+            Register argument = read(i);
+            if (argument.error != ErrorCode::None)
+            {
+                return SetError(out, argument.error, argument.node);
+            }
+            if (i == 0)
+            {
+                hasValue = argument.hasNumber;
+                value = argument.number;
+                continue;
+            }
+
+            if constexpr (Op == Opcode::UnknownArithmetic)
+            {
+                return SetError(out, ErrorCode::UnknownArithmetic, instruction.node);
+            }
+            if constexpr (Op == Opcode::Divide)
+            {
+                if (argument.hasNumber && argument.number == 0)
+                {
+                    return SetError(out, ErrorCode::DivisionByZero, instruction.node);
+                }
+            }
+            if (!hasValue || !argument.hasNumber)
+            {
+                hasValue = false;
+                continue;
+            }
+
+            double left = value;
+            double right = argument.number;
+            if constexpr (Op == Opcode::Add)
+            {
+                value = left + right;
+            }
+            else if constexpr (Op == Opcode::Subtract)
+            {
+                value = left - right;
+            }
+            else if constexpr (Op == Opcode::Multiply)
+            {
+                value = left * right;
+                if (value == 0 && left != 0 && right != 0)
+                {
+                    return SetError(out, ErrorCode::Underflow, instruction.node);
+                }
+            }
+            else if constexpr (Op == Opcode::Divide)
+            {
+                value = left / right;
+                if (value == 0 && left != 0 && !std::isinf(right))
+                {
+                    return SetError(out, ErrorCode::Underflow, instruction.node);
+                }
+            }
+            if (IsOverflow(value, left, right))
+            {
+                return SetError(out, ErrorCode::Overflow, instruction.node);
+            }
+        }
+
+        if (hasValue)
+        {
+            SetNumber(out, value);
+        }
+        else
+        {
+            SetNull(out);
+        }
+    }
+
+    // CALC_LOG: аргумент истинен, если VAL_NUM::INTEGER = 1; логика трехзначная,
+    // как в SQL. CALC_VAL_F превращает NULL в 0
+    template <Opcode Op, typename Read>
+    static void Logic(const Read& read, const Instruction& instruction, Register& out)
+    {
+        // Трехзначная логика: -1 - NULL, 0 - ложь, 1 - истина
+        int value = -1;
+        for (std::uint32_t i = 0; i < instruction.count; ++i)
+        {
+            Register argument = read(i);
+            if (argument.error != ErrorCode::None)
+            {
+                return SetError(out, argument.error, argument.node);
+            }
+
+            int operand = -1;
+            if (argument.hasNumber)
+            {
+                // Приведение к INTEGER округляет до ближайшего четного и проверяет диапазон
+                double rounded = std::nearbyint(argument.number);
+                if (std::isnan(rounded) || rounded < INT_MIN || rounded > INT_MAX)
+                {
+                    return SetError(out, ErrorCode::IntegerOutOfRange, instruction.node);
+                }
+                operand = rounded == 1 ? 1 : 0;
+            }
+            if (i == 0)
+            {
+                value = operand;
+                continue;
+            }
+
+            if constexpr (Op == Opcode::And)
+            {
+                value = value == 0 || operand == 0 ? 0 : (value < 0 || operand < 0 ? -1 : 1);
+            }
+            else if constexpr (Op == Opcode::Or)
+            {
+                value = value == 1 || operand == 1 ? 1 : (value < 0 || operand < 0 ? -1 : 0);
+            }
+            else
+            {
+                return SetError(out, ErrorCode::UnknownLogic, instruction.node);
+            }
+        }
+
+        if constexpr (Op == Opcode::Not)
+        {
+            if (value >= 0)
+            {
+                value = 1 - value;
+            }
+        }
+        SetNumber(out, value == 1 ? 1.0 : 0.0);
+    }
+
+    // CASE_ARG: первое решение по приоритету с ненулевым значением или
+    // с PRIORITET = 0; решения с ошибкой пропускаются. Если подходящего решения
+    // нет, результат - значение последнего вычисленного решения (или 0)
+    template <typename Read>
+    static void Case(const Slot* slots, const Read& read, const Instruction& instruction, Register& out)
+    {
+        Register value;
+        SetNumber(value, 0);
+        for (std::uint32_t i = 0; i < instruction.count; ++i)
+        {
+            Register decision = read(i);
+            if (decision.error != ErrorCode::None)
+            {
+                continue;
+            }
+            value = decision;
+            if (slots[i].flag || (value.hasNumber && value.number != 0))
+            {
+                break;
+            }
+        }
+        value.text = nullptr;
+        out = value;
+    }
+};
+
+// ==================== Пакетное исполнение ====================
+
+// Пакетный интерпретатор: регистры хранятся по столбцам для блока из kBlock
+// заказов, и каждая команда выполняется над всем блоком векторными
+// операциями. Группа из simd::kWidth заказов, в которой у операндов есть NULL
+// или ошибка либо возможна ошибка вычисления (деление на ноль, переполнение,
+// NaN), вычисляется поэлементно через Machine::Apply
+struct RuleEngine::BatchMachine
+{
+    static constexpr std::size_t kBlock = 256;
+
+    enum LaneState : std::uint8_t
+    {
+        kNumber,
+        kNull,
+        kError
+    };
+
+    // Операнд команды для векторного чтения
+    struct Lanes
+    {
+        const double* numbers = nullptr; // nullptr - константа
+        const std::uint8_t* states = nullptr;
+        double constant = 0;
+        bool isNumber = false; // У константы есть числовое значение
+    };
+
+    const RuleEngine& engine;
+    const RuleBatch& batch;
+    const Program& program;
+
+    std::vector<std::int32_t> inputs;              // Константа регистра LoadInput или -1
+    std::vector<const RuleBatch::Column*> columns; // Столбец пакета регистра LoadInput
+    std::vector<double> numbers;                   // [регистр * kBlock + заказ в блоке]
+    std::vector<std::uint8_t> states;
+    std::vector<ErrorCode> errors;
+    std::vector<std::uint32_t> nodes;
+    std::vector<Lanes> operands; // Операнды текущей команды
+    std::size_t offset = 0;      // Первый заказ блока
+    std::size_t size = 0;        // Заказов в блоке
+
+    BatchMachine(const RuleEngine& engine, const RuleBatch& batch, const Program& program)
+        : engine(engine)
+        , batch(batch)
+        , program(program)
+        , inputs(program.registers, -1)
+        , columns(program.registers, nullptr)
+        , numbers(program.registers * kBlock)
+        , states(program.registers * kBlock)
+        , errors(program.registers * kBlock)
+        , nodes(program.registers * kBlock)
+    {
+        for (const Instruction& instruction : program.code)
+        {
+            if (instruction.opcode == Opcode::LoadInput)
+            {
+                inputs[instruction.target] = static_cast<std::int32_t>(instruction.first);
+                columns[instruction.target] = batch.FindColumn(engine.inputs_[instruction.first].code);
+            }
+        }
+    }
+
+    // Вычисление заказов [first, first + count), count <= kBlock
+    void Run(std::size_t first, std::size_t count)
+    {
+        offset = first;
+        size = count;
+        for (const Instruction& instruction : program.code)
+        {
+            switch (instruction.opcode)
+            {
+            case Opcode::LoadInput:
+                LoadInput(instruction);
+                break;
+            case Opcode::Less:
+                Vector<&BatchMachine::Predicate<Opcode::Less>>(instruction);
+                break;
+            case Opcode::LessEqual:
+                Vector<&BatchMachine::Predicate<Opcode::LessEqual>>(instruction);
+                break;
+            case Opcode::Equal:
+                Vector<&BatchMachine::Predicate<Opcode::Equal>>(instruction);
+                break;
+            case Opcode::GreaterEqual:
+                Vector<&BatchMachine::Predicate<Opcode::GreaterEqual>>(instruction);
+                break;
+            case Opcode::Greater:
+                Vector<&BatchMachine::Predicate<Opcode::Greater>>(instruction);
+                break;
+            case Opcode::Add:
+                Vector<&BatchMachine::Arithmetic<Opcode::Add>>(instruction);
+                break;
+            case Opcode::Subtract:
+                Vector<&BatchMachine::Arithmetic<Opcode::Subtract>>(instruction);
+                break;
+            case Opcode::Multiply:
+                Vector<&BatchMachine::Arithmetic<Opcode::Multiply>>(instruction);
+                break;
+            case Opcode::Divide:
+                Vector<&BatchMachine::Arithmetic<Opcode::Divide>>(instruction);
+                break;
+            case Opcode::And:
+                Vector<&BatchMachine::Logic<Opcode::And>>(instruction);
+                break;
+            case Opcode::Or:
+                Vector<&BatchMachine::Logic<Opcode::Or>>(instruction);
+                break;
+            case Opcode::Not:
+                Vector<&BatchMachine::Logic<Opcode::Not>>(instruction);
+                break;
+            case Opcode::Case:
+                Vector<&BatchMachine::Case>(instruction);
+                break;
+            default:
+                // Ошибки и неизвестные операции
+                Scalar(instruction, 0, size);
+                break;
+            }
+        }
+    }
+
+    // Значение результата для заказа блока
+    Register GetResult(std::size_t lane) const
+    {
+        return ReadLane({SlotKind::Register, false, program.result}, lane);
+    }
+
+    // Обход блока группами по simd::kWidth; group возвращает false, если
+    // группу нужно вычислить поэлементно
+    template <bool (BatchMachine::*Group)(const Instruction&, std::size_t)>
+    void Vector(const Instruction& instruction)
+    {
+        operands.clear();
+        for (std::uint32_t i = 0; i < instruction.count; ++i)
+        {
+            operands.push_back(GetLanes(program.slots[instruction.first + i]));
+        }
+
+        std::size_t lane = 0;
+        for (; lane + simd::kWidth <= size; lane += simd::kWidth)
+        {
+            if (!(this->*Group)(instruction, lane))
+            {
+                Scalar(instruction, lane, lane + simd::kWidth);
+            }
+        }
+        Scalar(instruction, lane, size);
+    }
+
+    void Scalar(const Instruction& instruction, std::size_t from, std::size_t to)
+    {
+        const Slot* slots = program.slots.data() + instruction.first;
+        for (std::size_t lane = from; lane < to; ++lane)
+        {
+            Register out;
+            Machine::Apply(instruction, slots, [&](std::uint32_t i) { return ReadLane(slots[i], lane); }, out);
+            StoreLane(instruction.target, lane, out);
+        }
+    }
+
+    // CALC_PRED над числами: сравнение без NaN
+    template <Opcode Op>
+    bool Predicate(const Instruction& instruction, std::size_t lane)
+    {
+        if (operands.size() < 2 || !AllNumbers(operands[0], lane) || !AllNumbers(operands[1], lane))
+        {
+            return false;
+        }
+        simd::Pack left = LoadLanes(operands[0], lane);
+        simd::Pack right = LoadLanes(operands[1], lane);
+        if (simd::Any(simd::Unordered(left, right)))
+        {
+            return false;
+        }
+
+        simd::Mask mask;
+        if constexpr (Op == Opcode::Less)
+        {
+            mask = simd::Less(left, right);
+        }
+        else if constexpr (Op == Opcode::LessEqual)
+        {
+            mask = simd::LessEqual(left, right);
+        }
+        else if constexpr (Op == Opcode::Equal)
+        {
+            mask = simd::Equal(left, right);
+        }
+        else if constexpr (Op == Opcode::GreaterEqual)
+        {
+            mask = simd::GreaterEqual(left, right);
+        }
+        else
+        {
+            mask = simd::Greater(left, right);
+        }
+        StoreNumbers(instruction.target, lane, simd::Select(mask, simd::Broadcast(1.0), simd::Broadcast(0.0)));
+        return true;
+    }
+
+    // CALC_AR над числами без деления на ноль, переполнения и антипереполнения
+    template <Opcode Op>
+    bool Arithmetic(const Instruction& instruction, std::size_t lane)
+    {
+        for (const auto& operand : operands)
+        {
+            if (!AllNumbers(operand, lane))
+            {
+                return false;
+            }
+        }
+
+        simd::Pack value = operands.empty() ? simd::Broadcast(0.0) : LoadLanes(operands[0], lane);
+        for (std::size_t i = 1; i < operands.size(); ++i)
+        {
+            simd::Pack argument = LoadLanes(operands[i], lane);
+            simd::Pack next;
+            simd::Mask invalid = simd::False();
+            if constexpr (Op == Opcode::Add)
+            {
+                next = simd::Add(value, argument);
+            }
+            else if constexpr (Op == Opcode::Subtract)
+            {
+                next = simd::Subtract(value, argument);
+            }
+            else if constexpr (Op == Opcode::Multiply)
+            {
+                next = simd::Multiply(value, argument);
+                invalid = simd::And(simd::Equal(next, simd::Broadcast(0.0)),
+                                    simd::And(simd::NotEqual(value, simd::Broadcast(0.0)),
+                                              simd::NotEqual(argument, simd::Broadcast(0.0))));
+            }
+            else
+            {
+                if (simd::Any(simd::Equal(argument, simd::Broadcast(0.0))))
+                {
+                    return false;
+                }
+                next = simd::Divide(value, argument);
+                invalid = simd::And(simd::Equal(next, simd::Broadcast(0.0)),
+                                    simd::AndNot(simd::NotEqual(value, simd::Broadcast(0.0)), simd::IsInf(argument)));
+            }
+            simd::Mask overflow = simd::AndNot(simd::IsInf(next), simd::Or(simd::IsInf(value), simd::IsInf(argument)));
+            if (simd::Any(simd::Or(invalid, overflow)))
+            {
+                return false;
+            }
+            value = next;
+        }
+        StoreNumbers(instruction.target, lane, value);
+        return true;
+    }
+
+    // CALC_LOG над числами в диапазоне INTEGER: истина - значение округляется до 1
+    template <Opcode Op>
+    bool Logic(const Instruction& instruction, std::size_t lane)
+    {
+        if (operands.empty())
+        {
+            return false;
+        }
+
+        simd::Mask value = simd::False();
+        std::size_t count = Op == Opcode::Not ? 1 : operands.size();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (!AllNumbers(operands[i], lane))
+            {
+                return false;
+            }
+            simd::Pack argument = LoadLanes(operands[i], lane);
+            simd::Mask inRange =
+                simd::And(simd::Greater(argument, simd::Broadcast(-2e9)), simd::Less(argument, simd::Broadcast(2e9)));
+            if (!simd::All(inRange))
+            {
+                return false;
+            }
+
+            simd::Mask operand = simd::And(simd::Greater(argument, simd::Broadcast(0.5)),
+                                           simd::Less(argument, simd::Broadcast(1.5)));
+            if (i == 0)
+            {
+                value = operand;
+            }
+            else if constexpr (Op == Opcode::And)
+            {
+                value = simd::And(value, operand);
+            }
+            else if constexpr (Op == Opcode::Or)
+            {
+                value = simd::Or(value, operand);
+            }
+        }
+        if constexpr (Op == Opcode::Not)
+        {
+            value = simd::AndNot(simd::True(), value);
+        }
+        StoreNumbers(instruction.target, lane, simd::Select(value, simd::Broadcast(1.0), simd::Broadcast(0.0)));
+        return true;
+    }
+
+    // CASE_ARG без NULL и ошибок в решениях: выбор по маске вместо ветвлений
+    bool Case(const Instruction& instruction, std::size_t lane)
+    {
+        for (const auto& operand : operands)
+        {
+            if (!AllNumbers(operand, lane))
+            {
+                return false;
+            }
+        }
+
+        const Slot* slots = program.slots.data() + instruction.first;
+        simd::Pack value = simd::Broadcast(0.0);
+        simd::Mask done = simd::False();
+        for (std::size_t i = 0; i < operands.size() && !simd::All(done); ++i)
+        {
+            simd::Pack decision = LoadLanes(operands[i], lane);
+            value = simd::Select(done, value, decision);
+            done = simd::Or(done, slots[i].flag ? simd::True() : simd::NotEqual(decision, simd::Broadcast(0.0)));
+        }
+        StoreNumbers(instruction.target, lane, value);
+        return true;
+    }
+
+    // Константа или параметр заказа из столбца пакета
+    void LoadInput(const Instruction& instruction)
+    {
+        const Input& input = engine.inputs_[instruction.first];
+        const RuleBatch::Column* column = columns[instruction.target];
+        std::size_t base = instruction.target * kBlock;
+        for (std::size_t lane = 0; lane < size; ++lane)
+        {
+            std::size_t index = offset + lane;
+            if (column && column->states[index] != RuleBatch::State::Absent)
+            {
+                numbers[base + lane] = column->numbers[index];
+                states[base + lane] = column->states[index] == RuleBatch::State::Number ? kNumber : kNull;
+            }
+            else
+            {
+                numbers[base + lane] = input.value.number.value_or(0);
+                states[base + lane] = input.value.number ? kNumber : kNull;
+            }
+        }
+    }
+
+    Lanes GetLanes(const Slot& slot) const
+    {
+        switch (slot.kind)
+        {
+        case SlotKind::Constant:
+        {
+            const Literal& literal = engine.literals_[slot.index];
+            return {nullptr, nullptr, literal.number.value_or(0), literal.number.has_value()};
+        }
+        case SlotKind::Register:
+            return {&numbers[slot.index * kBlock], &states[slot.index * kBlock], 0, false};
+        case SlotKind::Null:
+        case SlotKind::Input:
+            break;
+        }
+        return {};
+    }
+
+    static bool AllNumbers(const Lanes& lanes, std::size_t lane)
+    {
+        if (!lanes.numbers)
+        {
+            return lanes.isNumber;
+        }
+        for (std::size_t i = 0; i < simd::kWidth; ++i)
+        {
+            if (lanes.states[lane + i] != kNumber)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static simd::Pack LoadLanes(const Lanes& lanes, std::size_t lane)
+    {
+        return lanes.numbers ? simd::Load(lanes.numbers + lane) : simd::Broadcast(lanes.constant);
+    }
+
+    void StoreNumbers(std::uint32_t target, std::size_t lane, simd::Pack value)
+    {
+        std::size_t index = target * kBlock + lane;
+        simd::Store(&numbers[index], value);
+        std::fill_n(&states[index], simd::kWidth, kNumber);
+    }
+
+    Register ReadLane(const Slot& slot, std::size_t lane) const
+    {
+        switch (slot.kind)
+        {
+        case SlotKind::Constant:
+            return Machine::ReadLiteral(engine.literals_[slot.index]);
+        case SlotKind::Register:
+        {
+            std::size_t index = slot.index * kBlock + lane;
+            Register value;
+            value.number = numbers[index];
+            value.hasNumber = states[index] == kNumber;
+            if (states[index] == kError)
+            {
+                value.error = errors[index];
+                value.node = nodes[index];
+            }
+            if (inputs[slot.index] >= 0)
+            {
+                value.text = ReadText(slot.index, offset + lane);
+            }
+            return value;
+        }
+        case SlotKind::Null:
+        case SlotKind::Input:
+            break;
+        }
+        return {};
+    }
+
+    // Строковое значение регистра LoadInput для заказа index
+    const std::string* ReadText(std::uint32_t target, std::size_t index) const
+    {
+        const RuleBatch::Column* column = columns[target];
+        if (column && column->states[index] != RuleBatch::State::Absent)
+        {
+            return column->texts.empty() || column->texts[index].empty() ? nullptr : &column->texts[index];
+        }
+        const Literal& value = engine.inputs_[inputs[target]].value;
+        return value.text ? &*value.text : nullptr;
+    }
+
+    void StoreLane(std::uint32_t target, std::size_t lane, const Register& value)
+    {
+        std::size_t index = target * kBlock + lane;
+        numbers[index] = value.number;
+        states[index] = value.error != ErrorCode::None ? kError : (value.hasNumber ? kNumber : kNull);
+        errors[index] = value.error;
+        nodes[index] = value.node;
+    }
+};
+
+std::optional<std::uint32_t> RuleEngine::FindRoot(int functionId, int objectId) const
+{
+    // Корень ищется так же, как в CALC_VAL_F
+    auto function = functions_.find(functionId);
+    if (function == functions_.end())
+    {
+        throw std::runtime_error("Функция с ID " + std::to_string(functionId) + " не найдена");
+    }
+
+    int type = function->second.type;
+    if (type == 3)
+    {
+        auto node = caseNodes_.find({functionId, objectId});
+        if (node == caseNodes_.end())
+        {
+            return std::nullopt; // Нет решений для объекта
+        }
+        return node->second;
+    }
+    if (type >= 0 && type < 3)
+    {
+        auto node = callNodes_.find({functionId, objectId, 1});
+        if (node == callNodes_.end())
+        {
+            throw std::runtime_error("Вызов функции " + std::to_string(functionId) + " для объекта " +
+                                     std::to_string(objectId) + " не найден");
+        }
+        return node->second;
+    }
+    throw std::runtime_error("Неизвестный тип функции: " + std::to_string(type));
+}
+
+std::optional<double> RuleEngine::Evaluate(int functionId, int objectId,
+                                           std::span<const OrderParameterValue> parameters) const
+{
+    auto root = FindRoot(functionId, objectId);
+    if (!root)
+    {
+        return 0.0;
+    }
+
+    // Большой граф с широкими уровнями вычисляется по уровням в пуле потоков,
+    // остальные - программой в вызывающем потоке
+    const Program& program = GetProgram(*root);
+    std::size_t count = program.code.size();
+    Register result;
+    if (count >= kParallelInstructions && !isCyclic_[*root] && count / (levels_[*root] + 1) >= kParallelChunk &&
+        WorkStealingPool::GetShared().GetThreadCount() > 0)
+    {
+        result = EvaluateParallel(*root, parameters);
+    }
+    else
+    {
+        std::array<Register, kInlineRegisters> inlineRegisters;
+        std::vector<Register> heapRegisters;
+        Register* registers = inlineRegisters.data();
+        if (program.registers > kInlineRegisters)
+        {
+            heapRegisters.resize(program.registers);
+            registers = heapRegisters.data();
+        }
+
+        Machine machine{*this, parameters, registers};
+        machine.Run(program);
+        result = registers[program.result];
+    }
+
+    if (result.error != ErrorCode::None)
+    {
+        throw std::runtime_error(FormatError(result));
+    }
+    if (!result.hasNumber)
+    {
+        return std::nullopt;
+    }
+    return result.number;
+}
+
+RuleEngine::Register RuleEngine::EvaluateParallel(std::uint32_t root,
+                                                  std::span<const OrderParameterValue> parameters) const
+{
+    // Узлы, от которых зависит корень, и читаемые ими константы
+    std::vector<bool> isUsed(nodes_.size(), false);
+    std::vector<Register> inputs(inputs_.size());
+    std::vector<bool> isLoaded(inputs_.size(), false);
+    std::vector<std::uint32_t> nodes{root};
+    isUsed[root] = true;
+    for (std::size_t next = 0; next < nodes.size(); ++next)
+    {
+        const Instruction& instruction = nodeCode_[nodes[next]];
+        for (std::uint32_t i = 0; i < instruction.count; ++i)
+        {
+            const Slot& slot = nodeSlots_[instruction.first + i];
+            if (slot.kind == SlotKind::Register && !isUsed[slot.index])
+            {
+                isUsed[slot.index] = true;
+                nodes.push_back(slot.index);
+            }
+            else if (slot.kind == SlotKind::Input && !isLoaded[slot.index])
+            {
+                isLoaded[slot.index] = true;
+                inputs[slot.index] = LoadInput(slot.index, parameters);
+            }
+        }
+    }
+
+    // Узлы одного уровня не зависят друг от друга
+    std::uint32_t levelCount = levels_[root] + 1;
+    std::vector<std::uint32_t> levelOffsets(levelCount + 1, 0);
+    for (std::uint32_t node : nodes)
+    {
+        ++levelOffsets[levels_[node] + 1];
+    }
+    std::partial_sum(levelOffsets.begin(), levelOffsets.end(), levelOffsets.begin());
+    std::vector<std::uint32_t> order(nodes.size());
+    std::vector<std::uint32_t> positions(levelOffsets.begin(), levelOffsets.end() - 1);
+    for (std::uint32_t node : nodes)
+    {
+        order[positions[levels_[node]]++] = node;
+    }
+
+    std::vector<Register> values(nodes_.size());
+    WorkStealingPool& pool = WorkStealingPool::GetShared();
+    for (std::uint32_t level = 0; level < levelCount; ++level)
+    {
+        std::uint32_t first = levelOffsets[level];
+        std::uint32_t count = levelOffsets[level + 1] - first;
+        auto execute = [&](std::size_t chunk) {
+            std::uint32_t begin = first + static_cast<std::uint32_t>(chunk) * kParallelChunk;
+            std::uint32_t end = std::min(begin + kParallelChunk, first + count);
+            for (std::uint32_t i = begin; i < end; ++i)
+            {
+                Execute(order[i], values.data(), inputs.data(), values[order[i]]);
+            }
+        };
+        // Узкие уровни не окупают передачу задач в пул
+        if (count < 2 * kParallelChunk)
+        {
+            execute(0);
+        }
+        else
+        {
+            pool.Run((count + kParallelChunk - 1) / kParallelChunk, execute);
+        }
+    }
+    return values[root];
+}
+
+// Константа; ее заменяет параметр заказа с тем же кодом
+RuleEngine::Register RuleEngine::LoadInput(std::uint32_t input, std::span<const OrderParameterValue> parameters) const
+{
+    const Input& value = inputs_[input];
+    for (const auto& parameter : parameters)
+    {
+        if (EqualsLower(parameter.code, value.code))
+        {
+            return {parameter.numValue.value_or(0), parameter.strValue.empty() ? nullptr : &parameter.strValue, 0,
+                    parameter.numValue.has_value(), ErrorCode::None};
+        }
+    }
+    return Machine::ReadLiteral(value.value);
+}
+
+void RuleEngine::Execute(std::uint32_t node, const Register* values, const Register* inputs, Register& out) const
+{
+    const Instruction& instruction = nodeCode_[node];
+    const Slot* slots = nodeSlots_.data() + instruction.first;
+    auto read = [&](std::uint32_t i) -> Register {
+        const Slot& slot = slots[i];
+        switch (slot.kind)
+        {
+        case SlotKind::Constant:
+            return Machine::ReadLiteral(literals_[slot.index]);
+        case SlotKind::Register:
+            return values[slot.index];
+        case SlotKind::Input:
+            return inputs[slot.index];
+        case SlotKind::Null:
+            break;
+        }
+        return {};
+    };
+    Machine::Apply(instruction, slots, read, out);
+}
+
+RuleBatchResult RuleEngine::EvaluateBatch(int functionId, int objectId, const RuleBatch& batch) const
+{
+    RuleBatchResult result;
+    auto root = FindRoot(functionId, objectId);
+    if (!root)
+    {
+        result.values.assign(batch.GetSize(), 0.0);
+        return result;
+    }
+
+    result.values.resize(batch.GetSize());
+    BatchMachine machine(*this, batch, GetProgram(*root));
+    for (std::size_t offset = 0; offset < batch.GetSize(); offset += BatchMachine::kBlock)
+    {
+        std::size_t size = std::min(BatchMachine::kBlock, batch.GetSize() - offset);
+        machine.Run(offset, size);
+        for (std::size_t lane = 0; lane < size; ++lane)
+        {
+            Register value = machine.GetResult(lane);
+            if (value.error != ErrorCode::None)
+            {
+                result.errors.emplace_back(offset + lane, FormatError(value));
+            }
+            else if (value.hasNumber)
+            {
+                result.values[offset + lane] = value.number;
+            }
+        }
+    }
+    return result;
+}
+
+std::string RuleEngine::FormatError(const Register& value) const
+{
+    const Node& node = nodes_[value.node];
+    auto operation = [&] { return functions_.at(node.functionId).text; };
+    switch (value.error)
+    {
+    case ErrorCode::None:
+        break;
+    case ErrorCode::Invalid:
+        return errors_[node.first];
+    case ErrorCode::Cycle:
+        return "Циклическая ссылка на функцию " + std::to_string(node.functionId);
+    case ErrorCode::UnknownPredicate:
+        return "Неизвестная операция: " + operation();
+    case ErrorCode::UnsupportedForStrings:
+        return "Операция " + operation() + " не поддерживается для строк";
+    case ErrorCode::NotEnoughArguments:
+        return "Недостаточно аргументов для сравнения";
+    case ErrorCode::UnknownArithmetic:
+        return "Неизвестная арифметическая операция: " + operation();
+    case ErrorCode::DivisionByZero:
+        return "Деление на ноль";
+    case ErrorCode::Overflow:
+        return "Значение вне диапазона: переполнение";
+    case ErrorCode::Underflow:
+        return "Значение вне диапазона: антипереполнение";
+    case ErrorCode::UnknownLogic:
+        return "Неизвестная логическая операция: " + operation();
+    case ErrorCode::IntegerOutOfRange:
+        return "Целое вне диапазона";
+    }
+    return {};
+}
+
+// ==================== Пакет заказов ====================
+
+RuleBatch::RuleBatch(std::size_t size)
+    : size_(size)
+{
+}
+
+std::size_t RuleBatch::GetSize() const
+{
+    return size_;
+}
+
+void RuleBatch::SetParameter(std::size_t index, std::string_view code, std::optional<double> number,
+                             std::string_view text)
+{
+    if (index >= size_)
+    {
+        throw std::out_of_range("Номер заказа вне пакета");
+    }
+
+    Column& column = GetColumn(code);
+    column.numbers[index] = number.value_or(0);
+    column.states[index] = number ? State::Number : State::Null;
+    if (!text.empty() && column.texts.empty())
+    {
+        column.texts.resize(size_);
+    }
+    if (!column.texts.empty())
+    {
+        column.texts[index] = text;
+    }
+}
+
+void RuleBatch::SetOrder(std::size_t index, std::span<const OrderParameterValue> parameters)
+{
+    // С обратного конца: из параметров с одинаковым кодом действует первый, как в Evaluate
+    for (auto it = parameters.rbegin(); it != parameters.rend(); ++it)
+    {
+        SetParameter(index, it->code, it->numValue, it->strValue);
+    }
+}
+
+void RuleBatch::SetNumbers(std::string_view code, std::span<const double> values)
+{
+    if (values.size() != size_)
+    {
+        throw std::invalid_argument("Размер столбца не совпадает с размером пакета");
+    }
+
+    Column& column = GetColumn(code);
+    column.numbers.assign(values.begin(), values.end());
+    column.states.assign(size_, State::Number);
+    column.texts.clear();
+}
+
+RuleBatch::Column& RuleBatch::GetColumn(std::string_view code)
+{
+    std::string key = ToLower(code);
+    auto it = columns_.find(key);
+    if (it == columns_.end())
+    {
+        Column column;
+        column.numbers.assign(size_, 0);
+        column.states.assign(size_, State::Absent);
+        it = columns_.emplace(std::move(key), std::move(column)).first;
+    }
+    return it->second;
+}
+
+const RuleBatch::Column* RuleBatch::FindColumn(const std::string& code) const
+{
+    auto it = columns_.find(code);
+    return it == columns_.end() ? nullptr : &it->second;
+}
+
+} // namespace core
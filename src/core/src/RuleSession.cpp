@@ -0,0 +1,168 @@
+#include "RuleSession.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace core
+{
+
+namespace
+{
+bool EqualsIgnoreCase(std::string_view left, std::string_view right)
+{
+    auto lower = [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; };
+    return left.size() == right.size() &&
+           std::equal(left.begin(), left.end(), right.begin(), [&](char l, char r) { return lower(l) == lower(r); });
+}
+} // namespace
+
+RuleSession::RuleSession(std::shared_ptr<const RuleEngine> engine, std::vector<OrderParameterValue> parameters)
+    : engine_(std::move(engine))
+    , parameters_(std::move(parameters))
+    , inputs_(engine_->inputs_.size())
+    , texts_(engine_->inputs_.size())
+    , values_(engine_->nodes_.size())
+    , isValid_(engine_->nodes_.size(), false)
+{
+    for (std::uint32_t i = 0; i < inputs_.size(); ++i)
+    {
+        inputs_[i] = engine_->LoadInput(i, parameters_);
+        if (inputs_[i].text)
+        {
+            texts_[i] = *inputs_[i].text;
+        }
+    }
+}
+
+std::optional<double> RuleSession::Evaluate(int functionId, int objectId)
+{
+    std::lock_guard lock(mutex_);
+    auto root = engine_->FindRoot(functionId, objectId);
+    if (!root)
+    {
+        return 0.0;
+    }
+
+    // Результат узла в цикле зависит от того, с какого узла начат обход,
+    // поэтому такие узлы вычисляются программой корня без сохранения
+    if (engine_->isCyclic_[*root])
+    {
+        return engine_->Evaluate(functionId, objectId, parameters_);
+    }
+
+    const Register& result = EvaluateNode(*root);
+    if (result.error != RuleEngine::ErrorCode::None)
+    {
+        throw std::runtime_error(engine_->FormatError(result));
+    }
+    if (!result.hasNumber)
+    {
+        return std::nullopt;
+    }
+    return result.number;
+}
+
+void RuleSession::SetParameter(const OrderParameterValue& parameter)
+{
+    std::lock_guard lock(mutex_);
+    auto it = std::find_if(parameters_.begin(), parameters_.end(), [&](const OrderParameterValue& p) {
+        return parameter.parameterId != 0 ? p.parameterId == parameter.parameterId
+                                          : EqualsIgnoreCase(p.code, parameter.code);
+    });
+    if (it != parameters_.end())
+    {
+        *it = parameter;
+    }
+    else
+    {
+        parameters_.push_back(parameter);
+    }
+    Refresh();
+}
+
+void RuleSession::RemoveParameter(int parameterId)
+{
+    std::lock_guard lock(mutex_);
+    std::erase_if(parameters_, [&](const OrderParameterValue& p) { return p.parameterId == parameterId; });
+    Refresh();
+}
+
+std::shared_ptr<const RuleEngine> RuleSession::GetEngine() const
+{
+    return engine_;
+}
+
+void RuleSession::Refresh()
+{
+    // Строки констант указывают в parameters_, поэтому перечитываются все константы,
+    // а сбрасываются только зависящие от изменившихся
+    for (std::uint32_t i = 0; i < inputs_.size(); ++i)
+    {
+        Register value = engine_->LoadInput(i, parameters_);
+        const Register& old = inputs_[i];
+        bool isSame = value.hasNumber == old.hasNumber && (!value.hasNumber || value.number == old.number) &&
+                      (value.text ? texts_[i] == *value.text : !texts_[i]);
+        inputs_[i] = value;
+        if (!isSame)
+        {
+            texts_[i] = value.text ? std::optional<std::string>(*value.text) : std::nullopt;
+            Invalidate(i);
+        }
+    }
+}
+
+void RuleSession::Invalidate(std::uint32_t input)
+{
+    stack_.assign(engine_->inputDependents_.begin() + engine_->inputOffsets_[input],
+                  engine_->inputDependents_.begin() + engine_->inputOffsets_[input + 1]);
+    while (!stack_.empty())
+    {
+        std::uint32_t node = stack_.back();
+        stack_.pop_back();
+        if (!isValid_[node])
+        {
+            continue; // Зависящие узлы уже сброшены
+        }
+        isValid_[node] = false;
+        for (std::uint32_t i = engine_->dependentOffsets_[node]; i < engine_->dependentOffsets_[node + 1]; ++i)
+        {
+            stack_.push_back(engine_->dependents_[i].node);
+        }
+    }
+}
+
+const RuleSession::Register& RuleSession::EvaluateNode(std::uint32_t node)
+{
+    // Обход без рекурсии; граф от корня без циклов, поэтому узел вычисляется,
+    // когда при повторном посещении все его операнды уже вычислены
+    stack_.assign(1, node);
+    while (!stack_.empty())
+    {
+        std::uint32_t current = stack_.back();
+        if (isValid_[current])
+        {
+            stack_.pop_back();
+            continue;
+        }
+
+        std::size_t size = stack_.size();
+        const RuleEngine::Instruction& instruction = engine_->nodeCode_[current];
+        for (std::uint32_t i = 0; i < instruction.count; ++i)
+        {
+            const RuleEngine::Slot& slot = engine_->nodeSlots_[instruction.first + i];
+            if (slot.kind == RuleEngine::SlotKind::Register && !isValid_[slot.index])
+            {
+                stack_.push_back(slot.index);
+            }
+        }
+        if (stack_.size() == size)
+        {
+            engine_->Execute(current, values_.data(), inputs_.data(), values_[current]);
+            isValid_[current] = true;
+            stack_.pop_back();
+        }
+    }
+    return values_[node];
+}
+
+} // namespace core
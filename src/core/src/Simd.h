@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CORE_SIMD_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CORE_SIMD_SSE2 1
+#endif
+
+// Минимальная обертка над векторными регистрами DOUBLE: AVX - 4 значения,
+// SSE2 - 2, без расширений - 1. Сравнения упорядоченные (с NaN ложны),
+// кроме NotEqual, который для NaN истинен, как в PostgreSQL
+namespace core::simd
+{
+
+#if defined(CORE_SIMD_AVX)
+
+constexpr std::size_t kWidth = 4;
+using Pack = __m256d;
+using Mask = __m256d;
+
+inline Pack Load(const double* p) { return _mm256_loadu_pd(p); }
+inline void Store(double* p, Pack a) { _mm256_storeu_pd(p, a); }
+inline Pack Broadcast(double x) { return _mm256_set1_pd(x); }
+
+inline Pack Add(Pack a, Pack b) { return _mm256_add_pd(a, b); }
+inline Pack Subtract(Pack a, Pack b) { return _mm256_sub_pd(a, b); }
+inline Pack Multiply(Pack a, Pack b) { return _mm256_mul_pd(a, b); }
+inline Pack Divide(Pack a, Pack b) { return _mm256_div_pd(a, b); }
+
+inline Mask Less(Pack a, Pack b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+inline Mask LessEqual(Pack a, Pack b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+inline Mask Equal(Pack a, Pack b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+inline Mask GreaterEqual(Pack a, Pack b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+inline Mask Greater(Pack a, Pack b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+inline Mask NotEqual(Pack a, Pack b) { return _mm256_cmp_pd(a, b, _CMP_NEQ_UQ); }
+inline Mask Unordered(Pack a, Pack b) { return _mm256_cmp_pd(a, b, _CMP_UNORD_Q); }
+
+inline Mask True() { return _mm256_castsi256_pd(_mm256_set1_epi64x(-1)); }
+inline Mask False() { return _mm256_setzero_pd(); }
+inline Mask And(Mask a, Mask b) { return _mm256_and_pd(a, b); }
+inline Mask Or(Mask a, Mask b) { return _mm256_or_pd(a, b); }
+inline Mask AndNot(Mask a, Mask b) { return _mm256_andnot_pd(b, a); } // a и не b
+inline Pack Select(Mask m, Pack a, Pack b) { return _mm256_blendv_pd(b, a, m); }
+inline bool Any(Mask m) { return _mm256_movemask_pd(m) != 0; }
+inline bool All(Mask m) { return _mm256_movemask_pd(m) == 0xF; }
+
+inline Mask IsInf(Pack a)
+{
+    Pack abs = _mm256_andnot_pd(_mm256_set1_pd(-0.0), a);
+    return Equal(abs, Broadcast(std::numeric_limits<double>::infinity()));
+}
+
+#elif defined(CORE_SIMD_SSE2)
+
+constexpr std::size_t kWidth = 2;
+using Pack = __m128d;
+using Mask = __m128d;
+
+inline Pack Load(const double* p) { return _mm_loadu_pd(p); }
+inline void Store(double* p, Pack a) { _mm_storeu_pd(p, a); }
+inline Pack Broadcast(double x) { return _mm_set1_pd(x); }
+
+inline Pack Add(Pack a, Pack b) { return _mm_add_pd(a, b); }
+inline Pack Subtract(Pack a, Pack b) { return _mm_sub_pd(a, b); }
+inline Pack Multiply(Pack a, Pack b) { return _mm_mul_pd(a, b); }
+inline Pack Divide(Pack a, Pack b) { return _mm_div_pd(a, b); }
+
+inline Mask Less(Pack a, Pack b) { return _mm_cmplt_pd(a, b); }
+inline Mask LessEqual(Pack a, Pack b) { return _mm_cmple_pd(a, b); }
+inline Mask Equal(Pack a, Pack b) { return _mm_cmpeq_pd(a, b); }
+inline Mask GreaterEqual(Pack a, Pack b) { return _mm_cmpge_pd(a, b); }
+inline Mask Greater(Pack a, Pack b) { return _mm_cmpgt_pd(a, b); }
+inline Mask NotEqual(Pack a, Pack b) { return _mm_cmpneq_pd(a, b); }
+inline Mask Unordered(Pack a, Pack b) { return _mm_cmpunord_pd(a, b); }
+
+inline Mask True() { return _mm_castsi128_pd(_mm_set1_epi32(-1)); }
+inline Mask False() { return _mm_setzero_pd(); }
+inline Mask And(Mask a, Mask b) { return _mm_and_pd(a, b); }
+inline Mask Or(Mask a, Mask b) { return _mm_or_pd(a, b); }
+inline Mask AndNot(Mask a, Mask b) { return _mm_andnot_pd(b, a); } // a и не b
+inline Pack Select(Mask m, Pack a, Pack b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+inline bool Any(Mask m) { return _mm_movemask_pd(m) != 0; }
+inline bool All(Mask m) { return _mm_movemask_pd(m) == 0x3; }
+
+inline Mask IsInf(Pack a)
+{
+    Pack abs = _mm_andnot_pd(_mm_set1_pd(-0.0), a);
+    return Equal(abs, Broadcast(std::numeric_limits<double>::infinity()));
+}
+
+#else
+
+constexpr std::size_t kWidth = 1;
+using Pack = double;
+using Mask = bool;
+
+inline Pack Load(const double* p) { return *p; }
+inline void Store(double* p, Pack a) { *p = a; }
+inline Pack Broadcast(double x) { return x; }
+
+inline Pack Add(Pack a, Pack b) { return a + b; }
+inline Pack Subtract(Pack a, Pack b) { return a - b; }
+inline Pack Multiply(Pack a, Pack b) { return a * b; }
+inline Pack Divide(Pack a, Pack b) { return a / b; }
+
+inline Mask Less(Pack a, Pack b) { return a < b; }
+inline Mask LessEqual(Pack a, Pack b) { return a <= b; }
+inline Mask Equal(Pack a, Pack b) { return a == b; }
+inline Mask GreaterEqual(Pack a, Pack b) { return a >= b; }
+inline Mask Greater(Pack a, Pack b) { return a > b; }
+inline Mask NotEqual(Pack a, Pack b) { return a != b; }
+inline Mask Unordered(Pack a, Pack b) { return std::isnan(a) || std::isnan(b); }
+
+inline Mask True() { return true; }
+inline Mask False() { return false; }
+inline Mask And(Mask a, Mask b) { return a && b; }
+inline Mask Or(Mask a, Mask b) { return a || b; }
+inline Mask AndNot(Mask a, Mask b) { return a && !b; }
+inline Pack Select(Mask m, Pack a, Pack b) { return m ? a : b; }
+inline bool Any(Mask m) { return m; }
+inline bool All(Mask m) { return m; }
+
+inline Mask IsInf(Pack a) { return std::isinf(a); }
+
+#endif
+
+} // namespace core::simd
@@ -1,15 +1,284 @@
 #include "TariffService.h"
 
+#include <map>
+#include <mutex>
+#include <string_view>
+
 namespace core
 {
 
+namespace
+{
+// Преобразование записей БД в модели
+
+Executor ToExecutor(const db::ExecutorInfo& e)
+{
+    Executor executor;
+    executor.id = e.id;
+    executor.code = e.code;
+    executor.name = e.name;
+    executor.address = e.address;
+    executor.phone = e.phone;
+    executor.email = e.email;
+    executor.isActive = e.isActive;
+    executor.note = e.note;
+    return executor;
+}
+
+Tariff ToTariff(const db::TariffInfo& t)
+{
+    Tariff tariff;
+    tariff.id = t.id;
+    tariff.code = t.code;
+    tariff.name = t.name;
+    tariff.serviceTypeId = t.serviceTypeId;
+    tariff.serviceName = t.serviceName;
+    tariff.executorId = t.executorId;
+    tariff.executorName = t.executorName;
+    tariff.dateBegin = t.dateBegin;
+    tariff.dateEnd = t.dateEnd;
+    tariff.isWithVat = t.isWithVat;
+    tariff.vatRate = t.vatRate;
+    tariff.isActive = t.isActive;
+    tariff.note = t.note;
+    return tariff;
+}
+
+// Заполнение заказа без параметров; объект переиспользуется при потоковом обходе
+void AssignOrder(Order& order, const db::OrderInfo& o)
+{
+    order.id = o.id;
+    order.code = o.code;
+    order.serviceTypeId = o.serviceTypeId;
+    order.serviceName = o.serviceName;
+    order.orderDate = o.orderDate;
+    order.executionDate = o.executionDate;
+    order.status = static_cast<OrderStatus>(o.status);
+    order.executorId = o.executorId;
+    order.executorName = o.executorName;
+    order.tariffId = o.tariffId;
+    order.tariffName = o.tariffName;
+    order.totalCost = o.totalCost;
+    order.note = o.note;
+}
+
+OrderParameterValue ToOrderParameter(const db::OrderParamInfo& p)
+{
+    OrderParameterValue param;
+    param.parameterId = p.parId;
+    param.code = p.code;
+    param.name = p.name;
+    param.type = p.type;
+    param.numValue = p.valNum;
+    param.strValue = p.valStr;
+    param.dateValue = p.valDate;
+    param.enumId = p.enumId;
+    param.enumName = p.enumName;
+    param.unitName = p.unitName;
+    return param;
+}
+
+std::optional<db::PageCursor> ToDbCursor(const std::optional<PageCursor>& cursor)
+{
+    if (!cursor)
+    {
+        return std::nullopt;
+    }
+    return db::PageCursor{cursor->key, cursor->id};
+}
+
+// Преобразование страницы БД в страницу моделей
+template <typename T, typename Info, typename Convert>
+Page<T> ToPage(db::Page<Info>&& page, Convert convert)
+{
+    Page<T> result;
+    result.items.reserve(page.items.size());
+    for (const auto& item : page.items)
+    {
+        result.items.push_back(convert(item));
+    }
+    if (page.next)
+    {
+        result.next = PageCursor{std::move(page.next->key), page.next->id};
+    }
+    return result;
+}
+} // namespace
+
+// ==================== Кэш справочников ====================
+
+struct TariffService::DictionaryCache
+{
+    std::mutex mutex;
+    std::uint64_t generation = 0; // Увеличивается при каждом сбросе
+    std::optional<std::vector<Unit>> units;
+    std::optional<std::vector<Enumeration>> enumerations;
+    std::map<int, std::optional<std::vector<EnumValue>>> enumValues; // Элементы не удаляются
+    std::optional<std::vector<Class>> classes;
+    std::optional<std::vector<Parameter>> parameters;
+    std::optional<std::vector<Coefficient>> coefficients;
+    std::optional<std::shared_ptr<const RuleEngine>> rules;
+
+    // Сброс справочников, зависящих от таблицы; пустое или неизвестное имя - сброс всех
+    void Invalidate(std::string_view table)
+    {
+        std::lock_guard lock(mutex);
+        ++generation;
+
+        bool rule = table == "funct_r" || table == "arg_funct" || table == "fact_fun" || table == "fact_par" ||
+                    table == "decision_rule" || table == "const" || table == "fun_comp";
+        bool all = !rule && table != "ei" && table != "parametr1" && table != "coefficient" &&
+                   table != "enum_val_r" && table != "pos_enum" && table != "chem_class";
+        // Параметры содержат наименование единицы измерения
+        if (all || table == "ei")
+        {
+            units.reset();
+            parameters.reset();
+        }
+        if (all || table == "parametr1")
+        {
+            parameters.reset();
+        }
+        if (all || table == "coefficient")
+        {
+            coefficients.reset();
+        }
+        if (all || table == "enum_val_r")
+        {
+            enumerations.reset();
+        }
+        if (all || table == "enum_val_r" || table == "pos_enum")
+        {
+            for (auto& [enumId, values] : enumValues)
+            {
+                values.reset();
+            }
+        }
+        if (all || table == "chem_class")
+        {
+            classes.reset();
+        }
+        if (all || rule)
+        {
+            rules.reset();
+        }
+    }
+};
+
 TariffService::TariffService(std::shared_ptr<db::DbApi> api)
     : api_(api)
+    , cache_(std::make_unique<DictionaryCache>())
 {
+    // Без подключения к БД кэш не используется
+    try
+    {
+        listener_ = api_->ListenDictionaryChanges([cache = cache_.get()](const std::string& table) {
+            cache->Invalidate(table);
+        });
+    }
+    catch (const db::Exception&)
+    {
+    }
 }
 
 TariffService::~TariffService() = default;
 
+bool TariffService::IsCacheUsable() const
+{
+    // Внутри транзакции видны незафиксированные изменения, которые могут быть откачены
+    return listener_ && listener_->IsListening() && api_->GetDatabase()->GetTransactionDepth() == 0;
+}
+
+template <typename T, typename Load>
+T TariffService::ReadCached(std::optional<T>& slot, Load load)
+{
+    if (!IsCacheUsable())
+    {
+        return load();
+    }
+
+    std::uint64_t generation;
+    {
+        std::lock_guard lock(cache_->mutex);
+        if (slot)
+        {
+            return *slot;
+        }
+        generation = cache_->generation;
+    }
+
+    T value = load();
+
+    std::lock_guard lock(cache_->mutex);
+    if (cache_->generation == generation)
+    {
+        slot = value;
+    }
+    return value;
+}
+
+// ==================== Группы изменений ====================
+
+TariffService::Batch::Batch(std::shared_ptr<db::DatabaseManager> db)
+    : db_(std::move(db))
+    , transaction_(std::make_unique<db::Transaction>(*db_))
+{
+}
+
+TariffService::Batch::~Batch() = default;
+
+bool TariffService::Batch::Try(const std::function<void()>& operation)
+{
+    if (!transaction_)
+    {
+        throw std::runtime_error("Группа изменений уже завершена");
+    }
+
+    // Вложенная транзакция - точка сохранения; без Commit откатывается деструктором
+    db::Transaction savepoint(*db_);
+    try
+    {
+        operation();
+        savepoint.Commit();
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        errors_.push_back(e.what());
+        return false;
+    }
+}
+
+void TariffService::Batch::Commit()
+{
+    if (!transaction_)
+    {
+        throw std::runtime_error("Группа изменений уже завершена");
+    }
+    transaction_->Commit();
+    transaction_.reset();
+}
+
+void TariffService::Batch::Rollback()
+{
+    if (!transaction_)
+    {
+        throw std::runtime_error("Группа изменений уже завершена");
+    }
+    transaction_->Rollback();
+    transaction_.reset();
+}
+
+const std::vector<std::string>& TariffService::Batch::GetErrors() const
+{
+    return errors_;
+}
+
+TariffService::Batch TariffService::BeginBatch()
+{
+    return Batch(api_->GetDatabase());
+}
+
 void TariffService::InitializeDatabase()
 {
     api_->InitializeSchema();
@@ -19,176 +288,205 @@ void TariffService::InitializeDatabase()
 
 std::vector<Unit> TariffService::GetAllUnits()
 {
-    auto dbUnits = api_->GetAllUnits();
-    std::vector<Unit> units;
-    units.reserve(dbUnits.size());
-    for (const auto& u : dbUnits)
-    {
-        Unit unit;
-        unit.id = u.id;
-        unit.code = u.code;
-        unit.name = u.name;
-        unit.note = u.note;
-        units.push_back(unit);
-    }
-    return units;
+    return ReadCached(cache_->units, [this] {
+        auto dbUnits = api_->GetAllUnits();
+        std::vector<Unit> units;
+        units.reserve(dbUnits.size());
+        for (const auto& u : dbUnits)
+        {
+            Unit unit;
+            unit.id = u.id;
+            unit.code = u.code;
+            unit.name = u.name;
+            unit.note = u.note;
+            units.push_back(unit);
+        }
+        return units;
+    });
 }
 
 Unit TariffService::CreateUnit(const Unit& unit)
 {
     Unit result = unit;
     result.id = api_->CreateUnit(unit.code, unit.name, unit.note);
+    cache_->Invalidate("ei");
     return result;
 }
 
 void TariffService::UpdateUnit(const Unit& unit)
 {
     api_->UpdateUnit(unit.id, unit.code, unit.name, unit.note);
+    cache_->Invalidate("ei");
 }
 
 void TariffService::DeleteUnit(int id)
 {
     api_->DeleteUnit(id);
+    cache_->Invalidate("ei");
 }
 
 // ==================== Перечисления ====================
 
 std::vector<Enumeration> TariffService::GetAllEnumerations()
 {
-    auto dbEnums = api_->GetAllEnums();
-    std::vector<Enumeration> enums;
-    enums.reserve(dbEnums.size());
-    for (const auto& e : dbEnums)
-    {
-        Enumeration enumeration;
-        enumeration.id = e.id;
-        enumeration.code = e.code;
-        enumeration.name = e.name;
-        enumeration.note = e.note;
-        enums.push_back(enumeration);
-    }
-    return enums;
+    return ReadCached(cache_->enumerations, [this] {
+        auto dbEnums = api_->GetAllEnums();
+        std::vector<Enumeration> enums;
+        enums.reserve(dbEnums.size());
+        for (const auto& e : dbEnums)
+        {
+            Enumeration enumeration;
+            enumeration.id = e.id;
+            enumeration.code = e.code;
+            enumeration.name = e.name;
+            enumeration.note = e.note;
+            enums.push_back(enumeration);
+        }
+        return enums;
+    });
 }
 
 Enumeration TariffService::CreateEnumeration(const Enumeration& enumeration)
 {
     Enumeration result = enumeration;
     result.id = api_->CreateEnum(enumeration.code, enumeration.name, enumeration.note);
+    cache_->Invalidate("enum_val_r");
     return result;
 }
 
 void TariffService::DeleteEnumeration(int id)
 {
     api_->DeleteEnum(id);
+    cache_->Invalidate("enum_val_r");
 }
 
 std::vector<EnumValue> TariffService::GetEnumValues(int enumId)
 {
-    auto dbValues = api_->GetEnumValues(enumId);
-    std::vector<EnumValue> values;
-    values.reserve(dbValues.size());
-    for (const auto& v : dbValues)
+    std::optional<std::vector<EnumValue>>* slot;
     {
-        EnumValue value;
-        value.id = v.id;
-        value.enumId = enumId;
-        value.code = v.code;
-        value.name = v.name;
-        value.position = v.position;
-        value.note = v.note;
-        values.push_back(value);
+        std::lock_guard lock(cache_->mutex);
+        slot = &cache_->enumValues[enumId];
     }
-    return values;
+
+    return ReadCached(*slot, [this, enumId] {
+        auto dbValues = api_->GetEnumValues(enumId);
+        std::vector<EnumValue> values;
+        values.reserve(dbValues.size());
+        for (const auto& v : dbValues)
+        {
+            EnumValue value;
+            value.id = v.id;
+            value.enumId = enumId;
+            value.code = v.code;
+            value.name = v.name;
+            value.position = v.position;
+            value.note = v.note;
+            values.push_back(value);
+        }
+        return values;
+    });
 }
 
 EnumValue TariffService::CreateEnumValue(const EnumValue& value)
 {
     EnumValue result = value;
     result.id = api_->CreateEnumValue(value.enumId, value.code, value.name, value.position, value.note);
+    cache_->Invalidate("pos_enum");
     return result;
 }
 
 void TariffService::DeleteEnumValue(int id)
 {
     api_->DeleteEnumValue(id);
+    cache_->Invalidate("pos_enum");
 }
 
 // ==================== Классы ====================
 
 std::vector<Class> TariffService::GetAllClasses()
 {
-    auto dbClasses = api_->GetAllClasses();
-    std::vector<Class> classes;
-    classes.reserve(dbClasses.size());
-    for (const auto& c : dbClasses)
-    {
-        Class cls;
-        cls.id = c.id;
-        cls.code = c.code;
-        cls.name = c.name;
-        cls.parentId = c.parentId;
-        cls.level = c.level;
-        cls.note = c.note;
-        classes.push_back(cls);
-    }
-    return classes;
+    return ReadCached(cache_->classes, [this] {
+        auto dbClasses = api_->GetAllClasses();
+        std::vector<Class> classes;
+        classes.reserve(dbClasses.size());
+        for (const auto& c : dbClasses)
+        {
+            Class cls;
+            cls.id = c.id;
+            cls.code = c.code;
+            cls.name = c.name;
+            cls.parentId = c.parentId;
+            cls.level = c.level;
+            cls.note = c.note;
+            classes.push_back(cls);
+        }
+        return classes;
+    });
 }
 
 Class TariffService::CreateClass(const Class& cls)
 {
     Class result = cls;
     result.id = api_->CreateClass(cls.code, cls.name, cls.parentId, cls.note);
+    cache_->Invalidate("chem_class");
     return result;
 }
 
 void TariffService::UpdateClass(const Class& cls)
 {
     api_->UpdateClass(cls.id, cls.code, cls.name, cls.note);
+    cache_->Invalidate("chem_class");
 }
 
 void TariffService::DeleteClass(int id)
 {
     api_->DeleteClass(id);
+    cache_->Invalidate("chem_class");
 }
 
 // ==================== Параметры ====================
 
 std::vector<Parameter> TariffService::GetAllParameters()
 {
-    auto dbParams = api_->GetAllParameters();
-    std::vector<Parameter> params;
-    params.reserve(dbParams.size());
-    for (const auto& p : dbParams)
-    {
-        Parameter param;
-        param.id = p.id;
-        param.code = p.code;
-        param.name = p.name;
-        param.classId = p.classId;
-        param.type = p.type;
-        param.unitId = p.unitId;
-        param.unitName = p.unitName;
-        param.note = p.note;
-        params.push_back(param);
-    }
-    return params;
+    return ReadCached(cache_->parameters, [this] {
+        auto dbParams = api_->GetAllParameters();
+        std::vector<Parameter> params;
+        params.reserve(dbParams.size());
+        for (const auto& p : dbParams)
+        {
+            Parameter param;
+            param.id = p.id;
+            param.code = p.code;
+            param.name = p.name;
+            param.classId = p.classId;
+            param.type = p.type;
+            param.unitId = p.unitId;
+            param.unitName = p.unitName;
+            param.note = p.note;
+            params.push_back(param);
+        }
+        return params;
+    });
 }
 
 Parameter TariffService::CreateParameter(const Parameter& param)
 {
     Parameter result = param;
     result.id = api_->CreateParameter(param.code, param.name, param.classId, param.type, param.unitId, param.note);
+    cache_->Invalidate("parametr1");
     return result;
 }
 
 void TariffService::UpdateParameter(const Parameter& param)
 {
     api_->UpdateParameter(param.id, param.code, param.name, param.type, param.unitId, param.note);
+    cache_->Invalidate("parametr1");
 }
 
 void TariffService::DeleteParameter(int id)
 {
     api_->DeleteParameter(id);
+    cache_->Invalidate("parametr1");
 }
 
 // ==================== Типы услуг ====================
@@ -214,44 +512,65 @@ std::vector<ServiceType> TariffService::GetAllServiceTypes()
 
 ServiceType TariffService::GetServiceType(int id)
 {
-    auto types = GetAllServiceTypes();
-    for (auto& t : types)
+    auto details = api_->GetServiceType(id);
+    if (!details)
     {
-        if (t.id == id)
-        {
-            auto params = api_->GetServiceTypeParams(id);
-            for (const auto& p : params)
-            {
-                ServiceTypeParameter param;
-                param.parameterId = p.parId;
-                param.code = p.code;
-                param.name = p.name;
-                param.type = p.type;
-                param.isRequired = p.isRequired;
-                param.defaultValue = p.defaultValNum;
-                param.defaultValueStr = p.defaultValStr;
-                param.minValue = p.minVal;
-                param.maxValue = p.maxVal;
-                param.unitName = p.unitName;
-                t.parameters.push_back(param);
-            }
-            return t;
-        }
+        throw std::runtime_error("Тип услуги не найден");
     }
-    throw std::runtime_error("Тип услуги не найден");
+
+    const auto& t = details->serviceType;
+    ServiceType type;
+    type.id = t.id;
+    type.code = t.code;
+    type.name = t.name;
+    type.classId = t.classId;
+    type.className = t.className;
+    type.note = t.note;
+    type.parameters.reserve(details->params.size());
+    for (const auto& p : details->params)
+    {
+        ServiceTypeParameter param;
+        param.parameterId = p.parId;
+        param.code = p.code;
+        param.name = p.name;
+        param.type = p.type;
+        param.isRequired = p.isRequired;
+        param.defaultValue = p.defaultValNum;
+        param.defaultValueStr = p.defaultValStr;
+        param.minValue = p.minVal;
+        param.maxValue = p.maxVal;
+        param.unitName = p.unitName;
+        type.parameters.push_back(param);
+    }
+    return type;
 }
 
 ServiceType TariffService::CreateServiceType(const ServiceType& serviceType)
 {
     ServiceType result = serviceType;
-    result.id = api_->CreateServiceType(serviceType.code, serviceType.name, serviceType.classId, serviceType.note);
-    
+
+    db::ServiceTypeInfo info{};
+    info.code = serviceType.code;
+    info.name = serviceType.name;
+    info.classId = serviceType.classId;
+    info.note = serviceType.note;
+
+    std::vector<db::ServiceTypeParamInfo> params;
+    params.reserve(serviceType.parameters.size());
     for (const auto& p : serviceType.parameters)
     {
-        api_->AddServiceTypeParam(result.id, p.parameterId, p.isRequired, 
-                                   p.defaultValue, p.defaultValueStr, p.minValue, p.maxValue);
+        db::ServiceTypeParamInfo param{};
+        param.parId = p.parameterId;
+        param.isRequired = p.isRequired;
+        param.defaultValNum = p.defaultValue;
+        param.defaultValStr = p.defaultValueStr;
+        param.minVal = p.minValue;
+        param.maxVal = p.maxValue;
+        params.push_back(param);
     }
-    
+
+    // Тип услуги и его параметры записываются за один сетевой обмен
+    result.id = api_->CreateServiceTypeWithParams(info, params);
     return result;
 }
 
@@ -285,20 +604,19 @@ std::vector<Executor> TariffService::GetAllExecutors()
     executors.reserve(dbExecutors.size());
     for (const auto& e : dbExecutors)
     {
-        Executor executor;
-        executor.id = e.id;
-        executor.code = e.code;
-        executor.name = e.name;
-        executor.address = e.address;
-        executor.phone = e.phone;
-        executor.email = e.email;
-        executor.isActive = e.isActive;
-        executor.note = e.note;
-        executors.push_back(executor);
+        executors.push_back(ToExecutor(e));
     }
     return executors;
 }
 
+Page<Executor> TariffService::GetExecutorsPage(int pageSize, const std::optional<PageCursor>& after,
+                                               const ExecutorFilter& filter)
+{
+    db::ExecutorFilter dbFilter;
+    dbFilter.isActive = filter.isActive;
+    return ToPage<Executor>(api_->GetExecutorsPage(pageSize, ToDbCursor(after), dbFilter), ToExecutor);
+}
+
 Executor TariffService::CreateExecutor(const Executor& executor)
 {
     Executor result = executor;
@@ -327,65 +645,84 @@ std::vector<Tariff> TariffService::GetAllTariffs()
     tariffs.reserve(dbTariffs.size());
     for (const auto& t : dbTariffs)
     {
-        Tariff tariff;
-        tariff.id = t.id;
-        tariff.code = t.code;
-        tariff.name = t.name;
-        tariff.serviceTypeId = t.serviceTypeId;
-        tariff.serviceName = t.serviceName;
-        tariff.executorId = t.executorId;
-        tariff.executorName = t.executorName;
-        tariff.dateBegin = t.dateBegin;
-        tariff.dateEnd = t.dateEnd;
-        tariff.isWithVat = t.isWithVat;
-        tariff.vatRate = t.vatRate;
-        tariff.isActive = t.isActive;
-        tariff.note = t.note;
-        tariffs.push_back(tariff);
+        tariffs.push_back(ToTariff(t));
     }
     return tariffs;
 }
 
+Page<Tariff> TariffService::GetTariffsPage(int pageSize, const std::optional<PageCursor>& after,
+                                           const TariffFilter& filter)
+{
+    db::TariffFilter dbFilter;
+    dbFilter.serviceTypeId = filter.serviceTypeId;
+    dbFilter.isActive = filter.isActive;
+    dbFilter.onDate = filter.onDate;
+    return ToPage<Tariff>(api_->GetTariffsPage(pageSize, ToDbCursor(after), dbFilter), ToTariff);
+}
+
 Tariff TariffService::GetTariff(int id)
 {
-    auto tariffs = GetAllTariffs();
-    for (auto& t : tariffs)
+    auto details = api_->GetTariff(id);
+    if (!details)
     {
-        if (t.id == id)
-        {
-            auto rates = api_->GetTariffRates(id);
-            for (const auto& r : rates)
-            {
-                TariffRate rate;
-                rate.id = r.id;
-                rate.tariffId = id;
-                rate.code = r.code;
-                rate.name = r.name;
-                rate.value = r.value;
-                rate.unitId = r.unitId;
-                rate.unitName = r.unitName;
-                rate.note = r.note;
-                t.rates.push_back(rate);
-            }
-            return t;
-        }
+        throw std::runtime_error("Тариф не найден");
+    }
+
+    Tariff tariff = ToTariff(details->tariff);
+    tariff.rates.reserve(details->rates.size());
+    for (const auto& r : details->rates)
+    {
+        TariffRate rate;
+        rate.id = r.id;
+        rate.tariffId = id;
+        rate.code = r.code;
+        rate.name = r.name;
+        rate.value = r.value;
+        rate.unitId = r.unitId;
+        rate.unitName = r.unitName;
+        rate.note = r.note;
+        tariff.rates.push_back(rate);
     }
-    throw std::runtime_error("Тариф не найден");
+    return tariff;
 }
 
 Tariff TariffService::CreateTariff(const Tariff& tariff)
 {
     Tariff result = tariff;
-    result.id = api_->CreateTariff(tariff.serviceTypeId, tariff.code, tariff.name,
-                                    tariff.executorId, tariff.dateBegin, tariff.dateEnd,
-                                    tariff.isWithVat, tariff.vatRate, tariff.isActive, tariff.note);
-    
-    for (auto& rate : result.rates)
+
+    db::TariffInfo info{};
+    info.code = tariff.code;
+    info.name = tariff.name;
+    info.serviceTypeId = tariff.serviceTypeId;
+    info.executorId = tariff.executorId;
+    info.dateBegin = tariff.dateBegin;
+    info.dateEnd = tariff.dateEnd;
+    info.isWithVat = tariff.isWithVat;
+    info.vatRate = tariff.vatRate;
+    info.isActive = tariff.isActive;
+    info.note = tariff.note;
+
+    std::vector<db::TariffRateInfo> rates;
+    rates.reserve(tariff.rates.size());
+    for (const auto& r : tariff.rates)
+    {
+        db::TariffRateInfo rate{};
+        rate.code = r.code;
+        rate.name = r.name;
+        rate.value = r.value;
+        rate.unitId = r.unitId;
+        rate.note = r.note;
+        rates.push_back(rate);
+    }
+
+    // Тариф и его ставки записываются за один сетевой обмен
+    result.id = api_->CreateTariffWithRates(info, rates);
+    for (std::size_t i = 0; i < result.rates.size(); ++i)
     {
-        rate.tariffId = result.id;
-        rate.id = api_->CreateTariffRate(result.id, rate.code, rate.name, rate.value, rate.unitId, rate.note);
+        result.rates[i].tariffId = result.id;
+        result.rates[i].id = rates[i].id;
     }
-    
+
     return result;
 }
 
@@ -423,71 +760,85 @@ void TariffService::DeleteTariffRate(int id)
 
 std::vector<Order> TariffService::GetAllOrders()
 {
-    auto dbOrders = api_->GetAllOrders();
     std::vector<Order> orders;
-    orders.reserve(dbOrders.size());
-    for (const auto& o : dbOrders)
+    ForEachOrder([&](const Order& order) { orders.push_back(order); });
+    return orders;
+}
+
+std::size_t TariffService::ForEachOrder(const std::function<void(const Order&)>& callback)
+{
+    Order order;
+    return api_->ForEachOrder([&](const db::OrderInfo& o) {
+        AssignOrder(order, o);
+        callback(order);
+    });
+}
+
+Page<Order> TariffService::GetOrdersPage(int pageSize, const std::optional<PageCursor>& after,
+                                         const OrderFilter& filter)
+{
+    db::OrderFilter dbFilter;
+    if (filter.status)
     {
-        Order order;
-        order.id = o.id;
-        order.code = o.code;
-        order.serviceTypeId = o.serviceTypeId;
-        order.serviceName = o.serviceName;
-        order.orderDate = o.orderDate;
-        order.executionDate = o.executionDate;
-        order.status = static_cast<OrderStatus>(o.status);
-        order.executorId = o.executorId;
-        order.executorName = o.executorName;
-        order.tariffId = o.tariffId;
-        order.tariffName = o.tariffName;
-        order.totalCost = o.totalCost;
-        order.note = o.note;
-        orders.push_back(order);
+        dbFilter.status = static_cast<int>(*filter.status);
     }
-    return orders;
+    dbFilter.dateFrom = filter.dateFrom;
+    dbFilter.dateTo = filter.dateTo;
+    dbFilter.serviceTypeId = filter.serviceTypeId;
+    return ToPage<Order>(api_->GetOrdersPage(pageSize, ToDbCursor(after), dbFilter), [](const db::OrderInfo& o) {
+        Order order;
+        AssignOrder(order, o);
+        return order;
+    });
 }
 
 Order TariffService::GetOrder(int id)
 {
-    auto orders = GetAllOrders();
-    for (auto& o : orders)
+    auto details = api_->GetOrder(id);
+    if (!details)
     {
-        if (o.id == id)
-        {
-            auto params = api_->GetOrderParams(id);
-            for (const auto& p : params)
-            {
-                OrderParameterValue param;
-                param.parameterId = p.parId;
-                param.code = p.code;
-                param.name = p.name;
-                param.type = p.type;
-                param.numValue = p.valNum;
-                param.strValue = p.valStr;
-                param.dateValue = p.valDate;
-                param.enumId = p.enumId;
-                param.enumName = p.enumName;
-                param.unitName = p.unitName;
-                o.parameters.push_back(param);
-            }
-            return o;
-        }
+        throw std::runtime_error("Заказ не найден");
+    }
+
+    Order order;
+    AssignOrder(order, details->order);
+    order.parameters.reserve(details->params.size());
+    for (const auto& p : details->params)
+    {
+        order.parameters.push_back(ToOrderParameter(p));
     }
-    throw std::runtime_error("Заказ не найден");
+    return order;
 }
 
 Order TariffService::CreateOrder(const Order& order)
 {
     Order result = order;
-    result.id = api_->CreateOrder(order.code, order.serviceTypeId, order.orderDate,
-                                   order.executionDate, static_cast<int>(order.status),
-                                   order.executorId, order.tariffId, order.note);
-    
+
+    db::OrderInfo info{};
+    info.code = order.code;
+    info.serviceTypeId = order.serviceTypeId;
+    info.orderDate = order.orderDate;
+    info.executionDate = order.executionDate;
+    info.status = static_cast<int>(order.status);
+    info.executorId = order.executorId;
+    info.tariffId = order.tariffId;
+    info.note = order.note;
+
+    std::vector<db::OrderParamInfo> params;
+    params.reserve(order.parameters.size());
     for (const auto& p : order.parameters)
     {
-        api_->SetOrderParam(result.id, p.parameterId, p.numValue, p.strValue, p.dateValue, p.enumId);
+        db::OrderParamInfo param{};
+        param.parId = p.parameterId;
+        param.valNum = p.numValue;
+        param.valStr = p.strValue;
+        param.valDate = p.dateValue;
+        param.enumId = p.enumId;
+        params.push_back(param);
     }
-    
+
+    // Заказ и значения его параметров записываются за один сетевой обмен
+    result.id = api_->CreateOrderWithParams(info, params);
     return result;
 }
 
@@ -505,33 +856,82 @@ void TariffService::DeleteOrder(int id)
 void TariffService::SetOrderParameter(int orderId, const OrderParameterValue& param)
 {
     api_->SetOrderParam(orderId, param.parameterId, param.numValue, param.strValue, param.dateValue, param.enumId);
+
+    auto sessions = GetRuleSessions(orderId);
+    if (sessions.empty())
+    {
+        return;
+    }
+    // Константы сопоставляются с параметрами по коду
+    OrderParameterValue value = param;
+    if (value.code.empty())
+    {
+        for (const auto& parameter : GetAllParameters())
+        {
+            if (parameter.id == value.parameterId)
+            {
+                value.code = parameter.code;
+                break;
+            }
+        }
+    }
+    for (const auto& session : sessions)
+    {
+        session->SetParameter(value);
+    }
 }
 
 void TariffService::RemoveOrderParameter(int orderId, int parameterId)
 {
     api_->RemoveOrderParam(orderId, parameterId);
+    for (const auto& session : GetRuleSessions(orderId))
+    {
+        session->RemoveParameter(parameterId);
+    }
+}
+
+std::vector<std::shared_ptr<RuleSession>> TariffService::GetRuleSessions(int orderId)
+{
+    std::lock_guard lock(sessionsMutex_);
+    std::vector<std::shared_ptr<RuleSession>> result;
+    auto [begin, end] = sessions_.equal_range(orderId);
+    for (auto it = begin; it != end;)
+    {
+        if (auto session = it->second.lock())
+        {
+            result.push_back(std::move(session));
+            ++it;
+        }
+        else
+        {
+            it = sessions_.erase(it);
+        }
+    }
+    return result;
 }
 
 // ==================== Коэффициенты ====================
 
 std::vector<Coefficient> TariffService::GetAllCoefficients()
 {
-    auto dbCoeffs = api_->GetAllCoefficients();
-    std::vector<Coefficient> coeffs;
-    coeffs.reserve(dbCoeffs.size());
-    for (const auto& c : dbCoeffs)
-    {
-        Coefficient coeff;
-        coeff.id = c.id;
-        coeff.code = c.code;
-        coeff.name = c.name;
-        coeff.valueMin = c.valueMin;
-        coeff.valueMax = c.valueMax;
-        coeff.valueDefault = c.valueDefault;
-        coeff.note = c.note;
-        coeffs.push_back(coeff);
-    }
-    return coeffs;
+    return ReadCached(cache_->coefficients, [this] {
+        auto dbCoeffs = api_->GetAllCoefficients();
+        std::vector<Coefficient> coeffs;
+        coeffs.reserve(dbCoeffs.size());
+        for (const auto& c : dbCoeffs)
+        {
+            Coefficient coeff;
+            coeff.id = c.id;
+            coeff.code = c.code;
+            coeff.name = c.name;
+            coeff.valueMin = c.valueMin;
+            coeff.valueMax = c.valueMax;
+            coeff.valueDefault = c.valueDefault;
+            coeff.note = c.note;
+            coeffs.push_back(coeff);
+        }
+        return coeffs;
+    });
 }
 
 Coefficient TariffService::CreateCoefficient(const Coefficient& coeff)
@@ -539,6 +939,7 @@ Coefficient TariffService::CreateCoefficient(const Coefficient& coeff)
     Coefficient result = coeff;
     result.id = api_->CreateCoefficient(coeff.code, coeff.name, coeff.valueMin, 
                                          coeff.valueMax, coeff.valueDefault, coeff.note);
+    cache_->Invalidate("coefficient");
     return result;
 }
 
@@ -546,11 +947,13 @@ void TariffService::UpdateCoefficient(const Coefficient& coeff)
 {
     api_->UpdateCoefficient(coeff.id, coeff.code, coeff.name, coeff.valueMin,
                              coeff.valueMax, coeff.valueDefault, coeff.note);
+    cache_->Invalidate("coefficient");
 }
 
 void TariffService::DeleteCoefficient(int id)
 {
     api_->DeleteCoefficient(id);
+    cache_->Invalidate("coefficient");
 }
 
 // ==================== Расчеты ====================
@@ -560,6 +963,65 @@ double TariffService::CalculateOrderCost(int orderId, std::optional<int> tariffI
     return api_->CalculateOrderCost(orderId, tariffId);
 }
 
+double TariffService::QuoteOrderCost(int orderId, std::optional<int> tariffId)
+{
+    return api_->QuoteOrderCost(orderId, tariffId);
+}
+
+double TariffService::AcceptOrderTariff(int orderId, int tariffId)
+{
+    return api_->AcceptOrderTariff(orderId, tariffId);
+}
+
+std::shared_ptr<const RuleEngine> TariffService::GetRuleEngine()
+{
+    return ReadCached(cache_->rules, [this] { return std::make_shared<const RuleEngine>(api_->LoadRuleSet()); });
+}
+
+std::optional<double> TariffService::EvaluateRule(int functionId, int objectId, int orderId)
+{
+    auto engine = GetRuleEngine();
+    std::vector<OrderParameterValue> parameters;
+    for (const auto& p : api_->GetOrderParams(orderId))
+    {
+        parameters.push_back(ToOrderParameter(p));
+    }
+    return engine->Evaluate(functionId, objectId, parameters);
+}
+
+std::shared_ptr<RuleSession> TariffService::OpenRuleSession(int orderId)
+{
+    auto engine = GetRuleEngine();
+    std::vector<OrderParameterValue> parameters;
+    for (const auto& p : api_->GetOrderParams(orderId))
+    {
+        parameters.push_back(ToOrderParameter(p));
+    }
+    auto session = std::make_shared<RuleSession>(std::move(engine), std::move(parameters));
+
+    std::lock_guard lock(sessionsMutex_);
+    std::erase_if(sessions_, [](const auto& entry) { return entry.second.expired(); });
+    sessions_.emplace(orderId, session);
+    return session;
+}
+
+RuleBatchResult TariffService::EvaluateRuleBatch(int functionId, int objectId, std::span<const int> orderIds)
+{
+    auto engine = GetRuleEngine();
+    auto params = api_->GetOrderParams(orderIds);
+    RuleBatch batch(params.GetCount());
+    for (std::size_t i = 0; i < params.GetCount(); ++i)
+    {
+        // Из параметров с одинаковым кодом действует первый, как в EvaluateRule
+        auto orderParams = params.Get(i);
+        for (auto it = orderParams.rbegin(); it != orderParams.rend(); ++it)
+        {
+            batch.SetParameter(i, it->code, it->valNum, it->valStr);
+        }
+    }
+    return engine->EvaluateBatch(functionId, objectId, batch);
+}
+
 ValidationResult TariffService::ValidateOrder(int orderId)
 {
     auto result = api_->ValidateOrder(orderId);
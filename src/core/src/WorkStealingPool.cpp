@@ -0,0 +1,163 @@
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+
+namespace core
+{
+
+WorkStealingPool::WorkStealingPool(std::size_t threadCount)
+{
+    for (std::size_t i = 0; i <= threadCount; ++i)
+    {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    threads_.reserve(threadCount);
+    for (std::size_t i = 0; i < threadCount; ++i)
+    {
+        threads_.emplace_back(&WorkStealingPool::Work, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+std::size_t WorkStealingPool::GetThreadCount() const
+{
+    return threads_.size();
+}
+
+WorkStealingPool& WorkStealingPool::GetShared()
+{
+    static WorkStealingPool pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    return pool;
+}
+
+void WorkStealingPool::Run(std::size_t count, const std::function<void(std::size_t)>& task)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->task = &task;
+    job->remaining = count;
+
+    // Счетчик увеличивается до публикации задач: иначе задачу могут взять
+    // и уменьшить счетчик раньше, чем она учтена, и он перейдет через ноль
+    {
+        std::lock_guard lock(mutex_);
+        queued_ += count;
+    }
+
+    // Задачи раздаются потокам по очереди; вызывающий берет свои из общей очереди
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        Queue& queue = *queues_[i % queues_.size()];
+        std::lock_guard lock(queue.mutex);
+        queue.tasks.push_back({job, i});
+    }
+    wake_.notify_all();
+
+    // Пока задачи задания не завершены, вызывающий выполняет любые задачи пула
+    std::size_t self = threads_.size();
+    Task next;
+    while (job->remaining.load() > 0)
+    {
+        if (TakeTask(self, next))
+        {
+            Execute(next);
+            continue;
+        }
+        std::size_t remaining = job->remaining.load();
+        if (remaining > 0)
+        {
+            job->remaining.wait(remaining);
+        }
+    }
+
+    if (job->error)
+    {
+        std::rethrow_exception(job->error);
+    }
+}
+
+void WorkStealingPool::Work(std::size_t self)
+{
+    Task task;
+    while (true)
+    {
+        if (TakeTask(self, task))
+        {
+            Execute(task);
+            continue;
+        }
+        std::unique_lock lock(mutex_);
+        wake_.wait(lock, [this] { return stop_ || queued_.load() > 0; });
+        if (stop_)
+        {
+            return;
+        }
+    }
+}
+
+bool WorkStealingPool::TakeTask(std::size_t self, Task& task)
+{
+    {
+        Queue& own = *queues_[self];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            --queued_;
+            return true;
+        }
+    }
+    for (std::size_t offset = 1; offset < queues_.size(); ++offset)
+    {
+        Queue& other = *queues_[(self + offset) % queues_.size()];
+        std::lock_guard lock(other.mutex);
+        if (!other.tasks.empty())
+        {
+            task = other.tasks.front();
+            other.tasks.pop_front();
+            --queued_;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::Execute(const Task& task)
+{
+    Job& job = *task.job;
+    try
+    {
+        (*job.task)(task.index);
+    }
+    catch (...)
+    {
+        std::lock_guard lock(job.errorMutex);
+        if (!job.error)
+        {
+            job.error = std::current_exception();
+        }
+    }
+    if (job.remaining.fetch_sub(1) == 1)
+    {
+        job.remaining.notify_all();
+    }
+}
+
+} // namespace core
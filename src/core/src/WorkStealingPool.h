@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace core
+{
+
+// Пул потоков с очередью задач у каждого потока: поток берет задачи с конца
+// своей очереди, а когда она пуста - забирает из начала чужих. Поток,
+// вызвавший Run, тоже выполняет задачи, поэтому пул без потоков выполняет
+// все последовательно
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(std::size_t threadCount);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    std::size_t GetThreadCount() const;
+
+    // Выполнение task(i) для всех i из [0, count) с ожиданием завершения.
+    // Первое исключение задачи передается вызывающему после завершения остальных
+    void Run(std::size_t count, const std::function<void(std::size_t)>& task);
+
+    // Общий пул: по потоку на ядро, кроме вызывающего
+    static WorkStealingPool& GetShared();
+
+private:
+    struct Job
+    {
+        const std::function<void(std::size_t)>* task = nullptr;
+        std::atomic<std::size_t> remaining{0};
+        std::mutex errorMutex;
+        std::exception_ptr error;
+    };
+
+    // Задача владеет заданием: последняя задача обращается к нему после того,
+    // как вызывающий Run может вернуться
+    struct Task
+    {
+        std::shared_ptr<Job> job;
+        std::size_t index = 0;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void Work(std::size_t self);
+    // Задача из очереди self (с конца) или из чужой очереди (с начала)
+    bool TakeTask(std::size_t self, Task& task);
+    static void Execute(const Task& task);
+
+    std::vector<std::unique_ptr<Queue>> queues_; // По потоку; последняя - для вызывающих Run
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::atomic<std::size_t> queued_{0}; // Задачи в очередях; увеличивается под mutex_
+    bool stop_ = false;
+};
+
+} // namespace core
@@ -0,0 +1,89 @@
+// ============================================================================
+// Async Database Manager
+// Описание: Неблокирующий доступ к PostgreSQL на корутинах Boost.Asio
+// ============================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/awaitable.hpp>
+
+#include "Database.h"
+
+namespace db
+{
+// Асинхронный менеджер подключений. Запросы отправляются через
+// PQsendQueryParams, а ожидание ответа выполняется на сокете подключения,
+// зарегистрированном в io_context, поэтому один поток может держать
+// одновременно столько запросов, сколько подключений в пуле.
+//
+// Объект не потокобезопасен: все корутины, работающие с ним, должны
+// выполняться на одном executor'е (однопоточный io_context или strand).
+// Менеджер должен пережить все запущенные через него корутины.
+//
+//   db::AsyncDatabaseManager db(io.get_executor());
+//   co_await db.Connect(params);
+//   auto result = co_await db.Query("SELECT * FROM GET_ALL_ORDERS()");
+class AsyncDatabaseManager
+{
+public:
+    explicit AsyncDatabaseManager(boost::asio::any_io_executor executor);
+
+    ~AsyncDatabaseManager();
+
+    // Запрет копирования
+    AsyncDatabaseManager(const AsyncDatabaseManager&) = delete;
+    AsyncDatabaseManager& operator=(const AsyncDatabaseManager&) = delete;
+
+    // Подключение: открывает params.pool.minSize подключений (не меньше одного).
+    // При ошибке выбрасывает Exception
+    boost::asio::awaitable<void> Connect(DatabaseManager::ConnectionParams params);
+
+    // Отключение; подключения, занятые запросами, закрываются по их завершении
+    void Disconnect();
+
+    // Проверка подключения
+    bool IsConnected() const;
+
+    // Выполнение параметризованного запроса (строка "NULL" означает NULL значение).
+    // При ошибке выбрасывает Exception
+    boost::asio::awaitable<std::unique_ptr<QueryResult>> Query(std::string query,
+                                                               std::vector<std::string> params = {},
+                                                               ResultFormat format = ResultFormat::Text);
+
+    // Общее количество подключений (свободных и занятых)
+    std::size_t GetSize() const;
+
+    // Количество свободных подключений
+    std::size_t GetIdleCount() const;
+
+private:
+    class AsyncConnection;
+    struct Waiter;
+
+    // Получение подключения: свободное, новое или после ожидания освобождения
+    boost::asio::awaitable<std::unique_ptr<AsyncConnection>> Acquire();
+
+    // Возврат подключения: передается ожидающей корутине или в список свободных
+    void Release(std::unique_ptr<AsyncConnection> connection);
+
+    boost::asio::any_io_executor executor_;
+    std::string connInfo_;
+    ConnectionPool::Options options_;
+    bool connected_ = false;
+    std::uint64_t generation_ = 0;
+
+    std::deque<std::unique_ptr<AsyncConnection>> idle_; // Последние возвращенные - в конце
+    std::deque<std::shared_ptr<Waiter>> waiters_;
+    std::size_t size_ = 0;
+};
+
+} // namespace db
@@ -0,0 +1,153 @@
+// ============================================================================
+// Connection Pool
+// Описание: Потокобезопасный пул подключений к PostgreSQL
+// ============================================================================
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <libpq-fe.h>
+
+#include "StatementCache.h"
+
+namespace db
+{
+// Одно подключение к БД, принадлежащее пулу
+class Connection
+{
+public:
+    Connection(PGconn* conn, std::size_t statementCacheSize);
+
+    ~Connection();
+
+    // Запрет копирования
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    // Низкоуровневый дескриптор libpq
+    PGconn* Get() const;
+
+    // Проверка состояния подключения
+    bool IsHealthy() const;
+
+    // Переподключение с теми же параметрами; кэш операторов сбрасывается
+    bool Reset();
+
+    // Кэш подготовленных операторов подключения
+    StatementCache& GetStatements();
+
+    // Время последнего возврата в пул
+    std::chrono::steady_clock::time_point GetLastUsed() const;
+
+    // Отметка об использовании
+    void Touch();
+
+private:
+    PGconn* conn_;
+    StatementCache statements_;
+    std::chrono::steady_clock::time_point lastUsed_;
+};
+
+// Пул подключений: выдача/возврат, ограничение размера, таймаут ожидания
+// и закрытие подключений, простаивающих дольше заданного времени
+class ConnectionPool : public std::enable_shared_from_this<ConnectionPool>
+{
+public:
+    // Параметры пула
+    struct Options
+    {
+        std::size_t minSize = 1;                          // Подключения, которые не закрываются по простою
+        std::size_t maxSize = 8;                          // Максимальное число подключений
+        std::chrono::milliseconds acquireTimeout{10000};  // Максимальное ожидание свободного подключения
+        std::chrono::seconds maxIdleTime{300};            // Время простоя до закрытия подключения
+        std::size_t statementCacheSize = 128;             // Подготовленных операторов на подключение (0 - без кэша)
+    };
+
+    // Подключение, выданное пулом; возвращается в пул при разрушении
+    class Lease
+    {
+    public:
+        Lease() = default;
+
+        Lease(std::shared_ptr<ConnectionPool> pool, std::unique_ptr<Connection> connection);
+
+        ~Lease();
+
+        Lease(Lease&& other) noexcept = default;
+        Lease& operator=(Lease&& other) noexcept;
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        Connection& operator*() const;
+        Connection* operator->() const;
+
+        explicit operator bool() const;
+
+        // Досрочный возврат подключения в пул
+        void Release();
+
+    private:
+        std::shared_ptr<ConnectionPool> pool_;
+        std::unique_ptr<Connection> connection_;
+    };
+
+    // Создает пул и сразу открывает minSize подключений.
+    // Объект пула должен принадлежать std::shared_ptr
+    ConnectionPool(std::string connInfo, const Options& options);
+
+    ~ConnectionPool();
+
+    // Запрет копирования
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // Получение подключения; при превышении acquireTimeout выбрасывает db::Exception
+    Lease Acquire();
+
+    // Закрытие подключений, простаивающих дольше maxIdleTime
+    void ReapIdle();
+
+    // Закрытие пула; выданные подключения закрываются при возврате
+    void Close();
+
+    // Проверка, открыт ли пул
+    bool IsOpen() const;
+
+    // Общее количество подключений (свободных и выданных)
+    std::size_t GetSize() const;
+
+    // Количество свободных подключений
+    std::size_t GetIdleCount() const;
+
+    // Параметры пула
+    const Options& GetOptions() const;
+
+private:
+    // Открытие нового подключения
+    std::unique_ptr<Connection> Open() const;
+
+    // Возврат подключения в пул
+    void Release(std::unique_ptr<Connection> connection);
+
+    // Извлечение простаивающих подключений (вызывается под мьютексом)
+    void CollectIdle(std::deque<std::unique_ptr<Connection>>& expired);
+
+    std::string connInfo_;
+    Options options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable available_;
+    std::deque<std::unique_ptr<Connection>> idle_; // Последние возвращенные - в конце
+    std::size_t size_ = 0;
+    bool closed_ = false;
+};
+
+} // namespace db
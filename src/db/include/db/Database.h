@@ -5,25 +5,55 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <vector>
 #include <map>
+#include <mutex>
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 
 #include <libpq-fe.h>
 
+#include "ConnectionPool.h"
+#include "NotificationListener.h"
+#include "QueryParams.h"
+#include "QueryStatistics.h"
+#include "SlowQueryLog.h"
+
 namespace db
 {
 // Исключение при работе с базой данных
 class Exception : public std::runtime_error
 {
 public:
-    explicit Exception(const std::string& message);
+    explicit Exception(const std::string& message, std::string sqlState = {});
+
+    // Код SQLSTATE ошибки сервера (пустой, если ошибка не от сервера)
+    const std::string& GetSqlState() const;
+
+private:
+    std::string sqlState_;
 };
 
-// Результат выполнения SQL запроса
+// Формат передачи значений в результате запроса
+enum class ResultFormat
+{
+    Text = 0,  // Текстовое представление (по умолчанию)
+    Binary = 1 // Двоичное представление в сетевом порядке байт
+};
+
+// Результат выполнения SQL запроса.
+// Типизированные методы разбирают как текстовый, так и двоичный формат
+// (int2/int4/int8, float4/float8, numeric, bool, date) без выделения памяти
+// и без исключений; при несовпадении типа возвращается std::nullopt
 class QueryResult
 {
 public:
@@ -41,26 +71,95 @@ public:
     // Получение значения ячейки по имени колонки
     std::optional<std::string> GetValue(int row, const std::string& columnName) const;
 
-    // Получение значения как integer
+    // Получение значения ячейки без копирования; представление действительно,
+    // пока жив QueryResult. Для NULL и для двоичных нетекстовых значений
+    // (int4, float8 и т.п.) возвращает std::nullopt
+    std::optional<std::string_view> GetStringView(int row, int col) const;
+
+    // Проверка ячейки на NULL
+    bool IsNull(int row, int col) const;
+
+    // Получение значения как integer; дробная часть NUMERIC отбрасывается
     std::optional<int> GetInt(int row, int col) const;
 
+    // Получение значения как 64-битного целого
+    std::optional<std::int64_t> GetInt64(int row, int col) const;
+
     // Получение значения как double
     std::optional<double> GetDouble(int row, int col) const;
 
+    // Получение значения как bool (целые числа: отличное от нуля - true)
+    std::optional<bool> GetBool(int row, int col) const;
+
+    // Получение значения как даты
+    std::optional<std::chrono::year_month_day> GetDate(int row, int col) const;
+
     // Проверка успешности выполнения
     bool IsSuccess() const;
 
     // Получение сообщения об ошибке
     std::string GetErrorMessage() const;
 
+    // Получение кода SQLSTATE ошибки
+    std::string GetSqlState() const;
+
 private:
     std::shared_ptr<PGresult> result_;
 };
 
-// Менеджер подключения к базе данных
+// Менеджер подключения к базе данных.
+// Запросы выполняются на подключениях из пула, поэтому методы можно вызывать
+// из нескольких потоков одновременно. Транзакция закрепляет подключение
+// за потоком, вызвавшим BeginTransaction, до Commit/Rollback. Вложенный
+// BeginTransaction создает точку сохранения, и Commit/Rollback на этом уровне
+// освобождают ее или откатывают изменения до нее.
+//
+// Если заданы реплики, запросы потока внутри ReadOnlyScope (вне транзакции)
+// выполняются на наименее загруженной из них. Сеанс - поток: после записи
+// на основном сервере чтение с реплики ждет, пока она применит WAL до позиции
+// этой записи; если реплика не успевает за replicaLagTimeout, запрос
+// выполняется на основном сервере
 class DatabaseManager
 {
 public:
+    // Оператор для пакетного выполнения
+    struct Statement
+    {
+        std::string query;
+        std::vector<std::string> params; // Строка "NULL" означает NULL значение
+
+        // Типизированные параметры (Bind): двоичные значения в params, их OID
+        // и признаки NULL; пустой types - текстовые параметры
+        std::vector<Oid> types{};
+        std::vector<bool> nulls{};
+
+        // Оператор с параметрами, закодированными как в Execute. В отличие
+        // от Execute значения копируются: оператор хранится до отправки пакета
+        template <typename... Args>
+            requires(sizeof...(Args) > 0)
+        static Statement Bind(std::string query, const Args&... args)
+        {
+            detail::BoundParams<Args...> bound(args...);
+            Statement statement{std::move(query), {}};
+            for (int i = 0; i < bound.kCount; ++i)
+            {
+                const char* value = bound.GetValues()[i];
+                auto length = static_cast<std::size_t>(bound.GetLengths()[i]);
+                statement.params.push_back(value ? std::string(value, length) : std::string());
+                statement.types.push_back(bound.GetTypes()[i]);
+                statement.nulls.push_back(value == nullptr);
+            }
+            return statement;
+        }
+    };
+
+    // Реплика для запросов только на чтение (потоковая репликация)
+    struct Replica
+    {
+        std::string host = "localhost";
+        std::string port = "5434";
+    };
+
     // Параметры подключения к БД
     struct ConnectionParams
     {
@@ -69,6 +168,17 @@ public:
         std::string database = "tariff_system";
         std::string user = "postgres";
         std::string password = "postgres";
+        ConnectionPool::Options pool;
+
+        // Реплики; база, пользователь, пароль и параметры пула - как у основного сервера
+        std::vector<Replica> replicas;
+        std::chrono::milliseconds replicaLagTimeout{200}; // Ожидание отстающей реплики
+
+        // Строка подключения libpq к основному серверу
+        std::string ToConnInfo() const;
+
+        // Строка подключения libpq к реплике
+        std::string ToConnInfo(const Replica& replica) const;
     };
 
     // Конструктор
@@ -84,7 +194,8 @@ public:
     // Подключение к базе данных
     bool Connect(const ConnectionParams& params);
 
-    // Отключение от базы данных
+    // Отключение от базы данных. Транзакция текущего потока откатывается;
+    // транзакции других потоков продолжаются на своих подключениях до Commit/Rollback
     void Disconnect();
 
     // Проверка подключения
@@ -94,29 +205,208 @@ public:
     std::unique_ptr<QueryResult> ExecuteQuery(const std::string& query);
 
     // Выполнение параметризованного запроса
-    std::unique_ptr<QueryResult> executeQuery(const std::string& query, const std::vector<std::string>& params);
+    std::unique_ptr<QueryResult> executeQuery(const std::string& query,
+                                              const std::vector<std::string>& params,
+                                              ResultFormat format = ResultFormat::Text);
+
+    // Выполнение запроса с типизированными параметрами $1, $2, ... OID и двоичное
+    // представление каждого параметра выводятся из типа аргумента во время
+    // компиляции: bool, int, std::int64_t, double, строки (std::string,
+    // std::string_view, const char*), std::chrono::year_month_day,
+    // std::optional<T> и std::nullopt (NULL). Значения кодируются в буфер на
+    // стеке, строки передаются без копирования. Результат - в двоичном формате
+    template <typename... Args>
+        requires(sizeof...(Args) > 0)
+    std::unique_ptr<QueryResult> Execute(const std::string& query, const Args&... args)
+    {
+        return Execute(ResultFormat::Binary, query, args...);
+    }
 
-    // Начало транзакции
+    // То же с явно заданным форматом результата
+    template <typename... Args>
+        requires(sizeof...(Args) > 0)
+    std::unique_ptr<QueryResult> Execute(ResultFormat format, const std::string& query, const Args&... args)
+    {
+        detail::BoundParams<Args...> bound(args...);
+        ParamView params{bound.kCount, bound.GetTypes(), bound.GetValues(), bound.GetLengths(), bound.GetFormats()};
+        return ExecuteBound(query, params, format);
+    }
+
+    // Выполнение операторов в конвейерном режиме libpq: все операторы
+    // отправляются до получения первого ответа (один сетевой обмен).
+    // Вне явной транзакции пакет выполняется как одна неявная транзакция:
+    // при ошибке любого оператора откатываются все, выбрасывается Exception
+    std::vector<std::unique_ptr<QueryResult>> ExecutePipeline(const std::vector<Statement>& statements,
+                                                              ResultFormat format = ResultFormat::Text);
+
+    // Потоковое выполнение запроса: строки передаются в onRows порциями по мере
+    // получения, весь результат в памяти не собирается. Порция содержит до chunkRows
+    // строк (при сборке с libpq старше 17 - по одной строке). onRows возвращает
+    // false, чтобы прекратить получение (запрос отменяется на сервере).
+    // Возвращает количество переданных строк. При ошибке выбрасывает Exception
+    std::size_t StreamQuery(const std::string& query,
+                            const std::vector<std::string>& params,
+                            const std::function<bool(const QueryResult& rows)>& onRows,
+                            ResultFormat format = ResultFormat::Text,
+                            int chunkRows = 1000);
+
+    // Загрузка данных командой COPY ... FROM STDIN. writeChunk дописывает в буфер
+    // очередную порцию строк в текстовом формате COPY и возвращает false, когда
+    // данных больше нет. Возвращает количество загруженных строк.
+    // При ошибке (в том числе исключении из writeChunk) COPY прерывается
+    // и выбрасывается Exception
+    std::size_t CopyIn(const std::string& query, const std::function<bool(std::string& chunk)>& writeChunk);
+
+    // Начало транзакции (внутри транзакции - точка сохранения)
     void BeginTransaction();
 
-    // Подтверждение транзакции
+    // Подтверждение транзакции или освобождение точки сохранения
     void Commit();
 
-    // Откат транзакции
+    // Откат транзакции или откат до точки сохранения
     void Rollback();
 
+    // Глубина вложенности транзакций текущего потока (0 - вне транзакции)
+    int GetTransactionDepth() const;
+
     // Выполнение SQL команды без возврата результата
     void Execute(const std::string& query);
 
+    // Начало и конец области запросов только на чтение текущего потока
+    // (вложенные области допускаются); удобнее через ReadOnlyScope
+    void BeginReadOnly();
+    void EndReadOnly();
+
+    // Количество реплик, к которым установлено подключение
+    std::size_t GetReplicaCount() const;
+
+    // Подписка на уведомления NOTIFY по каналам channels. Слушатель работает на
+    // отдельном подключении к основному серверу до своего разрушения.
+    // Без подключения к БД выбрасывает Exception
+    std::unique_ptr<NotificationListener> Listen(std::vector<std::string> channels,
+                                                 NotificationListener::Handler handler) const;
+
     // Получение последней ошибки
-    const std::string& GetLastError() const;
+    std::string GetLastError() const;
 
     // Экранирование строки для SQL
     std::string EscapeString(const std::string& str) const;
 
+    // Пул подключений (nullptr, если подключение не установлено)
+    std::shared_ptr<ConnectionPool> GetPool() const;
+
+    // Снимок статистики ExecuteQuery/executeQuery по нормализованным запросам
+    std::vector<QueryStatistics::StatementStatistics> GetStatistics() const;
+
+    // Статистика запросов: сброс и периодическая выгрузка
+    QueryStatistics& GetQueryStatistics();
+
+    // Журнал запросов ExecuteQuery/executeQuery, выполнявшихся дольше options.threshold.
+    // Для первого медленного вызова каждого запроса запрос повторяется под
+    // EXPLAIN (ANALYZE, BUFFERS) в откатываемой транзакции (точке сохранения)
+    void EnableSlowQueryLog(const SlowQueryLog::Options& options);
+
+    // Отключение журнала медленных запросов
+    void DisableSlowQueryLog();
+
 private:
-    PGconn* conn_ = nullptr;
+    // Параметры запроса в представлении libpq; пустые массивы types, lengths
+    // и formats означают текстовые параметры с выводом типов на сервере
+    struct ParamView
+    {
+        int count = 0;
+        const Oid* types = nullptr;
+        const char* const* values = nullptr;
+        const int* lengths = nullptr;
+        const int* formats = nullptr;
+    };
+
+    // Выполнение запроса с параметрами через кэш подготовленных операторов
+    std::unique_ptr<QueryResult> ExecuteBound(const std::string& query, const ParamView& params, ResultFormat format);
+
+    // Реплика: пул и последняя известная позиция применения WAL
+    struct ReplicaState
+    {
+        std::shared_ptr<ConnectionPool> pool;
+        std::atomic<std::uint64_t> replayLsn{0};
+    };
+
+    // Сеанс потока для маршрутизации на реплики
+    struct SessionState
+    {
+        int readOnlyDepth = 0;
+        bool pendingWrite = false; // Были запросы на основном сервере после получения lsn
+        std::uint64_t lsn = 0;     // Позиция WAL, которую реплика должна применить
+    };
+
+    // Сеансы потоков. Запись потока удаляется при его завершении (SessionOwner),
+    // реестр разделяется с потоками, чтобы пережить менеджер
+    struct SessionRegistry
+    {
+        std::mutex mutex;
+        std::unordered_map<std::thread::id, SessionState> states;
+    };
+
+    // Удаление записей завершающегося потока из реестров сеансов
+    class SessionOwner;
+
+    // Сеанс текущего потока; вызывается под sessions_->mutex.
+    // Запись удаляет только сам поток, поэтому ссылка остается валидной
+    SessionState& CurrentSession();
+
+    // Подключение к реплике для запроса только на чтение; false - запрос
+    // нужно выполнить на основном сервере. session - снимок сеанса потока,
+    // полученная позиция записей публикуется в реестре под его мьютексом
+    bool AcquireReplica(const std::shared_ptr<ConnectionPool>& primary,
+                        const std::vector<std::shared_ptr<ReplicaState>>& replicas,
+                        SessionState session,
+                        ConnectionPool::Lease& lease);
+
+    // Ожидание применения репликой WAL до позиции lsn
+    bool WaitForReplay(Connection& conn, ReplicaState& replica, std::uint64_t lsn) const;
+
+    // Транзакция потока: закрепленное подключение и число открытых точек сохранения
+    struct TransactionState
+    {
+        ConnectionPool::Lease lease;
+        int savepoints = 0;
+    };
+
+    // Транзакция текущего потока; при ее отсутствии выбрасывает Exception.
+    // Запись удаляет только сам поток, поэтому ссылка остается валидной
+    TransactionState& CurrentTransaction();
+
+    // Подключение для выполнения запроса: закрепленное за потоком в транзакции,
+    // либо взятое из пула основного сервера или реплики в lease
+    Connection& AcquireConnection(ConnectionPool::Lease& lease);
+
+    // Проверка результата запроса; при ошибке выбрасывает Exception
+    std::unique_ptr<QueryResult> CheckResult(PGresult* result);
+
+    // Учет выполненного запроса: статистика и журнал медленных запросов
+    void ObserveQuery(Connection& conn,
+                      const std::string& query,
+                      const ParamView& params,
+                      std::chrono::steady_clock::time_point start,
+                      const PGresult* result);
+
+    // План выполнения запроса; изменения, сделанные запросом, откатываются
+    static std::string ExplainQuery(PGconn* conn, const std::string& query, const ParamView& params);
+
+    // Сохранение текста последней ошибки
+    void SetLastError(const std::string& error);
+
+    std::shared_ptr<ConnectionPool> pool_;
+    std::string connInfo_;
+    std::unordered_map<std::thread::id, TransactionState> transactions_;
+    std::vector<std::shared_ptr<ReplicaState>> replicas_;
+    std::chrono::milliseconds replicaLagTimeout_{200};
+    std::atomic<std::size_t> nextReplica_{0};
+    std::shared_ptr<SessionRegistry> sessions_ = std::make_shared<SessionRegistry>();
     std::string lastError_;
+    mutable std::mutex mutex_;
+    QueryStatistics statistics_;
+    std::shared_ptr<SlowQueryLog> slowLog_;
 };
 
 // RAII обертка для транзакций
@@ -136,4 +426,19 @@ private:
     bool committed_;
 };
 
+// RAII обертка для области запросов только на чтение
+class ReadOnlyScope
+{
+public:
+    explicit ReadOnlyScope(DatabaseManager& db);
+
+    ~ReadOnlyScope();
+
+    ReadOnlyScope(const ReadOnlyScope&) = delete;
+    ReadOnlyScope& operator=(const ReadOnlyScope&) = delete;
+
+private:
+    DatabaseManager& db_;
+};
+
 } // namespace db
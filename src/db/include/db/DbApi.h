@@ -2,8 +2,10 @@
 
 #include "Database.h"
 
+#include <functional>
 #include <memory>
 #include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -155,6 +157,84 @@ struct OrderParamInfo
     std::string unitName;
 };
 
+// Order with its parameter values for BulkImportOrders.
+// Order ids and display names are ignored; parameters use parId and the values only
+struct OrderImport
+{
+    OrderInfo order;
+    std::vector<OrderParamInfo> params;
+};
+
+// Single tariff, order or service type with its child rows, read by id in one round trip
+struct TariffDetails
+{
+    TariffInfo tariff;
+    std::vector<TariffRateInfo> rates;
+};
+
+struct OrderDetails
+{
+    OrderInfo order;
+    std::vector<OrderParamInfo> params;
+};
+
+struct ServiceTypeDetails
+{
+    ServiceTypeInfo serviceType;
+    std::vector<ServiceTypeParamInfo> params;
+};
+
+// Parameter values of several orders in one contiguous array, grouped in request order:
+// the parameters of orderIds[i] are params[offsets[i]] .. params[offsets[i + 1] - 1]
+struct OrderParamsBatch
+{
+    std::vector<int> orderIds;
+    std::vector<std::size_t> offsets; // orderIds.size() + 1 entries
+    std::vector<OrderParamInfo> params;
+
+    std::size_t GetCount() const { return orderIds.size(); }
+
+    std::span<const OrderParamInfo> Get(std::size_t index) const
+    {
+        return std::span<const OrderParamInfo>(params).subspan(offsets[index], offsets[index + 1] - offsets[index]);
+    }
+};
+
+// Keyset pagination: position after the last row of the previous page
+struct PageCursor
+{
+    std::string key; // Sort key of the last row (order date, tariff or executor name); empty - no order date
+    int id = 0;
+};
+
+template <typename T>
+struct Page
+{
+    std::vector<T> items;
+    std::optional<PageCursor> next; // Empty on the last page
+};
+
+// Empty strings and std::nullopt mean "no filter"
+struct OrderFilter
+{
+    std::optional<int> status;
+    std::string dateFrom;
+    std::string dateTo;
+    std::optional<int> serviceTypeId;
+};
+
+struct TariffFilter
+{
+    std::optional<int> serviceTypeId;
+    std::optional<bool> isActive;
+    std::string onDate; // Tariffs valid on this date
+};
+
+struct ExecutorFilter
+{
+    std::optional<bool> isActive;
+};
+
 struct CoefficientInfo
 {
     int id;
@@ -175,6 +255,75 @@ struct OptimalExecutorInfo
     double estimatedCost;
 };
 
+// Rule definitions read by LoadRuleSet; field meanings follow the FUNCT_R, FACT_FUN,
+// FACT_PAR, DECISION_RULE, CONST and FUN_COMP tables
+struct RuleFunctionInfo
+{
+    int id;
+    int type; // 0 - predicate, 1 - arithmetic, 2 - logic, 3 - CASE
+    std::string operation;
+};
+
+struct RuleCallInfo
+{
+    int id;
+    int functionId;
+    int objectId;
+    int numCall;
+};
+
+struct RuleArgumentInfo
+{
+    int callId;
+    int numArg;
+    std::optional<double> valNum;
+    std::optional<std::string> valStr;
+    std::optional<int> constId;
+    std::optional<int> valFunctionId;
+    std::optional<int> valCallId;
+};
+
+struct RuleDecisionInfo
+{
+    int functionId;
+    int objectId;
+    int numCall;
+    int decisionFunctionId;
+    std::optional<int> priority;
+};
+
+struct RuleConstantInfo
+{
+    int id;
+    std::string code;
+    std::optional<double> valNum;
+    std::optional<std::string> valStr;
+};
+
+// FUN_COMP edge: the composite function is built from the component
+struct RuleCompositionInfo
+{
+    int functionId;
+    int componentId;
+};
+
+// Arguments are ordered by call and NUM_ARG; decisions by function, object and PRIORITET
+struct RuleSetInfo
+{
+    std::vector<RuleFunctionInfo> functions;
+    std::vector<RuleCallInfo> calls;
+    std::vector<RuleArgumentInfo> arguments;
+    std::vector<RuleDecisionInfo> decisions;
+    std::vector<RuleConstantInfo> constants;
+    std::vector<RuleCompositionInfo> compositions;
+};
+
+struct OrderCostInfo
+{
+    int orderId;
+    double totalCost;
+};
+
 struct ValidationResult
 {
     bool isValid;
@@ -187,9 +336,21 @@ public:
     explicit DbApi(std::shared_ptr<DatabaseManager> db);
     ~DbApi();
 
-    // Initialize database schema
+    // Apply the schema scripts embedded at build time. Scripts whose SHA-256
+    // matches the SCHEMA_MIGRATION ledger are skipped, so an up-to-date
+    // database costs a single query
     void InitializeSchema();
 
+    // Underlying connection manager (transactions, statistics)
+    std::shared_ptr<DatabaseManager> GetDatabase() const;
+
+    // Subscribe to dictionary change notifications (03_notify.sql). onChange
+    // receives the lower-case table name, or an empty string when
+    // notifications may have been missed and every dictionary must be reloaded.
+    // Called from the listener thread
+    std::unique_ptr<NotificationListener> ListenDictionaryChanges(
+        std::function<void(const std::string& table)> onChange);
+
     // ==================== Units of Measure ====================
     int CreateUnit(const std::string& code, const std::string& name, const std::string& note = "");
     void UpdateUnit(int id, const std::string& code, const std::string& name, const std::string& note = "");
@@ -236,6 +397,11 @@ public:
                              std::optional<double> minVal, std::optional<double> maxVal);
     void RemoveServiceTypeParam(int serviceTypeId, int parId);
     std::vector<ServiceTypeParamInfo> GetServiceTypeParams(int serviceTypeId);
+    // Service type with its parameters by primary key; std::nullopt if it does not exist
+    std::optional<ServiceTypeDetails> GetServiceType(int id);
+
+    // Creates a service type and all of its parameters in one pipelined round trip
+    int CreateServiceTypeWithParams(const ServiceTypeInfo& serviceType, const std::vector<ServiceTypeParamInfo>& params);
 
     // ==================== Executors ====================
     int CreateExecutor(const std::string& code, const std::string& name,
@@ -247,6 +413,10 @@ public:
                         const std::string& email, bool isActive, const std::string& note = "");
     void DeleteExecutor(int id);
     std::vector<ExecutorInfo> GetAllExecutors();
+    // Executors ordered by name; each page is an index range scan regardless of its depth
+    Page<ExecutorInfo> GetExecutorsPage(int pageSize,
+                                        const std::optional<PageCursor>& after = std::nullopt,
+                                        const ExecutorFilter& filter = {});
 
     // ==================== Tariffs ====================
     int CreateTariff(int serviceTypeId, const std::string& code, const std::string& name,
@@ -261,6 +431,10 @@ public:
                       const std::string& note = "");
     void DeleteTariff(int id);
     std::vector<TariffInfo> GetAllTariffs();
+    // Tariffs ordered by name
+    Page<TariffInfo> GetTariffsPage(int pageSize,
+                                    const std::optional<PageCursor>& after = std::nullopt,
+                                    const TariffFilter& filter = {});
 
     int CreateTariffRate(int tariffId, const std::string& code, const std::string& name,
                          double value, std::optional<int> unitId = std::nullopt,
@@ -269,6 +443,11 @@ public:
                           double value, std::optional<int> unitId, const std::string& note = "");
     void DeleteTariffRate(int id);
     std::vector<TariffRateInfo> GetTariffRates(int tariffId);
+    // Tariff with its rates by primary key; std::nullopt if it does not exist
+    std::optional<TariffDetails> GetTariff(int id);
+
+    // Creates a tariff and all of its rates in one pipelined round trip; rate ids are written back to rates
+    int CreateTariffWithRates(const TariffInfo& tariff, std::vector<TariffRateInfo>& rates);
 
     void AddTariffCoefficient(int tariffId, int coeffId, double value);
     void RemoveTariffCoefficient(int tariffId, int coeffId);
@@ -284,12 +463,31 @@ public:
                      std::optional<double> totalCost, const std::string& note = "");
     void DeleteOrder(int id);
     std::vector<OrderInfo> GetAllOrders();
+    // Orders from newest to oldest
+    Page<OrderInfo> GetOrdersPage(int pageSize,
+                                  const std::optional<PageCursor>& after = std::nullopt,
+                                  const OrderFilter& filter = {});
+
+    // Streams GET_ALL_ORDERS() row by row; the reference passed to callback is reused between rows.
+    // Returns the number of orders visited
+    std::size_t ForEachOrder(const std::function<void(const OrderInfo&)>& callback);
 
     void SetOrderParam(int orderId, int parId,
                        std::optional<double> valNum, const std::string& valStr = "",
                        const std::string& valDate = "", std::optional<int> enumId = std::nullopt);
     void RemoveOrderParam(int orderId, int parId);
     std::vector<OrderParamInfo> GetOrderParams(int orderId);
+    // Parameters of many orders in one round trip instead of one query per order
+    OrderParamsBatch GetOrderParams(std::span<const int> orderIds);
+    // Order with its parameter values by primary key; std::nullopt if it does not exist
+    std::optional<OrderDetails> GetOrder(int id);
+
+    // Creates an order and all of its parameter values in one pipelined round trip
+    int CreateOrderWithParams(const OrderInfo& order, const std::vector<OrderParamInfo>& params);
+
+    // Streams orders and their parameters through COPY into staging tables and merges them
+    // set-wise in one transaction; returns the new order ids in input order
+    std::vector<int> BulkImportOrders(const std::vector<OrderImport>& orders);
 
     // ==================== Coefficients ====================
     int CreateCoefficient(const std::string& code, const std::string& name,
@@ -326,17 +524,27 @@ public:
     // ==================== Calculations ====================
     double CalculateValue(int functionId, int objectId, std::optional<int> tariffId = std::nullopt);
     double CalculateOrderCost(int orderId, std::optional<int> tariffId = std::nullopt);
+    // Cost of the order under a tariff without storing it; runs on a replica when one is configured
+    double QuoteOrderCost(int orderId, std::optional<int> tariffId = std::nullopt);
+    // Assigns the tariff chosen by the user to the order and stores its cost
+    double AcceptOrderTariff(int orderId, int tariffId);
+    // Reprices all given orders with one set-based statement and stores their TOTAL_COST.
+    // tariffId overrides the tariff of every order; results are ordered by order id
+    std::vector<OrderCostInfo> CalculateOrderCosts(std::span<const int> orderIds,
+                                                   std::optional<int> tariffId = std::nullopt);
     double CalculateOrderItemCost(int orderItemId, int tariffId);
 
     ValidationResult ValidateOrder(int orderId);
 
+    // Reads all rule definitions for in-process evaluation in one pipelined round trip,
+    // from a single snapshot
+    RuleSetInfo LoadRuleSet();
+
     std::vector<OptimalExecutorInfo> FindOptimalExecutor(int serviceTypeId, const std::string& targetDate = "");
     std::vector<OptimalExecutorInfo> FindOptimalTariff(int orderId);
 
 private:
     std::shared_ptr<DatabaseManager> db_;
-    
-    void ExecuteSchemaFile(const std::string& filename);
 };
 
 } // namespace db
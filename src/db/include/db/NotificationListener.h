@@ -0,0 +1,72 @@
+// ============================================================================
+// Notification Listener
+// Описание: Получение уведомлений LISTEN/NOTIFY в фоновом потоке
+// ============================================================================
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <libpq-fe.h>
+
+namespace db
+{
+// Слушатель уведомлений PostgreSQL. Держит собственное подключение вне пула
+// (LISTEN действует в пределах сеанса) и вызывает обработчик из фонового
+// потока. При потере подключения переподключается; так как уведомления за
+// время разрыва потеряны, после восстановления обработчик вызывается
+// с пустым каналом - получатель должен считать изменившимся все
+class NotificationListener
+{
+public:
+    // Уведомление; пустой channel - возможна потеря уведомлений
+    struct Notification
+    {
+        std::string channel;
+        std::string payload;
+    };
+
+    using Handler = std::function<void(const Notification& notification)>;
+
+    // Запускает фоновый поток; первое подключение устанавливается в нем
+    NotificationListener(std::string connInfo, std::vector<std::string> channels, Handler handler);
+
+    // Останавливает поток и закрывает подключение
+    ~NotificationListener();
+
+    // Запрет копирования
+    NotificationListener(const NotificationListener&) = delete;
+    NotificationListener& operator=(const NotificationListener&) = delete;
+
+    // Подключение установлено, LISTEN выполнен для всех каналов
+    // и обработчик получил пустое уведомление о сбросе
+    bool IsListening() const;
+
+private:
+    // Цикл фонового потока
+    void Run();
+
+    // Подключение и подписка на каналы; nullptr при ошибке
+    PGconn* Subscribe() const;
+
+    // Ожидание данных на сокете; false при ошибке подключения
+    bool Receive(PGconn* conn);
+
+    // Пауза с проверкой остановки; false, если поток остановлен
+    bool Sleep(std::chrono::milliseconds duration) const;
+
+    const std::string connInfo_;
+    const std::vector<std::string> channels_;
+    const Handler handler_;
+
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> listening_{false};
+    std::thread thread_;
+};
+
+} // namespace db
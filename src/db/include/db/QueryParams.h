@@ -0,0 +1,256 @@
+// ============================================================================
+// Query Params
+// Описание: Типизированные параметры запроса в двоичном формате
+// ============================================================================
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <libpq-fe.h>
+
+namespace db
+{
+namespace detail
+{
+// Запись целого в сетевом порядке байт
+template <typename T>
+void WriteBigEndian(T value, char* buffer)
+{
+    for (std::size_t i = 0; i < sizeof(T); ++i)
+    {
+        buffer[i] = static_cast<char>(value >> (8 * (sizeof(T) - 1 - i)));
+    }
+}
+
+// Кодирование параметра: OID типа, размер во внутреннем буфере и запись значения.
+// Encode возвращает длину значения и устанавливает data (nullptr - NULL).
+// Строки не копируются: data указывает на исходные символы
+template <typename T>
+struct ParamTraits;
+
+template <>
+struct ParamTraits<bool>
+{
+    static constexpr Oid kType = 16;
+    static constexpr std::size_t kSize = 1;
+
+    static int Encode(bool value, char* buffer, const char*& data)
+    {
+        buffer[0] = value ? 1 : 0;
+        data = buffer;
+        return 1;
+    }
+};
+
+template <>
+struct ParamTraits<int>
+{
+    static constexpr Oid kType = 23;
+    static constexpr std::size_t kSize = 4;
+
+    static int Encode(int value, char* buffer, const char*& data)
+    {
+        WriteBigEndian(static_cast<std::uint32_t>(value), buffer);
+        data = buffer;
+        return 4;
+    }
+};
+
+template <>
+struct ParamTraits<std::int64_t>
+{
+    static constexpr Oid kType = 20;
+    static constexpr std::size_t kSize = 8;
+
+    static int Encode(std::int64_t value, char* buffer, const char*& data)
+    {
+        WriteBigEndian(static_cast<std::uint64_t>(value), buffer);
+        data = buffer;
+        return 8;
+    }
+};
+
+template <>
+struct ParamTraits<double>
+{
+    static constexpr Oid kType = 701;
+    static constexpr std::size_t kSize = 8;
+
+    static int Encode(double value, char* buffer, const char*& data)
+    {
+        static_assert(sizeof(double) == sizeof(std::uint64_t));
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        WriteBigEndian(bits, buffer);
+        data = buffer;
+        return 8;
+    }
+};
+
+// Дата - число дней от 2000-01-01
+template <>
+struct ParamTraits<std::chrono::year_month_day>
+{
+    static constexpr Oid kType = 1082;
+    static constexpr std::size_t kSize = 4;
+
+    static int Encode(const std::chrono::year_month_day& value, char* buffer, const char*& data)
+    {
+        constexpr std::chrono::sys_days epoch = std::chrono::year{2000} / 1 / 1;
+        auto days = (std::chrono::sys_days(value) - epoch).count();
+        WriteBigEndian(static_cast<std::uint32_t>(static_cast<std::int32_t>(days)), buffer);
+        data = buffer;
+        return 4;
+    }
+};
+
+// Строки передаются как text; двоичное представление text совпадает с символами
+template <>
+struct ParamTraits<std::string_view>
+{
+    static constexpr Oid kType = 25;
+    static constexpr std::size_t kSize = 0;
+
+    static int Encode(std::string_view value, char*, const char*& data)
+    {
+        data = value.data() ? value.data() : "";
+        return static_cast<int>(value.size());
+    }
+};
+
+template <>
+struct ParamTraits<std::string> : ParamTraits<std::string_view>
+{
+};
+
+// Нулевой указатель передается как NULL
+template <>
+struct ParamTraits<const char*>
+{
+    static constexpr Oid kType = 25;
+    static constexpr std::size_t kSize = 0;
+
+    static int Encode(const char* value, char*, const char*& data)
+    {
+        data = value;
+        return value ? static_cast<int>(std::strlen(value)) : 0;
+    }
+};
+
+template <>
+struct ParamTraits<char*> : ParamTraits<const char*>
+{
+};
+
+// Литерал nullptr не несет типа строки; NULL задается через std::nullopt
+template <>
+struct ParamTraits<std::nullptr_t>;
+
+template <std::size_t N>
+struct ParamTraits<char[N]> : ParamTraits<std::string_view>
+{
+};
+
+// Пустой optional и std::nullopt передаются как NULL
+template <typename T>
+struct ParamTraits<std::optional<T>>
+{
+    static constexpr Oid kType = ParamTraits<T>::kType;
+    static constexpr std::size_t kSize = ParamTraits<T>::kSize;
+
+    static int Encode(const std::optional<T>& value, char* buffer, const char*& data)
+    {
+        if (!value)
+        {
+            data = nullptr;
+            return 0;
+        }
+        return ParamTraits<T>::Encode(*value, buffer, data);
+    }
+};
+
+template <>
+struct ParamTraits<std::nullopt_t>
+{
+    static constexpr Oid kType = 0; // Тип определяет сервер
+    static constexpr std::size_t kSize = 0;
+
+    static int Encode(std::nullopt_t, char*, const char*& data)
+    {
+        data = nullptr;
+        return 0;
+    }
+};
+
+template <typename T>
+using ParamTraitsOf = ParamTraits<std::remove_cvref_t<T>>;
+
+// Закодированные параметры: массивы для PQexecParams/PQexecPrepared и буфер
+// значений фиксированного размера на стеке. Объект ссылается на собственный
+// буфер и на строки аргументов, поэтому не копируется и не должен
+// переживать аргументы
+template <typename... Args>
+class BoundParams
+{
+public:
+    static constexpr int kCount = static_cast<int>(sizeof...(Args));
+
+    explicit BoundParams(const Args&... args)
+    {
+        std::size_t index = 0;
+        std::size_t offset = 0;
+        (Bind(index++, offset, args), ...);
+    }
+
+    BoundParams(const BoundParams&) = delete;
+    BoundParams& operator=(const BoundParams&) = delete;
+
+    const Oid* GetTypes() const
+    {
+        return types_.data();
+    }
+
+    const char* const* GetValues() const
+    {
+        return values_.data();
+    }
+
+    const int* GetLengths() const
+    {
+        return lengths_.data();
+    }
+
+    const int* GetFormats() const
+    {
+        return formats_.data();
+    }
+
+private:
+    template <typename T>
+    void Bind(std::size_t index, std::size_t& offset, const T& value)
+    {
+        using Traits = ParamTraitsOf<T>;
+        types_[index] = Traits::kType;
+        formats_[index] = 1;
+        lengths_[index] = Traits::Encode(value, buffer_.data() + offset, values_[index]);
+        offset += Traits::kSize;
+    }
+
+    std::array<Oid, sizeof...(Args)> types_{};
+    std::array<const char*, sizeof...(Args)> values_{};
+    std::array<int, sizeof...(Args)> lengths_{};
+    std::array<int, sizeof...(Args)> formats_{};
+    std::array<char, (ParamTraitsOf<Args>::kSize + ... + 0)> buffer_{};
+};
+} // namespace detail
+
+} // namespace db
@@ -0,0 +1,137 @@
+// ============================================================================
+// Query Statistics
+// Описание: Статистика выполнения запросов на стороне клиента
+// ============================================================================
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace db
+{
+// Счетчики по нормализованному тексту запроса: количество вызовов и ошибок,
+// гистограмма задержек, строки и байты результата.
+//
+// Каждый поток пишет в собственный набор счетчиков (relaxed-атомики, без
+// блокировок); мьютекс берется только при первом вызове нового запроса
+// в потоке, при снятии снимка и обнулении
+class QueryStatistics
+{
+public:
+    // Формат периодической выгрузки
+    enum class Format
+    {
+        Text,
+        Json
+    };
+
+    // Снимок счетчиков одного запроса
+    struct StatementStatistics
+    {
+        std::string statement; // Нормализованный текст
+        std::uint64_t calls = 0;
+        std::uint64_t errors = 0;
+        std::uint64_t rows = 0;
+        std::uint64_t bytes = 0; // Объем результатов в памяти libpq
+        double totalMs = 0.0;
+        double maxMs = 0.0;
+        double p50Ms = 0.0;
+        double p95Ms = 0.0;
+        double p99Ms = 0.0;
+    };
+
+    QueryStatistics();
+
+    ~QueryStatistics();
+
+    // Запрет копирования
+    QueryStatistics(const QueryStatistics&) = delete;
+    QueryStatistics& operator=(const QueryStatistics&) = delete;
+
+    // Регистрация выполнения запроса
+    void Record(std::string_view query,
+                std::chrono::steady_clock::duration elapsed,
+                std::uint64_t rows,
+                std::uint64_t bytes,
+                bool failed);
+
+    // Снимок счетчиков, отсортированный по суммарному времени (по убыванию)
+    std::vector<StatementStatistics> Snapshot() const;
+
+    // Обнуление счетчиков
+    void Reset();
+
+    // Периодическая выгрузка снимка в sink из фонового потока.
+    // Повторный вызов заменяет предыдущую выгрузку
+    void StartDump(std::chrono::milliseconds interval, Format format, std::function<void(const std::string&)> sink);
+
+    // Остановка периодической выгрузки
+    void StopDump();
+
+    // Нормализация текста запроса: литералы заменяются на '?', пробелы схлопываются
+    static std::string Normalize(std::string_view query);
+
+    // Форматирование снимка таблицей
+    static std::string ToText(const std::vector<StatementStatistics>& statistics);
+
+    // Форматирование снимка массивом JSON
+    static std::string ToJson(const std::vector<StatementStatistics>& statistics);
+
+private:
+    // Логарифмическая гистограмма в микросекундах: 4 корзины на каждую степень двойки
+    static constexpr std::size_t kBucketCount = 4 * 40;
+
+    struct Counters
+    {
+        explicit Counters(std::string statement);
+
+        const std::string statement;
+        std::atomic<std::uint64_t> calls{0};
+        std::atomic<std::uint64_t> errors{0};
+        std::atomic<std::uint64_t> rows{0};
+        std::atomic<std::uint64_t> bytes{0};
+        std::atomic<std::uint64_t> totalNs{0};
+        std::atomic<std::uint64_t> maxNs{0};
+        std::array<std::atomic<std::uint64_t>, kBucketCount> buckets{};
+    };
+
+    // Счетчики одного потока; адреса Counters стабильны (deque)
+    struct Shard
+    {
+        std::mutex mutex; // Защищает только состав counters
+        std::deque<Counters> counters;
+    };
+
+    // Счетчики текущего потока для данного объекта
+    Counters& Local(std::string_view query);
+
+    static std::size_t BucketOf(std::uint64_t microseconds);
+
+    static double BucketUpperMs(std::size_t bucket);
+
+    const std::uint64_t id_; // Ключ thread_local кэша (адрес объекта может быть переиспользован)
+    const std::shared_ptr<const bool> alive_; // Записи кэшей потоков хранят weak_ptr на него
+
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<Shard>> shards_; // Живут дольше потоков-владельцев
+
+    std::mutex dumpMutex_;
+    std::condition_variable dumpWake_;
+    std::thread dumpThread_;
+    bool dumpStop_ = false;
+};
+
+} // namespace db
@@ -0,0 +1,150 @@
+// ============================================================================
+// Row Mapper
+// Описание: Отображение строк результата запроса на структуры
+// ============================================================================
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "Database.h"
+
+namespace db
+{
+// Привязка колонки результата к полю структуры
+template <typename T, typename Field>
+struct ColumnBinding
+{
+    int column;
+    Field T::*member;
+};
+
+// Создание привязки: Bind(0, &UnitOfMeasure::id)
+template <typename T, typename Field>
+constexpr ColumnBinding<T, Field> Bind(int column, Field T::*member)
+{
+    return {column, member};
+}
+
+// Описание колонок структуры. Специализация объявляет статический кортеж
+// привязок columns, например:
+//   template <> struct RowMapping<UnitOfMeasure>
+//   {
+//       static constexpr auto columns = std::make_tuple(Bind(0, &UnitOfMeasure::id), ...);
+//   };
+template <typename T>
+struct RowMapping;
+
+namespace detail
+{
+// Чтение ячейки в поле; NULL дает значение по умолчанию (0, пустая строка)
+inline void ReadField(const QueryResult& result, int row, int col, int& out)
+{
+    out = result.GetInt(row, col).value_or(0);
+}
+
+inline void ReadField(const QueryResult& result, int row, int col, std::int64_t& out)
+{
+    out = result.GetInt64(row, col).value_or(0);
+}
+
+inline void ReadField(const QueryResult& result, int row, int col, double& out)
+{
+    out = result.GetDouble(row, col).value_or(0.0);
+}
+
+inline void ReadField(const QueryResult& result, int row, int col, bool& out)
+{
+    out = result.GetBool(row, col).value_or(false);
+}
+
+inline void ReadField(const QueryResult& result, int row, int col, std::string& out)
+{
+    if (auto text = result.GetStringView(row, col))
+    {
+        out.assign(*text);
+    }
+    else if (!result.IsNull(row, col))
+    {
+        out = result.GetValue(row, col).value_or("");
+    }
+    else
+    {
+        out.clear();
+    }
+}
+
+// NULL и пустая строка различаются
+inline void ReadField(const QueryResult& result, int row, int col, std::optional<std::string>& out)
+{
+    if (result.IsNull(row, col))
+    {
+        out.reset();
+        return;
+    }
+    out.emplace();
+    ReadField(result, row, col, *out);
+}
+
+inline void ReadField(const QueryResult& result, int row, int col, std::optional<int>& out)
+{
+    out = result.GetInt(row, col);
+}
+
+inline void ReadField(const QueryResult& result, int row, int col, std::optional<std::int64_t>& out)
+{
+    out = result.GetInt64(row, col);
+}
+
+inline void ReadField(const QueryResult& result, int row, int col, std::optional<double>& out)
+{
+    out = result.GetDouble(row, col);
+}
+
+inline void ReadField(const QueryResult& result, int row, int col, std::optional<bool>& out)
+{
+    out = result.GetBool(row, col);
+}
+} // namespace detail
+
+// Заполнение структуры из строки результата по заданным привязкам
+template <typename T, typename... Bindings>
+void MapRow(const QueryResult& result, int row, T& item, const std::tuple<Bindings...>& bindings)
+{
+    std::apply([&](const auto&... binding) { (detail::ReadField(result, row, binding.column, item.*binding.member), ...); },
+               bindings);
+}
+
+// Заполнение структуры из строки результата по RowMapping<T>
+template <typename T>
+void MapRow(const QueryResult& result, int row, T& item)
+{
+    MapRow(result, row, item, RowMapping<T>::columns);
+}
+
+// Отображение всех строк результата за один проход
+template <typename T, typename... Bindings>
+std::vector<T> MapRows(const QueryResult& result, const std::tuple<Bindings...>& bindings)
+{
+    std::vector<T> items;
+    int rowCount = result.GetRowCount();
+    items.resize(static_cast<std::size_t>(rowCount));
+    for (int i = 0; i < rowCount; ++i)
+    {
+        MapRow(result, i, items[static_cast<std::size_t>(i)], bindings);
+    }
+    return items;
+}
+
+// Отображение всех строк результата по RowMapping<T>
+template <typename T>
+std::vector<T> MapRows(const QueryResult& result)
+{
+    return MapRows<T>(result, RowMapping<T>::columns);
+}
+
+} // namespace db
@@ -0,0 +1,73 @@
+// ============================================================================
+// Slow Query Log
+// Описание: Журнал медленных запросов с планами выполнения
+// ============================================================================
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace db
+{
+// Журнал запросов, превысивших порог времени выполнения. Для первого
+// медленного вызова каждого нормализованного запроса дополнительно
+// сохраняется план EXPLAIN (ANALYZE, BUFFERS). При превышении размера
+// файл ротируется: path -> path.1 -> ... -> path.<maxFiles - 1>
+class SlowQueryLog
+{
+public:
+    // Параметры журнала
+    struct Options
+    {
+        std::chrono::milliseconds threshold{500};   // Порог времени выполнения
+        std::string path = "slow_queries.log";       // Текущий файл журнала
+        std::size_t maxFileSize = 10 * 1024 * 1024;  // Размер файла до ротации
+        std::size_t maxFiles = 5;                    // Файлов вместе с текущим
+        bool explain = true;                         // Сохранять план первого вызова
+    };
+
+    explicit SlowQueryLog(Options options);
+
+    // Запрет копирования
+    SlowQueryLog(const SlowQueryLog&) = delete;
+    SlowQueryLog& operator=(const SlowQueryLog&) = delete;
+
+    // Параметры журнала
+    const Options& GetOptions() const;
+
+    // Превышает ли время выполнения порог
+    bool IsSlow(std::chrono::steady_clock::duration elapsed) const;
+
+    // Нужен ли план для запроса: true только один раз для каждого нормализованного текста
+    bool ShouldExplain(std::string_view query);
+
+    // Запись о медленном запросе; error и plan могут быть пустыми
+    void Write(std::string_view query,
+               const std::vector<std::string>* params,
+               std::chrono::steady_clock::duration elapsed,
+               std::string_view error,
+               std::string_view plan);
+
+    // Можно ли выполнить запрос под EXPLAIN: один оператор SELECT/INSERT/UPDATE/DELETE/VALUES/WITH
+    static bool IsExplainable(std::string_view query);
+
+private:
+    // Ротация файлов, если текущий превысил maxFileSize (вызывается под мьютексом)
+    void Rotate();
+
+    Options options_;
+
+    std::mutex mutex_;
+    std::ofstream file_;
+    std::size_t fileSize_ = 0;
+    std::unordered_set<std::string> explained_;
+};
+
+} // namespace db
@@ -0,0 +1,115 @@
+// ============================================================================
+// Statement Cache
+// Описание: LRU-кэш подготовленных операторов одного подключения
+// ============================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <libpq-fe.h>
+
+namespace db
+{
+// Кэш подготовленных операторов. Каждый уникальный текст запроса готовится
+// на сервере один раз (PQprepare), затем выполняется через PQexecPrepared.
+// Если заданы типы параметров, они входят в ключ: один текст с разными
+// типами - разные операторы. При переполнении вытесняется наименее
+// используемый оператор
+class StatementCache
+{
+public:
+    explicit StatementCache(std::size_t capacity);
+
+    // Запрет копирования
+    StatementCache(const StatementCache&) = delete;
+    StatementCache& operator=(const StatementCache&) = delete;
+
+    // Выполнение запроса через подготовленный оператор.
+    // Возвращает результат libpq (владение передается вызывающему)
+    PGresult* Execute(PGconn* conn,
+                      const std::string& query,
+                      int nParams,
+                      const Oid* paramTypes,
+                      const char* const* paramValues,
+                      const int* paramLengths,
+                      const int* paramFormats,
+                      int resultFormat);
+
+    // Постановка запроса в очередь конвейера (PQsendQueryPrepared).
+    // Если оператор еще не подготовлен, перед ним отправляется PQsendPrepare,
+    // а имя оператора записывается в preparedName.
+    // Возвращает число ожидаемых результатов (1 или 2) или 0 при ошибке отправки
+    int Send(PGconn* conn,
+             const std::string& query,
+             int nParams,
+             const Oid* paramTypes,
+             const char* const* paramValues,
+             const int* paramLengths,
+             const int* paramFormats,
+             int resultFormat,
+             std::string& preparedName);
+
+    // Обработка результата подготовки оператора preparedName, отправленной Send.
+    // При ошибке (в том числе при прерванном конвейере) оператор удаляется из кэша,
+    // если ключ не занят к этому времени другим оператором
+    void OnPrepared(const std::string& query,
+                    int nParams,
+                    const Oid* paramTypes,
+                    const std::string& preparedName,
+                    const PGresult* result);
+
+    // Сброс кэша без обращения к серверу (после переподключения)
+    void Clear();
+
+    // Количество операторов в кэше
+    std::size_t GetSize() const;
+
+    // Максимальное количество операторов
+    std::size_t GetCapacity() const;
+
+private:
+    struct Entry
+    {
+        std::string name;
+        std::list<std::string>::iterator position;
+    };
+
+    // Ключ кэша: текст запроса, при заданных типах - с их OID после нулевого
+    // символа. Ссылка действительна до следующего вызова
+    const std::string& Key(const std::string& query, int nParams, const Oid* paramTypes);
+
+    // Поиск или подготовка оператора; nullptr при ошибке подготовки (result - ошибка)
+    const Entry* Prepare(PGconn* conn,
+                         const std::string& key,
+                         const std::string& query,
+                         int nParams,
+                         const Oid* paramTypes,
+                         PGresult*& result);
+
+    // Регистрация нового оператора с вытеснением при переполнении
+    const Entry& Insert(PGconn* conn, const std::string& key);
+
+    // Удаление оператора из кэша и с сервера
+    void Evict(PGconn* conn, const std::string& key);
+
+    // Удаление оператора name только из кэша (на сервере он не создан)
+    void Forget(const std::string& key, const std::string& name);
+
+    // Удаление операторов, вытесненных в конвейерном режиме
+    void FlushDeallocations(PGconn* conn);
+
+    std::size_t capacity_;
+    std::uint64_t counter_ = 0;
+    std::string keyBuffer_;      // Переиспользуемый буфер ключа с типами
+    std::list<std::string> lru_; // Недавно использованные - в начале
+    std::unordered_map<std::string, Entry> entries_;
+    std::vector<std::string> pendingDeallocations_; // В конвейере DEALLOCATE через PQexec недоступен
+};
+
+} // namespace db
@@ -0,0 +1,474 @@
+#include "AsyncDatabase.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+#ifdef _WIN32
+#include <boost/asio/ip/tcp.hpp>
+#else
+#include <boost/asio/posix/stream_descriptor.hpp>
+#endif
+
+namespace asio = boost::asio;
+
+namespace
+{
+// Объект ожидания готовности сокета libpq
+#ifdef _WIN32
+using SocketHandle = asio::ip::tcp::socket;
+#else
+using SocketHandle = asio::posix::stream_descriptor;
+#endif
+} // namespace
+
+// Неблокирующее подключение. Сокет принадлежит libpq: объект asio только
+// ожидает готовность дескриптора и отпускает его перед PQfinish
+class db::AsyncDatabaseManager::AsyncConnection
+{
+public:
+    AsyncConnection(const asio::any_io_executor& executor, PGconn* conn)
+        : conn_(conn)
+        , socket_(executor)
+    {
+    }
+
+    ~AsyncConnection()
+    {
+        Detach();
+        PQfinish(conn_);
+    }
+
+    AsyncConnection(const AsyncConnection&) = delete;
+    AsyncConnection& operator=(const AsyncConnection&) = delete;
+
+    // Асинхронное установление подключения (PQconnectStart/PQconnectPoll)
+    static asio::awaitable<std::unique_ptr<AsyncConnection>> Open(asio::any_io_executor executor,
+                                                                  std::string connInfo,
+                                                                  std::uint64_t generation)
+    {
+        PGconn* conn = PQconnectStart(connInfo.c_str());
+        if (!conn)
+        {
+            throw Exception("Недостаточно памяти для подключения");
+        }
+        auto connection = std::make_unique<AsyncConnection>(executor, conn);
+        connection->generation_ = generation;
+        if (PQstatus(conn) == CONNECTION_BAD)
+        {
+            throw Exception(PQerrorMessage(conn));
+        }
+
+        // Начальное состояние - как после PGRES_POLLING_WRITING.
+        // При переборе адресов libpq может сменить сокет, поэтому после
+        // каждого ожидания дескриптор отпускается
+        auto status = PGRES_POLLING_WRITING;
+        while (status != PGRES_POLLING_OK)
+        {
+            if (status == PGRES_POLLING_FAILED)
+            {
+                throw Exception(PQerrorMessage(conn));
+            }
+            co_await connection->Wait(status == PGRES_POLLING_READING ? SocketHandle::wait_read
+                                                                      : SocketHandle::wait_write);
+            connection->Detach();
+            status = PQconnectPoll(conn);
+        }
+
+        if (PQsetnonblocking(conn, 1) != 0)
+        {
+            throw Exception(PQerrorMessage(conn));
+        }
+        co_return connection;
+    }
+
+    // Выполнение запроса; ошибка сервера возвращается в QueryResult,
+    // ошибка связи - исключением
+    asio::awaitable<std::unique_ptr<QueryResult>> Execute(const std::string& query,
+                                                          const std::vector<const char*>& values,
+                                                          ResultFormat format)
+    {
+        if (!PQsendQueryParams(conn_,
+                               query.c_str(),
+                               static_cast<int>(values.size()),
+                               nullptr,
+                               values.data(),
+                               nullptr,
+                               nullptr,
+                               static_cast<int>(format)))
+        {
+            throw Exception(PQerrorMessage(conn_));
+        }
+
+        // В неблокирующем режиме запрос может не уйти за один вызов PQflush
+        while (int pending = PQflush(conn_))
+        {
+            if (pending < 0)
+            {
+                throw Exception(PQerrorMessage(conn_));
+            }
+            co_await Wait(SocketHandle::wait_write);
+        }
+
+        // Получение результата: ожидание данных, пока libpq занят разбором ответа
+        std::unique_ptr<QueryResult> first;
+        while (true)
+        {
+            while (PQisBusy(conn_))
+            {
+                co_await Wait(SocketHandle::wait_read);
+                if (!PQconsumeInput(conn_))
+                {
+                    throw Exception(PQerrorMessage(conn_));
+                }
+            }
+
+            PGresult* result = PQgetResult(conn_);
+            if (!result)
+            {
+                break;
+            }
+            auto queryResult = std::make_unique<QueryResult>(result);
+            if (!first)
+            {
+                first = std::move(queryResult);
+            }
+        }
+
+        if (!first)
+        {
+            throw Exception(PQerrorMessage(conn_));
+        }
+        co_return first;
+    }
+
+    // Подключение можно вернуть в пул: связь есть, запрос и транзакция завершены
+    bool IsReusable() const
+    {
+        return PQstatus(conn_) == CONNECTION_OK && PQtransactionStatus(conn_) == PQTRANS_IDLE;
+    }
+
+    // Поколение пула, в котором открыто подключение (меняется при Disconnect)
+    std::uint64_t GetGeneration() const
+    {
+        return generation_;
+    }
+
+    std::chrono::steady_clock::time_point GetLastUsed() const
+    {
+        return lastUsed_;
+    }
+
+    void Touch()
+    {
+        lastUsed_ = std::chrono::steady_clock::now();
+    }
+
+private:
+    // Ожидание готовности сокета к чтению или записи
+    asio::awaitable<void> Wait(SocketHandle::wait_type type)
+    {
+        Attach();
+        co_await socket_.async_wait(type, asio::use_awaitable);
+    }
+
+    // Привязка текущего сокета libpq к объекту asio
+    void Attach()
+    {
+        int fd = PQsocket(conn_);
+        if (fd < 0)
+        {
+            throw Exception("Нет сокета подключения");
+        }
+        if (fd == attachedFd_)
+        {
+            return;
+        }
+        Detach();
+#ifdef _WIN32
+        socket_.assign(asio::ip::tcp::v4(), static_cast<SocketHandle::native_handle_type>(fd));
+#else
+        socket_.assign(fd);
+#endif
+        attachedFd_ = fd;
+    }
+
+    // Отвязка сокета без его закрытия
+    void Detach()
+    {
+        if (attachedFd_ >= 0)
+        {
+#ifdef _WIN32
+            boost::system::error_code ec;
+            socket_.release(ec);
+#else
+            socket_.release();
+#endif
+            attachedFd_ = -1;
+        }
+    }
+
+    PGconn* conn_;
+    SocketHandle socket_;
+    int attachedFd_ = -1;
+    std::uint64_t generation_ = 0;
+    std::chrono::steady_clock::time_point lastUsed_ = std::chrono::steady_clock::now();
+};
+
+// Корутина, ожидающая освобождения подключения
+struct db::AsyncDatabaseManager::Waiter
+{
+    Waiter(AsyncDatabaseManager& manager, const asio::any_io_executor& executor)
+        : manager(manager)
+        , timer(executor)
+    {
+    }
+
+    // Корутина уничтожена после передачи ей подключения, но до его получения:
+    // подключение возвращается в пул, иначе место в пуле было бы потеряно
+    ~Waiter()
+    {
+        if (connection)
+        {
+            manager.Release(std::move(connection));
+        }
+    }
+
+    AsyncDatabaseManager& manager;
+    asio::steady_timer timer;
+    std::unique_ptr<AsyncConnection> connection; // Заполняется при передаче подключения
+};
+
+db::AsyncDatabaseManager::AsyncDatabaseManager(asio::any_io_executor executor)
+    : executor_(std::move(executor))
+{
+}
+
+db::AsyncDatabaseManager::~AsyncDatabaseManager()
+{
+    Disconnect();
+}
+
+// Подключение
+asio::awaitable<void> db::AsyncDatabaseManager::Connect(DatabaseManager::ConnectionParams params)
+{
+    Disconnect();
+
+    connInfo_ = params.ToConnInfo();
+    options_ = params.pool;
+    options_.maxSize = std::max<std::size_t>(options_.maxSize, 1);
+    options_.minSize = std::min(options_.minSize, options_.maxSize);
+    connected_ = true;
+
+    // Первое подключение открывается сразу, чтобы ошибки параметров
+    // обнаруживались при подключении, а не при первом запросе
+    std::size_t count = std::max<std::size_t>(options_.minSize, 1);
+    auto generation = generation_;
+    try
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            ++size_;
+            auto connection = co_await AsyncConnection::Open(executor_, connInfo_, generation);
+            if (generation != generation_)
+            {
+                // Пока подключение открывалось, вызван Disconnect или новый Connect
+                co_return;
+            }
+            idle_.push_back(std::move(connection));
+        }
+    }
+    catch (...)
+    {
+        if (generation == generation_)
+        {
+            Disconnect();
+        }
+        throw;
+    }
+}
+
+// Отключение
+void db::AsyncDatabaseManager::Disconnect()
+{
+    // Занятые подключения старого поколения закроются при возврате
+    connected_ = false;
+    ++generation_;
+    size_ = 0;
+    idle_.clear();
+
+    // Ожидающие корутины просыпаются и получают исключение
+    auto waiters = std::move(waiters_);
+    waiters_.clear();
+    for (auto& waiter : waiters)
+    {
+        waiter->timer.cancel();
+    }
+}
+
+// Проверка подключения
+bool db::AsyncDatabaseManager::IsConnected() const
+{
+    return connected_;
+}
+
+// Выполнение параметризованного запроса
+asio::awaitable<std::unique_ptr<db::QueryResult>> db::AsyncDatabaseManager::Query(std::string query,
+                                                                                   std::vector<std::string> params,
+                                                                                   ResultFormat format)
+{
+    // Подготовка параметров - строка "NULL" означает NULL значение
+    std::vector<const char*> values;
+    values.reserve(params.size());
+    for (const auto& param : params)
+    {
+        values.push_back(param == "NULL" ? nullptr : param.c_str());
+    }
+
+    auto connection = co_await Acquire();
+
+    // Подключение возвращается и при исключении, и при уничтожении корутины;
+    // прерванный на середине запрос не даст вернуть подключение в оборот
+    struct ReleaseGuard
+    {
+        AsyncDatabaseManager& manager;
+        std::unique_ptr<AsyncConnection>& connection;
+
+        ~ReleaseGuard()
+        {
+            manager.Release(std::move(connection));
+        }
+    } guard{*this, connection};
+
+    auto result = co_await connection->Execute(query, values, format);
+    if (!result->IsSuccess())
+    {
+        throw Exception("Ошибка выполнения запроса: " + result->GetErrorMessage());
+    }
+    co_return result;
+}
+
+// Общее количество подключений
+std::size_t db::AsyncDatabaseManager::GetSize() const
+{
+    return size_;
+}
+
+// Количество свободных подключений
+std::size_t db::AsyncDatabaseManager::GetIdleCount() const
+{
+    return idle_.size();
+}
+
+// Получение подключения
+asio::awaitable<std::unique_ptr<db::AsyncDatabaseManager::AsyncConnection>> db::AsyncDatabaseManager::Acquire()
+{
+    auto deadline = std::chrono::steady_clock::now() + options_.acquireTimeout;
+
+    while (true)
+    {
+        if (!connected_)
+        {
+            throw Exception("Нет подключения к БД");
+        }
+
+        if (!idle_.empty())
+        {
+            auto connection = std::move(idle_.back());
+            idle_.pop_back();
+            co_return connection;
+        }
+
+        if (size_ < options_.maxSize)
+        {
+            // Disconnect во время открытия обнуляет size_ и меняет поколение;
+            // место возвращается только в пул того поколения, где было занято
+            auto generation = generation_;
+            ++size_;
+            std::unique_ptr<AsyncConnection> connection;
+            try
+            {
+                connection = co_await AsyncConnection::Open(executor_, connInfo_, generation);
+            }
+            catch (...)
+            {
+                if (generation == generation_)
+                {
+                    --size_;
+                }
+                throw;
+            }
+            co_return connection;
+        }
+
+        // Ожидание до передачи подключения (таймер отменяется) или до истечения срока
+        auto waiter = std::make_shared<Waiter>(*this, executor_);
+        waiter->timer.expires_at(deadline);
+        waiters_.push_back(waiter);
+
+        boost::system::error_code ec;
+        co_await waiter->timer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+        if (waiter->connection)
+        {
+            co_return std::move(waiter->connection);
+        }
+
+        waiters_.erase(std::remove(waiters_.begin(), waiters_.end(), waiter), waiters_.end());
+        if (ec != asio::error::operation_aborted)
+        {
+            throw Exception("Превышено время ожидания свободного подключения");
+        }
+    }
+}
+
+// Возврат подключения
+void db::AsyncDatabaseManager::Release(std::unique_ptr<AsyncConnection> connection)
+{
+    if (!connection)
+    {
+        return;
+    }
+
+    if (connection->GetGeneration() != generation_)
+    {
+        return;
+    }
+
+    if (!connection->IsReusable())
+    {
+        // Освободилось место в пуле - ожидающая корутина откроет новое подключение
+        connection.reset();
+        --size_;
+        if (!waiters_.empty())
+        {
+            auto waiter = waiters_.front();
+            waiters_.pop_front();
+            waiter->timer.cancel();
+        }
+        return;
+    }
+
+    connection->Touch();
+    if (!waiters_.empty())
+    {
+        auto waiter = waiters_.front();
+        waiters_.pop_front();
+        waiter->connection = std::move(connection);
+        waiter->timer.cancel();
+        return;
+    }
+
+    idle_.push_back(std::move(connection));
+
+    // Закрытие подключений, простаивающих дольше maxIdleTime
+    auto threshold = std::chrono::steady_clock::now() - options_.maxIdleTime;
+    while (!idle_.empty() && size_ > options_.minSize && idle_.front()->GetLastUsed() < threshold)
+    {
+        idle_.pop_front();
+        --size_;
+    }
+}
@@ -0,0 +1,311 @@
+#include "ConnectionPool.h"
+
+#include "Database.h"
+
+#include <algorithm>
+
+db::Connection::Connection(PGconn* conn, std::size_t statementCacheSize)
+    : conn_(conn)
+    , statements_(statementCacheSize)
+    , lastUsed_(std::chrono::steady_clock::now())
+{
+}
+
+db::Connection::~Connection()
+{
+    if (conn_)
+    {
+        PQfinish(conn_);
+    }
+}
+
+// Низкоуровневый дескриптор libpq
+PGconn* db::Connection::Get() const
+{
+    return conn_;
+}
+
+// Проверка состояния подключения
+bool db::Connection::IsHealthy() const
+{
+    return conn_ && PQstatus(conn_) == CONNECTION_OK;
+}
+
+// Переподключение с теми же параметрами
+bool db::Connection::Reset()
+{
+    // Подготовленные операторы не переживают переподключение
+    statements_.Clear();
+
+    PQreset(conn_);
+    return PQstatus(conn_) == CONNECTION_OK;
+}
+
+// Кэш подготовленных операторов подключения
+db::StatementCache& db::Connection::GetStatements()
+{
+    return statements_;
+}
+
+// Время последнего возврата в пул
+std::chrono::steady_clock::time_point db::Connection::GetLastUsed() const
+{
+    return lastUsed_;
+}
+
+// Отметка об использовании
+void db::Connection::Touch()
+{
+    lastUsed_ = std::chrono::steady_clock::now();
+}
+
+db::ConnectionPool::Lease::Lease(std::shared_ptr<ConnectionPool> pool, std::unique_ptr<Connection> connection)
+    : pool_(std::move(pool))
+    , connection_(std::move(connection))
+{
+}
+
+db::ConnectionPool::Lease::~Lease()
+{
+    Release();
+}
+
+db::ConnectionPool::Lease& db::ConnectionPool::Lease::operator=(Lease&& other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        pool_ = std::move(other.pool_);
+        connection_ = std::move(other.connection_);
+    }
+    return *this;
+}
+
+db::Connection& db::ConnectionPool::Lease::operator*() const
+{
+    return *connection_;
+}
+
+db::Connection* db::ConnectionPool::Lease::operator->() const
+{
+    return connection_.get();
+}
+
+db::ConnectionPool::Lease::operator bool() const
+{
+    return connection_ != nullptr;
+}
+
+// Досрочный возврат подключения в пул
+void db::ConnectionPool::Lease::Release()
+{
+    if (connection_)
+    {
+        pool_->Release(std::move(connection_));
+    }
+    pool_.reset();
+}
+
+db::ConnectionPool::ConnectionPool(std::string connInfo, const Options& options)
+    : connInfo_(std::move(connInfo))
+    , options_(options)
+{
+    if (options_.maxSize == 0)
+    {
+        options_.maxSize = 1;
+    }
+    options_.minSize = std::min(options_.minSize, options_.maxSize);
+
+    // Первое подключение открывается сразу, чтобы ошибки параметров
+    // обнаруживались при создании пула, а не при первом запросе
+    for (std::size_t i = 0; i < std::max<std::size_t>(options_.minSize, 1); ++i)
+    {
+        idle_.push_back(Open());
+        ++size_;
+    }
+}
+
+db::ConnectionPool::~ConnectionPool()
+{
+    Close();
+}
+
+// Получение подключения
+db::ConnectionPool::Lease db::ConnectionPool::Acquire()
+{
+    auto deadline = std::chrono::steady_clock::now() + options_.acquireTimeout;
+    std::deque<std::unique_ptr<Connection>> expired;
+
+    std::unique_lock lock(mutex_);
+    CollectIdle(expired);
+
+    while (true)
+    {
+        if (closed_)
+        {
+            throw Exception("Пул подключений закрыт");
+        }
+
+        if (!idle_.empty())
+        {
+            auto connection = std::move(idle_.back());
+            idle_.pop_back();
+            lock.unlock();
+            expired.clear();
+
+            // Подключение могло быть разорвано сервером за время простоя
+            if (connection->IsHealthy() || connection->Reset())
+            {
+                return Lease(shared_from_this(), std::move(connection));
+            }
+
+            connection.reset();
+            lock.lock();
+            --size_;
+            available_.notify_one();
+            continue;
+        }
+
+        if (size_ < options_.maxSize)
+        {
+            ++size_;
+            lock.unlock();
+            expired.clear();
+
+            try
+            {
+                return Lease(shared_from_this(), Open());
+            }
+            catch (...)
+            {
+                lock.lock();
+                --size_;
+                available_.notify_one();
+                throw;
+            }
+        }
+
+        if (available_.wait_until(lock, deadline) == std::cv_status::timeout && idle_.empty() &&
+            size_ >= options_.maxSize)
+        {
+            throw Exception("Превышено время ожидания свободного подключения");
+        }
+    }
+}
+
+// Закрытие подключений, простаивающих дольше maxIdleTime
+void db::ConnectionPool::ReapIdle()
+{
+    std::deque<std::unique_ptr<Connection>> expired;
+    {
+        std::lock_guard lock(mutex_);
+        CollectIdle(expired);
+    }
+}
+
+// Закрытие пула
+void db::ConnectionPool::Close()
+{
+    std::deque<std::unique_ptr<Connection>> connections;
+    {
+        std::lock_guard lock(mutex_);
+        closed_ = true;
+        size_ -= idle_.size();
+        connections.swap(idle_);
+    }
+    available_.notify_all();
+}
+
+// Проверка, открыт ли пул
+bool db::ConnectionPool::IsOpen() const
+{
+    std::lock_guard lock(mutex_);
+    return !closed_;
+}
+
+// Общее количество подключений
+std::size_t db::ConnectionPool::GetSize() const
+{
+    std::lock_guard lock(mutex_);
+    return size_;
+}
+
+// Количество свободных подключений
+std::size_t db::ConnectionPool::GetIdleCount() const
+{
+    std::lock_guard lock(mutex_);
+    return idle_.size();
+}
+
+// Параметры пула
+const db::ConnectionPool::Options& db::ConnectionPool::GetOptions() const
+{
+    return options_;
+}
+
+// Открытие нового подключения
+std::unique_ptr<db::Connection> db::ConnectionPool::Open() const
+{
+    PGconn* conn = PQconnectdb(connInfo_.c_str());
+    if (PQstatus(conn) != CONNECTION_OK)
+    {
+        std::string error = PQerrorMessage(conn);
+        PQfinish(conn);
+        throw Exception(error);
+    }
+
+    return std::make_unique<Connection>(conn, options_.statementCacheSize);
+}
+
+// Возврат подключения в пул
+void db::ConnectionPool::Release(std::unique_ptr<Connection> connection)
+{
+    // Незавершенная транзакция не должна достаться следующему потоку
+    bool reusable = connection->IsHealthy();
+    if (reusable)
+    {
+        switch (PQtransactionStatus(connection->Get()))
+        {
+        case PQTRANS_IDLE:
+            break;
+        case PQTRANS_INTRANS:
+        case PQTRANS_INERROR:
+            PQclear(PQexec(connection->Get(), "ROLLBACK"));
+            reusable = PQtransactionStatus(connection->Get()) == PQTRANS_IDLE;
+            break;
+        default:
+            reusable = false;
+            break;
+        }
+    }
+    connection->Touch();
+
+    std::deque<std::unique_ptr<Connection>> expired;
+    {
+        std::lock_guard lock(mutex_);
+        if (reusable && !closed_)
+        {
+            idle_.push_back(std::move(connection));
+        }
+        else
+        {
+            --size_;
+        }
+        CollectIdle(expired);
+    }
+    available_.notify_one();
+}
+
+// Извлечение простаивающих подключений; закрываются они уже вне мьютекса
+void db::ConnectionPool::CollectIdle(std::deque<std::unique_ptr<Connection>>& expired)
+{
+    auto threshold = std::chrono::steady_clock::now() - options_.maxIdleTime;
+
+    // Самые старые подключения находятся в начале очереди
+    while (!idle_.empty() && size_ > options_.minSize && idle_.front()->GetLastUsed() < threshold)
+    {
+        expired.push_back(std::move(idle_.front()));
+        idle_.pop_front();
+        --size_;
+    }
+}
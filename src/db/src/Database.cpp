@@ -1,8 +1,420 @@
 #include "Database.h"
 
-db::Exception::Exception(const std::string& message)
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string_view>
+
+namespace
+{
+// OID встроенных типов PostgreSQL (pg_type.dat)
+constexpr Oid kBoolOid = 16;
+constexpr Oid kInt8Oid = 20;
+constexpr Oid kInt2Oid = 21;
+constexpr Oid kInt4Oid = 23;
+constexpr Oid kFloat4Oid = 700;
+constexpr Oid kFloat8Oid = 701;
+constexpr Oid kDateOid = 1082;
+constexpr Oid kNumericOid = 1700;
+
+// Признаки знака в двоичном представлении numeric
+constexpr std::uint16_t kNumericNeg = 0x4000;
+constexpr std::uint16_t kNumericNaN = 0xC000;
+constexpr std::uint16_t kNumericPInf = 0xD000;
+constexpr std::uint16_t kNumericNInf = 0xF000;
+
+// Начало отсчета дат PostgreSQL
+constexpr std::chrono::sys_days kPostgresEpoch = std::chrono::year{2000} / 1 / 1;
+
+// Чтение беззнакового целого в сетевом порядке байт
+template <typename T>
+T ReadBigEndian(const char* data)
+{
+    T value = 0;
+    for (std::size_t i = 0; i < sizeof(T); ++i)
+    {
+        value = static_cast<T>((value << 8) | static_cast<unsigned char>(data[i]));
+    }
+    return value;
+}
+
+// Ячейка результата без копирования. Двоичное представление строковых типов
+// (text, varchar и т.п.) совпадает с текстовым, поэтому binary выставляется
+// только для типов, которые декодируются отдельно
+struct Cell
+{
+    std::string_view data;
+    Oid type;
+    bool binary;
+};
+
+bool HasBinaryDecoder(Oid type)
+{
+    switch (type)
+    {
+    case kBoolOid:
+    case kInt2Oid:
+    case kInt4Oid:
+    case kInt8Oid:
+    case kFloat4Oid:
+    case kFloat8Oid:
+    case kDateOid:
+    case kNumericOid:
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::optional<Cell> GetCell(const PGresult* result, int row, int col)
+{
+    if (PQgetisnull(result, row, col))
+    {
+        return std::nullopt;
+    }
+    Oid type = PQftype(result, col);
+    return Cell{std::string_view(PQgetvalue(result, row, col), static_cast<std::size_t>(PQgetlength(result, row, col))),
+                type,
+                PQfformat(result, col) == 1 && HasBinaryDecoder(type)};
+}
+
+// Целое число из двоичного представления
+std::optional<std::int64_t> DecodeBinaryInteger(const Cell& cell)
+{
+    switch (cell.type)
+    {
+    case kInt2Oid:
+        if (cell.data.size() == 2)
+            return static_cast<std::int16_t>(ReadBigEndian<std::uint16_t>(cell.data.data()));
+        break;
+    case kInt4Oid:
+        if (cell.data.size() == 4)
+            return static_cast<std::int32_t>(ReadBigEndian<std::uint32_t>(cell.data.data()));
+        break;
+    case kInt8Oid:
+        if (cell.data.size() == 8)
+            return static_cast<std::int64_t>(ReadBigEndian<std::uint64_t>(cell.data.data()));
+        break;
+    case kBoolOid:
+        if (cell.data.size() == 1)
+            return cell.data[0] != 0 ? 1 : 0;
+        break;
+    default:
+        break;
+    }
+    return std::nullopt;
+}
+
+// Двоичное представление numeric: заголовок и цифры по основанию 10000
+struct NumericView
+{
+    int ndigits;
+    int weight;
+    std::uint16_t sign;
+    int dscale;
+    const char* digits;
+
+    int Digit(int i) const
+    {
+        if (i < 0 || i >= ndigits)
+            return 0;
+        return static_cast<std::int16_t>(ReadBigEndian<std::uint16_t>(digits + i * 2));
+    }
+};
+
+std::optional<NumericView> ParseNumeric(const Cell& cell)
+{
+    if (cell.data.size() < 8)
+        return std::nullopt;
+    const char* p = cell.data.data();
+    NumericView view{static_cast<std::int16_t>(ReadBigEndian<std::uint16_t>(p)),
+                     static_cast<std::int16_t>(ReadBigEndian<std::uint16_t>(p + 2)),
+                     ReadBigEndian<std::uint16_t>(p + 4),
+                     ReadBigEndian<std::uint16_t>(p + 6),
+                     p + 8};
+    if (view.ndigits < 0 || cell.data.size() != 8 + static_cast<std::size_t>(view.ndigits) * 2)
+        return std::nullopt;
+    return view;
+}
+
+std::string FormatNumeric(const NumericView& numeric);
+
+template <typename T>
+std::optional<T> ParseLeadingNumber(std::string_view text);
+
+// Число с плавающей точкой из двоичного представления
+std::optional<double> DecodeBinaryDouble(const Cell& cell)
+{
+    switch (cell.type)
+    {
+    case kFloat8Oid:
+        if (cell.data.size() == 8)
+            return std::bit_cast<double>(ReadBigEndian<std::uint64_t>(cell.data.data()));
+        return std::nullopt;
+    case kFloat4Oid:
+        if (cell.data.size() == 4)
+            return std::bit_cast<float>(ReadBigEndian<std::uint32_t>(cell.data.data()));
+        return std::nullopt;
+    case kNumericOid:
+    {
+        // Через десятичную запись: from_chars округляет точно, а сумма
+        // цифр по основанию 10000 накапливает ошибку округления
+        auto numeric = ParseNumeric(cell);
+        if (!numeric)
+            return std::nullopt;
+        return ParseLeadingNumber<double>(FormatNumeric(*numeric));
+    }
+    default:
+    {
+        auto integer = DecodeBinaryInteger(cell);
+        if (integer)
+            return static_cast<double>(*integer);
+        return std::nullopt;
+    }
+    }
+}
+
+// Дата из двоичного представления (дни от 2000-01-01)
+std::optional<std::chrono::year_month_day> DecodeBinaryDate(const Cell& cell)
+{
+    if (cell.type != kDateOid || cell.data.size() != 4)
+        return std::nullopt;
+    auto days = static_cast<std::int32_t>(ReadBigEndian<std::uint32_t>(cell.data.data()));
+
+    // -infinity/infinity не представимы в year_month_day
+    if (days == std::numeric_limits<std::int32_t>::min() || days == std::numeric_limits<std::int32_t>::max())
+        return std::nullopt;
+    return std::chrono::year_month_day(kPostgresEpoch + std::chrono::days(days));
+}
+
+// Разбор числа из текста; строка должна быть прочитана полностью
+template <typename T>
+std::optional<T> ParseText(std::string_view text)
+{
+    T value{};
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || end != text.data() + text.size())
+        return std::nullopt;
+    return value;
+}
+
+// Разбор числа в начале текста, как std::stoi/std::stod: пробелы в начале
+// пропускаются, остаток после числа (например, дробная часть NUMERIC "5.00"
+// при чтении целого) не учитывается
+template <typename T>
+std::optional<T> ParseLeadingNumber(std::string_view text)
+{
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front())))
+        text.remove_prefix(1);
+    if (!text.empty() && text.front() == '+')
+        text.remove_prefix(1);
+    T value{};
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc())
+        return std::nullopt;
+    return value;
+}
+
+// Дата в формате ISO (YYYY-MM-DD), допускается время после даты
+std::optional<std::chrono::year_month_day> ParseTextDate(std::string_view text)
+{
+    if (text.size() < 10 || text[4] != '-' || text[7] != '-' ||
+        (text.size() > 10 && text[10] != ' ' && text[10] != 'T'))
+        return std::nullopt;
+    auto y = ParseText<int>(text.substr(0, 4));
+    auto m = ParseText<unsigned>(text.substr(5, 2));
+    auto d = ParseText<unsigned>(text.substr(8, 2));
+    if (!y || !m || !d)
+        return std::nullopt;
+    std::chrono::year_month_day date{std::chrono::year{*y}, std::chrono::month{*m}, std::chrono::day{*d}};
+    if (!date.ok())
+        return std::nullopt;
+    return date;
+}
+
+// Текстовое представление numeric, совпадающее с выводом сервера
+std::string FormatNumeric(const NumericView& numeric)
+{
+    switch (numeric.sign)
+    {
+    case kNumericNaN:
+        return "NaN";
+    case kNumericPInf:
+        return "Infinity";
+    case kNumericNInf:
+        return "-Infinity";
+    default:
+        break;
+    }
+
+    std::string text;
+    if (numeric.sign == kNumericNeg)
+        text += '-';
+
+    char group[8];
+    if (numeric.weight < 0)
+    {
+        text += '0';
+    }
+    else
+    {
+        for (int i = 0; i <= numeric.weight; ++i)
+        {
+            std::snprintf(group, sizeof(group), i == 0 ? "%d" : "%04d", numeric.Digit(i));
+            text += group;
+        }
+    }
+
+    if (numeric.dscale > 0)
+    {
+        text += '.';
+        std::string fraction;
+        for (int i = numeric.weight + 1; static_cast<int>(fraction.size()) < numeric.dscale; ++i)
+        {
+            std::snprintf(group, sizeof(group), "%04d", numeric.Digit(i));
+            fraction += group;
+        }
+        text.append(fraction, 0, static_cast<std::size_t>(numeric.dscale));
+    }
+    return text;
+}
+
+// Текстовое представление двоичного значения
+std::string FormatBinary(const Cell& cell)
+{
+    switch (cell.type)
+    {
+    case kBoolOid:
+        return DecodeBinaryInteger(cell).value_or(0) ? "t" : "f";
+    case kInt2Oid:
+    case kInt4Oid:
+    case kInt8Oid:
+    {
+        auto value = DecodeBinaryInteger(cell);
+        return value ? std::to_string(*value) : std::string();
+    }
+    case kFloat4Oid:
+    case kFloat8Oid:
+    {
+        auto value = DecodeBinaryDouble(cell);
+        if (!value)
+            return std::string();
+        if (std::isnan(*value))
+            return "NaN";
+        if (std::isinf(*value))
+            return *value > 0 ? "Infinity" : "-Infinity";
+        char buffer[32];
+        auto [end, ec] = cell.type == kFloat4Oid
+                             ? std::to_chars(buffer, buffer + sizeof(buffer), static_cast<float>(*value))
+                             : std::to_chars(buffer, buffer + sizeof(buffer), *value);
+        return std::string(buffer, end);
+    }
+    case kNumericOid:
+    {
+        auto numeric = ParseNumeric(cell);
+        return numeric ? FormatNumeric(*numeric) : std::string();
+    }
+    case kDateOid:
+    {
+        auto date = DecodeBinaryDate(cell);
+        if (!date)
+            return std::string();
+        char buffer[16];
+        std::snprintf(buffer,
+                      sizeof(buffer),
+                      "%04d-%02u-%02u",
+                      static_cast<int>(date->year()),
+                      static_cast<unsigned>(date->month()),
+                      static_cast<unsigned>(date->day()));
+        return buffer;
+    }
+    default:
+        return std::string(cell.data);
+    }
+}
+
+// Текстовые значения параметров для журнала; двоичные раскодируются по OID
+std::vector<std::string> FormatParams(
+    int count, const Oid* types, const char* const* values, const int* lengths, const int* formats)
+{
+    std::vector<std::string> text;
+    text.reserve(static_cast<std::size_t>(count));
+    for (int i = 0; i < count; ++i)
+    {
+        if (!values[i])
+        {
+            text.emplace_back("NULL");
+        }
+        else if (formats && formats[i] == 1)
+        {
+            std::string_view data(values[i], static_cast<std::size_t>(lengths[i]));
+            Oid type = types ? types[i] : 0;
+            text.push_back(FormatBinary(Cell{data, type, HasBinaryDecoder(type)}));
+        }
+        else
+        {
+            text.emplace_back(values[i]);
+        }
+    }
+    return text;
+}
+
+// Позиция WAL в формате pg_lsn ("16/B374D848")
+std::optional<std::uint64_t> ParseLsn(std::string_view text)
+{
+    auto slash = text.find('/');
+    if (slash == std::string_view::npos)
+        return std::nullopt;
+    std::uint32_t high = 0;
+    std::uint32_t low = 0;
+    auto [highEnd, highEc] = std::from_chars(text.data(), text.data() + slash, high, 16);
+    auto [lowEnd, lowEc] = std::from_chars(text.data() + slash + 1, text.data() + text.size(), low, 16);
+    if (highEc != std::errc() || lowEc != std::errc() || highEnd != text.data() + slash ||
+        lowEnd != text.data() + text.size())
+        return std::nullopt;
+    return (static_cast<std::uint64_t>(high) << 32) | low;
+}
+
+// Позиция WAL из первой ячейки результата; nullopt при ошибке или NULL
+std::optional<std::uint64_t> GetLsn(const PGresult* result)
+{
+    if (PQresultStatus(result) != PGRES_TUPLES_OK || PQntuples(result) == 0 || PQgetisnull(result, 0, 0))
+        return std::nullopt;
+    return ParseLsn(PQgetvalue(result, 0, 0));
+}
+
+// Имя точки сохранения вложенной транзакции уровня depth
+std::string SavepointName(int depth)
+{
+    return "tariff_sys_sp_" + std::to_string(depth);
+}
+
+// Запрос отмены выполняющегося на подключении запроса
+void CancelQuery(PGconn* conn)
+{
+    if (PGcancel* cancel = PQgetCancel(conn))
+    {
+        char error[256];
+        PQcancel(cancel, error, sizeof(error));
+        PQfreeCancel(cancel);
+    }
+}
+} // namespace
+
+db::Exception::Exception(const std::string& message, std::string sqlState)
     : std::runtime_error("Ошибка БД: " + message)
+    , sqlState_(std::move(sqlState))
+{
+}
+
+const std::string& db::Exception::GetSqlState() const
 {
+    return sqlState_;
 }
 
 db::QueryResult::QueryResult(PGresult* result)
@@ -25,11 +437,16 @@ int db::QueryResult::GetColumnCount() const
 // Получение значения ячейки как строки
 std::optional<std::string> db::QueryResult::GetValue(int row, int col) const
 {
-    if (PQgetisnull(result_.get(), row, col))
+    auto cell = GetCell(result_.get(), row, col);
+    if (!cell)
     {
         return std::nullopt;
     }
-    return std::string(PQgetvalue(result_.get(), row, col));
+    if (cell->binary)
+    {
+        return FormatBinary(*cell);
+    }
+    return std::string(cell->data);
 }
 
 // Получение значения ячейки по имени колонки
@@ -43,36 +460,96 @@ std::optional<std::string> db::QueryResult::GetValue(int row, const std::string&
     return GetValue(row, col);
 }
 
+// Получение значения ячейки без копирования
+std::optional<std::string_view> db::QueryResult::GetStringView(int row, int col) const
+{
+    auto cell = GetCell(result_.get(), row, col);
+    if (!cell || cell->binary)
+    {
+        return std::nullopt;
+    }
+    return cell->data;
+}
+
+// Проверка ячейки на NULL
+bool db::QueryResult::IsNull(int row, int col) const
+{
+    return PQgetisnull(result_.get(), row, col) != 0;
+}
+
 // Получение значения как integer
 std::optional<int> db::QueryResult::GetInt(int row, int col) const
 {
-    auto val = GetValue(row, col);
-    if (!val)
+    auto value = GetInt64(row, col);
+    if (!value || *value < std::numeric_limits<int>::min() || *value > std::numeric_limits<int>::max())
         return std::nullopt;
-    try
-    {
-        return std::stoi(*val);
-    }
-    catch (...)
-    {
+    return static_cast<int>(*value);
+}
+
+// Получение значения как 64-битного целого
+std::optional<std::int64_t> db::QueryResult::GetInt64(int row, int col) const
+{
+    auto cell = GetCell(result_.get(), row, col);
+    if (!cell)
         return std::nullopt;
+    if (cell->binary && cell->type == kNumericOid)
+    {
+        // Дробная часть отбрасывается, как при разборе текста
+        auto numeric = ParseNumeric(*cell);
+        if (!numeric)
+            return std::nullopt;
+        return ParseLeadingNumber<std::int64_t>(FormatNumeric(*numeric));
     }
+    if (cell->binary)
+        return DecodeBinaryInteger(*cell);
+    return ParseLeadingNumber<std::int64_t>(cell->data);
 }
 
 // Получение значения как double
 std::optional<double> db::QueryResult::GetDouble(int row, int col) const
 {
-    auto val = GetValue(row, col);
-    if (!val)
+    auto cell = GetCell(result_.get(), row, col);
+    if (!cell)
         return std::nullopt;
-    try
+    if (cell->binary)
+        return DecodeBinaryDouble(*cell);
+    return ParseLeadingNumber<double>(cell->data);
+}
+
+// Получение значения как bool
+std::optional<bool> db::QueryResult::GetBool(int row, int col) const
+{
+    auto cell = GetCell(result_.get(), row, col);
+    if (!cell)
+        return std::nullopt;
+    if (cell->binary)
     {
-        return std::stod(*val);
+        auto value = DecodeBinaryInteger(*cell);
+        if (!value)
+            return std::nullopt;
+        return *value != 0;
     }
-    catch (...)
-    {
+
+    std::string_view text = cell->data;
+    if (text == "t" || text == "true")
+        return true;
+    if (text == "f" || text == "false")
+        return false;
+    auto value = ParseText<std::int64_t>(text);
+    if (!value)
         return std::nullopt;
-    }
+    return *value != 0;
+}
+
+// Получение значения как даты
+std::optional<std::chrono::year_month_day> db::QueryResult::GetDate(int row, int col) const
+{
+    auto cell = GetCell(result_.get(), row, col);
+    if (!cell)
+        return std::nullopt;
+    if (cell->binary)
+        return DecodeBinaryDate(*cell);
+    return ParseTextDate(cell->data);
 }
 
 // Проверка успешности выполнения
@@ -88,6 +565,35 @@ std::string db::QueryResult::GetErrorMessage() const
     return PQresultErrorMessage(result_.get());
 }
 
+// Получение кода SQLSTATE ошибки
+std::string db::QueryResult::GetSqlState() const
+{
+    const char* state = PQresultErrorField(result_.get(), PG_DIAG_SQLSTATE);
+    return state ? state : "";
+}
+
+// Строка подключения libpq к основному серверу
+std::string db::DatabaseManager::ConnectionParams::ToConnInfo() const
+{
+    return ToConnInfo(Replica{host, port});
+}
+
+// Строка подключения libpq к реплике
+std::string db::DatabaseManager::ConnectionParams::ToConnInfo(const Replica& replica) const
+{
+    std::string connInfo =
+        "host=" + replica.host + " port=" + replica.port + " dbname=" + database + " user=" + user;
+
+    if (!password.empty())
+    {
+        connInfo += " password=" + password;
+    }
+
+    // Кодировка задается при подключении, без отдельного SET
+    connInfo += " client_encoding=UTF8";
+    return connInfo;
+}
+
 // Деструктор
 db::DatabaseManager::~DatabaseManager()
 {
@@ -102,77 +608,108 @@ bool db::DatabaseManager::Connect(const ConnectionParams& params)
         Disconnect();
     }
 
-    // Формирование строки подключения
-    std::string connInfo =
-        "host=" + params.host + " port=" + params.port + " dbname=" + params.database + " user=" + params.user;
-
-    if (!params.password.empty())
+    // Создание пула; первое подключение устанавливается сразу
+    std::shared_ptr<ConnectionPool> pool;
+    try
     {
-        connInfo += " password=" + params.password;
+        pool = std::make_shared<ConnectionPool>(params.ToConnInfo(), params.pool);
     }
-
-    // Установка подключения
-    conn_ = PQconnectdb(connInfo.c_str());
-
-    if (PQstatus(conn_) != CONNECTION_OK)
+    catch (const Exception& e)
     {
-        lastError_ = PQerrorMessage(conn_);
-        PQfinish(conn_);
-        conn_ = nullptr;
+        SetLastError(e.what());
         return false;
     }
 
-    // Установка кодировки UTF-8
-    PQexec(conn_, "SET client_encoding = 'UTF8'");
+    // Недоступная реплика не мешает работе: ее чтения идут на другие реплики
+    // или на основной сервер
+    std::vector<std::shared_ptr<ReplicaState>> replicas;
+    for (const auto& replica : params.replicas)
+    {
+        try
+        {
+            auto state = std::make_shared<ReplicaState>();
+            state->pool = std::make_shared<ConnectionPool>(params.ToConnInfo(replica), params.pool);
+            replicas.push_back(std::move(state));
+        }
+        catch (const Exception& e)
+        {
+            SetLastError(e.what());
+        }
+    }
 
+    std::lock_guard lock(mutex_);
+    pool_ = std::move(pool);
+    connInfo_ = params.ToConnInfo();
+    replicas_ = std::move(replicas);
+    replicaLagTimeout_ = params.replicaLagTimeout;
     return true;
 }
 
 // Отключение от базы данных
 void db::DatabaseManager::Disconnect()
 {
-    if (conn_)
+    std::shared_ptr<ConnectionPool> pool;
+    std::vector<std::shared_ptr<ReplicaState>> replicas;
+    ConnectionPool::Lease transaction;
+    {
+        std::lock_guard lock(mutex_);
+        pool.swap(pool_);
+        replicas.swap(replicas_);
+
+        // Транзакции других потоков завершают их владельцы: подключения этих
+        // потоков остаются у них и закрываются при возврате в закрытый пул
+        auto it = transactions_.find(std::this_thread::get_id());
+        if (it != transactions_.end())
+        {
+            transaction = std::move(it->second.lease);
+            transactions_.erase(it);
+        }
+
+        // Позиции WAL относятся к прежнему серверу; области чтения сохраняются
+        std::lock_guard sessionsLock(sessions_->mutex);
+        for (auto& [thread, session] : sessions_->states)
+        {
+            session.pendingWrite = false;
+            session.lsn = 0;
+        }
+    }
+
+    // Незавершенная транзакция потока откатывается при возврате подключения
+    transaction.Release();
+    if (pool)
+    {
+        pool->Close();
+    }
+    for (const auto& replica : replicas)
     {
-        PQfinish(conn_);
-        conn_ = nullptr;
+        replica->pool->Close();
     }
 }
 
 // Проверка подключения
 bool db::DatabaseManager::IsConnected() const
 {
-    return conn_ && PQstatus(conn_) == CONNECTION_OK;
+    auto pool = GetPool();
+    return pool && pool->IsOpen();
 }
 
 // Выполнение SQL запроса
 std::unique_ptr<db::QueryResult> db::DatabaseManager::ExecuteQuery(const std::string& query)
 {
-    if (!IsConnected())
-    {
-        throw Exception("Нет подключения к БД");
-    }
+    ConnectionPool::Lease lease;
+    Connection& conn = AcquireConnection(lease);
 
-    PGresult* result = PQexec(conn_, query.c_str());
-    auto queryResult = std::make_unique<QueryResult>(result);
-
-    if (!queryResult->IsSuccess())
-    {
-        lastError_ = queryResult->GetErrorMessage();
-        throw Exception("Ошибка выполнения запроса: " + lastError_);
-    }
-
-    return queryResult;
+    auto start = std::chrono::steady_clock::now();
+    PGresult* result = PQexec(conn.Get(), query.c_str());
+    ObserveQuery(conn, query, ParamView{}, start, result);
+    return CheckResult(result);
 }
 
 // Выполнение параметризованного запроса
 std::unique_ptr<db::QueryResult> db::DatabaseManager::executeQuery(const std::string& query,
-                                                                   const std::vector<std::string>& params)
+                                                                   const std::vector<std::string>& params,
+                                                                   ResultFormat format)
 {
-    if (!IsConnected())
-    {
-        throw Exception("Нет подключения к БД");
-    }
-
     // Подготовка параметров - строка "NULL" означает NULL значение
     std::vector<const char*> paramValues;
     for (const auto& param : params)
@@ -187,62 +724,885 @@ std::unique_ptr<db::QueryResult> db::DatabaseManager::executeQuery(const std::st
         }
     }
 
-    PGresult* result = PQexecParams(
-        conn_, query.c_str(), static_cast<int>(params.size()), nullptr, paramValues.data(), nullptr, nullptr, 0);
+    ParamView view{static_cast<int>(params.size()), nullptr, paramValues.data()};
 
-    auto queryResult = std::make_unique<QueryResult>(result);
+    ConnectionPool::Lease lease;
+    Connection& conn = AcquireConnection(lease);
 
-    if (!queryResult->IsSuccess())
-    {
-        lastError_ = queryResult->GetErrorMessage();
-        throw Exception("Ошибка выполнения запроса: " + lastError_);
-    }
+    // Запрос готовится на сервере один раз для каждого подключения
+    auto start = std::chrono::steady_clock::now();
+    PGresult* result = conn.GetStatements().Execute(
+        conn.Get(),
+        query,
+        static_cast<int>(params.size()),
+        nullptr,
+        paramValues.data(),
+        nullptr,
+        nullptr,
+        static_cast<int>(format));
+    ObserveQuery(conn, query, view, start, result);
 
-    return queryResult;
+    return CheckResult(result);
 }
 
-// Начало транзакции
-void db::DatabaseManager::BeginTransaction()
+// Выполнение запроса с параметрами через кэш подготовленных операторов
+std::unique_ptr<db::QueryResult> db::DatabaseManager::ExecuteBound(const std::string& query,
+                                                                   const ParamView& params,
+                                                                   ResultFormat format)
 {
-    ExecuteQuery("BEGIN");
-}
+    ConnectionPool::Lease lease;
+    Connection& conn = AcquireConnection(lease);
 
-// Подтверждение транзакции
-void db::DatabaseManager::Commit()
-{
-    ExecuteQuery("COMMIT");
-}
+    // Типы параметров входят в ключ кэша, поэтому оператор готовится
+    // с ними и сервер не выводит типы из контекста
+    auto start = std::chrono::steady_clock::now();
+    PGresult* result = conn.GetStatements().Execute(conn.Get(),
+                                                    query,
+                                                    params.count,
+                                                    params.types,
+                                                    params.values,
+                                                    params.lengths,
+                                                    params.formats,
+                                                    static_cast<int>(format));
+    ObserveQuery(conn, query, params, start, result);
 
-// Откат транзакции
-void db::DatabaseManager::Rollback()
-{
-    ExecuteQuery("ROLLBACK");
+    return CheckResult(result);
 }
 
-// Выполнение SQL команды без возврата результата
-void db::DatabaseManager::Execute(const std::string& query)
+// Выполнение операторов в конвейерном режиме
+std::vector<std::unique_ptr<db::QueryResult>> db::DatabaseManager::ExecutePipeline(
+    const std::vector<Statement>& statements, ResultFormat format)
 {
-    ExecuteQuery(query);
-}
+    std::vector<std::unique_ptr<QueryResult>> results;
+    if (statements.empty())
+    {
+        return results;
+    }
 
-// Получение последней ошибки
-const std::string& db::DatabaseManager::GetLastError() const
-{
-    return lastError_;
-}
+    ConnectionPool::Lease lease;
+    Connection& conn = AcquireConnection(lease);
+    PGconn* pg = conn.Get();
+    auto& cache = conn.GetStatements();
 
-// Экранирование строки для SQL
-std::string db::DatabaseManager::EscapeString(const std::string& str) const
-{
-    if (!IsConnected())
+    if (!PQenterPipelineMode(pg))
     {
-        throw Exception("Нет подключения к БД");
+        SetLastError(PQerrorMessage(pg));
+        throw Exception("Не удалось включить конвейерный режим: " + GetLastError());
     }
 
-    std::vector<char> buffer(str.length() * 2 + 1);
-    PQescapeStringConn(conn_, buffer.data(), str.c_str(), str.length(), nullptr);
-    return std::string(buffer.data());
-}
+    // Отправка всех операторов; для каждого запоминается имя оператора, если
+    // его результату предшествует результат подготовки
+    std::vector<std::string> prepared(statements.size());
+    std::vector<const char*> paramValues;
+    std::vector<int> paramLengths;
+    std::vector<int> paramFormats;
+    for (std::size_t i = 0; i < statements.size(); ++i)
+    {
+        const auto& statement = statements[i];
+        bool typed = !statement.types.empty();
+        paramValues.clear();
+        paramLengths.clear();
+        for (std::size_t j = 0; j < statement.params.size(); ++j)
+        {
+            const auto& param = statement.params[j];
+            bool isNull = typed ? statement.nulls[j] : param == "NULL";
+            paramValues.push_back(isNull ? nullptr : param.data());
+            paramLengths.push_back(static_cast<int>(param.size()));
+        }
+        paramFormats.assign(paramValues.size(), typed ? 1 : 0);
+
+        int expected = cache.Send(pg,
+                                  statement.query,
+                                  static_cast<int>(paramValues.size()),
+                                  typed ? statement.types.data() : nullptr,
+                                  paramValues.data(),
+                                  paramLengths.data(),
+                                  paramFormats.data(),
+                                  static_cast<int>(format),
+                                  prepared[i]);
+        if (expected == 0)
+        {
+            // Подключение в неопределенном состоянии; пул не вернет его в оборот
+            SetLastError(PQerrorMessage(pg));
+            throw Exception("Ошибка отправки запроса: " + GetLastError());
+        }
+    }
+
+    if (!PQpipelineSync(pg))
+    {
+        SetLastError(PQerrorMessage(pg));
+        throw Exception("Ошибка отправки запроса: " + GetLastError());
+    }
+
+    // Получение результатов в порядке отправки; после результатов каждого
+    // оператора PQgetResult возвращает nullptr
+    std::string error;
+    results.reserve(statements.size());
+    for (std::size_t i = 0; i < statements.size(); ++i)
+    {
+        if (!prepared[i].empty())
+        {
+            PGresult* prepareResult = PQgetResult(pg);
+            cache.OnPrepared(statements[i].query,
+                             static_cast<int>(statements[i].params.size()),
+                             statements[i].types.empty() ? nullptr : statements[i].types.data(),
+                             prepared[i],
+                             prepareResult);
+            if (error.empty() && PQresultStatus(prepareResult) == PGRES_FATAL_ERROR)
+            {
+                error = PQresultErrorMessage(prepareResult);
+            }
+            PQclear(prepareResult);
+            PQclear(PQgetResult(pg));
+        }
+
+        auto result = std::make_unique<QueryResult>(PQgetResult(pg));
+        PQclear(PQgetResult(pg));
+        if (error.empty() && !result->IsSuccess())
+        {
+            error = result->GetErrorMessage();
+            if (error.empty())
+            {
+                error = PQerrorMessage(pg);
+            }
+        }
+        results.push_back(std::move(result));
+    }
+
+    // Точка синхронизации завершает неявную транзакцию пакета
+    PGresult* sync = PQgetResult(pg);
+    PQclear(sync);
+    PQexitPipelineMode(pg);
+
+    if (!error.empty())
+    {
+        SetLastError(error);
+        throw Exception("Ошибка выполнения запроса: " + error);
+    }
+
+    return results;
+}
+
+// Потоковое выполнение запроса
+std::size_t db::DatabaseManager::StreamQuery(const std::string& query,
+                                             const std::vector<std::string>& params,
+                                             const std::function<bool(const QueryResult& rows)>& onRows,
+                                             ResultFormat format,
+                                             int chunkRows)
+{
+    std::vector<const char*> paramValues;
+    for (const auto& param : params)
+    {
+        paramValues.push_back(param == "NULL" ? nullptr : param.c_str());
+    }
+
+    ConnectionPool::Lease lease;
+    Connection& conn = AcquireConnection(lease);
+    PGconn* pg = conn.Get();
+    bool inTransaction = !lease; // Подключение закреплено за транзакцией потока
+
+    // Кэш операторов не используется: режим построчной выдачи включается сразу
+    // после отправки одного запроса, а подготовка добавила бы второй
+    if (!PQsendQueryParams(pg,
+                           query.c_str(),
+                           static_cast<int>(paramValues.size()),
+                           nullptr,
+                           paramValues.data(),
+                           nullptr,
+                           nullptr,
+                           static_cast<int>(format)))
+    {
+        SetLastError(PQerrorMessage(pg));
+        throw Exception("Ошибка отправки запроса: " + GetLastError());
+    }
+
+#ifdef LIBPQ_HAS_CHUNK_MODE
+    bool rowMode = PQsetChunkedRowsMode(pg, std::max(chunkRows, 1)) == 1;
+#else
+    (void)chunkRows;
+    bool rowMode = PQsetSingleRowMode(pg) == 1;
+#endif
+    if (!rowMode)
+    {
+        // Запрос уже отправлен; результат разбирается, чтобы освободить подключение
+        while (PGresult* result = PQgetResult(pg))
+        {
+            PQclear(result);
+        }
+        throw Exception("Не удалось включить построчное получение результата");
+    }
+
+    // Результаты со строками (PGRES_SINGLE_TUPLE или PGRES_TUPLES_CHUNK) завершаются
+    // пустым PGRES_TUPLES_OK; ошибка может прийти и после части строк
+    std::size_t rowCount = 0;
+    std::string error;
+    bool cancelled = false;
+    while (PGresult* result = PQgetResult(pg))
+    {
+        QueryResult rows(result);
+        auto status = PQresultStatus(result);
+        if (cancelled || !error.empty())
+        {
+            continue;
+        }
+        if (status != PGRES_SINGLE_TUPLE && status != PGRES_TUPLES_OK
+#ifdef LIBPQ_HAS_CHUNK_MODE
+            && status != PGRES_TUPLES_CHUNK
+#endif
+        )
+        {
+            error = rows.GetErrorMessage();
+            continue;
+        }
+        if (rows.GetRowCount() == 0)
+        {
+            continue;
+        }
+
+        rowCount += static_cast<std::size_t>(rows.GetRowCount());
+        bool proceed = false;
+        try
+        {
+            proceed = onRows(rows);
+        }
+        catch (...)
+        {
+            // Остаток результата отбрасывается, чтобы подключение можно было вернуть в пул
+            if (!inTransaction)
+            {
+                CancelQuery(pg);
+            }
+            while (PGresult* rest = PQgetResult(pg))
+            {
+                PQclear(rest);
+            }
+            throw;
+        }
+
+        // Отмена прерывает и транзакцию, поэтому внутри нее оставшиеся строки
+        // только дочитываются без передачи в onRows
+        if (!proceed)
+        {
+            cancelled = true;
+            if (!inTransaction)
+            {
+                CancelQuery(pg);
+            }
+        }
+    }
+
+    // Ошибка отмены (57014) ожидаема и не сообщается
+    if (!error.empty())
+    {
+        SetLastError(error);
+        throw Exception("Ошибка выполнения запроса: " + error);
+    }
+
+    return rowCount;
+}
+
+// Загрузка данных командой COPY ... FROM STDIN
+std::size_t db::DatabaseManager::CopyIn(const std::string& query,
+                                        const std::function<bool(std::string& chunk)>& writeChunk)
+{
+    ConnectionPool::Lease lease;
+    Connection& conn = AcquireConnection(lease);
+    PGconn* pg = conn.Get();
+
+    PGresult* start = PQexec(pg, query.c_str());
+    if (PQresultStatus(start) != PGRES_COPY_IN)
+    {
+        // Ответ на команду, не перешедшую в режим COPY (обычно ошибка)
+        auto result = std::make_unique<QueryResult>(start);
+        SetLastError(result->IsSuccess() ? "Команда не является COPY FROM STDIN" : result->GetErrorMessage());
+        throw Exception("Ошибка выполнения запроса: " + GetLastError());
+    }
+    PQclear(start);
+
+    // Данные передаются порциями: буфер переиспользуется, вся выгрузка
+    // в памяти не собирается
+    std::string chunk;
+    std::string abortReason;
+    try
+    {
+        bool more = true;
+        while (more)
+        {
+            chunk.clear();
+            more = writeChunk(chunk);
+            if (!chunk.empty() && PQputCopyData(pg, chunk.data(), static_cast<int>(chunk.size())) != 1)
+            {
+                abortReason = PQerrorMessage(pg);
+                break;
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        abortReason = e.what();
+    }
+
+    // Прерванный COPY завершается ошибкой на сервере, и транзакция откатывается
+    if (PQputCopyEnd(pg, abortReason.empty() ? nullptr : abortReason.c_str()) != 1)
+    {
+        SetLastError(PQerrorMessage(pg));
+        throw Exception("Ошибка завершения COPY: " + GetLastError());
+    }
+
+    // Итог COPY: количество строк или ошибка; после него PQgetResult возвращает nullptr
+    std::shared_ptr<PGresult> result(PQgetResult(pg), PQclear);
+    while (PGresult* next = PQgetResult(pg))
+    {
+        PQclear(next);
+    }
+
+    if (!abortReason.empty())
+    {
+        SetLastError(abortReason);
+        throw Exception("COPY прерван: " + abortReason);
+    }
+    if (PQresultStatus(result.get()) != PGRES_COMMAND_OK)
+    {
+        SetLastError(result ? PQresultErrorMessage(result.get()) : PQerrorMessage(pg));
+        throw Exception("Ошибка выполнения запроса: " + GetLastError());
+    }
+
+    std::size_t rows = 0;
+    const char* count = PQcmdTuples(result.get());
+    std::from_chars(count, count + std::strlen(count), rows);
+    return rows;
+}
+
+// Начало транзакции
+void db::DatabaseManager::BeginTransaction()
+{
+    auto threadId = std::this_thread::get_id();
+    TransactionState* current = nullptr;
+    {
+        std::lock_guard lock(mutex_);
+        auto it = transactions_.find(threadId);
+        if (it != transactions_.end())
+        {
+            current = &it->second;
+        }
+    }
+
+    // Вложенная транзакция - точка сохранения на закрепленном подключении
+    if (current)
+    {
+        std::string name = SavepointName(current->savepoints + 1);
+        CheckResult(PQexec(current->lease->Get(), ("SAVEPOINT " + name).c_str()));
+        ++current->savepoints;
+        return;
+    }
+
+    auto pool = GetPool();
+    if (!pool)
+    {
+        throw Exception("Нет подключения к БД");
+    }
+
+    // Подключение закрепляется за потоком до завершения транзакции
+    auto lease = pool->Acquire();
+    CheckResult(PQexec(lease->Get(), "BEGIN"));
+
+    {
+        std::lock_guard lock(mutex_);
+        transactions_.emplace(threadId, TransactionState{std::move(lease), 0});
+    }
+    std::lock_guard lock(sessions_->mutex);
+    CurrentSession().pendingWrite = true;
+}
+
+// Подтверждение транзакции
+void db::DatabaseManager::Commit()
+{
+    TransactionState& current = CurrentTransaction();
+    if (current.savepoints > 0)
+    {
+        // При ошибке (например, в прерванной транзакции) точка сохранения остается:
+        // откат в деструкторе Transaction вернется к ней, а не откатит всю транзакцию
+        std::string name = SavepointName(current.savepoints);
+        CheckResult(PQexec(current.lease->Get(), ("RELEASE SAVEPOINT " + name).c_str()));
+        --current.savepoints;
+        return;
+    }
+
+    ConnectionPool::Lease lease;
+    {
+        std::lock_guard lock(mutex_);
+        lease = std::move(current.lease);
+        transactions_.erase(std::this_thread::get_id());
+    }
+
+    CheckResult(PQexec(lease->Get(), "COMMIT"));
+}
+
+// Откат транзакции
+void db::DatabaseManager::Rollback()
+{
+    TransactionState& current = CurrentTransaction();
+    if (current.savepoints > 0)
+    {
+        // Откат до точки сохранения возвращает транзакцию из состояния ошибки
+        std::string name = SavepointName(current.savepoints);
+        CheckResult(PQexec(current.lease->Get(),
+                           ("ROLLBACK TO SAVEPOINT " + name + "; RELEASE SAVEPOINT " + name).c_str()));
+        --current.savepoints;
+        return;
+    }
+
+    ConnectionPool::Lease lease;
+    {
+        std::lock_guard lock(mutex_);
+        lease = std::move(current.lease);
+        transactions_.erase(std::this_thread::get_id());
+    }
+
+    CheckResult(PQexec(lease->Get(), "ROLLBACK"));
+}
+
+// Глубина вложенности транзакций текущего потока
+int db::DatabaseManager::GetTransactionDepth() const
+{
+    std::lock_guard lock(mutex_);
+    auto it = transactions_.find(std::this_thread::get_id());
+    return it == transactions_.end() ? 0 : it->second.savepoints + 1;
+}
+
+// Выполнение SQL команды без возврата результата
+void db::DatabaseManager::Execute(const std::string& query)
+{
+    ExecuteQuery(query);
+}
+
+// Начало области запросов только на чтение
+void db::DatabaseManager::BeginReadOnly()
+{
+    std::lock_guard lock(sessions_->mutex);
+    ++CurrentSession().readOnlyDepth;
+}
+
+// Конец области запросов только на чтение
+void db::DatabaseManager::EndReadOnly()
+{
+    std::lock_guard lock(sessions_->mutex);
+    auto& session = CurrentSession();
+    if (session.readOnlyDepth > 0)
+    {
+        --session.readOnlyDepth;
+    }
+}
+
+// Количество реплик
+std::size_t db::DatabaseManager::GetReplicaCount() const
+{
+    std::lock_guard lock(mutex_);
+    return replicas_.size();
+}
+
+// Подписка на уведомления
+std::unique_ptr<db::NotificationListener> db::DatabaseManager::Listen(std::vector<std::string> channels,
+                                                                      NotificationListener::Handler handler) const
+{
+    std::string connInfo;
+    {
+        std::lock_guard lock(mutex_);
+        if (!pool_)
+        {
+            throw Exception("Нет подключения к БД");
+        }
+        connInfo = connInfo_;
+    }
+    return std::make_unique<NotificationListener>(std::move(connInfo), std::move(channels), std::move(handler));
+}
+
+// Получение последней ошибки
+std::string db::DatabaseManager::GetLastError() const
+{
+    std::lock_guard lock(mutex_);
+    return lastError_;
+}
+
+// Экранирование строки для SQL
+std::string db::DatabaseManager::EscapeString(const std::string& str) const
+{
+    auto pool = GetPool();
+    if (!pool)
+    {
+        throw Exception("Нет подключения к БД");
+    }
+
+    auto lease = pool->Acquire();
+    std::vector<char> buffer(str.length() * 2 + 1);
+    PQescapeStringConn(lease->Get(), buffer.data(), str.c_str(), str.length(), nullptr);
+    return std::string(buffer.data());
+}
+
+// Пул подключений
+std::shared_ptr<db::ConnectionPool> db::DatabaseManager::GetPool() const
+{
+    std::lock_guard lock(mutex_);
+    return pool_;
+}
+
+// Снимок статистики запросов
+std::vector<db::QueryStatistics::StatementStatistics> db::DatabaseManager::GetStatistics() const
+{
+    return statistics_.Snapshot();
+}
+
+// Статистика запросов
+db::QueryStatistics& db::DatabaseManager::GetQueryStatistics()
+{
+    return statistics_;
+}
+
+// Включение журнала медленных запросов
+void db::DatabaseManager::EnableSlowQueryLog(const SlowQueryLog::Options& options)
+{
+    auto slowLog = std::make_shared<SlowQueryLog>(options);
+    std::lock_guard lock(mutex_);
+    slowLog_ = std::move(slowLog);
+}
+
+// Отключение журнала медленных запросов
+void db::DatabaseManager::DisableSlowQueryLog()
+{
+    std::lock_guard lock(mutex_);
+    slowLog_.reset();
+}
+
+// Реестры сеансов, в которых есть запись потока; при завершении потока
+// записи удаляются из реестров, которые еще существуют
+class db::DatabaseManager::SessionOwner
+{
+public:
+    ~SessionOwner()
+    {
+        auto threadId = std::this_thread::get_id();
+        for (const auto& weak : registries_)
+        {
+            if (auto registry = weak.lock())
+            {
+                std::lock_guard lock(registry->mutex);
+                registry->states.erase(threadId);
+            }
+        }
+    }
+
+    void Add(const std::shared_ptr<SessionRegistry>& registry)
+    {
+        std::erase_if(registries_, [](const auto& weak) { return weak.expired(); });
+        registries_.push_back(registry);
+    }
+
+private:
+    std::vector<std::weak_ptr<SessionRegistry>> registries_;
+};
+
+// Сеанс текущего потока
+db::DatabaseManager::SessionState& db::DatabaseManager::CurrentSession()
+{
+    thread_local SessionOwner owner;
+    auto [it, inserted] = sessions_->states.try_emplace(std::this_thread::get_id());
+    if (inserted)
+    {
+        owner.Add(sessions_);
+    }
+    return it->second;
+}
+
+// Транзакция текущего потока
+db::DatabaseManager::TransactionState& db::DatabaseManager::CurrentTransaction()
+{
+    std::lock_guard lock(mutex_);
+    auto it = transactions_.find(std::this_thread::get_id());
+    if (it == transactions_.end())
+    {
+        throw Exception("Нет активной транзакции");
+    }
+    return it->second;
+}
+
+// Подключение для выполнения запроса
+db::Connection& db::DatabaseManager::AcquireConnection(ConnectionPool::Lease& lease)
+{
+    std::shared_ptr<ConnectionPool> pool;
+    std::vector<std::shared_ptr<ReplicaState>> replicas;
+    SessionState session;
+    {
+        std::lock_guard lock(mutex_);
+
+        // Внутри транзакции все запросы потока идут через одно подключение.
+        // Запись удаляет только сам поток, поэтому ссылка остается валидной
+        auto it = transactions_.find(std::this_thread::get_id());
+        if (it != transactions_.end())
+        {
+            return *it->second.lease;
+        }
+        pool = pool_;
+
+        std::lock_guard sessionsLock(sessions_->mutex);
+        SessionState& current = CurrentSession();
+        if (current.readOnlyDepth == 0)
+        {
+            current.pendingWrite = true;
+        }
+        else
+        {
+            replicas = replicas_;
+        }
+        session = current;
+    }
+
+    if (!pool)
+    {
+        throw Exception("Нет подключения к БД");
+    }
+
+    if (!replicas.empty() && AcquireReplica(pool, replicas, session, lease))
+    {
+        return *lease;
+    }
+
+    lease = pool->Acquire();
+    return *lease;
+}
+
+// Подключение к реплике для запроса только на чтение
+bool db::DatabaseManager::AcquireReplica(const std::shared_ptr<ConnectionPool>& primary,
+                                         const std::vector<std::shared_ptr<ReplicaState>>& replicas,
+                                         SessionState session,
+                                         ConnectionPool::Lease& lease)
+{
+    // Позиция записей сеанса запрашивается лениво - перед первым чтением после них.
+    // Текущая позиция основного сервера не меньше позиции последней записи сеанса
+    if (session.pendingWrite)
+    {
+        auto primaryLease = primary->Acquire();
+        PGresult* result = PQexec(primaryLease->Get(), "SELECT pg_current_wal_lsn()");
+        auto lsn = GetLsn(result);
+        PQclear(result);
+        if (!lsn)
+        {
+            return false;
+        }
+        session.lsn = *lsn;
+        session.pendingWrite = false;
+
+        // Запрос выполнялся без блокировки реестра. Disconnect за это время
+        // сбросил pendingWrite - позиция прежнего сервера не сохраняется
+        std::lock_guard lock(sessions_->mutex);
+        SessionState& current = CurrentSession();
+        if (current.pendingWrite)
+        {
+            current.lsn = session.lsn;
+            current.pendingWrite = false;
+        }
+    }
+
+    // Порядок обхода: по числу выданных подключений, при равенстве - по кругу
+    std::size_t start = nextReplica_.fetch_add(1, std::memory_order_relaxed);
+    std::vector<std::pair<std::size_t, std::size_t>> order; // Загрузка, индекс
+    order.reserve(replicas.size());
+    for (std::size_t i = 0; i < replicas.size(); ++i)
+    {
+        std::size_t index = (start + i) % replicas.size();
+        const auto& pool = replicas[index]->pool;
+        std::size_t size = pool->GetSize();
+        std::size_t idle = pool->GetIdleCount();
+        order.emplace_back(size > idle ? size - idle : 0, index);
+    }
+    std::stable_sort(order.begin(), order.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first < rhs.first;
+    });
+
+    // Сначала реплики, уже применившие записи сеанса
+    for (const auto& [load, index] : order)
+    {
+        auto& replica = *replicas[index];
+        if (replica.replayLsn.load(std::memory_order_relaxed) < session.lsn)
+        {
+            continue;
+        }
+        try
+        {
+            lease = replica.pool->Acquire();
+            return true;
+        }
+        catch (const Exception&)
+        {
+            // Реплика недоступна - пробуем следующую
+        }
+    }
+
+    // Иначе ожидание на наименее загруженной доступной реплике
+    for (const auto& [load, index] : order)
+    {
+        auto& replica = *replicas[index];
+        try
+        {
+            lease = replica.pool->Acquire();
+        }
+        catch (const Exception&)
+        {
+            continue;
+        }
+        if (WaitForReplay(*lease, replica, session.lsn))
+        {
+            return true;
+        }
+        lease.Release();
+        return false;
+    }
+    return false;
+}
+
+// Ожидание применения репликой WAL до позиции lsn
+bool db::DatabaseManager::WaitForReplay(Connection& conn, ReplicaState& replica, std::uint64_t lsn) const
+{
+    auto deadline = std::chrono::steady_clock::now() + replicaLagTimeout_;
+    auto delay = std::chrono::milliseconds(1);
+    for (;;)
+    {
+        PGresult* result = PQexec(conn.Get(), "SELECT pg_last_wal_replay_lsn()");
+        auto replayed = GetLsn(result);
+        PQclear(result);
+
+        // NULL - сервер не в режиме восстановления, т.е. не реплика
+        if (!replayed)
+        {
+            return false;
+        }
+
+        auto known = replica.replayLsn.load(std::memory_order_relaxed);
+        while (known < *replayed &&
+               !replica.replayLsn.compare_exchange_weak(known, *replayed, std::memory_order_relaxed))
+        {
+        }
+        if (*replayed >= lsn)
+        {
+            return true;
+        }
+
+        if (std::chrono::steady_clock::now() + delay > deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(delay);
+        delay = std::min(delay * 2, std::chrono::milliseconds(20));
+    }
+}
+
+// Проверка результата запроса
+std::unique_ptr<db::QueryResult> db::DatabaseManager::CheckResult(PGresult* result)
+{
+    auto queryResult = std::make_unique<QueryResult>(result);
+
+    if (!queryResult->IsSuccess())
+    {
+        SetLastError(queryResult->GetErrorMessage());
+        throw Exception("Ошибка выполнения запроса: " + queryResult->GetErrorMessage(), queryResult->GetSqlState());
+    }
+
+    return queryResult;
+}
+
+// Учет выполненного запроса
+void db::DatabaseManager::ObserveQuery(Connection& conn,
+                                       const std::string& query,
+                                       const ParamView& params,
+                                       std::chrono::steady_clock::time_point start,
+                                       const PGresult* result)
+{
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    auto status = PQresultStatus(result);
+    bool failed = status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK;
+    auto rows = result ? static_cast<std::uint64_t>(PQntuples(result)) : 0;
+    auto bytes = result ? static_cast<std::uint64_t>(PQresultMemorySize(result)) : 0;
+    statistics_.Record(query, elapsed, rows, bytes, failed);
+
+    std::shared_ptr<SlowQueryLog> slowLog;
+    {
+        std::lock_guard lock(mutex_);
+        slowLog = slowLog_;
+    }
+    if (!slowLog || !slowLog->IsSlow(elapsed))
+    {
+        return;
+    }
+
+    // Неудачный запрос повторять незачем - в журнал попадает ошибка
+    std::string plan;
+    if (!failed && slowLog->ShouldExplain(query))
+    {
+        plan = ExplainQuery(conn.Get(), query, params);
+    }
+    auto text = FormatParams(params.count, params.types, params.values, params.lengths, params.formats);
+    slowLog->Write(query, &text, elapsed, failed ? PQresultErrorMessage(result) : "", plan);
+}
+
+// План выполнения запроса
+std::string db::DatabaseManager::ExplainQuery(PGconn* conn, const std::string& query, const ParamView& params)
+{
+    // В транзакции пользователя изменения откатываются до точки сохранения,
+    // вне ее - вместе с отдельной транзакцией
+    auto transactionStatus = PQtransactionStatus(conn);
+    if (transactionStatus != PQTRANS_IDLE && transactionStatus != PQTRANS_INTRANS)
+    {
+        return "(план недоступен: транзакция в состоянии ошибки)";
+    }
+    bool inTransaction = transactionStatus == PQTRANS_INTRANS;
+
+    auto exec = [conn](const char* command) {
+        PGresult* result = PQexec(conn, command);
+        bool ok = PQresultStatus(result) == PGRES_COMMAND_OK;
+        PQclear(result);
+        return ok;
+    };
+    if (!exec(inTransaction ? "SAVEPOINT tariff_sys_explain" : "BEGIN"))
+    {
+        return std::string("(план недоступен: ") + PQerrorMessage(conn) + ")";
+    }
+
+    std::string explain = "EXPLAIN (ANALYZE, BUFFERS) " + query;
+    PGresult* result = PQexecParams(
+        conn, explain.c_str(), params.count, params.types, params.values, params.lengths, params.formats, 0);
+
+    std::string plan;
+    if (PQresultStatus(result) == PGRES_TUPLES_OK)
+    {
+        for (int i = 0; i < PQntuples(result); ++i)
+        {
+            plan += PQgetvalue(result, i, 0);
+            plan += '\n';
+        }
+    }
+    else
+    {
+        plan = std::string("(план недоступен: ") + PQresultErrorMessage(result) + ")";
+    }
+    PQclear(result);
+
+    if (inTransaction)
+    {
+        exec("ROLLBACK TO SAVEPOINT tariff_sys_explain");
+        exec("RELEASE SAVEPOINT tariff_sys_explain");
+    }
+    else
+    {
+        exec("ROLLBACK");
+    }
+    return plan;
+}
+
+// Сохранение текста последней ошибки
+void db::DatabaseManager::SetLastError(const std::string& error)
+{
+    std::lock_guard lock(mutex_);
+    lastError_ = error;
+}
 
 db::Transaction::Transaction(DatabaseManager& db)
     : db_(db)
@@ -277,3 +1637,14 @@ void db::Transaction::Rollback()
     db_.Rollback();
     committed_ = true;
 }
+
+db::ReadOnlyScope::ReadOnlyScope(DatabaseManager& db)
+    : db_(db)
+{
+    db_.BeginReadOnly();
+}
+
+db::ReadOnlyScope::~ReadOnlyScope()
+{
+    db_.EndReadOnly();
+}
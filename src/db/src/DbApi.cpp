@@ -1,11 +1,407 @@
 #include "DbApi.h"
 
-#include <fstream>
-#include <sstream>
+#include "RowMapper.h"
+#include "SchemaScripts.h"
+
+#include <charconv>
+#include <map>
+#include <numeric>
+#include <span>
+#include <string_view>
 
 namespace db
 {
 
+namespace
+{
+// Composite writes send the header and its children in one pipeline. The
+// children cannot see the header's RETURNING value, so the header stores the
+// new id in a transaction-local setting that the children read back
+const std::string kParentId = "current_setting('tariff_sys.parent_id')::INTEGER";
+
+std::string StoreParentId(const std::string& insertCall)
+{
+    return "SELECT set_config('tariff_sys.parent_id', " + insertCall + "::TEXT, true)";
+}
+
+// Reads the header id from the first pipeline result
+int GetCreatedId(const std::vector<std::unique_ptr<QueryResult>>& results)
+{
+    if (!results.empty() && results.front()->GetRowCount() > 0)
+    {
+        if (auto id = results.front()->GetInt(0, 0))
+            return *id;
+    }
+    return 0;
+}
+
+// Typed parameters send empty strings as NULL, as the "NULL" sentinel did
+std::optional<std::string_view> NullIfEmpty(const std::string& value)
+{
+    if (value.empty())
+        return std::nullopt;
+    return value;
+}
+
+// Applied schema script checksums by script name
+std::map<std::string, std::string> LoadSchemaLedger(DatabaseManager& db)
+{
+    auto result = db.ExecuteQuery("SELECT SCRIPT_NAME, CHECKSUM FROM SCHEMA_MIGRATION");
+    std::map<std::string, std::string> ledger;
+    for (int row = 0; row < result->GetRowCount(); ++row)
+        ledger.emplace(result->GetValue(row, 0).value_or(""), result->GetValue(row, 1).value_or(""));
+    return ledger;
+}
+
+bool IsSchemaCurrent(const std::map<std::string, std::string>& ledger, std::span<const SchemaScript> scripts)
+{
+    for (const auto& script : scripts)
+    {
+        auto it = ledger.find(std::string(script.name));
+        if (it == ledger.end() || it->second != script.checksum)
+            return false;
+    }
+    return true;
+}
+
+// Rows are handed to COPY in chunks of about this size
+constexpr std::size_t kCopyChunkSize = 64 * 1024;
+
+// Text-format COPY field writers; fields are separated by tabs, rows end with '\n'
+void AppendCopyNull(std::string& out)
+{
+    out += "\\N";
+}
+
+void AppendCopyText(std::string& out, std::string_view value)
+{
+    for (char c : value)
+    {
+        switch (c)
+        {
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        default:
+            out += c;
+        }
+    }
+}
+
+// Empty strings are stored as NULL, as in the INS_* calls
+void AppendCopyOptionalText(std::string& out, const std::string& value)
+{
+    if (value.empty())
+        AppendCopyNull(out);
+    else
+        AppendCopyText(out, value);
+}
+
+template <typename T>
+void AppendCopyNumber(std::string& out, T value)
+{
+    char buffer[32];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, end);
+}
+
+template <typename T>
+void AppendCopyNumber(std::string& out, const std::optional<T>& value)
+{
+    if (value)
+        AppendCopyNumber(out, *value);
+    else
+        AppendCopyNull(out);
+}
+
+// Page queries fetch one extra row to tell whether another page follows
+std::vector<std::string> PageParams(int pageSize, const std::optional<PageCursor>& after)
+{
+    if (pageSize <= 0)
+        throw Exception("Размер страницы должен быть положительным");
+    return {std::to_string(pageSize + 1),
+            after ? after->key : "NULL",
+            after ? std::to_string(after->id) : "NULL"};
+}
+
+template <typename T, typename SortKey>
+Page<T> MakePage(std::vector<T> items, int pageSize, SortKey sortKey)
+{
+    Page<T> page;
+    if (items.size() > static_cast<std::size_t>(pageSize))
+    {
+        items.pop_back();
+        page.next = PageCursor{sortKey(items.back()), items.back().id};
+    }
+    page.items = std::move(items);
+    return page;
+}
+
+// Text literal of an INTEGER[] parameter: {1,2,3}
+std::string ToArrayLiteral(std::span<const int> values)
+{
+    std::string literal = "{";
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        if (i > 0)
+            literal += ',';
+        AppendCopyNumber(literal, values[i]);
+    }
+    literal += '}';
+    return literal;
+}
+} // namespace
+
+// ==================== Row Mappings ====================
+// Column order matches the RETURNS TABLE of the corresponding GET_* function
+
+template <>
+struct RowMapping<UnitOfMeasure>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &UnitOfMeasure::id),
+                                                    Bind(1, &UnitOfMeasure::code),
+                                                    Bind(2, &UnitOfMeasure::name),
+                                                    Bind(3, &UnitOfMeasure::note));
+};
+
+template <>
+struct RowMapping<EnumInfo>
+{
+    static constexpr auto columns = std::make_tuple(
+        Bind(0, &EnumInfo::id), Bind(1, &EnumInfo::code), Bind(2, &EnumInfo::name), Bind(3, &EnumInfo::note));
+};
+
+template <>
+struct RowMapping<EnumValue>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &EnumValue::id),
+                                                    Bind(1, &EnumValue::code),
+                                                    Bind(2, &EnumValue::name),
+                                                    Bind(3, &EnumValue::position),
+                                                    Bind(4, &EnumValue::note));
+};
+
+template <>
+struct RowMapping<ClassInfo>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &ClassInfo::id),
+                                                    Bind(1, &ClassInfo::code),
+                                                    Bind(2, &ClassInfo::name),
+                                                    Bind(3, &ClassInfo::parentId),
+                                                    Bind(4, &ClassInfo::level),
+                                                    Bind(5, &ClassInfo::note));
+};
+
+template <>
+struct RowMapping<ParameterInfo>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &ParameterInfo::id),
+                                                    Bind(1, &ParameterInfo::code),
+                                                    Bind(2, &ParameterInfo::name),
+                                                    Bind(3, &ParameterInfo::classId),
+                                                    Bind(4, &ParameterInfo::type),
+                                                    Bind(5, &ParameterInfo::typeName),
+                                                    Bind(6, &ParameterInfo::unitId),
+                                                    Bind(7, &ParameterInfo::unitName),
+                                                    Bind(8, &ParameterInfo::note));
+};
+
+template <>
+struct RowMapping<ServiceTypeInfo>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &ServiceTypeInfo::id),
+                                                    Bind(1, &ServiceTypeInfo::code),
+                                                    Bind(2, &ServiceTypeInfo::name),
+                                                    Bind(3, &ServiceTypeInfo::classId),
+                                                    Bind(4, &ServiceTypeInfo::className),
+                                                    Bind(5, &ServiceTypeInfo::note));
+};
+
+template <>
+struct RowMapping<ServiceTypeParamInfo>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &ServiceTypeParamInfo::parId),
+                                                    Bind(1, &ServiceTypeParamInfo::code),
+                                                    Bind(2, &ServiceTypeParamInfo::name),
+                                                    Bind(3, &ServiceTypeParamInfo::type),
+                                                    Bind(4, &ServiceTypeParamInfo::isRequired),
+                                                    Bind(5, &ServiceTypeParamInfo::defaultValNum),
+                                                    Bind(6, &ServiceTypeParamInfo::defaultValStr),
+                                                    Bind(7, &ServiceTypeParamInfo::minVal),
+                                                    Bind(8, &ServiceTypeParamInfo::maxVal),
+                                                    Bind(9, &ServiceTypeParamInfo::unitName));
+};
+
+template <>
+struct RowMapping<ExecutorInfo>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &ExecutorInfo::id),
+                                                    Bind(1, &ExecutorInfo::code),
+                                                    Bind(2, &ExecutorInfo::name),
+                                                    Bind(3, &ExecutorInfo::address),
+                                                    Bind(4, &ExecutorInfo::phone),
+                                                    Bind(5, &ExecutorInfo::email),
+                                                    Bind(6, &ExecutorInfo::isActive),
+                                                    Bind(7, &ExecutorInfo::note));
+};
+
+template <>
+struct RowMapping<TariffInfo>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &TariffInfo::id),
+                                                    Bind(1, &TariffInfo::code),
+                                                    Bind(2, &TariffInfo::name),
+                                                    Bind(3, &TariffInfo::serviceTypeId),
+                                                    Bind(4, &TariffInfo::serviceName),
+                                                    Bind(5, &TariffInfo::executorId),
+                                                    Bind(6, &TariffInfo::executorName),
+                                                    Bind(7, &TariffInfo::dateBegin),
+                                                    Bind(8, &TariffInfo::dateEnd),
+                                                    Bind(9, &TariffInfo::isWithVat),
+                                                    Bind(10, &TariffInfo::vatRate),
+                                                    Bind(11, &TariffInfo::isActive),
+                                                    Bind(12, &TariffInfo::note));
+};
+
+template <>
+struct RowMapping<TariffRateInfo>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &TariffRateInfo::id),
+                                                    Bind(1, &TariffRateInfo::code),
+                                                    Bind(2, &TariffRateInfo::name),
+                                                    Bind(3, &TariffRateInfo::value),
+                                                    Bind(4, &TariffRateInfo::unitId),
+                                                    Bind(5, &TariffRateInfo::unitName),
+                                                    Bind(6, &TariffRateInfo::note));
+};
+
+template <>
+struct RowMapping<OrderInfo>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &OrderInfo::id),
+                                                    Bind(1, &OrderInfo::code),
+                                                    Bind(2, &OrderInfo::serviceTypeId),
+                                                    Bind(3, &OrderInfo::serviceName),
+                                                    Bind(4, &OrderInfo::orderDate),
+                                                    Bind(5, &OrderInfo::executionDate),
+                                                    Bind(6, &OrderInfo::status),
+                                                    Bind(7, &OrderInfo::statusName),
+                                                    Bind(8, &OrderInfo::executorId),
+                                                    Bind(9, &OrderInfo::executorName),
+                                                    Bind(10, &OrderInfo::tariffId),
+                                                    Bind(11, &OrderInfo::tariffName),
+                                                    Bind(12, &OrderInfo::totalCost),
+                                                    Bind(13, &OrderInfo::note));
+};
+
+template <>
+struct RowMapping<OrderParamInfo>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &OrderParamInfo::parId),
+                                                    Bind(1, &OrderParamInfo::code),
+                                                    Bind(2, &OrderParamInfo::name),
+                                                    Bind(3, &OrderParamInfo::type),
+                                                    Bind(4, &OrderParamInfo::valNum),
+                                                    Bind(5, &OrderParamInfo::valStr),
+                                                    Bind(6, &OrderParamInfo::valDate),
+                                                    Bind(7, &OrderParamInfo::enumId),
+                                                    Bind(8, &OrderParamInfo::enumName),
+                                                    Bind(9, &OrderParamInfo::unitName));
+};
+
+template <>
+struct RowMapping<CoefficientInfo>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &CoefficientInfo::id),
+                                                    Bind(1, &CoefficientInfo::code),
+                                                    Bind(2, &CoefficientInfo::name),
+                                                    Bind(3, &CoefficientInfo::valueMin),
+                                                    Bind(4, &CoefficientInfo::valueMax),
+                                                    Bind(5, &CoefficientInfo::valueDefault),
+                                                    Bind(6, &CoefficientInfo::note));
+};
+
+template <>
+struct RowMapping<RuleFunctionInfo>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &RuleFunctionInfo::id),
+                                                    Bind(1, &RuleFunctionInfo::type),
+                                                    Bind(2, &RuleFunctionInfo::operation));
+};
+
+template <>
+struct RowMapping<RuleCallInfo>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &RuleCallInfo::id),
+                                                    Bind(1, &RuleCallInfo::functionId),
+                                                    Bind(2, &RuleCallInfo::objectId),
+                                                    Bind(3, &RuleCallInfo::numCall));
+};
+
+template <>
+struct RowMapping<RuleArgumentInfo>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &RuleArgumentInfo::callId),
+                                                    Bind(1, &RuleArgumentInfo::numArg),
+                                                    Bind(2, &RuleArgumentInfo::valNum),
+                                                    Bind(3, &RuleArgumentInfo::valStr),
+                                                    Bind(4, &RuleArgumentInfo::constId),
+                                                    Bind(5, &RuleArgumentInfo::valFunctionId),
+                                                    Bind(6, &RuleArgumentInfo::valCallId));
+};
+
+template <>
+struct RowMapping<RuleDecisionInfo>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &RuleDecisionInfo::functionId),
+                                                    Bind(1, &RuleDecisionInfo::objectId),
+                                                    Bind(2, &RuleDecisionInfo::numCall),
+                                                    Bind(3, &RuleDecisionInfo::decisionFunctionId),
+                                                    Bind(4, &RuleDecisionInfo::priority));
+};
+
+template <>
+struct RowMapping<RuleConstantInfo>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &RuleConstantInfo::id),
+                                                    Bind(1, &RuleConstantInfo::code),
+                                                    Bind(2, &RuleConstantInfo::valNum),
+                                                    Bind(3, &RuleConstantInfo::valStr));
+};
+
+template <>
+struct RowMapping<RuleCompositionInfo>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &RuleCompositionInfo::functionId),
+                                                    Bind(1, &RuleCompositionInfo::componentId));
+};
+
+template <>
+struct RowMapping<OrderCostInfo>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &OrderCostInfo::orderId),
+                                                    Bind(1, &OrderCostInfo::totalCost));
+};
+
+template <>
+struct RowMapping<OptimalExecutorInfo>
+{
+    static constexpr auto columns = std::make_tuple(Bind(0, &OptimalExecutorInfo::executorId),
+                                                    Bind(1, &OptimalExecutorInfo::executorName),
+                                                    Bind(2, &OptimalExecutorInfo::tariffId),
+                                                    Bind(3, &OptimalExecutorInfo::tariffName),
+                                                    Bind(4, &OptimalExecutorInfo::estimatedCost));
+};
+
 DbApi::DbApi(std::shared_ptr<DatabaseManager> db)
     : db_(db)
 {
@@ -13,40 +409,75 @@ DbApi::DbApi(std::shared_ptr<DatabaseManager> db)
 
 DbApi::~DbApi() = default;
 
-void DbApi::InitializeSchema()
+std::shared_ptr<DatabaseManager> DbApi::GetDatabase() const
 {
-    // Execute table creation script
-    ExecuteSchemaFile("database/schema/01_tables.sql");
-    // Execute index creation script
-    ExecuteSchemaFile("database/schema/02_indexes.sql");
-    // Execute procedure scripts
-    ExecuteSchemaFile("database/procedures/constructor/constructor.sql");
-    ExecuteSchemaFile("database/procedures/calculator/calculator.sql");
-    ExecuteSchemaFile("database/procedures/utils/utils.sql");
+    return db_;
 }
 
-void DbApi::ExecuteSchemaFile(const std::string& filename)
+std::unique_ptr<NotificationListener> DbApi::ListenDictionaryChanges(
+    std::function<void(const std::string& table)> onChange)
+{
+    return db_->Listen({"tariff_sys_dictionary"},
+                       [onChange = std::move(onChange)](const NotificationListener::Notification& notification) {
+                           onChange(notification.payload);
+                       });
+}
+
+void DbApi::InitializeSchema()
 {
-    std::ifstream file(filename);
-    if (!file.is_open())
+    auto scripts = GetSchemaScripts();
+
+    // Fast path: one query when every embedded script is already applied.
+    // Only a missing ledger (undefined_table) falls through to the slow path,
+    // which creates it; any other error is reported as is
+    try
+    {
+        if (IsSchemaCurrent(LoadSchemaLedger(*db_), scripts))
+            return;
+    }
+    catch (const Exception& e)
     {
-        throw Exception("Cannot open schema file: " + filename);
+        if (e.GetSqlState() != "42P01")
+            throw;
     }
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string sql = buffer.str();
+    Transaction transaction(*db_);
+
+    // Concurrent initializers wait here and then see each other's ledger rows
+    db_->Execute("SELECT pg_advisory_xact_lock(hashtext('tariff_sys.schema'))");
+    db_->Execute("SET LOCAL client_min_messages = WARNING;"
+                 "CREATE TABLE IF NOT EXISTS SCHEMA_MIGRATION ("
+                 " SCRIPT_NAME VARCHAR(255) PRIMARY KEY,"
+                 " CHECKSUM CHAR(64) NOT NULL,"
+                 " APPLIED_AT TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP)");
+    auto ledger = LoadSchemaLedger(*db_);
+
+    // Later scripts may depend on objects an earlier one recreates, so
+    // everything after the first changed script is applied again
+    bool changed = false;
+    for (const auto& script : scripts)
+    {
+        auto it = ledger.find(std::string(script.name));
+        changed = changed || it == ledger.end() || it->second != script.checksum;
+        if (!changed)
+            continue;
+
+        db_->Execute(std::string(script.sql));
+        db_->Execute("INSERT INTO SCHEMA_MIGRATION (SCRIPT_NAME, CHECKSUM) VALUES ($1, $2) "
+                     "ON CONFLICT (SCRIPT_NAME) DO UPDATE "
+                     "SET CHECKSUM = EXCLUDED.CHECKSUM, APPLIED_AT = CURRENT_TIMESTAMP",
+                     script.name,
+                     script.checksum);
+    }
 
-    db_->Execute(sql);
+    transaction.Commit();
 }
 
 // ==================== Units of Measure ====================
 
 int DbApi::CreateUnit(const std::string& code, const std::string& name, const std::string& note)
 {
-    std::string query = "SELECT INS_EI($1, $2, $3)";
-    std::vector<std::string> params = {code, name, note.empty() ? "NULL" : note};
-    auto result = db_->executeQuery(query, params);
+    auto result = db_->Execute("SELECT INS_EI($1, $2, $3)", code, name, NullIfEmpty(note));
     if (result->GetRowCount() > 0)
     {
         auto id = result->GetInt(0, 0);
@@ -58,42 +489,27 @@ int DbApi::CreateUnit(const std::string& code, const std::string& name, const st
 
 void DbApi::UpdateUnit(int id, const std::string& code, const std::string& name, const std::string& note)
 {
-    std::string query = "SELECT UPD_EI($1, $2, $3, $4)";
-    std::vector<std::string> params = {std::to_string(id), code, name, note.empty() ? "NULL" : note};
-    db_->executeQuery(query, params);
+    db_->Execute("SELECT UPD_EI($1, $2, $3, $4)", id, code, name, NullIfEmpty(note));
 }
 
 void DbApi::DeleteUnit(int id)
 {
-    std::string query = "SELECT DEL_EI($1)";
-    db_->executeQuery(query, {std::to_string(id)});
+    db_->Execute("SELECT DEL_EI($1)", id);
 }
 
 std::vector<UnitOfMeasure> DbApi::GetAllUnits()
 {
+    ReadOnlyScope readOnly(*db_);
     std::string query = "SELECT * FROM GET_ALL_EI()";
-    auto result = db_->ExecuteQuery(query);
-    std::vector<UnitOfMeasure> units;
-
-    for (int i = 0; i < result->GetRowCount(); ++i)
-    {
-        UnitOfMeasure unit;
-        unit.id = result->GetInt(i, 0).value_or(0);
-        unit.code = result->GetValue(i, 1).value_or("");
-        unit.name = result->GetValue(i, 2).value_or("");
-        unit.note = result->GetValue(i, 3).value_or("");
-        units.push_back(unit);
-    }
-    return units;
+    auto result = db_->executeQuery(query, {}, ResultFormat::Binary);
+    return MapRows<UnitOfMeasure>(*result);
 }
 
 // ==================== Enumerations ====================
 
 int DbApi::CreateEnum(const std::string& code, const std::string& name, const std::string& note)
 {
-    std::string query = "SELECT INS_ENUM($1, $2, $3)";
-    std::vector<std::string> params = {code, name, note.empty() ? "NULL" : note};
-    auto result = db_->executeQuery(query, params);
+    auto result = db_->Execute("SELECT INS_ENUM($1, $2, $3)", code, name, NullIfEmpty(note));
     if (result->GetRowCount() > 0)
     {
         auto id = result->GetInt(0, 0);
@@ -105,35 +521,22 @@ int DbApi::CreateEnum(const std::string& code, const std::string& name, const st
 
 void DbApi::DeleteEnum(int id)
 {
-    std::string query = "DELETE FROM ENUM_VAL_R WHERE ID_ENUM = $1";
-    db_->executeQuery(query, {std::to_string(id)});
+    db_->Execute("DELETE FROM ENUM_VAL_R WHERE ID_ENUM = $1", id);
 }
 
 std::vector<EnumInfo> DbApi::GetAllEnums()
 {
+    ReadOnlyScope readOnly(*db_);
     std::string query = "SELECT * FROM GET_ALL_ENUMS()";
-    auto result = db_->ExecuteQuery(query);
-    std::vector<EnumInfo> enums;
-
-    for (int i = 0; i < result->GetRowCount(); ++i)
-    {
-        EnumInfo info;
-        info.id = result->GetInt(i, 0).value_or(0);
-        info.code = result->GetValue(i, 1).value_or("");
-        info.name = result->GetValue(i, 2).value_or("");
-        info.note = result->GetValue(i, 3).value_or("");
-        enums.push_back(info);
-    }
-    return enums;
+    auto result = db_->executeQuery(query, {}, ResultFormat::Binary);
+    return MapRows<EnumInfo>(*result);
 }
 
 int DbApi::CreateEnumValue(int enumId, const std::string& code, const std::string& name, int position,
                            const std::string& note)
 {
-    std::string query = "SELECT INS_VAL_ENUM($1, $2, $3, $4, $5)";
-    std::vector<std::string> params = {std::to_string(enumId), code, name, std::to_string(position),
-                                       note.empty() ? "NULL" : note};
-    auto result = db_->executeQuery(query, params);
+    auto result = db_->Execute("SELECT INS_VAL_ENUM($1, $2, $3, $4, $5)", enumId, code, name, position,
+                               NullIfEmpty(note));
     if (result->GetRowCount() > 0)
     {
         auto id = result->GetInt(0, 0);
@@ -145,27 +548,15 @@ int DbApi::CreateEnumValue(int enumId, const std::string& code, const std::strin
 
 void DbApi::DeleteEnumValue(int id)
 {
-    std::string query = "DELETE FROM POS_ENUM WHERE ID_POS_ENUM = $1";
-    db_->executeQuery(query, {std::to_string(id)});
+    db_->Execute("DELETE FROM POS_ENUM WHERE ID_POS_ENUM = $1", id);
 }
 
 std::vector<EnumValue> DbApi::GetEnumValues(int enumId)
 {
+    ReadOnlyScope readOnly(*db_);
     std::string query = "SELECT * FROM GET_ENUM_VALUES($1)";
-    auto result = db_->executeQuery(query, {std::to_string(enumId)});
-    std::vector<EnumValue> values;
-
-    for (int i = 0; i < result->GetRowCount(); ++i)
-    {
-        EnumValue val;
-        val.id = result->GetInt(i, 0).value_or(0);
-        val.code = result->GetValue(i, 1).value_or("");
-        val.name = result->GetValue(i, 2).value_or("");
-        val.position = result->GetInt(i, 3).value_or(0);
-        val.note = result->GetValue(i, 4).value_or("");
-        values.push_back(val);
-    }
-    return values;
+    auto result = db_->executeQuery(query, {std::to_string(enumId)}, ResultFormat::Binary);
+    return MapRows<EnumValue>(*result);
 }
 
 // ==================== Classes ====================
@@ -173,9 +564,7 @@ std::vector<EnumValue> DbApi::GetEnumValues(int enumId)
 int DbApi::CreateClass(const std::string& code, const std::string& name, std::optional<int> parentId,
                        const std::string& note)
 {
-    std::string query = "SELECT INS_CLASS($1, $2, $3, $4)";
-    std::vector<std::string> params = {code, name, parentId ? std::to_string(*parentId) : "NULL", note};
-    auto result = db_->executeQuery(query, params);
+    auto result = db_->Execute("SELECT INS_CLASS($1, $2, $3, $4)", code, name, parentId, note);
     if (result->GetRowCount() > 0)
     {
         auto id = result->GetInt(0, 0);
@@ -187,35 +576,20 @@ int DbApi::CreateClass(const std::string& code, const std::string& name, std::op
 
 void DbApi::UpdateClass(int id, const std::string& code, const std::string& name, const std::string& note)
 {
-    std::string query = "SELECT UPD_CLASS($1, $2, $3, $4)";
-    std::vector<std::string> params = {std::to_string(id), code, name, note.empty() ? "NULL" : note};
-    db_->executeQuery(query, params);
+    db_->Execute("SELECT UPD_CLASS($1, $2, $3, $4)", id, code, name, NullIfEmpty(note));
 }
 
 void DbApi::DeleteClass(int id)
 {
-    std::string query = "SELECT DEL_CLASS($1)";
-    db_->executeQuery(query, {std::to_string(id)});
+    db_->Execute("SELECT DEL_CLASS($1)", id);
 }
 
 std::vector<ClassInfo> DbApi::GetAllClasses()
 {
+    ReadOnlyScope readOnly(*db_);
     std::string query = "SELECT * FROM GET_ALL_CLASSES()";
-    auto result = db_->ExecuteQuery(query);
-    std::vector<ClassInfo> classes;
-
-    for (int i = 0; i < result->GetRowCount(); ++i)
-    {
-        ClassInfo info;
-        info.id = result->GetInt(i, 0).value_or(0);
-        info.code = result->GetValue(i, 1).value_or("");
-        info.name = result->GetValue(i, 2).value_or("");
-        info.parentId = result->GetInt(i, 3);
-        info.level = result->GetInt(i, 4).value_or(0);
-        info.note = result->GetValue(i, 5).value_or("");
-        classes.push_back(info);
-    }
-    return classes;
+    auto result = db_->executeQuery(query, {}, ResultFormat::Binary);
+    return MapRows<ClassInfo>(*result);
 }
 
 // ==================== Parameters ====================
@@ -223,14 +597,8 @@ std::vector<ClassInfo> DbApi::GetAllClasses()
 int DbApi::CreateParameter(const std::string& code, const std::string& name, std::optional<int> classId, int type,
                            std::optional<int> unitId, const std::string& note)
 {
-    std::string query = "SELECT INS_PARAMETR($1, $2, $3, $4, $5, $6)";
-    std::vector<std::string> params = {code,
-                                       name,
-                                       classId ? std::to_string(*classId) : "NULL",
-                                       std::to_string(type),
-                                       unitId ? std::to_string(*unitId) : "NULL",
-                                       note.empty() ? "NULL" : note};
-    auto result = db_->executeQuery(query, params);
+    auto result = db_->Execute("SELECT INS_PARAMETR($1, $2, $3, $4, $5, $6)", code, name, classId, type, unitId,
+                               NullIfEmpty(note));
     if (result->GetRowCount() > 0)
     {
         auto id = result->GetInt(0, 0);
@@ -243,52 +611,27 @@ int DbApi::CreateParameter(const std::string& code, const std::string& name, std
 void DbApi::UpdateParameter(int id, const std::string& code, const std::string& name, int type,
                             std::optional<int> unitId, const std::string& note)
 {
-    std::string query = "SELECT UPD_PARAMETR($1, $2, $3, $4, $5, $6)";
-    std::vector<std::string> params = {std::to_string(id),
-                                       code,
-                                       name,
-                                       std::to_string(type),
-                                       unitId ? std::to_string(*unitId) : "NULL",
-                                       note.empty() ? "NULL" : note};
-    db_->executeQuery(query, params);
+    db_->Execute("SELECT UPD_PARAMETR($1, $2, $3, $4, $5, $6)", id, code, name, type, unitId, NullIfEmpty(note));
 }
 
 void DbApi::DeleteParameter(int id)
 {
-    std::string query = "SELECT DEL_PARAMETR($1)";
-    db_->executeQuery(query, {std::to_string(id)});
+    db_->Execute("SELECT DEL_PARAMETR($1)", id);
 }
 
 std::vector<ParameterInfo> DbApi::GetAllParameters()
 {
+    ReadOnlyScope readOnly(*db_);
     std::string query = "SELECT * FROM GET_ALL_PARAMETERS()";
-    auto result = db_->ExecuteQuery(query);
-    std::vector<ParameterInfo> params;
-
-    for (int i = 0; i < result->GetRowCount(); ++i)
-    {
-        ParameterInfo info;
-        info.id = result->GetInt(i, 0).value_or(0);
-        info.code = result->GetValue(i, 1).value_or("");
-        info.name = result->GetValue(i, 2).value_or("");
-        info.classId = result->GetInt(i, 3);
-        info.type = result->GetInt(i, 4).value_or(0);
-        info.typeName = result->GetValue(i, 5).value_or("");
-        info.unitId = result->GetInt(i, 6);
-        info.unitName = result->GetValue(i, 7).value_or("");
-        info.note = result->GetValue(i, 8).value_or("");
-        params.push_back(info);
-    }
-    return params;
+    auto result = db_->executeQuery(query, {}, ResultFormat::Binary);
+    return MapRows<ParameterInfo>(*result);
 }
 
 // ==================== Service Types ====================
 
 int DbApi::CreateServiceType(const std::string& code, const std::string& name, int classId, const std::string& note)
 {
-    std::string query = "SELECT INS_SERVICE_TYPE($1, $2, $3, $4)";
-    std::vector<std::string> params = {code, name, std::to_string(classId), note.empty() ? "NULL" : note};
-    auto result = db_->executeQuery(query, params);
+    auto result = db_->Execute("SELECT INS_SERVICE_TYPE($1, $2, $3, $4)", code, name, classId, NullIfEmpty(note));
     if (result->GetRowCount() > 0)
     {
         auto id = result->GetInt(0, 0);
@@ -300,80 +643,85 @@ int DbApi::CreateServiceType(const std::string& code, const std::string& name, i
 
 void DbApi::UpdateServiceType(int id, const std::string& code, const std::string& name, const std::string& note)
 {
-    std::string query = "SELECT UPD_SERVICE_TYPE($1, $2, $3, $4)";
-    std::vector<std::string> params = {std::to_string(id), code, name, note.empty() ? "NULL" : note};
-    db_->executeQuery(query, params);
+    db_->Execute("SELECT UPD_SERVICE_TYPE($1, $2, $3, $4)", id, code, name, NullIfEmpty(note));
 }
 
 void DbApi::DeleteServiceType(int id)
 {
-    std::string query = "SELECT DEL_SERVICE_TYPE($1)";
-    db_->executeQuery(query, {std::to_string(id)});
+    db_->Execute("SELECT DEL_SERVICE_TYPE($1)", id);
 }
 
 std::vector<ServiceTypeInfo> DbApi::GetAllServiceTypes()
 {
+    ReadOnlyScope readOnly(*db_);
     std::string query = "SELECT * FROM GET_ALL_SERVICE_TYPES()";
-    auto result = db_->ExecuteQuery(query);
-    std::vector<ServiceTypeInfo> types;
-
-    for (int i = 0; i < result->GetRowCount(); ++i)
-    {
-        ServiceTypeInfo info;
-        info.id = result->GetInt(i, 0).value_or(0);
-        info.code = result->GetValue(i, 1).value_or("");
-        info.name = result->GetValue(i, 2).value_or("");
-        info.classId = result->GetInt(i, 3).value_or(0);
-        info.className = result->GetValue(i, 4).value_or("");
-        info.note = result->GetValue(i, 5).value_or("");
-        types.push_back(info);
-    }
-    return types;
+    auto result = db_->executeQuery(query, {}, ResultFormat::Binary);
+    return MapRows<ServiceTypeInfo>(*result);
 }
 
 void DbApi::AddServiceTypeParam(int serviceTypeId, int parId, bool isRequired, std::optional<double> defaultNum,
                                 const std::string& defaultStr, std::optional<double> minVal,
                                 std::optional<double> maxVal)
 {
-    std::string query = "SELECT INS_SERVICE_TYPE_PARAM($1, $2, $3, $4, $5, $6, $7)";
-    std::vector<std::string> params = {std::to_string(serviceTypeId),
-                                       std::to_string(parId),
-                                       std::to_string(isRequired ? 1 : 0),
-                                       defaultNum ? std::to_string(*defaultNum) : "NULL",
-                                       defaultStr.empty() ? "NULL" : defaultStr,
-                                       minVal ? std::to_string(*minVal) : "NULL",
-                                       maxVal ? std::to_string(*maxVal) : "NULL"};
-    db_->executeQuery(query, params);
+    db_->Execute("SELECT INS_SERVICE_TYPE_PARAM($1, $2, $3, $4, $5, $6, $7)", serviceTypeId, parId, isRequired ? 1 : 0,
+                 defaultNum, NullIfEmpty(defaultStr), minVal, maxVal);
+}
+
+int DbApi::CreateServiceTypeWithParams(const ServiceTypeInfo& serviceType,
+                                       const std::vector<ServiceTypeParamInfo>& params)
+{
+    std::vector<DatabaseManager::Statement> statements;
+    statements.reserve(params.size() + 1);
+    statements.push_back(DatabaseManager::Statement::Bind(StoreParentId("INS_SERVICE_TYPE($1, $2, $3, $4)"),
+                                                          serviceType.code,
+                                                          serviceType.name,
+                                                          serviceType.classId,
+                                                          NullIfEmpty(serviceType.note)));
+
+    for (const auto& p : params)
+    {
+        statements.push_back(
+            DatabaseManager::Statement::Bind("SELECT INS_SERVICE_TYPE_PARAM(" + kParentId + ", $1, $2, $3, $4, $5, $6)",
+                                             p.parId,
+                                             p.isRequired ? 1 : 0,
+                                             p.defaultValNum,
+                                             NullIfEmpty(p.defaultValStr),
+                                             p.minVal,
+                                             p.maxVal));
+    }
+
+    auto results = db_->ExecutePipeline(statements);
+    if (int id = GetCreatedId(results))
+        return id;
+    throw Exception("Не удалось создать тип услуги");
 }
 
 void DbApi::RemoveServiceTypeParam(int serviceTypeId, int parId)
 {
-    std::string query = "DELETE FROM SERVICE_TYPE_PARAM WHERE ID_SERVICE_TYPE = $1 AND ID_PAR = $2";
-    db_->executeQuery(query, {std::to_string(serviceTypeId), std::to_string(parId)});
+    db_->Execute("DELETE FROM SERVICE_TYPE_PARAM WHERE ID_SERVICE_TYPE = $1 AND ID_PAR = $2", serviceTypeId, parId);
 }
 
 std::vector<ServiceTypeParamInfo> DbApi::GetServiceTypeParams(int serviceTypeId)
 {
+    ReadOnlyScope readOnly(*db_);
     std::string query = "SELECT * FROM GET_SERVICE_TYPE_PARAMS($1)";
-    auto result = db_->executeQuery(query, {std::to_string(serviceTypeId)});
-    std::vector<ServiceTypeParamInfo> params;
+    auto result = db_->executeQuery(query, {std::to_string(serviceTypeId)}, ResultFormat::Binary);
+    return MapRows<ServiceTypeParamInfo>(*result);
+}
 
-    for (int i = 0; i < result->GetRowCount(); ++i)
-    {
-        ServiceTypeParamInfo info;
-        info.parId = result->GetInt(i, 0).value_or(0);
-        info.code = result->GetValue(i, 1).value_or("");
-        info.name = result->GetValue(i, 2).value_or("");
-        info.type = result->GetInt(i, 3).value_or(0);
-        info.isRequired = result->GetInt(i, 4).value_or(0) == 1;
-        info.defaultValNum = result->GetDouble(i, 5);
-        info.defaultValStr = result->GetValue(i, 6).value_or("");
-        info.minVal = result->GetDouble(i, 7);
-        info.maxVal = result->GetDouble(i, 8);
-        info.unitName = result->GetValue(i, 9).value_or("");
-        params.push_back(info);
-    }
-    return params;
+std::optional<ServiceTypeDetails> DbApi::GetServiceType(int id)
+{
+    ReadOnlyScope readOnly(*db_);
+    auto results = db_->ExecutePipeline({{"SELECT * FROM GET_SERVICE_TYPE($1)", {std::to_string(id)}},
+                                         {"SELECT * FROM GET_SERVICE_TYPE_PARAMS($1)", {std::to_string(id)}}},
+                                        ResultFormat::Binary);
+    if (results[0]->GetRowCount() == 0)
+        return std::nullopt;
+
+    ServiceTypeDetails details{};
+    MapRow(*results[0], 0, details.serviceType);
+    details.params = MapRows<ServiceTypeParamInfo>(*results[1]);
+    return details;
 }
 
 // ==================== Executors ====================
@@ -381,15 +729,8 @@ std::vector<ServiceTypeParamInfo> DbApi::GetServiceTypeParams(int serviceTypeId)
 int DbApi::CreateExecutor(const std::string& code, const std::string& name, const std::string& address,
                           const std::string& phone, const std::string& email, bool isActive, const std::string& note)
 {
-    std::string query = "SELECT INS_EXECUTOR($1, $2, $3, $4, $5, $6, $7)";
-    std::vector<std::string> params = {code,
-                                       name,
-                                       address.empty() ? "NULL" : address,
-                                       phone.empty() ? "NULL" : phone,
-                                       email.empty() ? "NULL" : email,
-                                       std::to_string(isActive ? 1 : 0),
-                                       note.empty() ? "NULL" : note};
-    auto result = db_->executeQuery(query, params);
+    auto result = db_->Execute("SELECT INS_EXECUTOR($1, $2, $3, $4, $5, $6, $7)", code, name, NullIfEmpty(address),
+                               NullIfEmpty(phone), NullIfEmpty(email), isActive ? 1 : 0, NullIfEmpty(note));
     if (result->GetRowCount() > 0)
     {
         auto id = result->GetInt(0, 0);
@@ -402,44 +743,32 @@ int DbApi::CreateExecutor(const std::string& code, const std::string& name, cons
 void DbApi::UpdateExecutor(int id, const std::string& code, const std::string& name, const std::string& address,
                            const std::string& phone, const std::string& email, bool isActive, const std::string& note)
 {
-    std::string query = "SELECT UPD_EXECUTOR($1, $2, $3, $4, $5, $6, $7, $8)";
-    std::vector<std::string> params = {std::to_string(id),
-                                       code,
-                                       name,
-                                       address.empty() ? "NULL" : address,
-                                       phone.empty() ? "NULL" : phone,
-                                       email.empty() ? "NULL" : email,
-                                       std::to_string(isActive ? 1 : 0),
-                                       note.empty() ? "NULL" : note};
-    db_->executeQuery(query, params);
+    db_->Execute("SELECT UPD_EXECUTOR($1, $2, $3, $4, $5, $6, $7, $8)", id, code, name, NullIfEmpty(address),
+                 NullIfEmpty(phone), NullIfEmpty(email), isActive ? 1 : 0, NullIfEmpty(note));
 }
 
 void DbApi::DeleteExecutor(int id)
 {
-    std::string query = "SELECT DEL_EXECUTOR($1)";
-    db_->executeQuery(query, {std::to_string(id)});
+    db_->Execute("SELECT DEL_EXECUTOR($1)", id);
 }
 
 std::vector<ExecutorInfo> DbApi::GetAllExecutors()
 {
+    ReadOnlyScope readOnly(*db_);
     std::string query = "SELECT * FROM GET_ALL_EXECUTORS()";
-    auto result = db_->ExecuteQuery(query);
-    std::vector<ExecutorInfo> executors;
+    auto result = db_->executeQuery(query, {}, ResultFormat::Binary);
+    return MapRows<ExecutorInfo>(*result);
+}
 
-    for (int i = 0; i < result->GetRowCount(); ++i)
-    {
-        ExecutorInfo info;
-        info.id = result->GetInt(i, 0).value_or(0);
-        info.code = result->GetValue(i, 1).value_or("");
-        info.name = result->GetValue(i, 2).value_or("");
-        info.address = result->GetValue(i, 3).value_or("");
-        info.phone = result->GetValue(i, 4).value_or("");
-        info.email = result->GetValue(i, 5).value_or("");
-        info.isActive = result->GetInt(i, 6).value_or(0) == 1;
-        info.note = result->GetValue(i, 7).value_or("");
-        executors.push_back(info);
-    }
-    return executors;
+Page<ExecutorInfo> DbApi::GetExecutorsPage(int pageSize, const std::optional<PageCursor>& after,
+                                           const ExecutorFilter& filter)
+{
+    ReadOnlyScope readOnly(*db_);
+    std::string query = "SELECT * FROM GET_EXECUTORS_PAGE($1, $2, $3, $4)";
+    auto params = PageParams(pageSize, after);
+    params.push_back(filter.isActive ? (*filter.isActive ? "1" : "0") : "NULL");
+    auto result = db_->executeQuery(query, params, ResultFormat::Binary);
+    return MakePage(MapRows<ExecutorInfo>(*result), pageSize, [](const ExecutorInfo& e) { return e.name; });
 }
 
 // ==================== Tariffs ====================
@@ -448,18 +777,9 @@ int DbApi::CreateTariff(int serviceTypeId, const std::string& code, const std::s
                         std::optional<int> executorId, const std::string& dateBegin, const std::string& dateEnd,
                         bool isWithVat, double vatRate, bool isActive, const std::string& note)
 {
-    std::string query = "SELECT INS_TARIFF($1, $2, $3, $4, $5, $6, $7, $8, $9, $10)";
-    std::vector<std::string> params = {std::to_string(serviceTypeId),
-                                       code,
-                                       name,
-                                       executorId ? std::to_string(*executorId) : "NULL",
-                                       dateBegin.empty() ? "NULL" : dateBegin,
-                                       dateEnd.empty() ? "NULL" : dateEnd,
-                                       std::to_string(isWithVat ? 1 : 0),
-                                       std::to_string(vatRate),
-                                       std::to_string(isActive ? 1 : 0),
-                                       note.empty() ? "NULL" : note};
-    auto result = db_->executeQuery(query, params);
+    auto result = db_->Execute("SELECT INS_TARIFF($1, $2, $3, $4, $5, $6, $7, $8, $9, $10)", serviceTypeId, code, name,
+                               executorId, NullIfEmpty(dateBegin), NullIfEmpty(dateEnd), isWithVat ? 1 : 0, vatRate,
+                               isActive ? 1 : 0, NullIfEmpty(note));
     if (result->GetRowCount() > 0)
     {
         auto id = result->GetInt(0, 0);
@@ -473,64 +793,41 @@ void DbApi::UpdateTariff(int id, const std::string& code, const std::string& nam
                          const std::string& dateBegin, const std::string& dateEnd, bool isWithVat, double vatRate,
                          bool isActive, const std::string& note)
 {
-    std::string query = "SELECT UPD_TARIFF($1, $2, $3, $4, $5, $6, $7, $8, $9, $10)";
-    std::vector<std::string> params = {std::to_string(id),
-                                       code,
-                                       name,
-                                       executorId ? std::to_string(*executorId) : "NULL",
-                                       dateBegin.empty() ? "NULL" : dateBegin,
-                                       dateEnd.empty() ? "NULL" : dateEnd,
-                                       std::to_string(isWithVat ? 1 : 0),
-                                       std::to_string(vatRate),
-                                       std::to_string(isActive ? 1 : 0),
-                                       note.empty() ? "NULL" : note};
-    db_->executeQuery(query, params);
+    db_->Execute("SELECT UPD_TARIFF($1, $2, $3, $4, $5, $6, $7, $8, $9, $10)", id, code, name, executorId,
+                 NullIfEmpty(dateBegin), NullIfEmpty(dateEnd), isWithVat ? 1 : 0, vatRate, isActive ? 1 : 0,
+                 NullIfEmpty(note));
 }
 
 void DbApi::DeleteTariff(int id)
 {
-    std::string query = "SELECT DEL_TARIFF($1)";
-    db_->executeQuery(query, {std::to_string(id)});
+    db_->Execute("SELECT DEL_TARIFF($1)", id);
 }
 
 std::vector<TariffInfo> DbApi::GetAllTariffs()
 {
+    ReadOnlyScope readOnly(*db_);
     std::string query = "SELECT * FROM GET_ALL_TARIFFS()";
-    auto result = db_->ExecuteQuery(query);
-    std::vector<TariffInfo> tariffs;
+    auto result = db_->executeQuery(query, {}, ResultFormat::Binary);
+    return MapRows<TariffInfo>(*result);
+}
 
-    for (int i = 0; i < result->GetRowCount(); ++i)
-    {
-        TariffInfo info;
-        info.id = result->GetInt(i, 0).value_or(0);
-        info.code = result->GetValue(i, 1).value_or("");
-        info.name = result->GetValue(i, 2).value_or("");
-        info.serviceTypeId = result->GetInt(i, 3).value_or(0);
-        info.serviceName = result->GetValue(i, 4).value_or("");
-        info.executorId = result->GetInt(i, 5);
-        info.executorName = result->GetValue(i, 6).value_or("");
-        info.dateBegin = result->GetValue(i, 7).value_or("");
-        info.dateEnd = result->GetValue(i, 8).value_or("");
-        info.isWithVat = result->GetInt(i, 9).value_or(0) == 1;
-        info.vatRate = result->GetDouble(i, 10).value_or(0.0);
-        info.isActive = result->GetInt(i, 11).value_or(0) == 1;
-        info.note = result->GetValue(i, 12).value_or("");
-        tariffs.push_back(info);
-    }
-    return tariffs;
+Page<TariffInfo> DbApi::GetTariffsPage(int pageSize, const std::optional<PageCursor>& after, const TariffFilter& filter)
+{
+    ReadOnlyScope readOnly(*db_);
+    std::string query = "SELECT * FROM GET_TARIFFS_PAGE($1, $2, $3, $4, $5, $6)";
+    auto params = PageParams(pageSize, after);
+    params.push_back(filter.serviceTypeId ? std::to_string(*filter.serviceTypeId) : "NULL");
+    params.push_back(filter.isActive ? (*filter.isActive ? "1" : "0") : "NULL");
+    params.push_back(filter.onDate.empty() ? "NULL" : filter.onDate);
+    auto result = db_->executeQuery(query, params, ResultFormat::Binary);
+    return MakePage(MapRows<TariffInfo>(*result), pageSize, [](const TariffInfo& t) { return t.name; });
 }
 
 int DbApi::CreateTariffRate(int tariffId, const std::string& code, const std::string& name, double value,
                             std::optional<int> unitId, const std::string& note)
 {
-    std::string query = "SELECT INS_TARIFF_RATE($1, $2, $3, $4, $5, NULL, $6)";
-    std::vector<std::string> params = {std::to_string(tariffId),
-                                       code,
-                                       name,
-                                       std::to_string(value),
-                                       unitId ? std::to_string(*unitId) : "NULL",
-                                       note.empty() ? "NULL" : note};
-    auto result = db_->executeQuery(query, params);
+    auto result = db_->Execute("SELECT INS_TARIFF_RATE($1, $2, $3, $4, $5, NULL, $6)", tariffId, code, name, value,
+                               unitId, NullIfEmpty(note));
     if (result->GetRowCount() > 0)
     {
         auto id = result->GetInt(0, 0);
@@ -540,56 +837,88 @@ int DbApi::CreateTariffRate(int tariffId, const std::string& code, const std::st
     throw Exception("Не удалось создать ставку тарифа");
 }
 
+int DbApi::CreateTariffWithRates(const TariffInfo& tariff, std::vector<TariffRateInfo>& rates)
+{
+    std::vector<DatabaseManager::Statement> statements;
+    statements.reserve(rates.size() + 1);
+    statements.push_back(
+        DatabaseManager::Statement::Bind(StoreParentId("INS_TARIFF($1, $2, $3, $4, $5, $6, $7, $8, $9, $10)"),
+                                         tariff.serviceTypeId,
+                                         tariff.code,
+                                         tariff.name,
+                                         tariff.executorId,
+                                         NullIfEmpty(tariff.dateBegin),
+                                         NullIfEmpty(tariff.dateEnd),
+                                         tariff.isWithVat ? 1 : 0,
+                                         tariff.vatRate,
+                                         tariff.isActive ? 1 : 0,
+                                         NullIfEmpty(tariff.note)));
+
+    for (const auto& rate : rates)
+    {
+        statements.push_back(
+            DatabaseManager::Statement::Bind("SELECT INS_TARIFF_RATE(" + kParentId + ", $1, $2, $3, $4, NULL, $5)",
+                                             rate.code,
+                                             rate.name,
+                                             rate.value,
+                                             rate.unitId,
+                                             NullIfEmpty(rate.note)));
+    }
+
+    auto results = db_->ExecutePipeline(statements);
+    int id = GetCreatedId(results);
+    if (!id)
+        throw Exception("Не удалось создать тариф");
+
+    for (std::size_t i = 0; i < rates.size(); ++i)
+    {
+        rates[i].id = results[i + 1]->GetInt(0, 0).value_or(0);
+    }
+    return id;
+}
+
 void DbApi::UpdateTariffRate(int id, const std::string& code, const std::string& name, double value,
                              std::optional<int> unitId, const std::string& note)
 {
-    std::string query = "SELECT UPD_TARIFF_RATE($1, $2, $3, $4, $5, $6)";
-    std::vector<std::string> params = {std::to_string(id),
-                                       code,
-                                       name,
-                                       std::to_string(value),
-                                       unitId ? std::to_string(*unitId) : "NULL",
-                                       note.empty() ? "NULL" : note};
-    db_->executeQuery(query, params);
+    db_->Execute("SELECT UPD_TARIFF_RATE($1, $2, $3, $4, $5, $6)", id, code, name, value, unitId, NullIfEmpty(note));
 }
 
 void DbApi::DeleteTariffRate(int id)
 {
-    std::string query = "SELECT DEL_TARIFF_RATE($1)";
-    db_->executeQuery(query, {std::to_string(id)});
+    db_->Execute("SELECT DEL_TARIFF_RATE($1)", id);
 }
 
 std::vector<TariffRateInfo> DbApi::GetTariffRates(int tariffId)
 {
+    ReadOnlyScope readOnly(*db_);
     std::string query = "SELECT * FROM GET_TARIFF_RATES($1)";
-    auto result = db_->executeQuery(query, {std::to_string(tariffId)});
-    std::vector<TariffRateInfo> rates;
+    auto result = db_->executeQuery(query, {std::to_string(tariffId)}, ResultFormat::Binary);
+    return MapRows<TariffRateInfo>(*result);
+}
 
-    for (int i = 0; i < result->GetRowCount(); ++i)
-    {
-        TariffRateInfo info;
-        info.id = result->GetInt(i, 0).value_or(0);
-        info.code = result->GetValue(i, 1).value_or("");
-        info.name = result->GetValue(i, 2).value_or("");
-        info.value = result->GetDouble(i, 3).value_or(0.0);
-        info.unitId = result->GetInt(i, 4);
-        info.unitName = result->GetValue(i, 5).value_or("");
-        info.note = result->GetValue(i, 6).value_or("");
-        rates.push_back(info);
-    }
-    return rates;
+std::optional<TariffDetails> DbApi::GetTariff(int id)
+{
+    ReadOnlyScope readOnly(*db_);
+    auto results = db_->ExecutePipeline({{"SELECT * FROM GET_TARIFF($1)", {std::to_string(id)}},
+                                         {"SELECT * FROM GET_TARIFF_RATES($1)", {std::to_string(id)}}},
+                                        ResultFormat::Binary);
+    if (results[0]->GetRowCount() == 0)
+        return std::nullopt;
+
+    TariffDetails details{};
+    MapRow(*results[0], 0, details.tariff);
+    details.rates = MapRows<TariffRateInfo>(*results[1]);
+    return details;
 }
 
 void DbApi::AddTariffCoefficient(int tariffId, int coeffId, double value)
 {
-    std::string query = "SELECT INS_TARIFF_COEFFICIENT($1, $2, $3)";
-    db_->executeQuery(query, {std::to_string(tariffId), std::to_string(coeffId), std::to_string(value)});
+    db_->Execute("SELECT INS_TARIFF_COEFFICIENT($1, $2, $3)", tariffId, coeffId, value);
 }
 
 void DbApi::RemoveTariffCoefficient(int tariffId, int coeffId)
 {
-    std::string query = "DELETE FROM TARIFF_COEFFICIENT WHERE ID_TARIFF = $1 AND ID_COEFFICIENT = $2";
-    db_->executeQuery(query, {std::to_string(tariffId), std::to_string(coeffId)});
+    db_->Execute("DELETE FROM TARIFF_COEFFICIENT WHERE ID_TARIFF = $1 AND ID_COEFFICIENT = $2", tariffId, coeffId);
 }
 
 // ==================== Orders ====================
@@ -598,16 +927,9 @@ int DbApi::CreateOrder(const std::string& code, int serviceTypeId, const std::st
                        const std::string& executionDate, int status, std::optional<int> executorId,
                        std::optional<int> tariffId, const std::string& note)
 {
-    std::string query = "SELECT INS_ORDER($1, $2, $3, $4, $5, $6, $7, $8)";
-    std::vector<std::string> params = {code,
-                                       std::to_string(serviceTypeId),
-                                       orderDate.empty() ? "NULL" : orderDate,
-                                       executionDate.empty() ? "NULL" : executionDate,
-                                       std::to_string(status),
-                                       executorId ? std::to_string(*executorId) : "NULL",
-                                       tariffId ? std::to_string(*tariffId) : "NULL",
-                                       note.empty() ? "NULL" : note};
-    auto result = db_->executeQuery(query, params);
+    auto result = db_->Execute("SELECT INS_ORDER($1, $2, $3, $4, $5, $6, $7, $8)", code, serviceTypeId,
+                               NullIfEmpty(orderDate), NullIfEmpty(executionDate), status, executorId, tariffId,
+                               NullIfEmpty(note));
     if (result->GetRowCount() > 0)
     {
         auto id = result->GetInt(0, 0);
@@ -621,93 +943,254 @@ void DbApi::UpdateOrder(int id, const std::string& code, const std::string& exec
                         std::optional<int> executorId, std::optional<int> tariffId, std::optional<double> totalCost,
                         const std::string& note)
 {
-    std::string query = "SELECT UPD_ORDER($1, $2, $3, $4, $5, $6, $7, $8)";
-    std::vector<std::string> params = {std::to_string(id),
-                                       code,
-                                       executionDate.empty() ? "NULL" : executionDate,
-                                       std::to_string(status),
-                                       executorId ? std::to_string(*executorId) : "NULL",
-                                       tariffId ? std::to_string(*tariffId) : "NULL",
-                                       totalCost ? std::to_string(*totalCost) : "NULL",
-                                       note.empty() ? "NULL" : note};
-    db_->executeQuery(query, params);
+    db_->Execute("SELECT UPD_ORDER($1, $2, $3, $4, $5, $6, $7, $8)", id, code, NullIfEmpty(executionDate), status,
+                 executorId, tariffId, totalCost, NullIfEmpty(note));
 }
 
 void DbApi::DeleteOrder(int id)
 {
-    std::string query = "SELECT DEL_ORDER($1)";
-    db_->executeQuery(query, {std::to_string(id)});
+    db_->Execute("SELECT DEL_ORDER($1)", id);
 }
 
 std::vector<OrderInfo> DbApi::GetAllOrders()
 {
+    ReadOnlyScope readOnly(*db_);
     std::string query = "SELECT * FROM GET_ALL_ORDERS()";
-    auto result = db_->ExecuteQuery(query);
-    std::vector<OrderInfo> orders;
-
-    for (int i = 0; i < result->GetRowCount(); ++i)
-    {
-        OrderInfo info;
-        info.id = result->GetInt(i, 0).value_or(0);
-        info.code = result->GetValue(i, 1).value_or("");
-        info.serviceTypeId = result->GetInt(i, 2).value_or(0);
-        info.serviceName = result->GetValue(i, 3).value_or("");
-        info.orderDate = result->GetValue(i, 4).value_or("");
-        info.executionDate = result->GetValue(i, 5).value_or("");
-        info.status = result->GetInt(i, 6).value_or(0);
-        info.statusName = result->GetValue(i, 7).value_or("");
-        info.executorId = result->GetInt(i, 8);
-        info.executorName = result->GetValue(i, 9).value_or("");
-        info.tariffId = result->GetInt(i, 10);
-        info.tariffName = result->GetValue(i, 11).value_or("");
-        info.totalCost = result->GetDouble(i, 12);
-        info.note = result->GetValue(i, 13).value_or("");
-        orders.push_back(info);
-    }
-    return orders;
+    auto result = db_->executeQuery(query, {}, ResultFormat::Binary);
+    return MapRows<OrderInfo>(*result);
+}
+
+Page<OrderInfo> DbApi::GetOrdersPage(int pageSize, const std::optional<PageCursor>& after, const OrderFilter& filter)
+{
+    ReadOnlyScope readOnly(*db_);
+    std::string query = "SELECT * FROM GET_ORDERS_PAGE($1, $2, $3, $4, $5, $6, $7)";
+    // An order without a date has an empty cursor key, which is passed as NULL
+    auto params = PageParams(pageSize, after);
+    if (after && after->key.empty())
+        params[1] = "NULL";
+    params.push_back(filter.status ? std::to_string(*filter.status) : "NULL");
+    params.push_back(filter.dateFrom.empty() ? "NULL" : filter.dateFrom);
+    params.push_back(filter.dateTo.empty() ? "NULL" : filter.dateTo);
+    params.push_back(filter.serviceTypeId ? std::to_string(*filter.serviceTypeId) : "NULL");
+    auto result = db_->executeQuery(query, params, ResultFormat::Binary);
+    return MakePage(MapRows<OrderInfo>(*result), pageSize, [](const OrderInfo& o) { return o.orderDate; });
+}
+
+std::size_t DbApi::ForEachOrder(const std::function<void(const OrderInfo&)>& callback)
+{
+    ReadOnlyScope readOnly(*db_);
+    OrderInfo order{};
+    return db_->StreamQuery(
+        "SELECT * FROM GET_ALL_ORDERS()",
+        {},
+        [&](const QueryResult& rows) {
+            for (int i = 0; i < rows.GetRowCount(); ++i)
+            {
+                MapRow(rows, i, order);
+                callback(order);
+            }
+            return true;
+        },
+        ResultFormat::Binary);
 }
 
 void DbApi::SetOrderParam(int orderId, int parId, std::optional<double> valNum, const std::string& valStr,
                           const std::string& valDate, std::optional<int> enumId)
 {
-    std::string query = "SELECT INS_ORDER_PARAM($1, $2, $3, $4, $5, $6)";
-    std::vector<std::string> params = {std::to_string(orderId),
-                                       std::to_string(parId),
-                                       valNum ? std::to_string(*valNum) : "NULL",
-                                       valStr.empty() ? "NULL" : valStr,
-                                       valDate.empty() ? "NULL" : valDate,
-                                       enumId ? std::to_string(*enumId) : "NULL"};
-    db_->executeQuery(query, params);
+    db_->Execute("SELECT INS_ORDER_PARAM($1, $2, $3, $4, $5, $6)", orderId, parId, valNum, NullIfEmpty(valStr),
+                 NullIfEmpty(valDate), enumId);
+}
+
+int DbApi::CreateOrderWithParams(const OrderInfo& order, const std::vector<OrderParamInfo>& params)
+{
+    std::vector<DatabaseManager::Statement> statements;
+    statements.reserve(params.size() + 1);
+    statements.push_back(DatabaseManager::Statement::Bind(StoreParentId("INS_ORDER($1, $2, $3, $4, $5, $6, $7, $8)"),
+                                                          order.code,
+                                                          order.serviceTypeId,
+                                                          NullIfEmpty(order.orderDate),
+                                                          NullIfEmpty(order.executionDate),
+                                                          order.status,
+                                                          order.executorId,
+                                                          order.tariffId,
+                                                          NullIfEmpty(order.note)));
+
+    for (const auto& p : params)
+    {
+        statements.push_back(
+            DatabaseManager::Statement::Bind("SELECT INS_ORDER_PARAM(" + kParentId + ", $1, $2, $3, $4, $5)",
+                                             p.parId,
+                                             p.valNum,
+                                             NullIfEmpty(p.valStr),
+                                             NullIfEmpty(p.valDate),
+                                             p.enumId));
+    }
+
+    auto results = db_->ExecutePipeline(statements);
+    if (int id = GetCreatedId(results))
+        return id;
+    throw Exception("Не удалось создать заказ");
+}
+
+std::vector<int> DbApi::BulkImportOrders(const std::vector<OrderImport>& orders)
+{
+    std::vector<int> ids;
+    if (orders.empty())
+        return ids;
+
+    Transaction transaction(*db_);
+
+    // Ids are taken from the SERVICE_ORDER sequence up front so that parameter
+    // rows can reference their order before the orders themselves are merged
+    auto allocated = db_->executeQuery(
+        "SELECT nextval(pg_get_serial_sequence('service_order', 'id_order'))::INTEGER FROM generate_series(1, $1)",
+        {std::to_string(orders.size())},
+        ResultFormat::Binary);
+    ids.reserve(orders.size());
+    for (int i = 0; i < allocated->GetRowCount(); ++i)
+        ids.push_back(allocated->GetInt(i, 0).value_or(0));
+    if (ids.size() != orders.size())
+        throw Exception("Не удалось выделить идентификаторы заказов");
+
+    // Session-local staging tables are created once per connection and emptied on commit.
+    // They are also truncated up front: inside an outer transaction or savepoint the
+    // rows of a previous import on this connection are still there
+    db_->Execute("SET LOCAL client_min_messages = WARNING;"
+                 "CREATE TEMP TABLE IF NOT EXISTS STG_SERVICE_ORDER ("
+                 "ID_ORDER INTEGER, COD_ORDER VARCHAR, ID_SERVICE_TYPE INTEGER, ORDER_DATE DATE,"
+                 " EXECUTION_DATE DATE, STATUS INTEGER, ID_EXECUTOR INTEGER, ID_TARIFF INTEGER, NOTE TEXT"
+                 ") ON COMMIT DELETE ROWS;"
+                 "CREATE TEMP TABLE IF NOT EXISTS STG_ORDER_PARAM ("
+                 "LINE_NO INTEGER, ID_ORDER INTEGER, ID_PAR INTEGER, VAL_NUM DOUBLE PRECISION,"
+                 " VAL_STR TEXT, VAL_DATE DATE, ID_VAL_ENUM INTEGER"
+                 ") ON COMMIT DELETE ROWS;"
+                 "TRUNCATE STG_SERVICE_ORDER, STG_ORDER_PARAM");
+
+    std::size_t next = 0;
+    db_->CopyIn("COPY STG_SERVICE_ORDER FROM STDIN", [&](std::string& chunk) {
+        for (; next < orders.size() && chunk.size() < kCopyChunkSize; ++next)
+        {
+            const auto& order = orders[next].order;
+            AppendCopyNumber(chunk, ids[next]);
+            chunk += '\t';
+            AppendCopyText(chunk, order.code);
+            chunk += '\t';
+            AppendCopyNumber(chunk, order.serviceTypeId);
+            chunk += '\t';
+            AppendCopyOptionalText(chunk, order.orderDate);
+            chunk += '\t';
+            AppendCopyOptionalText(chunk, order.executionDate);
+            chunk += '\t';
+            AppendCopyNumber(chunk, order.status);
+            chunk += '\t';
+            AppendCopyNumber(chunk, order.executorId);
+            chunk += '\t';
+            AppendCopyNumber(chunk, order.tariffId);
+            chunk += '\t';
+            AppendCopyOptionalText(chunk, order.note);
+            chunk += '\n';
+        }
+        return next < orders.size();
+    });
+
+    // LINE_NO keeps the input order so that a repeated parameter resolves to its
+    // last value, as repeated SetOrderParam calls would
+    next = 0;
+    std::size_t param = 0;
+    int line = 0;
+    db_->CopyIn("COPY STG_ORDER_PARAM FROM STDIN", [&](std::string& chunk) {
+        for (; next < orders.size() && chunk.size() < kCopyChunkSize; param = 0, ++next)
+        {
+            const auto& params = orders[next].params;
+            for (; param < params.size() && chunk.size() < kCopyChunkSize; ++param)
+            {
+                const auto& p = params[param];
+                AppendCopyNumber(chunk, line++);
+                chunk += '\t';
+                AppendCopyNumber(chunk, ids[next]);
+                chunk += '\t';
+                AppendCopyNumber(chunk, p.parId);
+                chunk += '\t';
+                AppendCopyNumber(chunk, p.valNum);
+                chunk += '\t';
+                AppendCopyOptionalText(chunk, p.valStr);
+                chunk += '\t';
+                AppendCopyOptionalText(chunk, p.valDate);
+                chunk += '\t';
+                AppendCopyNumber(chunk, p.enumId);
+                chunk += '\n';
+            }
+            if (param < params.size())
+                break;
+        }
+        return next < orders.size();
+    });
+
+    db_->Execute("INSERT INTO SERVICE_ORDER (ID_ORDER, COD_ORDER, ID_SERVICE_TYPE, ORDER_DATE, EXECUTION_DATE,"
+                 " STATUS, ID_EXECUTOR, ID_TARIFF, NOTE) "
+                 "SELECT ID_ORDER, COD_ORDER, ID_SERVICE_TYPE, COALESCE(ORDER_DATE, CURRENT_DATE), EXECUTION_DATE,"
+                 " STATUS, ID_EXECUTOR, ID_TARIFF, NOTE "
+                 "FROM STG_SERVICE_ORDER;"
+                 "INSERT INTO ORDER_PARAM (ID_ORDER, ID_PAR, VAL_NUM, VAL_STR, VAL_DATE, ID_VAL_ENUM) "
+                 "SELECT DISTINCT ON (ID_ORDER, ID_PAR) ID_ORDER, ID_PAR, VAL_NUM, VAL_STR, VAL_DATE, ID_VAL_ENUM "
+                 "FROM STG_ORDER_PARAM "
+                 "ORDER BY ID_ORDER, ID_PAR, LINE_NO DESC");
+
+    transaction.Commit();
+    return ids;
 }
 
 void DbApi::RemoveOrderParam(int orderId, int parId)
 {
-    std::string query = "DELETE FROM ORDER_PARAM WHERE ID_ORDER = $1 AND ID_PAR = $2";
-    db_->executeQuery(query, {std::to_string(orderId), std::to_string(parId)});
+    db_->Execute("DELETE FROM ORDER_PARAM WHERE ID_ORDER = $1 AND ID_PAR = $2", orderId, parId);
 }
 
 std::vector<OrderParamInfo> DbApi::GetOrderParams(int orderId)
 {
+    ReadOnlyScope readOnly(*db_);
     std::string query = "SELECT * FROM GET_ORDER_PARAMS($1)";
-    auto result = db_->executeQuery(query, {std::to_string(orderId)});
-    std::vector<OrderParamInfo> params;
+    auto result = db_->executeQuery(query, {std::to_string(orderId)}, ResultFormat::Binary);
+    return MapRows<OrderParamInfo>(*result);
+}
 
+OrderParamsBatch DbApi::GetOrderParams(std::span<const int> orderIds)
+{
+    OrderParamsBatch batch;
+    batch.orderIds.assign(orderIds.begin(), orderIds.end());
+    batch.offsets.assign(orderIds.size() + 1, 0);
+    if (orderIds.empty())
+        return batch;
+
+    ReadOnlyScope readOnly(*db_);
+    std::string query = "SELECT * FROM GET_ORDER_PARAMS_BULK($1)";
+    auto result = db_->executeQuery(query, {ToArrayLiteral(orderIds)}, ResultFormat::Binary);
+    batch.params = MapRows<OrderParamInfo>(*result);
+
+    // Rows come ordered by the 1-based order_pos column: count the rows of each
+    // position, then the prefix sum turns the counts into group boundaries
+    constexpr int kOrderPosColumn = 11;
     for (int i = 0; i < result->GetRowCount(); ++i)
     {
-        OrderParamInfo info;
-        info.parId = result->GetInt(i, 0).value_or(0);
-        info.code = result->GetValue(i, 1).value_or("");
-        info.name = result->GetValue(i, 2).value_or("");
-        info.type = result->GetInt(i, 3).value_or(0);
-        info.valNum = result->GetDouble(i, 4);
-        info.valStr = result->GetValue(i, 5).value_or("");
-        info.valDate = result->GetValue(i, 6).value_or("");
-        info.enumId = result->GetInt(i, 7);
-        info.enumName = result->GetValue(i, 8).value_or("");
-        info.unitName = result->GetValue(i, 9).value_or("");
-        params.push_back(info);
+        auto pos = result->GetInt(i, kOrderPosColumn).value_or(0);
+        ++batch.offsets[static_cast<std::size_t>(pos)];
     }
-    return params;
+    std::partial_sum(batch.offsets.begin(), batch.offsets.end(), batch.offsets.begin());
+    return batch;
+}
+
+std::optional<OrderDetails> DbApi::GetOrder(int id)
+{
+    ReadOnlyScope readOnly(*db_);
+    auto results = db_->ExecutePipeline({{"SELECT * FROM GET_ORDER($1)", {std::to_string(id)}},
+                                         {"SELECT * FROM GET_ORDER_PARAMS($1)", {std::to_string(id)}}},
+                                        ResultFormat::Binary);
+    if (results[0]->GetRowCount() == 0)
+        return std::nullopt;
+
+    OrderDetails details{};
+    MapRow(*results[0], 0, details.order);
+    details.params = MapRows<OrderParamInfo>(*results[1]);
+    return details;
 }
 
 // ==================== Coefficients ====================
@@ -715,14 +1198,8 @@ std::vector<OrderParamInfo> DbApi::GetOrderParams(int orderId)
 int DbApi::CreateCoefficient(const std::string& code, const std::string& name, double valueMin, double valueMax,
                              double valueDefault, const std::string& note)
 {
-    std::string query = "SELECT INS_COEFFICIENT($1, $2, $3, $4, $5, $6)";
-    std::vector<std::string> params = {code,
-                                       name,
-                                       std::to_string(valueMin),
-                                       std::to_string(valueMax),
-                                       std::to_string(valueDefault),
-                                       note.empty() ? "NULL" : note};
-    auto result = db_->executeQuery(query, params);
+    auto result = db_->Execute("SELECT INS_COEFFICIENT($1, $2, $3, $4, $5, $6)", code, name, valueMin, valueMax,
+                               valueDefault, NullIfEmpty(note));
     if (result->GetRowCount() > 0)
     {
         auto id = result->GetInt(0, 0);
@@ -735,42 +1212,21 @@ int DbApi::CreateCoefficient(const std::string& code, const std::string& name, d
 void DbApi::UpdateCoefficient(int id, const std::string& code, const std::string& name, double valueMin,
                               double valueMax, double valueDefault, const std::string& note)
 {
-    std::string query = "SELECT UPD_COEFFICIENT($1, $2, $3, $4, $5, $6, $7)";
-    std::vector<std::string> params = {std::to_string(id),
-                                       code,
-                                       name,
-                                       std::to_string(valueMin),
-                                       std::to_string(valueMax),
-                                       std::to_string(valueDefault),
-                                       note.empty() ? "NULL" : note};
-    db_->executeQuery(query, params);
+    db_->Execute("SELECT UPD_COEFFICIENT($1, $2, $3, $4, $5, $6, $7)", id, code, name, valueMin, valueMax, valueDefault,
+                 NullIfEmpty(note));
 }
 
 void DbApi::DeleteCoefficient(int id)
 {
-    std::string query = "SELECT DEL_COEFFICIENT($1)";
-    db_->executeQuery(query, {std::to_string(id)});
+    db_->Execute("SELECT DEL_COEFFICIENT($1)", id);
 }
 
 std::vector<CoefficientInfo> DbApi::GetAllCoefficients()
 {
+    ReadOnlyScope readOnly(*db_);
     std::string query = "SELECT * FROM GET_ALL_COEFFICIENTS()";
-    auto result = db_->ExecuteQuery(query);
-    std::vector<CoefficientInfo> coeffs;
-
-    for (int i = 0; i < result->GetRowCount(); ++i)
-    {
-        CoefficientInfo info;
-        info.id = result->GetInt(i, 0).value_or(0);
-        info.code = result->GetValue(i, 1).value_or("");
-        info.name = result->GetValue(i, 2).value_or("");
-        info.valueMin = result->GetDouble(i, 3).value_or(0.0);
-        info.valueMax = result->GetDouble(i, 4).value_or(0.0);
-        info.valueDefault = result->GetDouble(i, 5).value_or(0.0);
-        info.note = result->GetValue(i, 6).value_or("");
-        coeffs.push_back(info);
-    }
-    return coeffs;
+    auto result = db_->executeQuery(query, {}, ResultFormat::Binary);
+    return MapRows<CoefficientInfo>(*result);
 }
 
 // ==================== Functions ====================
@@ -778,9 +1234,7 @@ std::vector<CoefficientInfo> DbApi::GetAllCoefficients()
 int DbApi::CreateFunction(const std::string& code, const std::string& name, int type, const std::string& operation,
                           const std::string& note)
 {
-    std::string query = "SELECT INS_FUNCT($1, $2, $3, $4, $5)";
-    std::vector<std::string> params = {code, name, std::to_string(type), operation.empty() ? "NULL" : operation, note};
-    auto result = db_->executeQuery(query, params);
+    auto result = db_->Execute("SELECT INS_FUNCT($1, $2, $3, $4, $5)", code, name, type, NullIfEmpty(operation), note);
     if (result->GetRowCount() > 0)
     {
         auto id = result->GetInt(0, 0);
@@ -793,32 +1247,20 @@ int DbApi::CreateFunction(const std::string& code, const std::string& name, int
 void DbApi::UpdateFunction(int id, const std::string& code, const std::string& name, int type,
                            const std::string& operation, const std::string& note)
 {
-    std::string query = "SELECT UPD_FUNCT($1, $2, $3, $4, $5, $6)";
-    std::vector<std::string> params = {std::to_string(id),
-                                       code,
-                                       name,
-                                       std::to_string(type),
-                                       operation.empty() ? "NULL" : operation,
-                                       note.empty() ? "NULL" : note};
-    db_->executeQuery(query, params);
+    db_->Execute("SELECT UPD_FUNCT($1, $2, $3, $4, $5, $6)", id, code, name, type, NullIfEmpty(operation),
+                 NullIfEmpty(note));
 }
 
 void DbApi::DeleteFunction(int id)
 {
-    std::string query = "SELECT DEL_FUNCT($1)";
-    db_->executeQuery(query, {std::to_string(id)});
+    db_->Execute("SELECT DEL_FUNCT($1)", id);
 }
 
 int DbApi::AddArgument(int functionId, int argNumber, std::optional<int> classArg, const std::string& name,
                        const std::string& note)
 {
-    std::string query = "SELECT INS_ARG_FUN($1, $2, $3, $4, $5)";
-    std::vector<std::string> params = {std::to_string(functionId),
-                                       std::to_string(argNumber),
-                                       classArg ? std::to_string(*classArg) : "NULL",
-                                       name.empty() ? "NULL" : name,
-                                       note};
-    auto result = db_->executeQuery(query, params);
+    auto result = db_->Execute("SELECT INS_ARG_FUN($1, $2, $3, $4, $5)", functionId, argNumber, classArg,
+                               NullIfEmpty(name), note);
     if (result->GetRowCount() > 0)
     {
         auto id = result->GetInt(0, 0);
@@ -830,9 +1272,7 @@ int DbApi::AddArgument(int functionId, int argNumber, std::optional<int> classAr
 
 int DbApi::CreateObject(int classId, const std::string& code, const std::string& name, const std::string& note)
 {
-    std::string query = "SELECT INS_OB($1, $2, $3, $4, $5)";
-    std::vector<std::string> params = {std::to_string(classId), code, name, "NULL", note.empty() ? "" : note};
-    auto result = db_->executeQuery(query, params);
+    auto result = db_->Execute("SELECT INS_OB($1, $2, $3, NULL, $4)", classId, code, name, note);
     if (result->GetRowCount() > 0)
     {
         auto id = result->GetInt(0, 0);
@@ -844,24 +1284,18 @@ int DbApi::CreateObject(int classId, const std::string& code, const std::string&
 
 void DbApi::UpdateObject(int id, const std::string& code, const std::string& name, const std::string& note)
 {
-    std::string query = "SELECT UPD_OB($1, $2, $3, $4)";
-    std::vector<std::string> params = {std::to_string(id), code, name, note.empty() ? "NULL" : note};
-    db_->executeQuery(query, params);
+    db_->Execute("SELECT UPD_OB($1, $2, $3, $4)", id, code, name, NullIfEmpty(note));
 }
 
 void DbApi::DeleteObject(int id)
 {
-    std::string query = "SELECT DEL_OB($1)";
-    db_->executeQuery(query, {std::to_string(id)});
+    db_->Execute("SELECT DEL_OB($1)", id);
 }
 
 void DbApi::UpdateRoleValue(int functionId, int objectId, std::optional<double> numValue)
 {
-    std::string query = "SELECT UPDATE_VAL_ROLE($1, $2, NULL, NULL, $3, NULL, NULL, NULL, NULL)";
-    std::vector<std::string> params = {std::to_string(functionId),
-                                       std::to_string(objectId),
-                                       numValue ? std::to_string(*numValue) : "NULL"};
-    db_->executeQuery(query, params);
+    db_->Execute("SELECT UPDATE_VAL_ROLE($1, $2, NULL, NULL, $3, NULL, NULL, NULL, NULL)", functionId, objectId,
+                 numValue);
 }
 
 // ==================== Calculations ====================
@@ -894,6 +1328,43 @@ double DbApi::CalculateOrderCost(int orderId, std::optional<int> tariffId)
     return *val;
 }
 
+double DbApi::QuoteOrderCost(int orderId, std::optional<int> tariffId)
+{
+    ReadOnlyScope readOnly(*db_);
+    std::string query = "SELECT QUOTE_ORDER_COST($1, $2)";
+    std::vector<std::string> params = {std::to_string(orderId), tariffId ? std::to_string(*tariffId) : "NULL"};
+    auto result = db_->executeQuery(query, params);
+    if (result->GetRowCount() == 0)
+        throw Exception("Не удалось рассчитать стоимость заказа");
+    auto val = result->GetDouble(0, 0);
+    if (!val)
+        throw Exception("Некорректный результат расчета");
+    return *val;
+}
+
+double DbApi::AcceptOrderTariff(int orderId, int tariffId)
+{
+    std::string query = "SELECT ACCEPT_ORDER_TARIFF($1, $2)";
+    auto result = db_->executeQuery(query, {std::to_string(orderId), std::to_string(tariffId)});
+    if (result->GetRowCount() == 0)
+        throw Exception("Не удалось сохранить тариф заказа");
+    auto val = result->GetDouble(0, 0);
+    if (!val)
+        throw Exception("Некорректный результат расчета");
+    return *val;
+}
+
+std::vector<OrderCostInfo> DbApi::CalculateOrderCosts(std::span<const int> orderIds, std::optional<int> tariffId)
+{
+    if (orderIds.empty())
+        return {};
+
+    std::string query = "SELECT * FROM CALC_ORDER_COST_BATCH($1, $2)";
+    std::vector<std::string> params = {ToArrayLiteral(orderIds), tariffId ? std::to_string(*tariffId) : "NULL"};
+    auto result = db_->executeQuery(query, params, ResultFormat::Binary);
+    return MapRows<OrderCostInfo>(*result);
+}
+
 double DbApi::CalculateOrderItemCost(int orderItemId, int tariffId)
 {
     std::string query = "SELECT CALC_ORDER_ITEM_COST($1, $2)";
@@ -908,54 +1379,80 @@ double DbApi::CalculateOrderItemCost(int orderItemId, int tariffId)
 
 ValidationResult DbApi::ValidateOrder(int orderId)
 {
+    ReadOnlyScope readOnly(*db_);
     std::string query = "SELECT * FROM VALIDATE_ORDER($1)";
     auto result = db_->executeQuery(query, {std::to_string(orderId)});
     if (result->GetRowCount() == 0)
         return {false, "Заказ не найден"};
 
     ValidationResult res;
-    auto isValid = result->GetValue(0, 0);
-    res.isValid = isValid && (*isValid == "t" || *isValid == "true" || *isValid == "1");
+    res.isValid = result->GetBool(0, 0).value_or(false);
     res.errorMessage = result->GetValue(0, 1).value_or("");
     return res;
 }
 
 std::vector<OptimalExecutorInfo> DbApi::FindOptimalExecutor(int serviceTypeId, const std::string& targetDate)
 {
+    ReadOnlyScope readOnly(*db_);
     std::string query = "SELECT * FROM FIND_OPTIMAL_EXECUTOR($1, $2)";
     std::vector<std::string> params = {std::to_string(serviceTypeId), targetDate.empty() ? "NULL" : targetDate};
-    auto result = db_->executeQuery(query, params);
-
-    std::vector<OptimalExecutorInfo> executors;
-    for (int i = 0; i < result->GetRowCount(); ++i)
-    {
-        OptimalExecutorInfo info;
-        info.executorId = result->GetInt(i, 0).value_or(0);
-        info.executorName = result->GetValue(i, 1).value_or("");
-        info.tariffId = result->GetInt(i, 2).value_or(0);
-        info.tariffName = result->GetValue(i, 3).value_or("");
-        info.estimatedCost = result->GetDouble(i, 4).value_or(0.0);
-        executors.push_back(info);
-    }
-    return executors;
+    auto result = db_->executeQuery(query, params, ResultFormat::Binary);
+    return MapRows<OptimalExecutorInfo>(*result);
 }
 
 std::vector<OptimalExecutorInfo> DbApi::FindOptimalTariff(int orderId)
 {
+    ReadOnlyScope readOnly(*db_);
     std::string query = "SELECT * FROM FIND_OPTIMAL_TARIFF($1)";
-    auto result = db_->executeQuery(query, {std::to_string(orderId)});
-
-    std::vector<OptimalExecutorInfo> tariffs;
-    for (int i = 0; i < result->GetRowCount(); ++i)
-    {
-        OptimalExecutorInfo info;
-        info.tariffId = result->GetInt(i, 0).value_or(0);
-        info.tariffName = result->GetValue(i, 1).value_or("");
-        info.executorName = result->GetValue(i, 2).value_or("");
-        info.estimatedCost = result->GetDouble(i, 3).value_or(0.0);
-        tariffs.push_back(info);
-    }
-    return tariffs;
+    auto result = db_->executeQuery(query, {std::to_string(orderId)}, ResultFormat::Binary);
+
+    // FIND_OPTIMAL_TARIFF returns (tariff_id, tariff_name, executor_name, cost)
+    static constexpr auto columns = std::make_tuple(Bind(0, &OptimalExecutorInfo::tariffId),
+                                                    Bind(1, &OptimalExecutorInfo::tariffName),
+                                                    Bind(2, &OptimalExecutorInfo::executorName),
+                                                    Bind(3, &OptimalExecutorInfo::estimatedCost));
+    return MapRows<OptimalExecutorInfo>(*result, columns);
+}
+
+RuleSetInfo DbApi::LoadRuleSet()
+{
+    // All six tables are read from one snapshot, so a rule set edited
+    // concurrently is seen either whole or not at all. Inside a caller's
+    // transaction the reads follow its isolation level instead
+    ReadOnlyScope readOnly(*db_);
+    bool ownTransaction = db_->GetTransactionDepth() == 0;
+    std::vector<DatabaseManager::Statement> statements;
+    if (ownTransaction)
+        statements.push_back({"BEGIN ISOLATION LEVEL REPEATABLE READ READ ONLY", {}});
+    statements.insert(statements.end(),
+                      {{"SELECT ID_FUNCT, TYPE_F, OPERATION FROM FUNCT_R", {}},
+                       {"SELECT ID_FACT_FUN, ID_FUNCT, ID_PR, NUM_CALL FROM FACT_FUN", {}},
+                       {"SELECT fp.ID_FACT_FUN, af.NUM_ARG, fp.VAL_NUM, fp.VAL_STR, fp.ID_VAL_CONST, fp.ID_VAL_FUNCT, "
+                        "fp.ID_VAL_FACT_FUN "
+                        "FROM FACT_PAR fp JOIN ARG_FUNCT af ON fp.ID_ARG = af.ID_ARG "
+                        "ORDER BY fp.ID_FACT_FUN, af.NUM_ARG",
+                        {}},
+                       {"SELECT ID_FUNCT, ID_PR, NUM_CALL, ID_FUNCT_DEC, PRIORITET FROM DECISION_RULE "
+                        "ORDER BY ID_FUNCT, ID_PR, PRIORITET NULLS LAST, NUM_CALL, ID_FUNCT_DEC",
+                        {}},
+                       {"SELECT ID_CONST, COD_CONST, VAL_NUM, VAL_STR FROM CONST", {}},
+                       {"SELECT ID_FUNCT, ID_FUNCT_COMP FROM FUN_COMP", {}}});
+    if (ownTransaction)
+        statements.push_back({"COMMIT", {}});
+
+    // On error the statements after the failed one are skipped, COMMIT
+    // included; the pool rolls back the open transaction on return
+    auto results = db_->ExecutePipeline(statements, ResultFormat::Binary);
+    std::size_t first = ownTransaction ? 1 : 0;
+
+    RuleSetInfo rules;
+    rules.functions = MapRows<RuleFunctionInfo>(*results[first]);
+    rules.calls = MapRows<RuleCallInfo>(*results[first + 1]);
+    rules.arguments = MapRows<RuleArgumentInfo>(*results[first + 2]);
+    rules.decisions = MapRows<RuleDecisionInfo>(*results[first + 3]);
+    rules.constants = MapRows<RuleConstantInfo>(*results[first + 4]);
+    rules.compositions = MapRows<RuleCompositionInfo>(*results[first + 5]);
+    return rules;
 }
 
 } // namespace db
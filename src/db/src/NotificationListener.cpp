@@ -0,0 +1,186 @@
+#include "NotificationListener.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <poll.h>
+#endif
+
+namespace
+{
+// Период проверки флага остановки при ожидании уведомлений
+constexpr std::chrono::milliseconds kPollInterval{250};
+
+// Задержка переподключения: удваивается после каждой неудачи до максимума
+constexpr std::chrono::milliseconds kMinReconnectDelay{100};
+constexpr std::chrono::milliseconds kMaxReconnectDelay{30000};
+
+// Ожидание данных на сокете: 1 - есть данные, 0 - таймаут, -1 - ошибка.
+// poll, в отличие от select, не ограничен номером дескриптора (FD_SETSIZE)
+int WaitReadable(int socket, std::chrono::milliseconds timeout)
+{
+#ifdef _WIN32
+    WSAPOLLFD descriptor{};
+    descriptor.fd = static_cast<SOCKET>(socket);
+    descriptor.events = POLLRDNORM;
+    int ready = WSAPoll(&descriptor, 1, static_cast<int>(timeout.count()));
+#else
+    pollfd descriptor{};
+    descriptor.fd = socket;
+    descriptor.events = POLLIN;
+    int ready = poll(&descriptor, 1, static_cast<int>(timeout.count()));
+#endif
+    return ready < 0 ? -1 : (ready > 0 ? 1 : 0);
+}
+} // namespace
+
+db::NotificationListener::NotificationListener(std::string connInfo, std::vector<std::string> channels, Handler handler)
+    : connInfo_(std::move(connInfo))
+    , channels_(std::move(channels))
+    , handler_(std::move(handler))
+{
+    thread_ = std::thread(&NotificationListener::Run, this);
+}
+
+db::NotificationListener::~NotificationListener()
+{
+    stop_ = true;
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+// Подключение установлено и LISTEN выполнен для всех каналов
+bool db::NotificationListener::IsListening() const
+{
+    return listening_.load();
+}
+
+// Цикл фонового потока
+void db::NotificationListener::Run()
+{
+    auto delay = kMinReconnectDelay;
+    while (!stop_)
+    {
+        PGconn* conn = Subscribe();
+        if (!conn)
+        {
+            if (!Sleep(delay))
+            {
+                break;
+            }
+            delay = std::min(delay * 2, kMaxReconnectDelay);
+            continue;
+        }
+        delay = kMinReconnectDelay;
+
+        // Уведомления до подписки (или за время разрыва) не получены.
+        // Признак подписки выставляется после сброса: пока он не виден,
+        // данные, прочитанные до сброса, не считаются актуальными
+        try
+        {
+            handler_(Notification{});
+        }
+        catch (...)
+        {
+            // Ошибка обработчика не останавливает получение уведомлений
+        }
+        listening_ = true;
+
+        while (!stop_ && Receive(conn))
+        {
+        }
+
+        listening_ = false;
+        PQfinish(conn);
+    }
+}
+
+// Подключение и подписка на каналы
+PGconn* db::NotificationListener::Subscribe() const
+{
+    PGconn* conn = PQconnectdb(connInfo_.c_str());
+    if (PQstatus(conn) != CONNECTION_OK)
+    {
+        PQfinish(conn);
+        return nullptr;
+    }
+
+    for (const auto& channel : channels_)
+    {
+        char* identifier = PQescapeIdentifier(conn, channel.c_str(), channel.size());
+        if (!identifier)
+        {
+            PQfinish(conn);
+            return nullptr;
+        }
+        std::string sql = std::string("LISTEN ") + identifier;
+        PQfreemem(identifier);
+
+        PGresult* result = PQexec(conn, sql.c_str());
+        bool ok = PQresultStatus(result) == PGRES_COMMAND_OK;
+        PQclear(result);
+        if (!ok)
+        {
+            PQfinish(conn);
+            return nullptr;
+        }
+    }
+    return conn;
+}
+
+// Ожидание данных на сокете и разбор уведомлений
+bool db::NotificationListener::Receive(PGconn* conn)
+{
+    int socket = PQsocket(conn);
+    if (socket < 0)
+    {
+        return false;
+    }
+
+    int ready = WaitReadable(socket, kPollInterval);
+    if (ready <= 0)
+    {
+        return ready == 0;
+    }
+
+    // Закрытое сервером подключение тоже становится доступным для чтения
+    if (!PQconsumeInput(conn))
+    {
+        return false;
+    }
+
+    while (PGnotify* notify = PQnotifies(conn))
+    {
+        Notification notification{notify->relname, notify->extra ? notify->extra : ""};
+        PQfreemem(notify);
+        try
+        {
+            handler_(notification);
+        }
+        catch (...)
+        {
+            // Ошибка обработчика не останавливает получение уведомлений
+        }
+    }
+    return PQstatus(conn) == CONNECTION_OK;
+}
+
+// Пауза с проверкой остановки
+bool db::NotificationListener::Sleep(std::chrono::milliseconds duration) const
+{
+    auto deadline = std::chrono::steady_clock::now() + duration;
+    while (!stop_)
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+        {
+            return true;
+        }
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(deadline - now, kPollInterval));
+    }
+    return false;
+}
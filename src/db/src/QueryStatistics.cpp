@@ -0,0 +1,458 @@
+#include "QueryStatistics.h"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstdio>
+#include <unordered_map>
+
+namespace
+{
+// Идентификаторы объектов статистики для thread_local кэша
+std::atomic<std::uint64_t> nextStatisticsId{1};
+
+// Предел кэша исходных текстов в потоке: запросы с литералами дают
+// неограниченное число разных текстов при одном нормализованном
+constexpr std::size_t kMaxCachedQueries = 4096;
+
+// Поиск в кэше по string_view без создания строки
+struct TextHash
+{
+    using is_transparent = void;
+
+    std::size_t operator()(std::string_view text) const
+    {
+        return std::hash<std::string_view>{}(text);
+    }
+};
+
+bool IsIdentifierChar(char c)
+{
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$';
+}
+
+void AppendJsonString(std::string& out, std::string_view value)
+{
+    out += '"';
+    for (char c : value)
+    {
+        switch (c)
+        {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                out += escaped;
+            }
+            else
+            {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+} // namespace
+
+db::QueryStatistics::Counters::Counters(std::string statement)
+    : statement(std::move(statement))
+{
+}
+
+db::QueryStatistics::QueryStatistics()
+    : id_(nextStatisticsId.fetch_add(1, std::memory_order_relaxed))
+    , alive_(std::make_shared<bool>(true))
+{
+}
+
+db::QueryStatistics::~QueryStatistics()
+{
+    StopDump();
+}
+
+// Регистрация выполнения запроса
+void db::QueryStatistics::Record(std::string_view query,
+                                 std::chrono::steady_clock::duration elapsed,
+                                 std::uint64_t rows,
+                                 std::uint64_t bytes,
+                                 bool failed)
+{
+    Counters& counters = Local(query);
+    auto ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+
+    // Увеличивает счетчики только поток-владелец, но Reset обнуляет их из
+    // другого потока, поэтому нужны атомарные приращения: чтение-запись
+    // вернула бы значения, прочитанные до обнуления. Без конкуренции
+    // fetch_add не дороже пары load/store на той же кэш-линии
+    constexpr auto relaxed = std::memory_order_relaxed;
+    counters.calls.fetch_add(1, relaxed);
+    if (failed)
+    {
+        counters.errors.fetch_add(1, relaxed);
+    }
+    counters.rows.fetch_add(rows, relaxed);
+    counters.bytes.fetch_add(bytes, relaxed);
+    counters.totalNs.fetch_add(ns, relaxed);
+    std::uint64_t maxNs = counters.maxNs.load(relaxed);
+    while (ns > maxNs && !counters.maxNs.compare_exchange_weak(maxNs, ns, relaxed))
+    {
+    }
+    counters.buckets[BucketOf(ns / 1000)].fetch_add(1, relaxed);
+}
+
+// Снимок счетчиков
+std::vector<db::QueryStatistics::StatementStatistics> db::QueryStatistics::Snapshot() const
+{
+    struct Merged
+    {
+        StatementStatistics statistics;
+        std::uint64_t totalNs = 0;
+        std::uint64_t maxNs = 0;
+        std::array<std::uint64_t, kBucketCount> buckets{};
+    };
+
+    std::vector<std::shared_ptr<Shard>> shards;
+    {
+        std::lock_guard lock(mutex_);
+        shards = shards_;
+    }
+
+    // Один запрос встречается в нескольких потоках - счетчики суммируются
+    constexpr auto relaxed = std::memory_order_relaxed;
+    std::unordered_map<std::string_view, Merged> merged;
+    for (const auto& shard : shards)
+    {
+        std::lock_guard lock(shard->mutex);
+        for (const auto& counters : shard->counters)
+        {
+            auto& entry = merged[counters.statement];
+            entry.statistics.calls += counters.calls.load(relaxed);
+            entry.statistics.errors += counters.errors.load(relaxed);
+            entry.statistics.rows += counters.rows.load(relaxed);
+            entry.statistics.bytes += counters.bytes.load(relaxed);
+            entry.totalNs += counters.totalNs.load(relaxed);
+            entry.maxNs = std::max(entry.maxNs, counters.maxNs.load(relaxed));
+            for (std::size_t i = 0; i < kBucketCount; ++i)
+            {
+                entry.buckets[i] += counters.buckets[i].load(relaxed);
+            }
+        }
+    }
+
+    std::vector<StatementStatistics> result;
+    result.reserve(merged.size());
+    for (auto& [statement, entry] : merged)
+    {
+        auto& statistics = entry.statistics;
+        if (statistics.calls == 0)
+        {
+            continue;
+        }
+        statistics.statement = std::string(statement);
+        statistics.totalMs = static_cast<double>(entry.totalNs) / 1e6;
+        statistics.maxMs = static_cast<double>(entry.maxNs) / 1e6;
+
+        // Процентиль - верхняя граница корзины, не больше максимума
+        std::uint64_t count = 0;
+        for (std::uint64_t bucketCount : entry.buckets)
+        {
+            count += bucketCount;
+        }
+        auto percentile = [&](double fraction) {
+            auto rank = static_cast<std::uint64_t>(fraction * static_cast<double>(count - 1)) + 1;
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < kBucketCount; ++i)
+            {
+                seen += entry.buckets[i];
+                if (seen >= rank)
+                {
+                    return std::min(BucketUpperMs(i), statistics.maxMs);
+                }
+            }
+            return statistics.maxMs;
+        };
+        if (count > 0)
+        {
+            statistics.p50Ms = percentile(0.50);
+            statistics.p95Ms = percentile(0.95);
+            statistics.p99Ms = percentile(0.99);
+        }
+        result.push_back(std::move(statistics));
+    }
+
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) { return a.totalMs > b.totalMs; });
+    return result;
+}
+
+// Обнуление счетчиков
+void db::QueryStatistics::Reset()
+{
+    std::vector<std::shared_ptr<Shard>> shards;
+    {
+        std::lock_guard lock(mutex_);
+        shards = shards_;
+    }
+
+    // Записи не удаляются: на них ссылаются кэши потоков
+    constexpr auto relaxed = std::memory_order_relaxed;
+    for (const auto& shard : shards)
+    {
+        std::lock_guard lock(shard->mutex);
+        for (auto& counters : shard->counters)
+        {
+            counters.calls.store(0, relaxed);
+            counters.errors.store(0, relaxed);
+            counters.rows.store(0, relaxed);
+            counters.bytes.store(0, relaxed);
+            counters.totalNs.store(0, relaxed);
+            counters.maxNs.store(0, relaxed);
+            for (auto& bucket : counters.buckets)
+            {
+                bucket.store(0, relaxed);
+            }
+        }
+    }
+}
+
+// Периодическая выгрузка снимка
+void db::QueryStatistics::StartDump(std::chrono::milliseconds interval,
+                                    Format format,
+                                    std::function<void(const std::string&)> sink)
+{
+    StopDump();
+
+    std::lock_guard lock(dumpMutex_);
+    dumpStop_ = false;
+    dumpThread_ = std::thread([this, interval, format, sink = std::move(sink)] {
+        std::unique_lock lock(dumpMutex_);
+        while (!dumpWake_.wait_for(lock, interval, [this] { return dumpStop_; }))
+        {
+            lock.unlock();
+            try
+            {
+                auto snapshot = Snapshot();
+                sink(format == Format::Json ? ToJson(snapshot) : ToText(snapshot));
+            }
+            catch (...)
+            {
+                // Ошибка приемника не должна останавливать выгрузку
+            }
+            lock.lock();
+        }
+    });
+}
+
+// Остановка периодической выгрузки
+void db::QueryStatistics::StopDump()
+{
+    std::thread thread;
+    {
+        std::lock_guard lock(dumpMutex_);
+        dumpStop_ = true;
+        thread = std::move(dumpThread_);
+    }
+    dumpWake_.notify_all();
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
+
+// Нормализация текста запроса
+std::string db::QueryStatistics::Normalize(std::string_view query)
+{
+    std::string result;
+    result.reserve(query.size());
+
+    bool space = false;
+    for (std::size_t i = 0; i < query.size();)
+    {
+        char c = query[i];
+        if (std::isspace(static_cast<unsigned char>(c)))
+        {
+            space = !result.empty();
+            ++i;
+            continue;
+        }
+        if (space)
+        {
+            result += ' ';
+            space = false;
+        }
+
+        bool afterIdentifier = !result.empty() && IsIdentifierChar(result.back());
+        if (c == '\'')
+        {
+            // Строковый литерал; '' внутри - экранированная кавычка
+            ++i;
+            while (i < query.size())
+            {
+                if (query[i] == '\'' && (i + 1 >= query.size() || query[i + 1] != '\''))
+                {
+                    ++i;
+                    break;
+                }
+                i += query[i] == '\'' ? 2 : 1;
+            }
+            result += '?';
+        }
+        else if (std::isdigit(static_cast<unsigned char>(c)) && !afterIdentifier)
+        {
+            while (i < query.size() && (std::isalnum(static_cast<unsigned char>(query[i])) || query[i] == '.'))
+            {
+                ++i;
+            }
+            result += '?';
+        }
+        else
+        {
+            result += c;
+            ++i;
+        }
+    }
+    return result;
+}
+
+// Форматирование снимка таблицей
+std::string db::QueryStatistics::ToText(const std::vector<StatementStatistics>& statistics)
+{
+    std::string out = "     calls   errors   total_ms    p50_ms    p95_ms    p99_ms    max_ms       rows      bytes  statement\n";
+    char line[160];
+    for (const auto& s : statistics)
+    {
+        std::snprintf(line,
+                      sizeof(line),
+                      "%10llu %8llu %10.1f %9.2f %9.2f %9.2f %9.2f %10llu %10llu  ",
+                      static_cast<unsigned long long>(s.calls),
+                      static_cast<unsigned long long>(s.errors),
+                      s.totalMs,
+                      s.p50Ms,
+                      s.p95Ms,
+                      s.p99Ms,
+                      s.maxMs,
+                      static_cast<unsigned long long>(s.rows),
+                      static_cast<unsigned long long>(s.bytes));
+        out += line;
+        out += s.statement;
+        out += '\n';
+    }
+    return out;
+}
+
+// Форматирование снимка массивом JSON
+std::string db::QueryStatistics::ToJson(const std::vector<StatementStatistics>& statistics)
+{
+    std::string out = "[";
+    char numbers[256];
+    for (std::size_t i = 0; i < statistics.size(); ++i)
+    {
+        const auto& s = statistics[i];
+        out += i == 0 ? "\n  {\"statement\": " : ",\n  {\"statement\": ";
+        AppendJsonString(out, s.statement);
+        std::snprintf(numbers,
+                      sizeof(numbers),
+                      ", \"calls\": %llu, \"errors\": %llu, \"rows\": %llu, \"bytes\": %llu"
+                      ", \"total_ms\": %.3f, \"p50_ms\": %.3f, \"p95_ms\": %.3f, \"p99_ms\": %.3f, \"max_ms\": %.3f}",
+                      static_cast<unsigned long long>(s.calls),
+                      static_cast<unsigned long long>(s.errors),
+                      static_cast<unsigned long long>(s.rows),
+                      static_cast<unsigned long long>(s.bytes),
+                      s.totalMs,
+                      s.p50Ms,
+                      s.p95Ms,
+                      s.p99Ms,
+                      s.maxMs);
+        out += numbers;
+    }
+    out += statistics.empty() ? "]\n" : "\n]\n";
+    return out;
+}
+
+// Счетчики текущего потока
+db::QueryStatistics::Counters& db::QueryStatistics::Local(std::string_view query)
+{
+    struct LocalCache
+    {
+        std::weak_ptr<const bool> owner; // Истекает при разрушении объекта статистики
+        std::shared_ptr<Shard> shard;
+        std::unordered_map<std::string, Counters*, TextHash, std::equal_to<>> byQuery; // Исходный текст
+        std::unordered_map<std::string, Counters*> byStatement;                        // Нормализованный текст
+    };
+    thread_local std::unordered_map<std::uint64_t, LocalCache> caches;
+
+    auto found = caches.find(id_);
+    if (found == caches.end())
+    {
+        // Объект разрушается в другом потоке и не может очистить этот кэш,
+        // поэтому записи разрушенных объектов удаляются при появлении нового
+        std::erase_if(caches, [](const auto& entry) { return entry.second.owner.expired(); });
+        found = caches.emplace(id_, LocalCache{alive_, nullptr, {}, {}}).first;
+    }
+
+    auto& cache = found->second;
+    if (auto it = cache.byQuery.find(query); it != cache.byQuery.end())
+    {
+        return *it->second;
+    }
+
+    if (!cache.shard)
+    {
+        cache.shard = std::make_shared<Shard>();
+        std::lock_guard lock(mutex_);
+        shards_.push_back(cache.shard);
+    }
+
+    auto statement = Normalize(query);
+    Counters*& counters = cache.byStatement[statement];
+    if (!counters)
+    {
+        std::lock_guard lock(cache.shard->mutex);
+        counters = &cache.shard->counters.emplace_back(statement);
+    }
+
+    if (cache.byQuery.size() >= kMaxCachedQueries)
+    {
+        cache.byQuery.clear();
+    }
+    cache.byQuery.emplace(query, counters);
+    return *counters;
+}
+
+std::size_t db::QueryStatistics::BucketOf(std::uint64_t microseconds)
+{
+    // До 4 мкс - по корзине на микросекунду, далее 4 корзины на степень двойки
+    if (microseconds < 4)
+    {
+        return static_cast<std::size_t>(microseconds);
+    }
+    auto exponent = static_cast<std::size_t>(std::bit_width(microseconds)) - 1;
+    auto sub = static_cast<std::size_t>(microseconds >> (exponent - 2)) & 3;
+    return std::min(4 * (exponent - 1) + sub, kBucketCount - 1);
+}
+
+double db::QueryStatistics::BucketUpperMs(std::size_t bucket)
+{
+    if (bucket < 4)
+    {
+        return static_cast<double>(bucket + 1) / 1000.0;
+    }
+    std::size_t exponent = bucket / 4 + 1;
+    std::size_t sub = bucket % 4;
+    return static_cast<double>((5 + sub) << (exponent - 2)) / 1000.0;
+}
@@ -0,0 +1,25 @@
+// ============================================================================
+// Schema Scripts
+// Описание: SQL скрипты схемы, встроенные при сборке
+// ============================================================================
+
+#pragma once
+
+#include <span>
+#include <string_view>
+
+namespace db
+{
+// Скрипт схемы; содержимое и контрольная сумма вычисляются при сборке
+// (cmake/EmbedSchema.cmake)
+struct SchemaScript
+{
+    std::string_view name;     // Путь относительно каталога database
+    std::string_view sql;      // Текст скрипта
+    std::string_view checksum; // SHA-256 текста в шестнадцатеричном виде
+};
+
+// Встроенные скрипты схемы в порядке применения
+std::span<const SchemaScript> GetSchemaScripts();
+
+} // namespace db
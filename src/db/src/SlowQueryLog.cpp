@@ -0,0 +1,192 @@
+#include "SlowQueryLog.h"
+
+#include "QueryStatistics.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <system_error>
+
+namespace
+{
+// Длинные значения параметров обрезаются до этого размера
+constexpr std::size_t kMaxParamLength = 200;
+
+// Текущее время для записи журнала
+std::string Timestamp()
+{
+    auto now = std::chrono::system_clock::now();
+    std::time_t time = std::chrono::system_clock::to_time_t(now);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &time);
+#else
+    localtime_r(&time, &local);
+#endif
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+    return buffer;
+}
+
+// Первое слово запроса в верхнем регистре
+std::string FirstKeyword(std::string_view query)
+{
+    std::size_t begin = 0;
+    while (begin < query.size() && (std::isspace(static_cast<unsigned char>(query[begin])) || query[begin] == '('))
+    {
+        ++begin;
+    }
+    std::string keyword;
+    for (std::size_t i = begin; i < query.size() && std::isalpha(static_cast<unsigned char>(query[i])); ++i)
+    {
+        keyword += static_cast<char>(std::toupper(static_cast<unsigned char>(query[i])));
+    }
+    return keyword;
+}
+} // namespace
+
+db::SlowQueryLog::SlowQueryLog(Options options)
+    : options_(std::move(options))
+{
+    options_.maxFiles = std::max<std::size_t>(options_.maxFiles, 1);
+}
+
+// Параметры журнала
+const db::SlowQueryLog::Options& db::SlowQueryLog::GetOptions() const
+{
+    return options_;
+}
+
+// Превышает ли время выполнения порог
+bool db::SlowQueryLog::IsSlow(std::chrono::steady_clock::duration elapsed) const
+{
+    return elapsed >= options_.threshold;
+}
+
+// Нужен ли план для запроса
+bool db::SlowQueryLog::ShouldExplain(std::string_view query)
+{
+    if (!options_.explain || !IsExplainable(query))
+    {
+        return false;
+    }
+
+    auto shape = QueryStatistics::Normalize(query);
+    std::lock_guard lock(mutex_);
+    return explained_.insert(std::move(shape)).second;
+}
+
+// Запись о медленном запросе
+void db::SlowQueryLog::Write(std::string_view query,
+                             const std::vector<std::string>* params,
+                             std::chrono::steady_clock::duration elapsed,
+                             std::string_view error,
+                             std::string_view plan)
+{
+    // Запись формируется целиком до захвата мьютекса
+    char header[96];
+    std::snprintf(header,
+                  sizeof(header),
+                  " duration: %.3f ms\n",
+                  std::chrono::duration<double, std::milli>(elapsed).count());
+
+    std::string entry = Timestamp() + header;
+    entry += "statement: ";
+    entry += query;
+    entry += '\n';
+    if (params && !params->empty())
+    {
+        entry += "parameters:";
+        for (std::size_t i = 0; i < params->size(); ++i)
+        {
+            const auto& value = (*params)[i];
+            entry += " $" + std::to_string(i + 1) + "=";
+            if (value == "NULL")
+            {
+                entry += "NULL";
+            }
+            else
+            {
+                entry += '\'';
+                entry.append(value, 0, kMaxParamLength);
+                entry += value.size() > kMaxParamLength ? "...'" : "'";
+            }
+        }
+        entry += '\n';
+    }
+    if (!error.empty())
+    {
+        entry += "error: ";
+        entry += error;
+        if (entry.back() != '\n')
+        {
+            entry += '\n';
+        }
+    }
+    if (!plan.empty())
+    {
+        entry += "plan:\n";
+        entry += plan;
+        if (entry.back() != '\n')
+        {
+            entry += '\n';
+        }
+    }
+    entry += '\n';
+
+    std::lock_guard lock(mutex_);
+    Rotate();
+    if (!file_.is_open())
+    {
+        file_.open(options_.path, std::ios::app | std::ios::binary);
+        std::error_code ec;
+        auto size = std::filesystem::file_size(options_.path, ec);
+        fileSize_ = ec ? 0 : static_cast<std::size_t>(size);
+    }
+    file_ << entry;
+    file_.flush();
+    fileSize_ += entry.size();
+}
+
+// Можно ли выполнить запрос под EXPLAIN
+bool db::SlowQueryLog::IsExplainable(std::string_view query)
+{
+    // Несколько операторов в одной строке EXPLAIN не принимает
+    auto end = query.find_last_not_of(" \t\r\n;");
+    if (end == std::string_view::npos || query.substr(0, end + 1).find(';') != std::string_view::npos)
+    {
+        return false;
+    }
+
+    auto keyword = FirstKeyword(query);
+    return keyword == "SELECT" || keyword == "INSERT" || keyword == "UPDATE" || keyword == "DELETE" ||
+           keyword == "VALUES" || keyword == "WITH";
+}
+
+// Ротация файлов
+void db::SlowQueryLog::Rotate()
+{
+    if (fileSize_ < options_.maxFileSize || !file_.is_open())
+    {
+        return;
+    }
+
+    file_.close();
+    fileSize_ = 0;
+
+    // Ошибки файловой системы не прерывают запись: в худшем случае файл продолжит расти
+    std::error_code ec;
+    if (options_.maxFiles == 1)
+    {
+        std::filesystem::remove(options_.path, ec);
+        return;
+    }
+    std::filesystem::remove(options_.path + "." + std::to_string(options_.maxFiles - 1), ec);
+    for (std::size_t i = options_.maxFiles - 1; i > 1; --i)
+    {
+        std::filesystem::rename(options_.path + "." + std::to_string(i - 1), options_.path + "." + std::to_string(i), ec);
+    }
+    std::filesystem::rename(options_.path, options_.path + ".1", ec);
+}
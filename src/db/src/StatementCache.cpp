@@ -0,0 +1,264 @@
+#include "StatementCache.h"
+
+#include <cstring>
+
+namespace
+{
+// Ошибки, после которых оператор нужно подготовить заново:
+// 26000 - оператор удален на сервере (DEALLOCATE/DISCARD ALL),
+// 0A000 - изменился тип результата после пересоздания функции
+bool IsStaleStatement(const PGresult* result)
+{
+    const char* state = PQresultErrorField(result, PG_DIAG_SQLSTATE);
+    return state && (std::strcmp(state, "26000") == 0 || std::strcmp(state, "0A000") == 0);
+}
+
+bool IsSuccess(const PGresult* result)
+{
+    auto status = PQresultStatus(result);
+    return status == PGRES_COMMAND_OK || status == PGRES_TUPLES_OK;
+}
+} // namespace
+
+db::StatementCache::StatementCache(std::size_t capacity)
+    : capacity_(capacity)
+{
+}
+
+// Выполнение запроса через подготовленный оператор
+PGresult* db::StatementCache::Execute(PGconn* conn,
+                                      const std::string& query,
+                                      int nParams,
+                                      const Oid* paramTypes,
+                                      const char* const* paramValues,
+                                      const int* paramLengths,
+                                      const int* paramFormats,
+                                      int resultFormat)
+{
+    if (capacity_ == 0)
+    {
+        return PQexecParams(
+            conn, query.c_str(), nParams, paramTypes, paramValues, paramLengths, paramFormats, resultFormat);
+    }
+
+    FlushDeallocations(conn);
+    const std::string& key = Key(query, nParams, paramTypes);
+
+    for (int attempt = 0;; ++attempt)
+    {
+        PGresult* result = nullptr;
+        const Entry* entry = Prepare(conn, key, query, nParams, paramTypes, result);
+        if (!entry)
+        {
+            return result;
+        }
+
+        result = PQexecPrepared(
+            conn, entry->name.c_str(), nParams, paramValues, paramLengths, paramFormats, resultFormat);
+        if (IsSuccess(result) || attempt > 0 || !IsStaleStatement(result))
+        {
+            return result;
+        }
+
+        // Повтор безопасен только вне транзакции: внутри нее ошибка уже
+        // перевела транзакцию в состояние отката
+        Evict(conn, key);
+        if (PQtransactionStatus(conn) != PQTRANS_IDLE)
+        {
+            return result;
+        }
+        PQclear(result);
+    }
+}
+
+// Постановка запроса в очередь конвейера
+int db::StatementCache::Send(PGconn* conn,
+                             const std::string& query,
+                             int nParams,
+                             const Oid* paramTypes,
+                             const char* const* paramValues,
+                             const int* paramLengths,
+                             const int* paramFormats,
+                             int resultFormat,
+                             std::string& preparedName)
+{
+    preparedName.clear();
+    if (capacity_ == 0)
+    {
+        return PQsendQueryParams(
+                   conn, query.c_str(), nParams, paramTypes, paramValues, paramLengths, paramFormats, resultFormat)
+                   ? 1
+                   : 0;
+    }
+
+    int expected = 1;
+    const std::string& key = Key(query, nParams, paramTypes);
+    auto it = entries_.find(key);
+    const Entry* entry = nullptr;
+    if (it != entries_.end())
+    {
+        lru_.splice(lru_.begin(), lru_, it->second.position);
+        entry = &it->second;
+    }
+    else
+    {
+        entry = &Insert(conn, key);
+        if (!PQsendPrepare(conn, entry->name.c_str(), query.c_str(), nParams, paramTypes))
+        {
+            return 0;
+        }
+        preparedName = entry->name;
+        ++expected;
+    }
+
+    if (!PQsendQueryPrepared(
+            conn, entry->name.c_str(), nParams, paramValues, paramLengths, paramFormats, resultFormat))
+    {
+        return 0;
+    }
+    return expected;
+}
+
+// Обработка результата подготовки, отправленной Send
+void db::StatementCache::OnPrepared(const std::string& query,
+                                    int nParams,
+                                    const Oid* paramTypes,
+                                    const std::string& preparedName,
+                                    const PGresult* result)
+{
+    if (!IsSuccess(result))
+    {
+        Forget(Key(query, nParams, paramTypes), preparedName);
+    }
+}
+
+// Сброс кэша без обращения к серверу
+void db::StatementCache::Clear()
+{
+    entries_.clear();
+    lru_.clear();
+    pendingDeallocations_.clear();
+}
+
+// Количество операторов в кэше
+std::size_t db::StatementCache::GetSize() const
+{
+    return entries_.size();
+}
+
+// Максимальное количество операторов
+std::size_t db::StatementCache::GetCapacity() const
+{
+    return capacity_;
+}
+
+// Ключ кэша
+const std::string& db::StatementCache::Key(const std::string& query, int nParams, const Oid* paramTypes)
+{
+    if (!paramTypes || nParams == 0)
+    {
+        return query;
+    }
+
+    // Нулевой символ не встречается в тексте запроса, поэтому ключи
+    // с типами не совпадают с ключами без них
+    keyBuffer_.assign(query);
+    keyBuffer_ += '\0';
+    keyBuffer_.append(reinterpret_cast<const char*>(paramTypes), sizeof(Oid) * static_cast<std::size_t>(nParams));
+    return keyBuffer_;
+}
+
+// Поиск или подготовка оператора
+const db::StatementCache::Entry* db::StatementCache::Prepare(PGconn* conn,
+                                                             const std::string& key,
+                                                             const std::string& query,
+                                                             int nParams,
+                                                             const Oid* paramTypes,
+                                                             PGresult*& result)
+{
+    auto it = entries_.find(key);
+    if (it != entries_.end())
+    {
+        lru_.splice(lru_.begin(), lru_, it->second.position);
+        return &it->second;
+    }
+
+    const Entry& entry = Insert(conn, key);
+    result = PQprepare(conn, entry.name.c_str(), query.c_str(), nParams, paramTypes);
+    if (!IsSuccess(result))
+    {
+        Forget(key, entry.name);
+        return nullptr;
+    }
+    PQclear(result);
+    result = nullptr;
+    return &entry;
+}
+
+// Регистрация нового оператора с вытеснением при переполнении
+const db::StatementCache::Entry& db::StatementCache::Insert(PGconn* conn, const std::string& key)
+{
+    if (entries_.size() >= capacity_)
+    {
+        Evict(conn, std::string(lru_.back()));
+    }
+
+    std::string name = "ts" + std::to_string(++counter_);
+    lru_.push_front(key);
+    auto [inserted, _] = entries_.emplace(key, Entry{std::move(name), lru_.begin()});
+    return inserted->second;
+}
+
+// Удаление оператора из кэша и с сервера
+void db::StatementCache::Evict(PGconn* conn, const std::string& key)
+{
+    auto it = entries_.find(key);
+    if (it == entries_.end())
+    {
+        return;
+    }
+
+    // В прерванной транзакции сервер отклонит DEALLOCATE; оператор
+    // останется до закрытия подключения, имена не переиспользуются
+    if (PQpipelineStatus(conn) != PQ_PIPELINE_OFF)
+    {
+        pendingDeallocations_.push_back(it->second.name);
+    }
+    else if (PQtransactionStatus(conn) != PQTRANS_INERROR)
+    {
+        std::string sql = "DEALLOCATE " + it->second.name;
+        PQclear(PQexec(conn, sql.c_str()));
+    }
+
+    lru_.erase(it->second.position);
+    entries_.erase(it);
+}
+
+// Удаление оператора только из кэша
+void db::StatementCache::Forget(const std::string& key, const std::string& name)
+{
+    // Ключ мог быть вытеснен и подготовлен заново под другим именем
+    auto it = entries_.find(key);
+    if (it != entries_.end() && it->second.name == name)
+    {
+        lru_.erase(it->second.position);
+        entries_.erase(it);
+    }
+}
+
+// Удаление операторов, вытесненных в конвейерном режиме
+void db::StatementCache::FlushDeallocations(PGconn* conn)
+{
+    if (pendingDeallocations_.empty() || PQtransactionStatus(conn) == PQTRANS_INERROR)
+    {
+        return;
+    }
+
+    std::string sql;
+    for (const auto& name : pendingDeallocations_)
+    {
+        sql += "DEALLOCATE " + name + ";";
+    }
+    PQclear(PQexec(conn, sql.c_str()));
+    pendingDeallocations_.clear();
+}
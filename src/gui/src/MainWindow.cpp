@@ -634,12 +634,12 @@ void MainWindow::refreshOrders()
 {
     try
     {
-        auto orders = service_->GetAllOrders();
-        ordersTable_->setRowCount(static_cast<int>(orders.size()));
-        
-        for (size_t i = 0; i < orders.size(); ++i)
-        {
-            const auto& o = orders[i];
+        // Строки добавляются по мере получения, без промежуточного списка заказов
+        ordersTable_->setUpdatesEnabled(false);
+        ordersTable_->setRowCount(0);
+        int i = 0;
+        service_->ForEachOrder([&](const core::Order& o) {
+            ordersTable_->insertRow(i);
             ordersTable_->setItem(i, 0, new QTableWidgetItem(QString::number(o.id)));
             ordersTable_->setItem(i, 1, new QTableWidgetItem(QString::fromStdString(o.code)));
             ordersTable_->setItem(i, 2, new QTableWidgetItem(QString::fromStdString(o.serviceName)));
@@ -649,10 +649,13 @@ void MainWindow::refreshOrders()
             ordersTable_->setItem(i, 6, new QTableWidgetItem(QString::fromStdString(o.executorName)));
             ordersTable_->setItem(i, 7, new QTableWidgetItem(QString::fromStdString(o.tariffName)));
             ordersTable_->setItem(i, 8, new QTableWidgetItem(o.totalCost ? QString::number(*o.totalCost, 'f', 2) : ""));
-        }
+            ++i;
+        });
+        ordersTable_->setUpdatesEnabled(true);
     }
     catch (const std::exception& e)
     {
+        ordersTable_->setUpdatesEnabled(true);
         statusBar()->showMessage(QString::fromStdString(e.what()));
     }
 }
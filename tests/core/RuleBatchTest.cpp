@@ -0,0 +1,243 @@
+#include "TestRules.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace core;
+
+namespace
+{
+
+constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+constexpr double kInfinity = std::numeric_limits<double>::infinity();
+
+// Больше нескольких блоков BatchMachine (256 заказов) с неполным последним
+constexpr std::size_t kOrders = 1000 + 37;
+
+// Функции объекта 1 над константами A, B и C: все векторные команды,
+// цепочки с делением и CASE с ошибками в решениях
+std::shared_ptr<const RuleEngine> BuildRules()
+{
+    return RuleSetBuilder()
+        .Const(1, "A", 1.0)
+        .Const(2, "B", 2.0)
+        .Const(3, "C", 3.0)
+        .Define(1, 1, "+")
+        .Define(2, 1, "-")
+        .Define(3, 1, "*")
+        .Define(4, 1, "/")
+        .Define(5, 0, "<")
+        .Define(6, 0, "=")
+        .Define(7, 0, "<>")
+        .Define(8, 0, ">=")
+        .Define(9, 2, "AND")
+        .Define(10, 2, "OR")
+        .Define(11, 2, "NOT")
+        .Define(12, 1, "/")
+        .Define(13, 1, "*")
+        .Define(14, 0, "<=")
+        .Define(15, 0, ">")
+        .Define(20, 3, "")
+        .Define(21, 1, "+")
+        .Call(1, 1, {Constant(1), Constant(2)})
+        .Call(2, 1, {Constant(1), Constant(2)})
+        .Call(3, 1, {Constant(1), Constant(2), Constant(3)})
+        .Call(4, 1, {Constant(1), Constant(2)})
+        .Call(5, 1, {Constant(1), Constant(2)})
+        .Call(6, 1, {Constant(1), Constant(3)})
+        .Call(7, 1, {Constant(2), Constant(3)})
+        .Call(8, 1, {Function(3), Constant(3)})
+        .Call(9, 1, {Function(5), Function(8)})
+        .Call(10, 1, {Function(6), Function(9)})
+        .Call(11, 1, {Function(10)})
+        .Call(12, 1, {Function(1), Function(2)})
+        .Call(13, 1, {Function(12), Constant(3), Number(0.5)})
+        .Call(14, 1, {Constant(3), Number(2)})
+        .Call(15, 1, {Function(4), Constant(3)})
+        // Деление с ошибкой пропускается, ноль не выбирается
+        .Decide(20, 1, 4, 1)
+        .Decide(20, 1, 14, 2)
+        .Decide(20, 1, 13, 3)
+        .Decide(20, 1, 1, std::nullopt)
+        .Call(21, 1, {Function(20), Function(11), Function(7), Function(15)})
+        .Build();
+}
+
+constexpr int kFunctions[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 20, 21};
+
+// Результат EvaluateBatch для каждого заказа
+std::vector<Outcome> EvaluateBatch(const RuleEngine& engine, int functionId, const RuleBatch& batch)
+{
+    RuleBatchResult result = engine.EvaluateBatch(functionId, 1, batch);
+    EXPECT_EQ(result.values.size(), batch.GetSize());
+    std::vector<Outcome> outcomes(batch.GetSize());
+    for (std::size_t i = 0; i < outcomes.size() && i < result.values.size(); ++i)
+    {
+        outcomes[i].value = result.values[i];
+    }
+    for (const auto& [index, message] : result.errors)
+    {
+        EXPECT_FALSE(result.values.at(index).has_value()) << "заказ " << index;
+        outcomes.at(index) = {std::nullopt, message};
+    }
+    return outcomes;
+}
+
+// Сравнение пакета с поэлементным Evaluate для всех функций
+void ExpectBatchMatchesEvaluate(const RuleEngine& engine, const RuleBatch& batch,
+                                const std::vector<std::vector<OrderParameterValue>>& orders)
+{
+    for (int function : kFunctions)
+    {
+        auto batched = EvaluateBatch(engine, function, batch);
+        for (std::size_t i = 0; i < orders.size(); ++i)
+        {
+            ASSERT_EQ(batched[i], EvaluateOrder(engine, function, 1, orders[i]))
+                << "функция " << function << ", заказ " << i;
+        }
+    }
+}
+
+// Числа без ошибок: векторный путь
+double CleanValue(std::mt19937& random)
+{
+    return std::uniform_int_distribution<int>(1, 40)(random) / 4.0 - 5.5;
+}
+
+} // namespace
+
+TEST(RuleBatchTest, CleanColumnsMatchEvaluate)
+{
+    auto engine = BuildRules();
+    std::mt19937 random(1);
+
+    std::vector<double> a(kOrders);
+    std::vector<double> b(kOrders);
+    std::vector<double> c(kOrders);
+    std::vector<std::vector<OrderParameterValue>> orders(kOrders);
+    for (std::size_t i = 0; i < kOrders; ++i)
+    {
+        a[i] = CleanValue(random);
+        b[i] = CleanValue(random);
+        c[i] = CleanValue(random);
+        orders[i] = {OrderParameter("A", a[i]), OrderParameter("b", b[i]), OrderParameter("C", c[i])};
+    }
+
+    RuleBatch batch(kOrders);
+    batch.SetNumbers("a", a);
+    batch.SetNumbers("B", b);
+    batch.SetNumbers("c", c);
+    ExpectBatchMatchesEvaluate(*engine, batch, orders);
+}
+
+TEST(RuleBatchTest, MixedLanesMatchEvaluate)
+{
+    // Редкие NULL, нули делителей, NaN, бесконечности, переполнения и
+    // отсутствующие параметры среди чистых заказов: в одном блоке есть
+    // и векторные группы, и группы, вычисляемые поэлементно
+    auto engine = BuildRules();
+    const std::optional<double> special[] = {std::nullopt, 0.0, -0.0, kNaN, -kNaN, kInfinity, -kInfinity,
+                                             1e308, -1e308, 1e-308};
+    std::mt19937 random(2);
+    std::bernoulli_distribution isSpecial(0.04);
+    std::bernoulli_distribution isAbsent(0.01);
+    std::uniform_int_distribution<std::size_t> pick(0, std::size(special) - 1);
+
+    std::vector<std::vector<OrderParameterValue>> orders(kOrders);
+    RuleBatch batch(kOrders);
+    for (std::size_t i = 0; i < kOrders; ++i)
+    {
+        for (const char* code : {"A", "B", "C"})
+        {
+            if (isAbsent(random))
+            {
+                continue; // Значение константы
+            }
+            std::optional<double> value = isSpecial(random) ? special[pick(random)] : CleanValue(random);
+            orders[i].push_back(OrderParameter(code, value));
+        }
+        batch.SetOrder(i, orders[i]);
+    }
+    ExpectBatchMatchesEvaluate(*engine, batch, orders);
+}
+
+TEST(RuleBatchTest, SpecialValuesInEveryLanePosition)
+{
+    // Особое значение в каждой позиции группы и на границах блоков
+    auto engine = BuildRules();
+    const std::optional<double> special[] = {std::nullopt, 0.0, kNaN, kInfinity, 1e308};
+    std::vector<std::vector<OrderParameterValue>> orders;
+    for (const auto& value : special)
+    {
+        for (const char* code : {"A", "B", "C"})
+        {
+            for (std::size_t position = 0; position < 16; ++position)
+            {
+                std::vector<std::vector<OrderParameterValue>> run(16);
+                for (std::size_t i = 0; i < run.size(); ++i)
+                {
+                    double clean = 1.5 + static_cast<double>(i);
+                    run[i] = {OrderParameter("A", clean), OrderParameter("B", -clean), OrderParameter("C", 2.0)};
+                }
+                for (auto& parameter : run[position])
+                {
+                    if (parameter.code == code)
+                    {
+                        parameter.numValue = value;
+                    }
+                }
+                orders.insert(orders.end(), run.begin(), run.end());
+            }
+        }
+    }
+
+    RuleBatch batch(orders.size());
+    for (std::size_t i = 0; i < orders.size(); ++i)
+    {
+        batch.SetOrder(i, orders[i]);
+    }
+    ExpectBatchMatchesEvaluate(*engine, batch, orders);
+}
+
+TEST(RuleBatchTest, ColumnsMissingFromBatchUseConstants)
+{
+    // Столбцы B и C не заданы: операнды - значения констант для всех заказов
+    auto engine = BuildRules();
+    std::mt19937 random(3);
+    std::vector<double> a(kOrders);
+    std::vector<std::vector<OrderParameterValue>> orders(kOrders);
+    for (std::size_t i = 0; i < kOrders; ++i)
+    {
+        a[i] = i % 97 == 0 ? 2.0 : CleanValue(random); // A = B: деление на ноль в функции 12
+        orders[i] = {OrderParameter("a", a[i])};
+    }
+
+    RuleBatch batch(kOrders);
+    batch.SetNumbers("A", a);
+    ExpectBatchMatchesEvaluate(*engine, batch, orders);
+}
+
+TEST(RuleBatchTest, SmallBatches)
+{
+    // Пустой пакет, пакеты из одной группы и группы с хвостом
+    auto engine = BuildRules();
+    for (std::size_t size = 0; size < 9; ++size)
+    {
+        std::vector<std::vector<OrderParameterValue>> orders(size);
+        RuleBatch batch(size);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            orders[i] = {OrderParameter("A", static_cast<double>(i)), OrderParameter("B", 1.0)};
+            batch.SetOrder(i, orders[i]);
+        }
+        ExpectBatchMatchesEvaluate(*engine, batch, orders);
+    }
+}
@@ -0,0 +1,240 @@
+#include "TestRules.h"
+
+#include <gtest/gtest.h>
+
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace core;
+
+namespace
+{
+
+constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+// Вычисление каждого заказа через Evaluate, RuleSession и EvaluateBatch
+// с проверкой совпадения; возвращает результаты Evaluate
+std::vector<Outcome> EvaluateAll(const std::shared_ptr<const RuleEngine>& engine, int functionId, int objectId,
+                                 const std::vector<std::vector<OrderParameterValue>>& orders)
+{
+    std::vector<Outcome> expected;
+    RuleBatch batch(orders.size());
+    for (std::size_t i = 0; i < orders.size(); ++i)
+    {
+        expected.push_back(EvaluateOrder(*engine, functionId, objectId, orders[i]));
+        batch.SetOrder(i, orders[i]);
+
+        RuleSession session(engine, orders[i]);
+        EXPECT_EQ(EvaluateSession(session, functionId, objectId), expected.back()) << "заказ " << i;
+    }
+
+    RuleBatchResult result = engine->EvaluateBatch(functionId, objectId, batch);
+    std::vector<Outcome> batched(orders.size());
+    for (std::size_t i = 0; i < orders.size(); ++i)
+    {
+        batched[i].value = result.values[i];
+    }
+    for (const auto& [index, message] : result.errors)
+    {
+        batched[index] = {std::nullopt, message};
+    }
+    for (std::size_t i = 0; i < orders.size(); ++i)
+    {
+        EXPECT_EQ(batched[i], expected[i]) << "заказ " << i;
+    }
+    return expected;
+}
+
+// Заказы со значениями одного параметра; пакет длиннее ширины вектора,
+// чтобы проверить и векторный, и поэлементный путь
+std::vector<std::vector<OrderParameterValue>> Orders(const std::string& code,
+                                                     const std::vector<std::optional<double>>& values)
+{
+    std::vector<std::vector<OrderParameterValue>> orders;
+    for (std::size_t repeat = 0; repeat < 3; ++repeat)
+    {
+        for (const auto& value : values)
+        {
+            orders.push_back({OrderParameter(code, value)});
+        }
+    }
+    return orders;
+}
+
+} // namespace
+
+TEST(RuleEngineTest, ParametersReplaceConstants)
+{
+    auto engine = RuleSetBuilder()
+                      .Const(1, "A", 1.0)
+                      .Define(1, 1, "+")
+                      .Call(1, 1, {Constant(1), Number(2)})
+                      .Build();
+
+    EXPECT_EQ(EvaluateOrder(*engine, 1, 1, {}), (Outcome{3.0, {}}));
+    auto results = EvaluateAll(engine, 1, 1, Orders("a", {5.0, -1.0, std::nullopt}));
+    EXPECT_EQ(results[0], (Outcome{7.0, {}}));
+    EXPECT_EQ(results[1], (Outcome{1.0, {}}));
+    EXPECT_EQ(results[2], (Outcome{std::nullopt, {}}));
+}
+
+TEST(RuleEngineTest, NaNComparesAsInPostgreSQL)
+{
+    // NaN равен NaN и больше любого числа
+    auto engine = RuleSetBuilder()
+                      .Const(1, "X", 0.0)
+                      .Define(1, 0, ">")
+                      .Define(2, 0, "=")
+                      .Define(3, 1, "+")
+                      .Define(4, 0, "<")
+                      .Call(1, 1, {Constant(1), Number(1e308)})
+                      .Call(2, 1, {Constant(1), Number(kNaN)})
+                      .Call(3, 1, {Constant(1), Number(1)})
+                      .Call(4, 1, {Number(1), Constant(1)})
+                      .Build();
+
+    auto orders = Orders("x", {kNaN, 2.0, -kNaN});
+    EXPECT_EQ(EvaluateAll(engine, 1, 1, orders)[0], (Outcome{1.0, {}}));
+    EXPECT_EQ(EvaluateAll(engine, 2, 1, orders)[0], (Outcome{1.0, {}}));
+    EXPECT_TRUE(std::isnan(EvaluateAll(engine, 3, 1, orders)[0].value.value()));
+    EXPECT_EQ(EvaluateAll(engine, 4, 1, orders)[0], (Outcome{1.0, {}}));
+}
+
+TEST(RuleEngineTest, DivisionByZeroIsAnError)
+{
+    auto engine = RuleSetBuilder()
+                      .Const(1, "Z", 0.0)
+                      .Define(1, 1, "/")
+                      .Call(1, 1, {Number(10), Constant(1)})
+                      .Build();
+
+    auto results = EvaluateAll(engine, 1, 1, Orders("z", {2.0, 0.0, std::nullopt, -0.0, 4.0}));
+    EXPECT_EQ(results[0], (Outcome{5.0, {}}));
+    EXPECT_EQ(results[1], (Outcome{std::nullopt, "Деление на ноль"}));
+    EXPECT_EQ(results[2], (Outcome{std::nullopt, {}}));
+    EXPECT_EQ(results[3], (Outcome{std::nullopt, "Деление на ноль"}));
+    EXPECT_EQ(results[4], (Outcome{2.5, {}}));
+}
+
+TEST(RuleEngineTest, CaseSkipsDecisionsWithErrors)
+{
+    // Функции 1-3 для объектов 1-3: ошибка при Z = 0, ноль и 7
+    RuleSetBuilder builder;
+    builder.Const(1, "Z", 0.0).Define(1, 1, "/").Define(2, 1, "*").Define(3, 1, "+").Define(10, 3, "");
+    for (int object = 1; object <= 3; ++object)
+    {
+        builder.Call(1, object, {Number(1), Constant(1)})
+            .Call(2, object, {Number(0), Number(5)})
+            .Call(3, object, {Number(3), Number(4)});
+    }
+    // Объект 1: ошибка пропускается, 0 не выбирается, выбирается 7
+    builder.Decide(10, 1, 1, 1).Decide(10, 1, 2, 2).Decide(10, 1, 3, std::nullopt);
+    // Объект 2: все решения с ошибкой - 0
+    builder.Decide(10, 2, 1, 1);
+    // Объект 3: безусловное решение (PRIORITET = 0) выбирается и при нуле
+    builder.Decide(10, 3, 3, 1).Decide(10, 3, 2, 0);
+    auto engine = builder.Build();
+
+    auto orders = Orders("z", {0.0, 1.0});
+    auto first = EvaluateAll(engine, 10, 1, orders);
+    EXPECT_EQ(first[0], (Outcome{7.0, {}}));
+    EXPECT_EQ(first[1], (Outcome{1.0, {}}));
+    auto second = EvaluateAll(engine, 10, 2, orders);
+    EXPECT_EQ(second[0], (Outcome{0.0, {}}));
+    EXPECT_EQ(second[1], (Outcome{1.0, {}}));
+    EXPECT_EQ(EvaluateAll(engine, 10, 3, orders)[0], (Outcome{0.0, {}}));
+
+    // Объект без решений
+    EXPECT_EQ(EvaluateAll(engine, 10, 4, orders)[0], (Outcome{0.0, {}}));
+}
+
+TEST(RuleEngineTest, CyclesAreReportedAndSkippedByCase)
+{
+    auto engine = RuleSetBuilder()
+                      .Define(1, 1, "+")
+                      .Define(2, 1, "+")
+                      .Define(3, 1, "*")
+                      .Define(4, 1, "+")
+                      .Define(10, 3, "")
+                      .Call(1, 1, {Function(2), Number(1)})
+                      .Call(2, 1, {Function(1), Number(1)})
+                      .Call(3, 1, {Function(1), Number(2)})
+                      .Call(4, 1, {Number(5)})
+                      .Decide(10, 1, 3, 1)
+                      .Decide(10, 1, 4, 2)
+                      .Build();
+
+    auto orders = Orders("z", {1.0});
+    for (int function : {1, 2, 3})
+    {
+        Outcome outcome = EvaluateAll(engine, function, 1, orders)[0];
+        EXPECT_NE(outcome.error.find("Циклическая ссылка"), std::string::npos) << "функция " << function;
+    }
+    EXPECT_EQ(EvaluateAll(engine, 10, 1, orders)[0], (Outcome{5.0, {}}));
+}
+
+TEST(RuleEngineTest, SessionFollowsParameterChanges)
+{
+    auto engine = RuleSetBuilder()
+                      .Const(1, "A", 1.0)
+                      .Const(2, "B", 2.0)
+                      .Define(1, 1, "+")
+                      .Define(2, 1, "/")
+                      .Define(3, 0, "=")
+                      .Call(1, 1, {Constant(1), Constant(2)})
+                      .Call(2, 1, {Function(1), Constant(1)})
+                      .Call(3, 1, {Constant(1), Text("x")})
+                      .Build();
+
+    std::vector<OrderParameterValue> parameters;
+    RuleSession session(engine, parameters);
+    std::vector<OrderParameterValue> edits = {OrderParameter("a", 0.0), OrderParameter("b", kNaN),
+                                              OrderParameter("A", 3.0), OrderParameter("b", std::nullopt)};
+    edits.push_back(OrderParameter("a", std::nullopt));
+    edits.back().strValue = "x";
+    for (const auto& edit : edits)
+    {
+        // Параметр без parameterId заменяет параметр с тем же кодом (коды из одной буквы)
+        session.SetParameter(edit);
+        std::erase_if(parameters, [&](const OrderParameterValue& p) {
+            return std::tolower(p.code[0]) == std::tolower(edit.code[0]);
+        });
+        parameters.push_back(edit);
+        for (int function : {1, 2, 3})
+        {
+            EXPECT_EQ(EvaluateSession(session, function, 1), EvaluateOrder(*engine, function, 1, parameters))
+                << "функция " << function << ", параметр " << edit.code;
+        }
+    }
+}
+
+TEST(RuleEngineTest, WideGraphMatchesSequentialEvaluation)
+{
+    // Широкий граф вычисляется по уровням в пуле потоков
+    constexpr int kLeaves = 8192;
+    RuleSetBuilder builder;
+    builder.Const(1, "P", 1.0).Define(1, 1, "+");
+    std::vector<db::RuleArgumentInfo> sum;
+    for (int leaf = 2; leaf <= kLeaves + 1; ++leaf)
+    {
+        builder.Define(leaf, 1, "*").Call(leaf, 1, {Constant(1), Number(leaf % 7)});
+        sum.push_back(Function(leaf));
+    }
+    builder.Call(1, 1, sum);
+    auto engine = builder.Build();
+
+    double expected = 0;
+    for (int leaf = 2; leaf <= kLeaves + 1; ++leaf)
+    {
+        expected += 2.0 * (leaf % 7);
+    }
+    auto results = EvaluateAll(engine, 1, 1, {{OrderParameter("p", 2.0)}, {OrderParameter("p", std::nullopt)}});
+    EXPECT_EQ(results[0], (Outcome{expected, {}}));
+    EXPECT_EQ(results[1], (Outcome{std::nullopt, {}}));
+}
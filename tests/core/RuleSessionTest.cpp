@@ -0,0 +1,263 @@
+#include "TestRules.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace core;
+
+namespace
+{
+
+constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+// Функции объектов 1 и 2 над константами A, B, C (NULL), D и строковой S:
+// цепочки через аргументы, решения CASE, связи FUN_COMP и цикл
+std::shared_ptr<const RuleEngine> BuildRules()
+{
+    RuleSetBuilder builder;
+    builder.Const(1, "A", 1.0)
+        .Const(2, "B", 2.0)
+        .Const(3, "C", std::nullopt)
+        .Const(4, "D", 0.0)
+        .Const(5, "S", std::nullopt, "x")
+        .Define(1, 1, "+")
+        .Define(2, 1, "/")
+        .Define(3, 1, "*")
+        .Define(4, 0, "=")
+        .Define(5, 0, "<>")
+        .Define(6, 0, ">")
+        .Define(7, 2, "AND")
+        .Define(8, 2, "NOT")
+        .Define(9, 1, "-")
+        .Define(20, 3, "")
+        .Define(21, 1, "+")
+        .Define(30, 1, "+")
+        .Define(31, 1, "+");
+    for (int object = 1; object <= 2; ++object)
+    {
+        builder.Call(1, object, {Constant(1), object == 1 ? Constant(2) : Number(10)})
+            .Call(2, object, {Function(1), object == 1 ? Constant(3) : Constant(4)})
+            .Call(3, object, {Function(2), Constant(1), Constant(2)})
+            .Call(4, object, {Constant(5), Text("x")})
+            .Call(5, object, {Constant(5), Constant(1)})
+            .Call(6, object, {Function(3), Constant(4)})
+            .Call(7, object, {Function(4), Function(6)})
+            .Call(8, object, {Function(7)})
+            .Call(9, object, {Function(3), Number(1)})
+            .Decide(20, object, 2, 1)
+            .Decide(20, object, 9, 2)
+            .Decide(20, object, 1, std::nullopt)
+            .Call(21, object, {Function(20), Function(8)})
+            .Call(30, object, {Function(31), Constant(1)})
+            .Call(31, object, {Function(30), Constant(2)});
+    }
+    // Связи FUN_COMP сбрасывают составные функции, но не участвуют в вычислении;
+    // вторая связь направлена против зависимости через аргументы
+    builder.Compose(21, 4).Compose(3, 20);
+    return builder.Build();
+}
+
+constexpr int kFunctions[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 20, 21, 30, 31};
+
+bool EqualsIgnoreCase(std::string_view left, std::string_view right)
+{
+    return std::equal(left.begin(), left.end(), right.begin(), right.end(), [](char l, char r) {
+        return std::tolower(static_cast<unsigned char>(l)) == std::tolower(static_cast<unsigned char>(r));
+    });
+}
+
+// Параметры заказа, изменяемые так же, как в RuleSession
+class Parameters
+{
+public:
+    void Set(const OrderParameterValue& parameter)
+    {
+        auto it = std::find_if(values_.begin(), values_.end(), [&](const OrderParameterValue& p) {
+            return parameter.parameterId != 0 ? p.parameterId == parameter.parameterId
+                                              : EqualsIgnoreCase(p.code, parameter.code);
+        });
+        if (it != values_.end())
+        {
+            *it = parameter;
+        }
+        else
+        {
+            values_.push_back(parameter);
+        }
+    }
+
+    void Remove(int parameterId)
+    {
+        std::erase_if(values_, [&](const OrderParameterValue& p) { return p.parameterId == parameterId; });
+    }
+
+    const std::vector<OrderParameterValue>& Get() const
+    {
+        return values_;
+    }
+
+private:
+    std::vector<OrderParameterValue> values_;
+};
+
+OrderParameterValue MakeParameter(int parameterId, std::string code, std::optional<double> number,
+                                  std::string text = {})
+{
+    OrderParameterValue parameter = OrderParameter(std::move(code), number);
+    parameter.parameterId = parameterId;
+    parameter.strValue = std::move(text);
+    return parameter;
+}
+
+// Результаты сеанса совпадают с вычислением заново по тем же параметрам
+void ExpectSessionMatches(RuleSession& session, const RuleEngine& engine, const Parameters& parameters,
+                          const std::vector<int>& functions, const std::string& step)
+{
+    for (int object = 1; object <= 2; ++object)
+    {
+        for (int function : functions)
+        {
+            EXPECT_EQ(EvaluateSession(session, function, object),
+                      EvaluateOrder(engine, function, object, parameters.Get()))
+                << step << ", функция " << function << ", объект " << object;
+        }
+    }
+}
+
+} // namespace
+
+TEST(RuleSessionTest, InitialParametersMatchEvaluate)
+{
+    // Из параметров с одинаковым кодом действует первый
+    auto engine = BuildRules();
+    std::vector<OrderParameterValue> initial = {MakeParameter(1, "a", 5.0), MakeParameter(2, "B", std::nullopt),
+                                                MakeParameter(3, "A", 7.0), MakeParameter(4, "s", std::nullopt, "y")};
+    Parameters parameters;
+    for (const auto& parameter : initial)
+    {
+        parameters.Set(parameter);
+    }
+
+    RuleSession session(engine, initial);
+    EXPECT_EQ(session.GetEngine(), engine);
+    ExpectSessionMatches(session, *engine, parameters, {std::begin(kFunctions), std::end(kFunctions)}, "начало");
+}
+
+TEST(RuleSessionTest, EditsInvalidateDependentNodes)
+{
+    // Каждое изменение затрагивает свою часть графа; после него вычисляется
+    // весь граф, так что устаревший результат любого узла будет замечен
+    auto engine = BuildRules();
+    RuleSession session(engine, {});
+    Parameters parameters;
+    std::vector<int> all(std::begin(kFunctions), std::end(kFunctions));
+    ExpectSessionMatches(session, *engine, parameters, all, "без параметров");
+
+    const std::vector<std::pair<std::string, OrderParameterValue>> edits = {
+        {"C задан", MakeParameter(3, "C", 4.0)},
+        {"деление на ноль", MakeParameter(2, "b", -1.0)},
+        {"A NULL", MakeParameter(1, "A", std::nullopt)},
+        {"A NaN", MakeParameter(1, "a", kNaN)},
+        {"то же значение", MakeParameter(1, "a", kNaN)},
+        {"строка S", MakeParameter(5, "S", std::nullopt, "y")},
+        {"строка и число S", MakeParameter(5, "s", 1.0, "x")},
+        {"строка у числовой константы", MakeParameter(4, "D", 0.0, "x")},
+        {"D без строки", MakeParameter(4, "D", 3.0)},
+        {"замена по коду", MakeParameter(0, "c", 0.0)},
+        {"новый код", MakeParameter(6, "Q", 1.0)},
+    };
+    for (const auto& [step, edit] : edits)
+    {
+        session.SetParameter(edit);
+        parameters.Set(edit);
+        ExpectSessionMatches(session, *engine, parameters, all, step);
+    }
+
+    // Удаление возвращает значения констант
+    for (int parameterId : {3, 1, 5, 42, 4, 2})
+    {
+        session.RemoveParameter(parameterId);
+        parameters.Remove(parameterId);
+        ExpectSessionMatches(session, *engine, parameters, all, "удален " + std::to_string(parameterId));
+    }
+}
+
+TEST(RuleSessionTest, CachedNodesSurviveUnrelatedEdits)
+{
+    // Между изменениями вычисляется только часть функций: сброс узлов должен
+    // накапливаться, пока до них не дойдет очередь
+    auto engine = BuildRules();
+    RuleSession session(engine, {});
+    Parameters parameters;
+    ExpectSessionMatches(session, *engine, parameters, {21}, "начало");
+
+    session.SetParameter(MakeParameter(1, "A", 3.0));
+    parameters.Set(MakeParameter(1, "A", 3.0));
+    ExpectSessionMatches(session, *engine, parameters, {4, 5}, "A, только строки");
+
+    session.SetParameter(MakeParameter(5, "S", std::nullopt, "y"));
+    parameters.Set(MakeParameter(5, "S", std::nullopt, "y"));
+    ExpectSessionMatches(session, *engine, parameters, {1}, "S, только сумма");
+
+    ExpectSessionMatches(session, *engine, parameters, {21, 8, 3, 20}, "после двух изменений");
+}
+
+TEST(RuleSessionTest, RandomEditsMatchEvaluate)
+{
+    auto engine = BuildRules();
+    RuleSession session(engine, {});
+    Parameters parameters;
+
+    const char* codes[] = {"A", "b", "C", "d", "S", "Q"};
+    const std::optional<double> numbers[] = {std::nullopt, 0.0, -0.0, 1.0, 2.5, -3.0, kNaN, 1e308};
+    const char* texts[] = {"", "", "x", "y"};
+    std::mt19937 random(4);
+    std::uniform_int_distribution<int> action(0, 9);
+    std::uniform_int_distribution<std::size_t> code(0, std::size(codes) - 1);
+    std::uniform_int_distribution<std::size_t> number(0, std::size(numbers) - 1);
+    std::uniform_int_distribution<std::size_t> text(0, std::size(texts) - 1);
+    std::bernoulli_distribution isUpper(0.5);
+    std::bernoulli_distribution isEvaluated(0.3);
+
+    for (int step = 0; step < 500; ++step)
+    {
+        std::size_t index = code(random);
+        int parameterId = static_cast<int>(index) + 1;
+        int kind = action(random);
+        if (kind == 0)
+        {
+            session.RemoveParameter(parameterId);
+            parameters.Remove(parameterId);
+        }
+        else
+        {
+            // Коды в разном регистре; без parameterId параметр ищется по коду
+            std::string name = codes[index];
+            name[0] = static_cast<char>(isUpper(random) ? std::toupper(name[0]) : std::tolower(name[0]));
+            auto edit = MakeParameter(kind < 3 ? 0 : parameterId, name, numbers[number(random)], texts[text(random)]);
+            session.SetParameter(edit);
+            parameters.Set(edit);
+        }
+
+        std::vector<int> functions;
+        std::copy_if(std::begin(kFunctions), std::end(kFunctions), std::back_inserter(functions),
+                     [&](int) { return isEvaluated(random); });
+        ExpectSessionMatches(session, *engine, parameters, functions, "шаг " + std::to_string(step));
+        if (HasFailure())
+        {
+            return;
+        }
+    }
+}
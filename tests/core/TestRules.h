@@ -0,0 +1,151 @@
+#pragma once
+
+#include <core/RuleEngine.h>
+#include <core/RuleSession.h>
+
+#include <cmath>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Аргумент вызова; callId и numArg заполняет RuleSetBuilder::Call
+inline db::RuleArgumentInfo Number(double value)
+{
+    return {0, 0, value, std::nullopt, std::nullopt, std::nullopt, std::nullopt};
+}
+
+inline db::RuleArgumentInfo Text(std::string value)
+{
+    return {0, 0, std::nullopt, std::move(value), std::nullopt, std::nullopt, std::nullopt};
+}
+
+inline db::RuleArgumentInfo Constant(int constId)
+{
+    return {0, 0, std::nullopt, std::nullopt, constId, std::nullopt, std::nullopt};
+}
+
+inline db::RuleArgumentInfo Function(int functionId)
+{
+    return {0, 0, std::nullopt, std::nullopt, std::nullopt, functionId, std::nullopt};
+}
+
+// Набор правил в памяти, как его загружает DbApi::LoadRuleSet
+class RuleSetBuilder
+{
+public:
+    RuleSetBuilder& Define(int functionId, int type, std::string operation)
+    {
+        rules_.functions.push_back({functionId, type, std::move(operation)});
+        return *this;
+    }
+
+    RuleSetBuilder& Call(int functionId, int objectId, std::vector<db::RuleArgumentInfo> arguments)
+    {
+        int callId = static_cast<int>(rules_.calls.size()) + 1;
+        rules_.calls.push_back({callId, functionId, objectId, 1});
+        for (std::size_t i = 0; i < arguments.size(); ++i)
+        {
+            arguments[i].callId = callId;
+            arguments[i].numArg = static_cast<int>(i) + 1;
+            rules_.arguments.push_back(std::move(arguments[i]));
+        }
+        return *this;
+    }
+
+    RuleSetBuilder& Decide(int functionId, int objectId, int decisionFunctionId, std::optional<int> priority)
+    {
+        rules_.decisions.push_back({functionId, objectId, 1, decisionFunctionId, priority});
+        return *this;
+    }
+
+    RuleSetBuilder& Const(int id, std::string code, std::optional<double> value,
+                          std::optional<std::string> text = std::nullopt)
+    {
+        rules_.constants.push_back({id, std::move(code), value, std::move(text)});
+        return *this;
+    }
+
+    // Связь FUN_COMP: функция functionId составлена из componentId
+    RuleSetBuilder& Compose(int functionId, int componentId)
+    {
+        rules_.compositions.push_back({functionId, componentId});
+        return *this;
+    }
+
+    std::shared_ptr<const core::RuleEngine> Build() const
+    {
+        return std::make_shared<const core::RuleEngine>(rules_);
+    }
+
+private:
+    db::RuleSetInfo rules_;
+};
+
+// Итог вычисления: значение (std::nullopt - NULL) или текст ошибки
+struct Outcome
+{
+    std::optional<double> value;
+    std::string error;
+};
+
+inline bool operator==(const Outcome& left, const Outcome& right)
+{
+    if (left.error != right.error || left.value.has_value() != right.value.has_value())
+    {
+        return false;
+    }
+    if (!left.value)
+    {
+        return true;
+    }
+    return *left.value == *right.value || (std::isnan(*left.value) && std::isnan(*right.value));
+}
+
+inline std::ostream& operator<<(std::ostream& out, const Outcome& outcome)
+{
+    if (!outcome.error.empty())
+    {
+        return out << "error: " << outcome.error;
+    }
+    if (!outcome.value)
+    {
+        return out << "NULL";
+    }
+    return out << *outcome.value;
+}
+
+inline core::OrderParameterValue OrderParameter(std::string code, std::optional<double> value)
+{
+    core::OrderParameterValue parameter;
+    parameter.code = std::move(code);
+    parameter.numValue = value;
+    return parameter;
+}
+
+inline Outcome EvaluateOrder(const core::RuleEngine& engine, int functionId, int objectId,
+                             const std::vector<core::OrderParameterValue>& parameters)
+{
+    try
+    {
+        return {engine.Evaluate(functionId, objectId, parameters), {}};
+    }
+    catch (const std::runtime_error& error)
+    {
+        return {std::nullopt, error.what()};
+    }
+}
+
+inline Outcome EvaluateSession(core::RuleSession& session, int functionId, int objectId)
+{
+    try
+    {
+        return {session.Evaluate(functionId, objectId), {}};
+    }
+    catch (const std::runtime_error& error)
+    {
+        return {std::nullopt, error.what()};
+    }
+}
@@ -0,0 +1,160 @@
+#include "WorkStealingPool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace core;
+
+namespace
+{
+
+// Счетчики выполнений задач по индексу
+class Counters
+{
+public:
+    explicit Counters(std::size_t size)
+        : counts_(std::make_unique<std::atomic<int>[]>(size))
+        , size_(size)
+    {
+    }
+
+    void Hit(std::size_t index)
+    {
+        ASSERT_LT(index, size_);
+        counts_[index].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Каждый индекс выполнен ровно expected раз
+    void ExpectEach(int expected) const
+    {
+        for (std::size_t i = 0; i < size_; ++i)
+        {
+            ASSERT_EQ(counts_[i].load(), expected) << "задача " << i;
+        }
+    }
+
+private:
+    std::unique_ptr<std::atomic<int>[]> counts_;
+    std::size_t size_;
+};
+
+} // namespace
+
+TEST(WorkStealingPoolTest, RunsEveryTaskOnce)
+{
+    WorkStealingPool pool(4);
+    EXPECT_EQ(pool.GetThreadCount(), 4u);
+    for (std::size_t count : {0, 1, 2, 5, 1000})
+    {
+        Counters counters(count);
+        pool.Run(count, [&](std::size_t i) { counters.Hit(i); });
+        counters.ExpectEach(1);
+    }
+}
+
+TEST(WorkStealingPoolTest, WithoutThreadsRunsInCaller)
+{
+    WorkStealingPool pool(0);
+    EXPECT_EQ(pool.GetThreadCount(), 0u);
+    std::vector<std::size_t> order;
+    auto caller = std::this_thread::get_id();
+    pool.Run(5, [&](std::size_t i) {
+        EXPECT_EQ(std::this_thread::get_id(), caller);
+        order.push_back(i);
+    });
+    // Вызывающий берет задачи с конца своей очереди
+    EXPECT_EQ(order, (std::vector<std::size_t>{4, 3, 2, 1, 0}));
+}
+
+TEST(WorkStealingPoolTest, ConcurrentRunsStress)
+{
+    // Несколько потоков одновременно вызывают Run для одного пула: задачи
+    // разных заданий смешиваются в очередях и крадутся между потоками
+    constexpr int kCallers = 8;
+    constexpr int kRounds = 200;
+    WorkStealingPool pool(4);
+
+    std::vector<std::thread> callers;
+    std::atomic<int> failures{0};
+    for (int caller = 0; caller < kCallers; ++caller)
+    {
+        callers.emplace_back([&, caller] {
+            for (int round = 0; round < kRounds; ++round)
+            {
+                std::size_t count = static_cast<std::size_t>((caller * 31 + round * 7) % 97 + 1);
+                Counters counters(count);
+                std::atomic<std::size_t> sum{0};
+                pool.Run(count, [&](std::size_t i) {
+                    counters.Hit(i);
+                    sum.fetch_add(i, std::memory_order_relaxed);
+                });
+                // После возврата Run все задачи задания завершены
+                if (sum.load() != count * (count - 1) / 2)
+                {
+                    ++failures;
+                }
+                counters.ExpectEach(1);
+            }
+        });
+    }
+    for (auto& thread : callers)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(failures.load(), 0);
+}
+
+TEST(WorkStealingPoolTest, NestedRunCompletes)
+{
+    // Задача, вызывающая Run, выполняет вложенные задачи сама или ждет их,
+    // не блокируя пул
+    WorkStealingPool pool(2);
+    constexpr std::size_t kOuter = 16;
+    constexpr std::size_t kInner = 64;
+    Counters counters(kOuter * kInner);
+    pool.Run(kOuter, [&](std::size_t outer) {
+        pool.Run(kInner, [&](std::size_t inner) { counters.Hit(outer * kInner + inner); });
+    });
+    counters.ExpectEach(1);
+}
+
+TEST(WorkStealingPoolTest, ExceptionReachesCallerAfterAllTasks)
+{
+    WorkStealingPool pool(3);
+    constexpr std::size_t kCount = 200;
+    Counters counters(kCount);
+    EXPECT_THROW(pool.Run(kCount,
+                          [&](std::size_t i) {
+                              counters.Hit(i);
+                              if (i % 50 == 7)
+                              {
+                                  throw std::runtime_error("задача " + std::to_string(i));
+                              }
+                          }),
+                 std::runtime_error);
+    counters.ExpectEach(1);
+
+    // Пул остается рабочим после ошибки
+    Counters next(kCount);
+    pool.Run(kCount, [&](std::size_t i) { next.Hit(i); });
+    next.ExpectEach(1);
+}
+
+TEST(WorkStealingPoolTest, DestroyedRightAfterRuns)
+{
+    // Потоки, только что проснувшиеся на задачи, завершаются в деструкторе
+    for (int attempt = 0; attempt < 50; ++attempt)
+    {
+        WorkStealingPool pool(3);
+        std::atomic<std::size_t> done{0};
+        pool.Run(7, [&](std::size_t) { ++done; });
+        EXPECT_EQ(done.load(), 7u);
+    }
+}
@@ -0,0 +1,134 @@
+#include "TestDatabase.h"
+
+#include <db/ConnectionPool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace db;
+
+namespace
+{
+
+ConnectionPool::Options SmallPool(std::size_t maxSize)
+{
+    ConnectionPool::Options options;
+    options.minSize = 1;
+    options.maxSize = maxSize;
+    options.acquireTimeout = std::chrono::milliseconds(100);
+    return options;
+}
+
+class ConnectionPoolTest : public DatabaseTest
+{
+};
+
+} // namespace
+
+TEST(ConnectionPoolOfflineTest, UnreachableServerFailsOnCreation)
+{
+    // Первое подключение открывается в конструкторе
+    EXPECT_THROW((void)std::make_shared<ConnectionPool>("host=127.0.0.1 port=1 connect_timeout=1", SmallPool(2)),
+                 Exception);
+}
+
+TEST_F(ConnectionPoolTest, LeaseReturnsConnectionOnDestruction)
+{
+    auto pool = std::make_shared<ConnectionPool>(GetConnInfo(), SmallPool(2));
+    EXPECT_EQ(pool->GetSize(), 1u);
+    EXPECT_EQ(pool->GetIdleCount(), 1u);
+
+    PGconn* first = nullptr;
+    {
+        auto lease = pool->Acquire();
+        ASSERT_TRUE(lease);
+        EXPECT_TRUE(lease->IsHealthy());
+        first = lease->Get();
+        EXPECT_EQ(pool->GetIdleCount(), 0u);
+    }
+    EXPECT_EQ(pool->GetIdleCount(), 1u);
+
+    // Последнее возвращенное подключение выдается первым
+    auto lease = pool->Acquire();
+    EXPECT_EQ(lease->Get(), first);
+    lease.Release();
+    EXPECT_FALSE(lease);
+    EXPECT_EQ(pool->GetIdleCount(), 1u);
+}
+
+TEST_F(ConnectionPoolTest, AcquireTimesOutAtMaxSize)
+{
+    auto pool = std::make_shared<ConnectionPool>(GetConnInfo(), SmallPool(2));
+    auto first = pool->Acquire();
+    auto second = pool->Acquire();
+    EXPECT_EQ(pool->GetSize(), 2u);
+    EXPECT_THROW(pool->Acquire(), Exception);
+
+    second.Release();
+    EXPECT_NO_THROW(pool->Acquire());
+}
+
+TEST_F(ConnectionPoolTest, OpenTransactionIsRolledBackOnReturn)
+{
+    auto pool = std::make_shared<ConnectionPool>(GetConnInfo(), SmallPool(1));
+    {
+        auto lease = pool->Acquire();
+        PQclear(PQexec(lease->Get(), "BEGIN"));
+        EXPECT_EQ(PQtransactionStatus(lease->Get()), PQTRANS_INTRANS);
+    }
+    auto lease = pool->Acquire();
+    EXPECT_EQ(PQtransactionStatus(lease->Get()), PQTRANS_IDLE);
+}
+
+TEST_F(ConnectionPoolTest, ClosedPoolClosesReturnedConnections)
+{
+    auto pool = std::make_shared<ConnectionPool>(GetConnInfo(), SmallPool(2));
+    auto lease = pool->Acquire();
+    pool->Close();
+    EXPECT_FALSE(pool->IsOpen());
+    EXPECT_THROW(pool->Acquire(), Exception);
+    EXPECT_EQ(pool->GetSize(), 1u);
+
+    lease.Release();
+    EXPECT_EQ(pool->GetSize(), 0u);
+    EXPECT_EQ(pool->GetIdleCount(), 0u);
+}
+
+TEST_F(ConnectionPoolTest, ConcurrentAcquireStaysWithinMaxSize)
+{
+    auto options = SmallPool(3);
+    options.acquireTimeout = std::chrono::seconds(10);
+    auto pool = std::make_shared<ConnectionPool>(GetConnInfo(), options);
+
+    std::atomic<std::size_t> active{0};
+    std::atomic<std::size_t> peak{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t)
+    {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 50; ++i)
+            {
+                auto lease = pool->Acquire();
+                std::size_t now = ++active;
+                std::size_t seen = peak.load();
+                while (now > seen && !peak.compare_exchange_weak(seen, now))
+                {
+                }
+                PQclear(PQexec(lease->Get(), "SELECT 1"));
+                --active;
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_LE(peak.load(), 3u);
+    EXPECT_LE(pool->GetSize(), 3u);
+    EXPECT_EQ(pool->GetIdleCount(), pool->GetSize());
+}
@@ -0,0 +1,139 @@
+#include "TestDatabase.h"
+
+#include <db/DbApi.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace db;
+
+namespace
+{
+
+class PagingTest : public DatabaseTest
+{
+protected:
+    void SetUp() override
+    {
+        DatabaseTest::SetUp();
+        if (IsSkipped())
+        {
+            return;
+        }
+        database_ = std::make_shared<DatabaseManager>();
+        ASSERT_TRUE(database_->Connect(params_)) << database_->GetLastError();
+        api_ = std::make_unique<DbApi>(database_);
+        api_->InitializeSchema();
+
+        // Тестовые строки откатываются вместе с транзакцией в TearDown
+        transaction_ = std::make_unique<Transaction>(*database_);
+    }
+
+    void TearDown() override
+    {
+        transaction_.reset();
+    }
+
+    // Все страницы исполнителей подряд; проверяет размер каждой страницы
+    std::vector<ExecutorInfo> ReadAllPages(int pageSize, const ExecutorFilter& filter = {})
+    {
+        std::vector<ExecutorInfo> rows;
+        std::optional<PageCursor> cursor;
+        do
+        {
+            auto page = api_->GetExecutorsPage(pageSize, cursor, filter);
+            EXPECT_LE(page.items.size(), static_cast<std::size_t>(pageSize));
+            if (page.next)
+            {
+                EXPECT_EQ(page.items.size(), static_cast<std::size_t>(pageSize));
+                EXPECT_EQ(page.next->id, page.items.back().id);
+                EXPECT_EQ(page.next->key, page.items.back().name);
+            }
+            rows.insert(rows.end(), page.items.begin(), page.items.end());
+            cursor = page.next;
+        } while (cursor);
+        return rows;
+    }
+
+    std::shared_ptr<DatabaseManager> database_;
+    std::unique_ptr<DbApi> api_;
+    std::unique_ptr<Transaction> transaction_;
+};
+
+std::multiset<int> Ids(const std::vector<ExecutorInfo>& rows)
+{
+    std::multiset<int> ids;
+    for (const auto& row : rows)
+    {
+        ids.insert(row.id);
+    }
+    return ids;
+}
+
+} // namespace
+
+TEST(PagingOfflineTest, PageSizeMustBePositive)
+{
+    DbApi api(std::make_shared<DatabaseManager>());
+    EXPECT_THROW(api.GetExecutorsPage(0), Exception);
+    EXPECT_THROW(api.GetTariffsPage(-1), Exception);
+    EXPECT_THROW(api.GetOrdersPage(0), Exception);
+}
+
+TEST_F(PagingTest, PagesCoverEveryExecutorOnce)
+{
+    // Одинаковые имена: порядок внутри них задает ID
+    std::vector<int> created;
+    for (int i = 0; i < 7; ++i)
+    {
+        std::string name = i < 3 ? "Тест страниц А" : "Тест страниц Б";
+        created.push_back(api_->CreateExecutor("PAGING_TEST_" + std::to_string(i), name));
+    }
+
+    auto all = api_->GetAllExecutors();
+    for (int pageSize : {1, 3, 7, 100})
+    {
+        auto rows = ReadAllPages(pageSize);
+        EXPECT_EQ(Ids(rows), Ids(all)) << "pageSize = " << pageSize;
+
+        std::vector<int> order;
+        for (const auto& row : rows)
+        {
+            if (std::find(created.begin(), created.end(), row.id) != created.end())
+            {
+                order.push_back(row.id);
+            }
+        }
+        EXPECT_EQ(order, created) << "pageSize = " << pageSize;
+    }
+}
+
+TEST_F(PagingTest, FilterAppliesToEveryPage)
+{
+    for (int i = 0; i < 5; ++i)
+    {
+        api_->CreateExecutor("PAGING_TEST_" + std::to_string(i), "Тест фильтра", "", "", "", i % 2 == 0);
+    }
+
+    std::map<bool, std::multiset<int>> expected;
+    for (const auto& row : api_->GetAllExecutors())
+    {
+        expected[row.isActive].insert(row.id);
+    }
+
+    for (bool isActive : {true, false})
+    {
+        ExecutorFilter filter;
+        filter.isActive = isActive;
+        auto rows = ReadAllPages(2, filter);
+        for (const auto& row : rows)
+        {
+            EXPECT_EQ(row.isActive, isActive);
+        }
+        EXPECT_EQ(Ids(rows), expected[isActive]);
+    }
+}
@@ -0,0 +1,117 @@
+#include <db/Database.h>
+#include <db/QueryParams.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+
+using namespace db;
+using detail::BoundParams;
+
+namespace
+{
+
+// Байты значения параметра
+std::string Bytes(const char* data, int length)
+{
+    return std::string(data, static_cast<std::size_t>(length));
+}
+
+} // namespace
+
+TEST(QueryParamsTest, NumbersAreBigEndian)
+{
+    BoundParams<int, std::int64_t, double, bool> params(0x01020304, -2, 1.5, true);
+    ASSERT_EQ(params.kCount, 4);
+
+    EXPECT_EQ(params.GetTypes()[0], 23u);
+    EXPECT_EQ(params.GetTypes()[1], 20u);
+    EXPECT_EQ(params.GetTypes()[2], 701u);
+    EXPECT_EQ(params.GetTypes()[3], 16u);
+
+    EXPECT_EQ(Bytes(params.GetValues()[0], params.GetLengths()[0]), std::string("\x01\x02\x03\x04", 4));
+    EXPECT_EQ(Bytes(params.GetValues()[1], params.GetLengths()[1]), std::string(7, '\xff') + '\xfe');
+    // 1.5 = 0x3FF8000000000000
+    EXPECT_EQ(Bytes(params.GetValues()[2], params.GetLengths()[2]), std::string("\x3f\xf8", 2) + std::string(6, '\0'));
+    EXPECT_EQ(Bytes(params.GetValues()[3], params.GetLengths()[3]), std::string(1, '\x01'));
+
+    for (int i = 0; i < params.kCount; ++i)
+    {
+        EXPECT_EQ(params.GetFormats()[i], 1);
+    }
+}
+
+TEST(QueryParamsTest, DatesCountDaysFrom2000)
+{
+    using namespace std::chrono;
+    BoundParams<year_month_day, year_month_day, year_month_day> params(
+        year{2000} / 1 / 1, year{2000} / 1 / 2, year{1999} / 12 / 31);
+
+    EXPECT_EQ(params.GetTypes()[0], 1082u);
+    EXPECT_EQ(Bytes(params.GetValues()[0], params.GetLengths()[0]), std::string(4, '\0'));
+    EXPECT_EQ(Bytes(params.GetValues()[1], params.GetLengths()[1]), std::string("\0\0\0\x01", 4));
+    EXPECT_EQ(Bytes(params.GetValues()[2], params.GetLengths()[2]), std::string(4, '\xff'));
+}
+
+TEST(QueryParamsTest, StringsAreNotCopied)
+{
+    std::string text = "строка";
+    std::string_view view = "вид";
+    const char* pointer = "указатель";
+    BoundParams<std::string, std::string_view, const char*, char[5]> params(text, view, pointer, "abcd");
+
+    for (int i = 0; i < params.kCount; ++i)
+    {
+        EXPECT_EQ(params.GetTypes()[i], 25u);
+    }
+    EXPECT_EQ(params.GetValues()[0], text.data());
+    EXPECT_EQ(params.GetLengths()[0], static_cast<int>(text.size()));
+    EXPECT_EQ(params.GetValues()[1], view.data());
+    EXPECT_EQ(params.GetValues()[2], pointer);
+    EXPECT_EQ(params.GetLengths()[2], static_cast<int>(std::strlen(pointer)));
+    EXPECT_EQ(Bytes(params.GetValues()[3], params.GetLengths()[3]), "abcd"); // Без завершающего нуля
+
+    // Пустая строка - значение, а не NULL
+    BoundParams<std::string> empty(std::string{});
+    EXPECT_NE(empty.GetValues()[0], nullptr);
+    EXPECT_EQ(empty.GetLengths()[0], 0);
+}
+
+TEST(QueryParamsTest, NullValues)
+{
+    const char* missing = nullptr;
+    BoundParams<std::optional<int>, std::optional<double>, std::nullopt_t, const char*, std::optional<int>> params(
+        std::nullopt, std::nullopt, std::nullopt, missing, 7);
+
+    EXPECT_EQ(params.GetTypes()[0], 23u);
+    EXPECT_EQ(params.GetTypes()[1], 701u);
+    EXPECT_EQ(params.GetTypes()[2], 0u); // Тип выводит сервер
+    EXPECT_EQ(params.GetTypes()[3], 25u);
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_EQ(params.GetValues()[i], nullptr) << i;
+        EXPECT_EQ(params.GetLengths()[i], 0) << i;
+    }
+    EXPECT_EQ(Bytes(params.GetValues()[4], params.GetLengths()[4]), std::string("\0\0\0\x07", 4));
+}
+
+TEST(QueryParamsTest, StatementBindCopiesValues)
+{
+    std::optional<std::string_view> none;
+    auto statement = [&] {
+        std::string text = "NULL"; // Строка "NULL" в типизированном операторе - обычное значение
+        return DatabaseManager::Statement::Bind("SELECT $1, $2, $3", 5, text, none);
+    }();
+
+    ASSERT_EQ(statement.params.size(), 3u);
+    EXPECT_EQ(statement.types, (std::vector<Oid>{23, 25, 25}));
+    EXPECT_EQ(statement.nulls, (std::vector<bool>{false, false, true}));
+    EXPECT_EQ(statement.params[0], std::string("\0\0\0\x05", 4));
+    EXPECT_EQ(statement.params[1], "NULL");
+    EXPECT_TRUE(statement.params[2].empty());
+}
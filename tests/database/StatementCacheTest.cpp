@@ -0,0 +1,104 @@
+#include "TestDatabase.h"
+
+#include <db/StatementCache.h>
+
+#include <memory>
+#include <string>
+
+using namespace db;
+
+namespace
+{
+
+class StatementCacheTest : public DatabaseTest
+{
+protected:
+    void SetUp() override
+    {
+        DatabaseTest::SetUp();
+        if (IsSkipped())
+        {
+            return;
+        }
+        conn_.reset(PQconnectdb(GetConnInfo().c_str()));
+        ASSERT_EQ(PQstatus(conn_.get()), CONNECTION_OK) << PQerrorMessage(conn_.get());
+    }
+
+    // Выполнение через кэш без параметров; true - успех
+    bool Run(StatementCache& cache, const std::string& query)
+    {
+        PGresult* result = cache.Execute(conn_.get(), query, 0, nullptr, nullptr, nullptr, nullptr, 0);
+        auto status = PQresultStatus(result);
+        PQclear(result);
+        return status == PGRES_TUPLES_OK || status == PGRES_COMMAND_OK;
+    }
+
+    // Операторы, подготовленные на сервере для подключения
+    int CountPrepared()
+    {
+        PGresult* result = PQexec(conn_.get(), "SELECT count(*) FROM pg_prepared_statements");
+        int count = std::stoi(PQgetvalue(result, 0, 0));
+        PQclear(result);
+        return count;
+    }
+
+    std::unique_ptr<PGconn, decltype(&PQfinish)> conn_{nullptr, &PQfinish};
+};
+
+} // namespace
+
+TEST_F(StatementCacheTest, EvictsLeastRecentlyUsedStatement)
+{
+    StatementCache cache(2);
+    ASSERT_TRUE(Run(cache, "SELECT 1"));
+    ASSERT_TRUE(Run(cache, "SELECT 2"));
+    ASSERT_TRUE(Run(cache, "SELECT 1")); // SELECT 2 становится самым старым
+    ASSERT_TRUE(Run(cache, "SELECT 3"));
+
+    EXPECT_EQ(cache.GetSize(), 2u);
+    EXPECT_EQ(CountPrepared(), 2); // Вытесненный оператор удален на сервере
+
+    ASSERT_TRUE(Run(cache, "SELECT 2"));
+    EXPECT_EQ(cache.GetSize(), 2u);
+    EXPECT_EQ(CountPrepared(), 2);
+}
+
+TEST_F(StatementCacheTest, ParameterTypesArePartOfTheKey)
+{
+    StatementCache cache(8);
+    const char* values[] = {"1"};
+    Oid int4[] = {23};
+    Oid int8[] = {20};
+    PQclear(cache.Execute(conn_.get(), "SELECT $1", 1, int4, values, nullptr, nullptr, 0));
+    PQclear(cache.Execute(conn_.get(), "SELECT $1", 1, int8, values, nullptr, nullptr, 0));
+    PQclear(cache.Execute(conn_.get(), "SELECT $1", 1, int4, values, nullptr, nullptr, 0));
+    EXPECT_EQ(cache.GetSize(), 2u);
+}
+
+TEST_F(StatementCacheTest, FailedPreparationIsNotCached)
+{
+    StatementCache cache(4);
+    EXPECT_FALSE(Run(cache, "SELEC 1"));
+    EXPECT_EQ(cache.GetSize(), 0u);
+    EXPECT_TRUE(Run(cache, "SELECT 1"));
+    EXPECT_EQ(cache.GetSize(), 1u);
+}
+
+TEST_F(StatementCacheTest, RepreparesStatementDroppedOnServer)
+{
+    StatementCache cache(4);
+    ASSERT_TRUE(Run(cache, "SELECT 1"));
+    PQclear(PQexec(conn_.get(), "DEALLOCATE ALL"));
+
+    // Вне транзакции оператор готовится заново и запрос повторяется
+    EXPECT_TRUE(Run(cache, "SELECT 1"));
+    EXPECT_EQ(CountPrepared(), 1);
+}
+
+TEST_F(StatementCacheTest, ZeroCapacityDisablesPreparation)
+{
+    StatementCache cache(0);
+    EXPECT_TRUE(Run(cache, "SELECT 1"));
+    EXPECT_EQ(cache.GetSize(), 0u);
+    EXPECT_EQ(CountPrepared(), 0);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <db/Database.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <optional>
+#include <string>
+
+// Параметры тестовой БД из переменных окружения DB_HOST, DB_PORT, DB_NAME,
+// DB_USER и DB_PASSWORD; без DB_HOST тесты, которым нужен сервер, пропускаются
+inline std::optional<db::DatabaseManager::ConnectionParams> GetTestDatabase()
+{
+    const char* host = std::getenv("DB_HOST");
+    if (!host || !*host)
+    {
+        return std::nullopt;
+    }
+
+    db::DatabaseManager::ConnectionParams params;
+    params.host = host;
+    auto read = [](const char* name, std::string& value) {
+        if (const char* env = std::getenv(name); env && *env)
+        {
+            value = env;
+        }
+    };
+    read("DB_PORT", params.port);
+    read("DB_NAME", params.database);
+    read("DB_USER", params.user);
+    read("DB_PASSWORD", params.password);
+    return params;
+}
+
+// Тест, которому нужен сервер PostgreSQL
+class DatabaseTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        auto params = GetTestDatabase();
+        if (!params)
+        {
+            GTEST_SKIP() << "DB_HOST не задан";
+        }
+        params_ = *params;
+    }
+
+    std::string GetConnInfo() const
+    {
+        return params_.ToConnInfo();
+    }
+
+    db::DatabaseManager::ConnectionParams params_;
+};